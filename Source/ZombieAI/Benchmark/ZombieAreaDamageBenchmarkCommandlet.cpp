@@ -0,0 +1,219 @@
+#include "ZombieAreaDamageBenchmarkCommandlet.h"
+#include "../Zombie/ZombieAreaDamageSubsystem.h"
+#include "../Zombie/ZombieCharacter.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogZombieAreaDamageBenchmark, Log, All);
+
+// The height above the horde's center that blasts go off at, about the middle of a zombie.
+static const float BenchmarkBlastHeight = 100.f;
+
+/**
+ * Sets default values for this commandlet's properties.
+ */
+UZombieAreaDamageBenchmarkCommandlet::UZombieAreaDamageBenchmarkCommandlet()
+{
+	// Nothing should walk or shoot through the horde while it's being blasted.
+	NumBots = 0;
+}
+
+/**
+ * Runs the benchmark.
+ */
+int32 UZombieAreaDamageBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString MapName = TEXT("/Game/Levels/MainLevel");
+	FParse::Value(*Params, TEXT("Map="), MapName);
+
+	FString ZombieCounts = TEXT("100,1000,10000");
+	FParse::Value(*Params, TEXT("Zombies="), ZombieCounts, false);
+
+	FParse::Value(*Params, TEXT("Blasts="), NumBlasts);
+	FParse::Value(*Params, TEXT("WarmupTicks="), NumWarmupTicks);
+	FParse::Value(*Params, TEXT("Radius="), BlastRadius);
+	FParse::Value(*Params, TEXT("ConeAngle="), BlastConeHalfAngleDegrees);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("SpawnRadius="), SpawnRadius);
+
+	OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmark") / TEXT("ZombieAreaDamage");
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	if (NumBlasts <= 0 || BlastRadius <= 0.f)
+	{
+		UE_LOG(LogZombieAreaDamageBenchmark, Error, TEXT("-Blasts and -Radius have to be greater than 0."));
+		return 1;
+	}
+
+	TArray<FString> CountStrings;
+	ZombieCounts.ParseIntoArray(CountStrings, TEXT(","));
+
+	UWorld* World = LoadWorld(MapName);
+	if (World == nullptr)
+	{
+		UE_LOG(LogZombieAreaDamageBenchmark, Error, TEXT("Couldn't load the map %s."), *MapName);
+		return 1;
+	}
+
+	TArray<FZombieAreaDamageBenchmarkResult> Results;
+	for (const FString& CountString : CountStrings)
+	{
+		const int32 NumZombies = FCString::Atoi(*CountString);
+		if (NumZombies <= 0) continue;
+
+		const FZombieAreaDamageBenchmarkResult& Result = Results.Add_GetRef(RunBlasts(World, NumZombies));
+		UE_LOG(LogZombieAreaDamageBenchmark, Display, TEXT("%d zombies: %.4f ms overlap, %.4f ms kernel per blast, %.4f ms gather, %.1f hits, %d mismatches."), Result.NumZombies, Result.OverlapMs, Result.KernelMs, Result.GatherMs, Result.AverageHits, Result.NumMismatches);
+	}
+
+	UnloadWorld(World);
+	WriteBlastResults(Results);
+
+	return 0;
+}
+
+/**
+ * Spawns the horde, lets it settle and times the blasts against it.
+ */
+FZombieAreaDamageBenchmarkResult UZombieAreaDamageBenchmarkCommandlet::RunBlasts(UWorld* World, int32 NumZombies)
+{
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+
+	SpawnHorde(World, NumZombies);
+
+	// Let the zombies fall onto the navmesh and the physics scene catch up with them.
+	for (int32 TickIndex = 0; TickIndex < NumWarmupTicks; ++TickIndex)
+	{
+		TickWorld(World);
+	}
+
+	FZombieAreaDamageBenchmarkResult Result;
+	Result.NumZombies = Zombies.Num();
+	Result.NumBlasts = NumBlasts;
+
+	UZombieAreaDamageSubsystem* AreaDamage = World->GetSubsystem<UZombieAreaDamageSubsystem>();
+	if (AreaDamage == nullptr)
+	{
+		ClearHorde(World);
+		return Result;
+	}
+
+	// Both ways blast the same areas.
+	FRandomStream RandomStream(Seed);
+	TArray<FZombieAreaDamage> Areas;
+	Areas.Reserve(NumBlasts);
+	for (int32 BlastIndex = 0; BlastIndex < NumBlasts; ++BlastIndex)
+	{
+		FZombieAreaDamage& Area = Areas.AddDefaulted_GetRef();
+		const FVector2D Offset = FVector2D(RandomStream.FRandRange(-1.f, 1.f), RandomStream.FRandRange(-1.f, 1.f)) * SpawnRadius;
+		Area.Origin = Center + FVector(Offset, BenchmarkBlastHeight);
+		Area.Direction = FRotator(0.f, RandomStream.FRandRange(0.f, 360.f), 0.f).Vector();
+		Area.Radius = BlastRadius;
+		Area.ConeHalfAngleDegrees = BlastConeHalfAngleDegrees;
+	}
+
+	TArray<int32> OverlapHits;
+	OverlapHits.Reserve(NumBlasts);
+
+	double StartSeconds = FPlatformTime::Seconds();
+	for (const FZombieAreaDamage& Area : Areas)
+	{
+		OverlapHits.Add(OverlapArea(World, Area));
+	}
+	Result.OverlapMs = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / NumBlasts;
+
+	StartSeconds = FPlatformTime::Seconds();
+	AreaDamage->GatherLocations();
+	Result.GatherMs = (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+
+	TArray<FZombieHandle> Handles;
+	TArray<float> Damage;
+	int64 TotalHits = 0;
+
+	StartSeconds = FPlatformTime::Seconds();
+	for (int32 BlastIndex = 0; BlastIndex < NumBlasts; ++BlastIndex)
+	{
+		const int32 NumHits = AreaDamage->FindZombiesInArea(Areas[BlastIndex], Handles, Damage);
+		TotalHits += NumHits;
+
+		if (NumHits != OverlapHits[BlastIndex]) Result.NumMismatches++;
+	}
+	Result.KernelMs = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / NumBlasts;
+	Result.AverageHits = (double)TotalHits / NumBlasts;
+
+	ClearHorde(World);
+
+	return Result;
+}
+
+/**
+ * Finds the zombies in the area with a physics overlap, the way it would be done without the
+ * ZombieAreaDamageSubsystem.
+ *
+ * @return The number of zombies in the area.
+ */
+int32 UZombieAreaDamageBenchmarkCommandlet::OverlapArea(UWorld* World, const FZombieAreaDamage& Area)
+{
+	// Zombie capsules are Pawns unless steering gave them their own channel.
+	FCollisionObjectQueryParams ObjectQueryParams;
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Zombie);
+
+	TArray<FOverlapResult> Overlaps;
+	World->OverlapMultiByObjectType(Overlaps, Area.Origin, FQuat::Identity, ObjectQueryParams, FCollisionShape::MakeSphere(Area.Radius), FCollisionQueryParams(SCENE_QUERY_STAT(ZombieAreaDamageBenchmark), false));
+
+	const FVector Direction = Area.Direction.GetSafeNormal();
+	const float ConeCos = (Area.ConeHalfAngleDegrees >= 180.f) ? -2.f : FMath::Cos(FMath::DegreesToRadians(Area.ConeHalfAngleDegrees));
+
+	// The overlap touches the edge of a zombie's capsule and a zombie can have several
+	// components, so the zombies are counted once each by their location like the kernel does.
+	OverlappedZombies.Reset();
+	int32 NumHits = 0;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		const AZombieCharacter* ZombieCharacter = Cast<AZombieCharacter>(Overlap.GetActor());
+		if (ZombieCharacter == nullptr || ZombieCharacter->GetState() == ZombieStates::DEAD) continue;
+
+		bool bAlreadyOverlapped = false;
+		OverlappedZombies.Add(ZombieCharacter, &bAlreadyOverlapped);
+		if (bAlreadyOverlapped) continue;
+
+		const FVector ToZombie = ZombieCharacter->GetActorLocation() - Area.Origin;
+		const float Distance = ToZombie.Size();
+		if (Distance > Area.Radius || FVector::DotProduct(ToZombie, Direction) < ConeCos * Distance) continue;
+
+		NumHits++;
+	}
+
+	return NumHits;
+}
+
+/**
+ * Writes the results to `OutputPath` as a CSV and a JSON file.
+ */
+void UZombieAreaDamageBenchmarkCommandlet::WriteBlastResults(const TArray<FZombieAreaDamageBenchmarkResult>& Results) const
+{
+	FString Csv = TEXT("Zombies,Blasts,AverageHits,OverlapMs,KernelMs,GatherMs,OverlapBlastsPerSecond,KernelBlastsPerSecond,Mismatches\n");
+	FString Json = FString::Printf(TEXT("{\n\t\"seed\": %d,\n\t\"radius\": %f,\n\t\"coneAngle\": %f,\n\t\"results\": [\n"), Seed, BlastRadius, BlastConeHalfAngleDegrees);
+
+	for (int32 ResultIndex = 0; ResultIndex < Results.Num(); ++ResultIndex)
+	{
+		const FZombieAreaDamageBenchmarkResult& Result = Results[ResultIndex];
+		const double OverlapBlastsPerSecond = (Result.OverlapMs > 0.0) ? 1000.0 / Result.OverlapMs : 0.0;
+		const double KernelBlastsPerSecond = (Result.KernelMs > 0.0) ? 1000.0 / Result.KernelMs : 0.0;
+
+		Csv += FString::Printf(TEXT("%d,%d,%.2f,%.5f,%.5f,%.5f,%.1f,%.1f,%d\n"), Result.NumZombies, Result.NumBlasts, Result.AverageHits, Result.OverlapMs, Result.KernelMs, Result.GatherMs, OverlapBlastsPerSecond, KernelBlastsPerSecond, Result.NumMismatches);
+		Json += FString::Printf(TEXT("\t\t{ \"zombies\": %d, \"blasts\": %d, \"averageHits\": %.2f, \"overlapMs\": %.5f, \"kernelMs\": %.5f, \"gatherMs\": %.5f, \"overlapBlastsPerSecond\": %.1f, \"kernelBlastsPerSecond\": %.1f, \"mismatches\": %d }"), Result.NumZombies, Result.NumBlasts, Result.AverageHits, Result.OverlapMs, Result.KernelMs, Result.GatherMs, OverlapBlastsPerSecond, KernelBlastsPerSecond, Result.NumMismatches);
+		Json += (ResultIndex + 1 < Results.Num()) ? TEXT(",\n") : TEXT("\n");
+	}
+
+	Json += TEXT("\t]\n}\n");
+
+	const FString CsvPath = OutputPath + TEXT(".csv");
+	const FString JsonPath = OutputPath + TEXT(".json");
+	FFileHelper::SaveStringToFile(Csv, *CsvPath);
+	FFileHelper::SaveStringToFile(Json, *JsonPath);
+
+	UE_LOG(LogZombieAreaDamageBenchmark, Display, TEXT("Wrote the results to %s and %s."), *CsvPath, *JsonPath);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ZombieHordeBenchmarkCommandlet.h"
+#include "ZombieAreaDamageBenchmarkCommandlet.generated.h"
+
+/**
+ * The results of blasting one horde size.
+ */
+struct FZombieAreaDamageBenchmarkResult
+{
+	// The number of zombies that were spawned and the number of blasts that were timed.
+	int32 NumZombies = 0;
+	int32 NumBlasts = 0;
+
+	// The average number of zombies in each blast.
+	double AverageHits = 0.0;
+
+	// The average time of a blast found with a physics overlap, in milliseconds.
+	double OverlapMs = 0.0;
+
+	// The time it took to copy the zombie locations into the ZombieAreaDamageSubsystem, in
+	// milliseconds. It's paid once per frame no matter how many blasts there are.
+	double GatherMs = 0.0;
+
+	// The average time of a blast found with the ZombieAreaDamageSubsystem's kernel, in
+	// milliseconds.
+	double KernelMs = 0.0;
+
+	// The number of blasts where the overlap and the kernel didn't find the same zombies.
+	int32 NumMismatches = 0;
+};
+
+/**
+ * The ZombieAreaDamageBenchmarkCommandlet compares two ways of finding the zombies in a
+ * grenade blast or a shotgun cone. It spawns hordes of different sizes like the
+ * ZombieHordeBenchmarkCommandlet and then times the same random blasts found with a physics
+ * sphere overlap that casts every overlapping component to a ZombieCharacter, and with the
+ * SIMD kernel of the ZombieAreaDamageSubsystem. No damage is done, so every blast sees the
+ * whole horde.
+ *
+ * Run it with:
+ *
+ *     UE4Editor-Cmd ZombieAI.uproject -run=ZombieAreaDamageBenchmark -nullrhi -unattended
+ *         [-Map=/Game/Levels/MainLevel] [-Zombies=100,1000,10000] [-Blasts=1000] [-WarmupTicks=60]
+ *         [-Radius=600] [-ConeAngle=180] [-Seed=1] [-SpawnRadius=5000] [-Output=Path/Without/Extension]
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieAreaDamageBenchmarkCommandlet : public UZombieHordeBenchmarkCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this commandlet's properties.
+	UZombieAreaDamageBenchmarkCommandlet();
+
+	/**
+	 * Runs the benchmark.
+	 */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/**
+	 * Spawns the horde, lets it settle and times the blasts against it.
+	 */
+	FZombieAreaDamageBenchmarkResult RunBlasts(UWorld* World, int32 NumZombies);
+
+	/**
+	 * Finds the zombies in the area with a physics overlap, the way it would be done without the
+	 * ZombieAreaDamageSubsystem.
+	 *
+	 * @return The number of zombies in the area.
+	 */
+	int32 OverlapArea(UWorld* World, const struct FZombieAreaDamage& Area);
+
+	/**
+	 * Writes the results to `OutputPath` as a CSV and a JSON file.
+	 */
+	void WriteBlastResults(const TArray<FZombieAreaDamageBenchmarkResult>& Results) const;
+
+protected:
+	// The number of blasts to time for each horde size.
+	int32 NumBlasts = 1000;
+
+	// The radius and the cone angle of every blast.
+	float BlastRadius = 600.f;
+	float BlastConeHalfAngleDegrees = 180.f;
+
+	// The zombies the overlap has already found in the blast being tested.
+	TSet<const AActor*> OverlappedZombies;
+};
@@ -0,0 +1,63 @@
+#include "ZombieBenchmarkTimings.h"
+
+bool FZombieBenchmarkTimings::bRecording = false;
+volatile int64 FZombieBenchmarkTimings::TotalCycles[(int32)ZombieBenchmarkTimers::NUM] = {};
+
+/**
+ * Clears the totals and starts adding up time.
+ */
+void FZombieBenchmarkTimings::StartRecording()
+{
+	for (int32 Index = 0; Index < (int32)ZombieBenchmarkTimers::NUM; ++Index)
+	{
+		FPlatformAtomics::InterlockedExchange(&TotalCycles[Index], 0);
+	}
+
+	bRecording = true;
+}
+
+/**
+ * Stops adding up time. The totals are kept until the next recording starts.
+ */
+void FZombieBenchmarkTimings::StopRecording()
+{
+	bRecording = false;
+}
+
+/**
+ * Adds time to the total of the group.
+ */
+void FZombieBenchmarkTimings::AddCycles(ZombieBenchmarkTimers Timer, int64 Cycles)
+{
+	FPlatformAtomics::InterlockedAdd(&TotalCycles[(int32)Timer], Cycles);
+}
+
+/**
+ * Returns the total time spent in the group since recording started, in milliseconds.
+ */
+double FZombieBenchmarkTimings::GetMilliseconds(ZombieBenchmarkTimers Timer)
+{
+	return FPlatformTime::ToMilliseconds64(TotalCycles[(int32)Timer]);
+}
+
+/**
+ * Returns the name the group is reported under.
+ */
+const TCHAR* FZombieBenchmarkTimings::GetName(ZombieBenchmarkTimers Timer)
+{
+	switch (Timer)
+	{
+	case ZombieBenchmarkTimers::PERCEPTION:
+		return TEXT("Perception");
+	case ZombieBenchmarkTimers::DECISION:
+		return TEXT("Decision");
+	case ZombieBenchmarkTimers::MOVEMENT:
+		return TEXT("Movement");
+	case ZombieBenchmarkTimers::ANIMATION:
+		return TEXT("Animation");
+	case ZombieBenchmarkTimers::BULLETS:
+		return TEXT("Bullets");
+	default:
+		return TEXT("Unknown");
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * The groups of work that the ZombieHordeBenchmarkCommandlet reports the time of.
+ */
+enum class ZombieBenchmarkTimers : uint8 {
+	PERCEPTION,
+	DECISION,
+	MOVEMENT,
+	ANIMATION,
+	BULLETS,
+	NUM,
+};
+
+/**
+ * Adds up the time spent in each group of work while a benchmark is recording. Scopes can be
+ * timed on any thread, so the totals are only ever added to atomically.
+ */
+struct ZOMBIEAI_API FZombieBenchmarkTimings
+{
+	/**
+	 * Clears the totals and starts adding up time.
+	 */
+	static void StartRecording();
+
+	/**
+	 * Stops adding up time. The totals are kept until the next recording starts.
+	 */
+	static void StopRecording();
+
+	/**
+	 * Returns whether time is being added up.
+	 */
+	static bool IsRecording() { return bRecording; }
+
+	/**
+	 * Adds time to the total of the group.
+	 */
+	static void AddCycles(ZombieBenchmarkTimers Timer, int64 Cycles);
+
+	/**
+	 * Returns the total time spent in the group since recording started, in milliseconds.
+	 */
+	static double GetMilliseconds(ZombieBenchmarkTimers Timer);
+
+	/**
+	 * Returns the name the group is reported under.
+	 */
+	static const TCHAR* GetName(ZombieBenchmarkTimers Timer);
+
+private:
+	// Whether time is being added up.
+	static bool bRecording;
+
+	// The total cycles spent in each group.
+	static volatile int64 TotalCycles[(int32)ZombieBenchmarkTimers::NUM];
+};
+
+/**
+ * Adds the time between its construction and destruction to a group while a benchmark is
+ * recording, and does nothing otherwise.
+ */
+struct FZombieBenchmarkScope
+{
+	FZombieBenchmarkScope(ZombieBenchmarkTimers InTimer)
+		: Timer(InTimer)
+		, StartCycles(FZombieBenchmarkTimings::IsRecording() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FZombieBenchmarkScope()
+	{
+		if (StartCycles != 0) FZombieBenchmarkTimings::AddCycles(Timer, FPlatformTime::Cycles64() - StartCycles);
+	}
+
+private:
+	// The group the time is added to.
+	ZombieBenchmarkTimers Timer;
+
+	// When the scope started, or 0 if nothing was recording.
+	uint64 StartCycles;
+};
@@ -0,0 +1,511 @@
+#include "ZombieHordeBenchmarkCommandlet.h"
+#include "../Player/PlayerCharacter.h"
+#include "../Player/BulletSimulationSubsystem.h"
+#include "../Zombie/ZombieCharacter.h"
+#include "../ZombieAIGameModeBase.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "NavigationSystem.h"
+#include "Perception/AISense_Sight.h"
+#include "../Zombie/ZombieCrowdSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogZombieHordeBenchmark, Log, All);
+
+// The height above the navmesh that zombies and bots are spawned at so their capsules don't
+// start inside the floor.
+static const float BenchmarkSpawnHeight = 100.f;
+
+// The number of seconds it takes a bot to walk once around its circle.
+static const float BenchmarkBotLapTime = 60.f;
+
+// The budget that every time sliced system gets, which is more than any tick takes. With a
+// budget that depends on how fast the machine is, a run would do different work each time.
+static const float BenchmarkUnlimitedBudgetMs = 1000000.f;
+
+// The console variables that are pinned so that a run with the same seed does the same work.
+// Asynchronous work is made synchronous since its results arrive whenever the workers finish.
+// They can still be changed with -CVars.
+static const TCHAR* BenchmarkPinnedConsoleVariables[] =
+{
+	TEXT("zombie.Think.BudgetMs=1000000"),
+	TEXT("zombie.RoamPoints.BudgetMs=1000000"),
+	TEXT("zombie.Sight.MaxTracesPerFrame=1000000"),
+	TEXT("zombie.LineOfSight.Async=0"),
+	TEXT("zombie.Paths.Async=0"),
+};
+
+/**
+ * Sets default values for this commandlet's properties.
+ */
+UZombieHordeBenchmarkCommandlet::UZombieHordeBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+/**
+ * Runs the benchmark.
+ */
+int32 UZombieHordeBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString MapName = TEXT("/Game/Levels/MainLevel");
+	FParse::Value(*Params, TEXT("Map="), MapName);
+
+	FString ZombieCounts = TEXT("100,1000,10000");
+	FParse::Value(*Params, TEXT("Zombies="), ZombieCounts, false);
+
+	FParse::Value(*Params, TEXT("Ticks="), NumTicks);
+	FParse::Value(*Params, TEXT("WarmupTicks="), NumWarmupTicks);
+	FParse::Value(*Params, TEXT("DeltaTime="), DeltaTime);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Bots="), NumBots);
+	FParse::Value(*Params, TEXT("SpawnRadius="), SpawnRadius);
+	// Nothing is rendered, so zombie animations are only updated if they're made to be. Without
+	// rendering hardware there's nothing else to measure them with, so always update them then.
+	bAlwaysTickAnimation = FParse::Param(*Params, TEXT("AlwaysTickAnimation")) || FParse::Param(FCommandLine::Get(), TEXT("nullrhi"));
+
+	OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmark") / TEXT("ZombieHorde");
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	if (NumTicks <= 0 || DeltaTime <= 0.f)
+	{
+		UE_LOG(LogZombieHordeBenchmark, Error, TEXT("-Ticks and -DeltaTime have to be greater than 0."));
+		return 1;
+	}
+
+	if (!bAlwaysTickAnimation)
+	{
+		UE_LOG(LogZombieHordeBenchmark, Warning, TEXT("Zombie animations aren't updated since nothing is rendered, so the animation times will be close to 0. Run with -AlwaysTickAnimation or -nullrhi to measure them."));
+	}
+
+	// Pin everything that would make runs with the same seed differ, then apply the console
+	// variables to benchmark with, for example to compare a feature on and off. All of it is
+	// put back however the benchmark returns.
+	FZombieBenchmarkSettingsGuard Settings;
+	PinBudgets(Settings);
+
+	FString CVars;
+	if (FParse::Value(*Params, TEXT("CVars="), CVars, false))
+	{
+		TArray<FString> Assignments;
+		CVars.ParseIntoArray(Assignments, TEXT(","));
+		for (const FString& Assignment : Assignments)
+		{
+			Settings.SetConsoleVariable(Assignment);
+		}
+	}
+
+	TArray<FString> CountStrings;
+	ZombieCounts.ParseIntoArray(CountStrings, TEXT(","));
+
+	UWorld* World = LoadWorld(MapName);
+	if (World == nullptr)
+	{
+		UE_LOG(LogZombieHordeBenchmark, Error, TEXT("Couldn't load the map %s."), *MapName);
+		return 1;
+	}
+
+	TArray<FZombieHordeBenchmarkResult> Results;
+	for (const FString& CountString : CountStrings)
+	{
+		const int32 NumZombies = FCString::Atoi(*CountString);
+		if (NumZombies <= 0) continue;
+
+		const FZombieHordeBenchmarkResult& Result = Results.Add_GetRef(RunHorde(World, NumZombies));
+		UE_LOG(LogZombieHordeBenchmark, Display, TEXT("%d zombies: %.3f ms average, %.3f ms max frame, checksum %08x."), Result.NumZombies, Result.AverageFrameMs, Result.MaxFrameMs, Result.Checksum);
+	}
+
+	UnloadWorld(World);
+	WriteResults(Results);
+
+	return 0;
+}
+
+/**
+ * Puts back everything that was changed.
+ */
+FZombieBenchmarkSettingsGuard::~FZombieBenchmarkSettingsGuard()
+{
+	// Go backwards so that something changed twice ends up with the value from before the first
+	// change.
+	for (int32 Index = SavedProperties.Num() - 1; Index >= 0; --Index)
+	{
+		const FSavedProperty& Saved = SavedProperties[Index];
+		UObject* Object = Saved.Object.Get();
+		if (Object == nullptr) continue;
+
+		void* Value = Saved.Property->ContainerPtrToValuePtr<void>(Object);
+		if (Saved.Property->IsFloatingPoint()) Saved.Property->SetFloatingPointPropertyValue(Value, Saved.Value);
+		else Saved.Property->SetIntPropertyValue(Value, (int64)Saved.Value);
+	}
+
+	// A console variable ignores values from anything with a lower priority than what set it
+	// last, so the old value is set with the benchmark's priority and then the old priority is
+	// put back.
+	for (int32 Index = SavedConsoleVariables.Num() - 1; Index >= 0; --Index)
+	{
+		const FSavedConsoleVariable& Saved = SavedConsoleVariables[Index];
+		Saved.ConsoleVariable->Set(*Saved.Value, ECVF_SetByCommandline);
+		Saved.ConsoleVariable->SetFlags((EConsoleVariableFlags)((Saved.ConsoleVariable->GetFlags() & ~ECVF_SetByMask) | Saved.SetBy));
+	}
+}
+
+/**
+ * Sets a console variable from a `Name=Value` assignment.
+ */
+void FZombieBenchmarkSettingsGuard::SetConsoleVariable(const FString& Assignment)
+{
+	FString Name;
+	FString Value;
+	if (!Assignment.Split(TEXT("="), &Name, &Value)) return;
+
+	IConsoleVariable* ConsoleVariable = IConsoleManager::Get().FindConsoleVariable(*Name);
+	if (ConsoleVariable == nullptr)
+	{
+		UE_LOG(LogZombieHordeBenchmark, Warning, TEXT("Unknown console variable %s."), *Name);
+		return;
+	}
+
+	SavedConsoleVariables.Add(FSavedConsoleVariable{ ConsoleVariable, ConsoleVariable->GetString(), (EConsoleVariableFlags)(ConsoleVariable->GetFlags() & ECVF_SetByMask) });
+	ConsoleVariable->Set(*Value, ECVF_SetByCommandline);
+}
+
+/**
+ * Sets a numeric property of a class's default object, whether it's public or not.
+ */
+void FZombieBenchmarkSettingsGuard::SetDefaultProperty(UClass* Class, const TCHAR* PropertyName, double Value)
+{
+	FNumericProperty* Property = FindFProperty<FNumericProperty>(Class, PropertyName);
+	if (Property == nullptr)
+	{
+		UE_LOG(LogZombieHordeBenchmark, Warning, TEXT("Unknown property %s of %s."), PropertyName, *Class->GetName());
+		return;
+	}
+
+	UObject* Defaults = Class->GetDefaultObject();
+	void* PropertyValue = Property->ContainerPtrToValuePtr<void>(Defaults);
+	const double OldValue = Property->IsFloatingPoint() ? Property->GetFloatingPointPropertyValue(PropertyValue) : (double)Property->GetSignedIntPropertyValue(PropertyValue);
+	SavedProperties.Add(FSavedProperty{ Defaults, Property, OldValue });
+
+	if (Property->IsFloatingPoint()) Property->SetFloatingPointPropertyValue(PropertyValue, Value);
+	else Property->SetIntPropertyValue(PropertyValue, (int64)Value);
+}
+
+/**
+ * Lifts the time budgets of the systems that the zombies use and makes their asynchronous
+ * work synchronous, so that they do the same work every run however fast the machine is.
+ */
+void UZombieHordeBenchmarkCommandlet::PinBudgets(FZombieBenchmarkSettingsGuard& Settings) const
+{
+	for (const TCHAR* Assignment : BenchmarkPinnedConsoleVariables)
+	{
+		Settings.SetConsoleVariable(Assignment);
+	}
+
+	// The sight sense of the zombies' perception components stops tracing when its time slice
+	// runs out. Its instances are copied from the defaults when the world's perception system
+	// starts, so this has to happen before the world is loaded. The properties aren't public so
+	// they're set through reflection.
+	Settings.SetDefaultProperty(UAISense_Sight::StaticClass(), TEXT("MaxTimeSlicePerTick"), BenchmarkUnlimitedBudgetMs / 1000.0);
+	Settings.SetDefaultProperty(UAISense_Sight::StaticClass(), TEXT("MaxTracesPerTick"), (double)MAX_int32);
+}
+
+/**
+ * Loads the map and starts play in it.
+ */
+UWorld* UZombieHordeBenchmarkCommandlet::LoadWorld(const FString& MapName)
+{
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = (Package != nullptr) ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (World == nullptr) return nullptr;
+
+	World->AddToRoot();
+	World->WorldType = EWorldType::Game;
+
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(true)
+			.CreateNavigation(true)
+			.CreateAISystem(true)
+			.ShouldSimulatePhysics(false)
+			.EnableTraceCollision(true));
+	}
+
+	World->SetGameMode(FURL());
+
+	// The benchmark spawns its own hordes, so the game mode mustn't add waves of its own.
+	AZombieAIGameModeBase* GameMode = Cast<AZombieAIGameModeBase>(World->GetAuthGameMode());
+	if (GameMode != nullptr)
+	{
+		GameMode->TimeBetweenWaves = 0.f;
+		GameMode->PrewarmCount = 0;
+		GameMode->SpawnBudgetMs = BenchmarkUnlimitedBudgetMs;
+	}
+
+	World->UpdateWorldComponents(true, false);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	// Spawn everything around the player start if the map has navmesh there, since that's
+	// where the zombies are meant to be.
+	AActor* PlayerStart = World->GetAuthGameMode() != nullptr ? World->GetAuthGameMode()->FindPlayerStart(nullptr) : nullptr;
+	Center = (PlayerStart != nullptr) ? PlayerStart->GetActorLocation() : FVector::ZeroVector;
+
+	return World;
+}
+
+/**
+ * Stops play in the world and tears it down.
+ */
+void UZombieHordeBenchmarkCommandlet::UnloadWorld(UWorld* World)
+{
+	World->EndPlay(EEndPlayReason::Quit);
+	World->DestroyWorld(false);
+	GEngine->DestroyWorldContext(World);
+	World->RemoveFromRoot();
+
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+/**
+ * Spawns the horde and the bots, ticks the world and returns how long it took.
+ */
+FZombieHordeBenchmarkResult UZombieHordeBenchmarkCommandlet::RunHorde(UWorld* World, int32 NumZombies)
+{
+	// Seed everything the same way for every horde so that runs can be compared.
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+
+	SpawnHorde(World, NumZombies);
+
+	FZombieHordeBenchmarkResult Result;
+	Result.NumZombies = Zombies.Num();
+	Result.NumTicks = NumTicks;
+
+	float Time = 0.f;
+	for (int32 TickIndex = 0; TickIndex < NumWarmupTicks; ++TickIndex)
+	{
+		UpdateBots(World, Time);
+		TickWorld(World);
+		Time += DeltaTime;
+	}
+
+	FZombieBenchmarkTimings::StartRecording();
+
+	double TotalSeconds = 0.0;
+	for (int32 TickIndex = 0; TickIndex < NumTicks; ++TickIndex)
+	{
+		UpdateBots(World, Time);
+
+		const double StartSeconds = FPlatformTime::Seconds();
+		TickWorld(World);
+		const double FrameSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+		TotalSeconds += FrameSeconds;
+		Result.MaxFrameMs = FMath::Max(Result.MaxFrameMs, FrameSeconds * 1000.0);
+		Time += DeltaTime;
+	}
+
+	FZombieBenchmarkTimings::StopRecording();
+
+	Result.AverageFrameMs = TotalSeconds * 1000.0 / NumTicks;
+	for (int32 Timer = 0; Timer < (int32)ZombieBenchmarkTimers::NUM; ++Timer)
+	{
+		Result.AverageTimerMs[Timer] = FZombieBenchmarkTimings::GetMilliseconds((ZombieBenchmarkTimers)Timer) / NumTicks;
+	}
+
+	Result.Checksum = ComputeChecksum(World);
+
+	ClearHorde(World);
+
+	return Result;
+}
+
+/**
+ * Spawns the bots at the center and the zombies on the navmesh around it.
+ */
+void UZombieHordeBenchmarkCommandlet::SpawnHorde(UWorld* World, int32 NumZombies)
+{
+	FRandomStream RandomStream(Seed);
+
+	// Seed the zombies' own random choices too, which they make from when they're taken over.
+	UZombieCrowdSubsystem* Crowd = World->GetSubsystem<UZombieCrowdSubsystem>();
+	if (Crowd != nullptr) Crowd->SetRandomSeed(Seed);
+
+	UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 BotIndex = 0; BotIndex < NumBots; ++BotIndex)
+	{
+		APlayerCharacter* Bot = World->SpawnActor<APlayerCharacter>(APlayerCharacter::StaticClass(), Center, FRotator::ZeroRotator, SpawnParams);
+		if (Bot != nullptr) Bots.Add(Bot);
+	}
+
+	Zombies.Reserve(NumZombies);
+	for (int32 ZombieIndex = 0; ZombieIndex < NumZombies; ++ZombieIndex)
+	{
+		const FVector2D Offset = FVector2D(RandomStream.FRandRange(-1.f, 1.f), RandomStream.FRandRange(-1.f, 1.f)) * SpawnRadius;
+		FVector Location = Center + FVector(Offset, 0.f);
+
+		FNavLocation NavLocation;
+		if (NavigationSystem != nullptr && NavigationSystem->ProjectPointToNavigation(Location, NavLocation, FVector(500.f, 500.f, 5000.f)))
+		{
+			Location = NavLocation.Location;
+		}
+
+		const FRotator Rotation(0.f, RandomStream.FRandRange(0.f, 360.f), 0.f);
+		AZombieCharacter* Zombie = World->SpawnActor<AZombieCharacter>(AZombieCharacter::StaticClass(), Location + FVector(0.f, 0.f, BenchmarkSpawnHeight), Rotation, SpawnParams);
+		if (Zombie == nullptr) continue;
+
+		// Nothing is rendered so zombie animations would never be updated otherwise.
+		if (bAlwaysTickAnimation && Zombie->ZombieSkeletalMesh != nullptr)
+		{
+			Zombie->ZombieSkeletalMesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+		}
+
+		Zombies.Add(Zombie);
+	}
+}
+
+/**
+ * Returns a checksum of the state, health and location of every zombie in the crowd. Runs with
+ * the same seed end up with the same checksum.
+ */
+uint32 UZombieHordeBenchmarkCommandlet::ComputeChecksum(UWorld* World) const
+{
+	UZombieCrowdSubsystem* Crowd = World->GetSubsystem<UZombieCrowdSubsystem>();
+	if (Crowd == nullptr) return 0;
+
+	uint32 Checksum = 0;
+	for (int32 Index = 0; Index < Crowd->GetNumSlots(); ++Index)
+	{
+		const AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		// Round the location to whole units so that the checksum doesn't depend on the last bits
+		// of the floating point math.
+		const FVector Location = ZombieCharacter->GetActorLocation();
+		const FIntVector RoundedLocation(FMath::RoundToInt(Location.X), FMath::RoundToInt(Location.Y), FMath::RoundToInt(Location.Z));
+
+		Checksum = HashCombine(Checksum, GetTypeHash(Index));
+		Checksum = HashCombine(Checksum, GetTypeHash((uint8)Crowd->GetStates()[Index]));
+		Checksum = HashCombine(Checksum, GetTypeHash(FMath::RoundToInt(Crowd->GetHealths()[Index])));
+		Checksum = HashCombine(Checksum, GetTypeHash(RoundedLocation));
+	}
+
+	return Checksum;
+}
+
+/**
+ * Destroys the bots and the zombies and lets the world settle before the next horde.
+ */
+void UZombieHordeBenchmarkCommandlet::ClearHorde(UWorld* World)
+{
+	for (AZombieCharacter* Zombie : Zombies)
+	{
+		if (Zombie == nullptr) continue;
+
+		AController* Controller = Zombie->GetController();
+		Zombie->Destroy();
+		if (Controller != nullptr) Controller->Destroy();
+	}
+
+	for (APlayerCharacter* Bot : Bots)
+	{
+		if (Bot != nullptr) Bot->Destroy();
+	}
+
+	Zombies.Empty();
+	Bots.Empty();
+
+	// Let the world settle before the next horde is spawned.
+	TickWorld(World);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+/**
+ * Ticks the world the way the engine does every frame. The world ticks the tickable objects in
+ * it, such as the zombie subsystems, itself.
+ */
+void UZombieHordeBenchmarkCommandlet::TickWorld(UWorld* World)
+{
+	World->Tick(LEVELTICK_All, DeltaTime);
+}
+
+/**
+ * Moves the bots along their circle and fires a bullet from each one towards the center.
+ */
+void UZombieHordeBenchmarkCommandlet::UpdateBots(UWorld* World, float Time)
+{
+	UBulletSimulationSubsystem* BulletSimulation = World->GetSubsystem<UBulletSimulationSubsystem>();
+
+	const float BotRadius = SpawnRadius * 0.5f;
+	for (int32 BotIndex = 0; BotIndex < Bots.Num(); ++BotIndex)
+	{
+		APlayerCharacter* Bot = Bots[BotIndex];
+		if (Bot == nullptr) continue;
+
+		// Spread the bots evenly around the circle.
+		const float Angle = 2.f * PI * (Time / BenchmarkBotLapTime + (float)BotIndex / Bots.Num());
+		const FVector Location = Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * BotRadius + FVector(0.f, 0.f, BenchmarkSpawnHeight);
+		const FVector Direction = (Center - Location).GetSafeNormal2D();
+
+		Bot->SetActorLocationAndRotation(Location, Direction.Rotation());
+		if (BulletSimulation != nullptr) BulletSimulation->FireBullet(Location, Direction, Bot->Damage, Bot);
+	}
+}
+
+/**
+ * Writes the results to `OutputPath` as a CSV and a JSON file.
+ */
+void UZombieHordeBenchmarkCommandlet::WriteResults(const TArray<FZombieHordeBenchmarkResult>& Results) const
+{
+	FString Csv = TEXT("Zombies,Ticks,AverageFrameMs,MaxFrameMs,Checksum");
+	for (int32 Timer = 0; Timer < (int32)ZombieBenchmarkTimers::NUM; ++Timer)
+	{
+		Csv += FString::Printf(TEXT(",%sMs"), FZombieBenchmarkTimings::GetName((ZombieBenchmarkTimers)Timer));
+	}
+	Csv += TEXT("\n");
+
+	FString Json = FString::Printf(TEXT("{\n\t\"seed\": %d,\n\t\"deltaTime\": %f,\n\t\"alwaysTickAnimation\": %s,\n\t\"results\": [\n"), Seed, DeltaTime, bAlwaysTickAnimation ? TEXT("true") : TEXT("false"));
+
+	for (int32 ResultIndex = 0; ResultIndex < Results.Num(); ++ResultIndex)
+	{
+		const FZombieHordeBenchmarkResult& Result = Results[ResultIndex];
+
+		Csv += FString::Printf(TEXT("%d,%d,%.4f,%.4f,%u"), Result.NumZombies, Result.NumTicks, Result.AverageFrameMs, Result.MaxFrameMs, Result.Checksum);
+		Json += FString::Printf(TEXT("\t\t{ \"zombies\": %d, \"ticks\": %d, \"averageFrameMs\": %.4f, \"maxFrameMs\": %.4f, \"checksum\": %u"), Result.NumZombies, Result.NumTicks, Result.AverageFrameMs, Result.MaxFrameMs, Result.Checksum);
+
+		for (int32 Timer = 0; Timer < (int32)ZombieBenchmarkTimers::NUM; ++Timer)
+		{
+			Csv += FString::Printf(TEXT(",%.4f"), Result.AverageTimerMs[Timer]);
+			Json += FString::Printf(TEXT(", \"%sMs\": %.4f"), FZombieBenchmarkTimings::GetName((ZombieBenchmarkTimers)Timer), Result.AverageTimerMs[Timer]);
+		}
+
+		Csv += TEXT("\n");
+		Json += (ResultIndex + 1 < Results.Num()) ? TEXT(" },\n") : TEXT(" }\n");
+	}
+
+	Json += TEXT("\t]\n}\n");
+
+	const FString CsvPath = OutputPath + TEXT(".csv");
+	const FString JsonPath = OutputPath + TEXT(".json");
+	FFileHelper::SaveStringToFile(Csv, *CsvPath);
+	FFileHelper::SaveStringToFile(Json, *JsonPath);
+
+	UE_LOG(LogZombieHordeBenchmark, Display, TEXT("Wrote the results to %s and %s."), *CsvPath, *JsonPath);
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ZombieBenchmarkTimings.h"
+#include "Commandlets/Commandlet.h"
+#include "HAL/IConsoleManager.h"
+#include "ZombieHordeBenchmarkCommandlet.generated.h"
+
+class APlayerCharacter;
+class AZombieCharacter;
+
+/**
+ * The results of running one horde size.
+ */
+struct FZombieHordeBenchmarkResult
+{
+	// The number of zombies that were spawned and the number of ticks that were timed.
+	int32 NumZombies = 0;
+	int32 NumTicks = 0;
+
+	// The average and longest time of a whole world tick, in milliseconds.
+	double AverageFrameMs = 0.0;
+	double MaxFrameMs = 0.0;
+
+	// The average time per tick spent in each group of work, in milliseconds.
+	double AverageTimerMs[(int32)ZombieBenchmarkTimers::NUM] = {};
+
+	// A checksum of the crowd at the end of the run, which is the same for runs with the same seed.
+	uint32 Checksum = 0;
+};
+
+/**
+ * Changes console variables and engine defaults for the length of a benchmark, and puts them back
+ * the way they were when it goes out of scope. A benchmark run by an automation test inside the
+ * editor would otherwise leave its settings behind for every later play session.
+ */
+class FZombieBenchmarkSettingsGuard
+{
+public:
+	FZombieBenchmarkSettingsGuard() = default;
+	UE_NONCOPYABLE(FZombieBenchmarkSettingsGuard);
+
+	/**
+	 * Puts back everything that was changed.
+	 */
+	~FZombieBenchmarkSettingsGuard();
+
+	/**
+	 * Sets a console variable from a `Name=Value` assignment.
+	 */
+	void SetConsoleVariable(const FString& Assignment);
+
+	/**
+	 * Sets a numeric property of a class's default object, whether it's public or not.
+	 */
+	void SetDefaultProperty(UClass* Class, const TCHAR* PropertyName, double Value);
+
+private:
+	// A console variable's value and what set it before the benchmark changed it.
+	struct FSavedConsoleVariable
+	{
+		IConsoleVariable* ConsoleVariable;
+		FString Value;
+		EConsoleVariableFlags SetBy;
+	};
+
+	// A default object's property value before the benchmark changed it.
+	struct FSavedProperty
+	{
+		TWeakObjectPtr<UObject> Object;
+		FNumericProperty* Property;
+		double Value;
+	};
+
+	// Everything that was changed, in the order it was first changed.
+	TArray<FSavedConsoleVariable> SavedConsoleVariables;
+	TArray<FSavedProperty> SavedProperties;
+};
+
+/**
+ * The ZombieHordeBenchmarkCommandlet measures how the zombies scale. It loads a map without
+ * rendering anything, spawns hordes of different sizes around bot players that walk in a circle
+ * and fire simulated bullets, ticks the world a fixed number of times with a fixed seed and
+ * writes the time spent in perception, decisions, movement, animation and bullets to a CSV and a
+ * JSON file, along with a checksum of the crowd at the end.
+ *
+ * Time budgets are lifted and asynchronous work is made synchronous, so that runs with the same
+ * seed do the same work and end with the same checksum. Everything is put back once it's done. Zombie animations are only updated with
+ * -AlwaysTickAnimation or -nullrhi, since nothing is rendered.
+ *
+ * Run it with:
+ *
+ *     UE4Editor-Cmd ZombieAI.uproject -run=ZombieHordeBenchmark -nullrhi -unattended
+ *         [-Map=/Game/Levels/MainLevel] [-Zombies=100,1000,10000] [-Ticks=600] [-WarmupTicks=60]
+ *         [-DeltaTime=0.0333] [-Seed=1] [-Bots=2] [-SpawnRadius=5000] [-Output=Path/Without/Extension]
+ *         [-CVars=zombie.Steering.Enabled=0,zombie.Movement.Simple=1] [-AlwaysTickAnimation]
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieHordeBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this commandlet's properties.
+	UZombieHordeBenchmarkCommandlet();
+
+	/**
+	 * Runs the benchmark.
+	 */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/**
+	 * Lifts the time budgets of the systems that the zombies use and makes their asynchronous
+	 * work synchronous, so that they do the same work every run however fast the machine is.
+	 */
+	void PinBudgets(FZombieBenchmarkSettingsGuard& Settings) const;
+
+	/**
+	 * Loads the map and starts play in it.
+	 */
+	UWorld* LoadWorld(const FString& MapName);
+
+	/**
+	 * Stops play in the world and tears it down.
+	 */
+	void UnloadWorld(UWorld* World);
+
+	/**
+	 * Spawns the horde and the bots, ticks the world and returns how long it took.
+	 */
+	FZombieHordeBenchmarkResult RunHorde(UWorld* World, int32 NumZombies);
+
+	/**
+	 * Spawns the bots at the center and the zombies on the navmesh around it.
+	 */
+	void SpawnHorde(UWorld* World, int32 NumZombies);
+
+	/**
+	 * Returns a checksum of the state, health and location of every zombie in the crowd. Runs with
+	 * the same seed end up with the same checksum.
+	 */
+	uint32 ComputeChecksum(UWorld* World) const;
+
+	/**
+	 * Destroys the bots and the zombies and lets the world settle before the next horde.
+	 */
+	void ClearHorde(UWorld* World);
+
+	/**
+	 * Ticks the world the way the engine does every frame. The world ticks the tickable objects in
+	 * it, such as the zombie subsystems, itself.
+	 */
+	void TickWorld(UWorld* World);
+
+	/**
+	 * Moves the bots along their circle and fires a bullet from each one towards the center.
+	 */
+	void UpdateBots(UWorld* World, float Time);
+
+	/**
+	 * Writes the results to `OutputPath` as a CSV and a JSON file.
+	 */
+	void WriteResults(const TArray<FZombieHordeBenchmarkResult>& Results) const;
+
+protected:
+	// The number of ticks to time and to run before timing starts.
+	int32 NumTicks = 600;
+	int32 NumWarmupTicks = 60;
+
+	// The fixed time step of every tick.
+	float DeltaTime = 1.f / 30.f;
+
+	// The seed the horde is spawned and the simulation is run with.
+	int32 Seed = 1;
+
+	// The number of bots and the radius around the center of the map that everything spawns in.
+	int32 NumBots = 2;
+	float SpawnRadius = 5000.f;
+
+	// Whether zombie animations are updated even though nothing is rendered.
+	bool bAlwaysTickAnimation = false;
+
+	// The path of the results without the file extension.
+	FString OutputPath;
+
+	// The center that the horde spawns around and the bots walk around.
+	FVector Center = FVector::ZeroVector;
+
+	// The bots and zombies of the horde being run.
+	UPROPERTY(Transient)
+	TArray<APlayerCharacter*> Bots;
+
+	UPROPERTY(Transient)
+	TArray<AZombieCharacter*> Zombies;
+};
@@ -0,0 +1,99 @@
+#include "ZombieHordeBenchmarkCommandlet.h"
+#include "ZombieBenchmarkTimings.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// The hordes the test runs. They're small so that the test finishes quickly, but big enough that
+// every group of work has zombies to do it for.
+static const int32 HordeTestZombieCounts[] = { 10, 50 };
+
+// The number of ticks each horde is run for.
+static const int32 HordeTestTicks = 30;
+
+// The number of times the hordes are run. Every run has to end with the same checksums.
+static const int32 HordeTestRuns = 2;
+
+/**
+ * Runs the ZombieHordeBenchmarkCommandlet on a couple of small hordes twice and checks that it
+ * writes a row of timings for each of them to the CSV and JSON files, and that both runs leave
+ * the crowd in the same state. Run it headless with:
+ *
+ *     UE4Editor-Cmd ZombieAI.uproject -nullrhi -unattended -ExecCmds="Automation RunTests ZombieAI.Benchmark.Horde; Quit"
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FZombieHordeBenchmarkTest, "ZombieAI.Benchmark.Horde", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FZombieHordeBenchmarkTest::RunTest(const FString& Parameters)
+{
+	FString ZombieCounts;
+	for (int32 Count : HordeTestZombieCounts)
+	{
+		ZombieCounts += FString::Printf(TEXT("%s%d"), ZombieCounts.IsEmpty() ? TEXT("") : TEXT(","), Count);
+	}
+
+	// Zombies, ticks, the average and the worst frame, the checksum, then every group of work.
+	const int32 NumColumns = 5 + (int32)ZombieBenchmarkTimers::NUM;
+
+	// The checksum of every horde in every run.
+	TArray<FString> Checksums[HordeTestRuns];
+
+	for (int32 Run = 0; Run < HordeTestRuns; ++Run)
+	{
+		const FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Automation") / FString::Printf(TEXT("ZombieHordeBenchmarkTest%d"), Run);
+		const FString CsvPath = OutputPath + TEXT(".csv");
+		const FString JsonPath = OutputPath + TEXT(".json");
+		IFileManager::Get().Delete(*CsvPath);
+		IFileManager::Get().Delete(*JsonPath);
+
+		UZombieHordeBenchmarkCommandlet* Commandlet = NewObject<UZombieHordeBenchmarkCommandlet>();
+		const FString Params = FString::Printf(TEXT("-Zombies=%s -Ticks=%d -WarmupTicks=5 -Seed=1 -Output=\"%s\""), *ZombieCounts, HordeTestTicks, *OutputPath);
+		if (!TestEqual(TEXT("The benchmark succeeds"), Commandlet->Main(Params), 0)) return false;
+
+		FString Csv;
+		if (!TestTrue(TEXT("The CSV file was written"), FFileHelper::LoadFileToString(Csv, *CsvPath))) return false;
+		TestTrue(TEXT("The JSON file was written"), FPaths::FileExists(JsonPath));
+
+		TArray<FString> Lines;
+		Csv.ParseIntoArrayLines(Lines);
+		if (!TestEqual(TEXT("There's a header and a row for every horde"), Lines.Num(), (int32)UE_ARRAY_COUNT(HordeTestZombieCounts) + 1)) return false;
+
+		TArray<FString> Header;
+		Lines[0].ParseIntoArray(Header, TEXT(","));
+		TestEqual(TEXT("The header has a column for every timing"), Header.Num(), NumColumns);
+
+		for (int32 RowIndex = 0; RowIndex < UE_ARRAY_COUNT(HordeTestZombieCounts); ++RowIndex)
+		{
+			TArray<FString> Columns;
+			Lines[RowIndex + 1].ParseIntoArray(Columns, TEXT(","));
+			if (!TestEqual(TEXT("The row has a value for every column"), Columns.Num(), NumColumns)) return false;
+
+			TestEqual(TEXT("Every zombie of the horde was spawned"), FCString::Atoi(*Columns[0]), HordeTestZombieCounts[RowIndex]);
+			TestEqual(TEXT("Every tick was run"), FCString::Atoi(*Columns[1]), HordeTestTicks);
+			TestTrue(TEXT("The frames took some time"), FCString::Atod(*Columns[2]) > 0.0);
+			TestTrue(TEXT("The worst frame is at least the average"), FCString::Atod(*Columns[3]) >= FCString::Atod(*Columns[2]));
+			Checksums[Run].Add(Columns[4]);
+
+			for (int32 Column = 5; Column < NumColumns; ++Column)
+			{
+				const double Milliseconds = FCString::Atod(*Columns[Column]);
+				TestTrue(FString::Printf(TEXT("%s is a time"), *Header[Column]), FMath::IsFinite(Milliseconds) && Milliseconds >= 0.0);
+			}
+		}
+	}
+
+	// With the same seed every run has to do the same work and leave the crowd the same way.
+	for (int32 Run = 1; Run < HordeTestRuns; ++Run)
+	{
+		for (int32 RowIndex = 0; RowIndex < UE_ARRAY_COUNT(HordeTestZombieCounts); ++RowIndex)
+		{
+			TestEqual(FString::Printf(TEXT("The %d zombie horde ends the same way every run"), HordeTestZombieCounts[RowIndex]), Checksums[Run][RowIndex], Checksums[0][RowIndex]);
+		}
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include "ZombieLagCompensationBenchmarkCommandlet.h"
+#include "../Zombie/ZombieCharacter.h"
+#include "../Zombie/ZombieLagCompensationSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogZombieLagCompensationBenchmark, Log, All);
+
+// How far past the zombie a shot goes, so that it passes all the way through the capsule.
+static const float BenchmarkShotOvershoot = 200.f;
+
+/**
+ * Sets default values for this commandlet's properties.
+ */
+UZombieLagCompensationBenchmarkCommandlet::UZombieLagCompensationBenchmarkCommandlet()
+{
+	// Record for a few seconds so the history is full and the zombies are on the move.
+	NumWarmupTicks = 90;
+}
+
+/**
+ * Runs the benchmark.
+ */
+int32 UZombieLagCompensationBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString MapName = TEXT("/Game/Levels/MainLevel");
+	FParse::Value(*Params, TEXT("Map="), MapName);
+
+	FString ZombieCounts = TEXT("100,1000,10000");
+	FParse::Value(*Params, TEXT("Zombies="), ZombieCounts, false);
+
+	FParse::Value(*Params, TEXT("Traces="), NumTraces);
+	FParse::Value(*Params, TEXT("Records="), NumRecords);
+	FParse::Value(*Params, TEXT("WarmupTicks="), NumWarmupTicks);
+	FParse::Value(*Params, TEXT("ShotDistance="), ShotDistance);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("SpawnRadius="), SpawnRadius);
+
+	OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmark") / TEXT("ZombieLagCompensation");
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	if (NumTraces <= 0 || NumRecords <= 0)
+	{
+		UE_LOG(LogZombieLagCompensationBenchmark, Error, TEXT("-Traces and -Records have to be greater than 0."));
+		return 1;
+	}
+
+	// A commandlet's world isn't a server, so the history has to be told to record anyway.
+	IConsoleVariable* RecordVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("zombie.LagCompensation.Record"));
+	if (RecordVariable != nullptr) RecordVariable->Set(2, ECVF_SetByCommandline);
+
+	TArray<FString> CountStrings;
+	ZombieCounts.ParseIntoArray(CountStrings, TEXT(","));
+
+	UWorld* World = LoadWorld(MapName);
+	if (World == nullptr)
+	{
+		UE_LOG(LogZombieLagCompensationBenchmark, Error, TEXT("Couldn't load the map %s."), *MapName);
+		return 1;
+	}
+
+	TArray<FZombieLagCompensationBenchmarkResult> Results;
+	for (const FString& CountString : CountStrings)
+	{
+		const int32 NumZombies = FCString::Atoi(*CountString);
+		if (NumZombies <= 0) continue;
+
+		const FZombieLagCompensationBenchmarkResult& Result = Results.Add_GetRef(RunTraces(World, NumZombies));
+		UE_LOG(LogZombieLagCompensationBenchmark, Display, TEXT("%d zombies: %lld bytes of history (%d frames), %.4f ms per record, %.5f ms per trace, %d of %d shots hit rewound, %d hit without rewinding."), Result.NumZombies, Result.HistoryBytes, Result.NumFrames, Result.RecordMs, Result.TraceMs, Result.NumRewoundHits, Result.NumTraces, Result.NumCurrentHits);
+	}
+
+	UnloadWorld(World);
+	WriteTraceResults(Results);
+
+	return 0;
+}
+
+/**
+ * Spawns the horde, records its history and times the rewound shots against it.
+ */
+FZombieLagCompensationBenchmarkResult UZombieLagCompensationBenchmarkCommandlet::RunTraces(UWorld* World, int32 NumZombies)
+{
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+
+	SpawnHorde(World, NumZombies);
+
+	// Let the zombies chase the bots around so that where they were differs from where they are.
+	float Time = 0.f;
+	for (int32 TickIndex = 0; TickIndex < NumWarmupTicks; ++TickIndex)
+	{
+		UpdateBots(World, Time);
+		TickWorld(World);
+		Time += DeltaTime;
+	}
+
+	FZombieLagCompensationBenchmarkResult Result;
+	Result.NumZombies = Zombies.Num();
+
+	UZombieLagCompensationSubsystem* LagCompensation = World->GetSubsystem<UZombieLagCompensationSubsystem>();
+	if (LagCompensation == nullptr)
+	{
+		ClearHorde(World);
+		return Result;
+	}
+
+	Result.NumFrames = LagCompensation->GetNumHistoryFrames();
+	Result.HistoryBytes = LagCompensation->GetHistoryAllocatedSize();
+
+	// Aim every shot at where a random live zombie was a random time ago, from a random side.
+	const float Now = World->GetTimeSeconds();
+	const float RecordedSeconds = LagCompensation->GetRecordedSeconds();
+
+	FRandomStream RandomStream(Seed);
+	TArray<FZombieHandle> Targets;
+	TArray<FVector> Starts;
+	TArray<FVector> Ends;
+	TArray<float> Times;
+	for (int32 Attempt = 0; Attempt < NumTraces * 4 && Targets.Num() < NumTraces && Zombies.Num() > 0; ++Attempt)
+	{
+		const AZombieCharacter* ZombieCharacter = Zombies[RandomStream.RandHelper(Zombies.Num())];
+		if (ZombieCharacter == nullptr || ZombieCharacter->GetState() == ZombieStates::DEAD) continue;
+
+		const float ShotTime = Now - RandomStream.FRandRange(0.f, RecordedSeconds);
+		FVector Location;
+		if (!LagCompensation->GetRewoundLocation(ZombieCharacter->GetCrowdHandle(), ShotTime, Location)) continue;
+
+		const FVector Direction = FRotator(0.f, RandomStream.FRandRange(0.f, 360.f), 0.f).Vector();
+		Targets.Add(ZombieCharacter->GetCrowdHandle());
+		Starts.Add(Location - Direction * ShotDistance);
+		Ends.Add(Location + Direction * BenchmarkShotOvershoot);
+		Times.Add(ShotTime);
+	}
+
+	Result.NumTraces = Targets.Num();
+	if (Result.NumTraces == 0)
+	{
+		ClearHorde(World);
+		return Result;
+	}
+
+	// Other zombies in the way take the shot too, so only hits on the target are counted.
+	FZombieRewindHit Hit;
+	double StartSeconds = FPlatformTime::Seconds();
+	for (int32 TraceIndex = 0; TraceIndex < Result.NumTraces; ++TraceIndex)
+	{
+		if (LagCompensation->RewindTrace(Starts[TraceIndex], Ends[TraceIndex], Times[TraceIndex], 0.f, Hit) && Hit.Handle == Targets[TraceIndex]) Result.NumRewoundHits++;
+	}
+	Result.TraceMs = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / Result.NumTraces;
+
+	for (int32 TraceIndex = 0; TraceIndex < Result.NumTraces; ++TraceIndex)
+	{
+		if (LagCompensation->RewindTrace(Starts[TraceIndex], Ends[TraceIndex], Now, 0.f, Hit) && Hit.Handle == Targets[TraceIndex]) Result.NumCurrentHits++;
+	}
+
+	// Recording over and over at the same time fills the history with copies of the same frame,
+	// so it's timed last.
+	StartSeconds = FPlatformTime::Seconds();
+	for (int32 RecordIndex = 0; RecordIndex < NumRecords; ++RecordIndex)
+	{
+		LagCompensation->RecordPoses();
+	}
+	Result.RecordMs = (FPlatformTime::Seconds() - StartSeconds) * 1000.0 / NumRecords;
+
+	ClearHorde(World);
+
+	return Result;
+}
+
+/**
+ * Writes the results to `OutputPath` as a CSV and a JSON file.
+ */
+void UZombieLagCompensationBenchmarkCommandlet::WriteTraceResults(const TArray<FZombieLagCompensationBenchmarkResult>& Results) const
+{
+	FString Csv = TEXT("Zombies,Frames,HistoryBytes,BytesPerZombie,RecordMs,Traces,TraceMs,TracesPerSecond,RewoundHits,CurrentHits\n");
+	FString Json = FString::Printf(TEXT("{\n\t\"seed\": %d,\n\t\"shotDistance\": %f,\n\t\"results\": [\n"), Seed, ShotDistance);
+
+	for (int32 ResultIndex = 0; ResultIndex < Results.Num(); ++ResultIndex)
+	{
+		const FZombieLagCompensationBenchmarkResult& Result = Results[ResultIndex];
+		const double BytesPerZombie = (Result.NumZombies > 0) ? (double)Result.HistoryBytes / Result.NumZombies : 0.0;
+		const double TracesPerSecond = (Result.TraceMs > 0.0) ? 1000.0 / Result.TraceMs : 0.0;
+
+		Csv += FString::Printf(TEXT("%d,%d,%lld,%.1f,%.5f,%d,%.6f,%.1f,%d,%d\n"), Result.NumZombies, Result.NumFrames, Result.HistoryBytes, BytesPerZombie, Result.RecordMs, Result.NumTraces, Result.TraceMs, TracesPerSecond, Result.NumRewoundHits, Result.NumCurrentHits);
+		Json += FString::Printf(TEXT("\t\t{ \"zombies\": %d, \"frames\": %d, \"historyBytes\": %lld, \"bytesPerZombie\": %.1f, \"recordMs\": %.5f, \"traces\": %d, \"traceMs\": %.6f, \"tracesPerSecond\": %.1f, \"rewoundHits\": %d, \"currentHits\": %d }"), Result.NumZombies, Result.NumFrames, Result.HistoryBytes, BytesPerZombie, Result.RecordMs, Result.NumTraces, Result.TraceMs, TracesPerSecond, Result.NumRewoundHits, Result.NumCurrentHits);
+		Json += (ResultIndex + 1 < Results.Num()) ? TEXT(",\n") : TEXT("\n");
+	}
+
+	Json += TEXT("\t]\n}\n");
+
+	const FString CsvPath = OutputPath + TEXT(".csv");
+	const FString JsonPath = OutputPath + TEXT(".json");
+	FFileHelper::SaveStringToFile(Csv, *CsvPath);
+	FFileHelper::SaveStringToFile(Json, *JsonPath);
+
+	UE_LOG(LogZombieLagCompensationBenchmark, Display, TEXT("Wrote the results to %s and %s."), *CsvPath, *JsonPath);
+}
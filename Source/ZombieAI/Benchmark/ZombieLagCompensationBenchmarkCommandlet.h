@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ZombieHordeBenchmarkCommandlet.h"
+#include "ZombieLagCompensationBenchmarkCommandlet.generated.h"
+
+/**
+ * The results of rewinding shots against one horde size.
+ */
+struct FZombieLagCompensationBenchmarkResult
+{
+	// The number of zombies that were spawned and the number of shots that were timed.
+	int32 NumZombies = 0;
+	int32 NumTraces = 0;
+
+	// The number of frames each zombie's history holds and the bytes the whole history takes.
+	int32 NumFrames = 0;
+	int64 HistoryBytes = 0;
+
+	// The average time to record one frame of the history, in milliseconds.
+	double RecordMs = 0.0;
+
+	// The average time of one rewound trace, in milliseconds.
+	double TraceMs = 0.0;
+
+	// The number of shots that hit the zombie they were aimed at where it was, and the number
+	// that would have hit it where it is now.
+	int32 NumRewoundHits = 0;
+	int32 NumCurrentHits = 0;
+};
+
+/**
+ * The ZombieLagCompensationBenchmarkCommandlet measures what it costs to check shots against
+ * where the zombies were. It spawns hordes of different sizes like the
+ * ZombieHordeBenchmarkCommandlet, records the ZombieLagCompensationSubsystem's history while the
+ * zombies chase the bots, then fires random shots at where zombies were up to a second ago and
+ * times the rewound traces. It also counts how many of the shots would have missed without the
+ * rewind.
+ *
+ * Run it with:
+ *
+ *     UE4Editor-Cmd ZombieAI.uproject -run=ZombieLagCompensationBenchmark -nullrhi -unattended
+ *         [-Map=/Game/Levels/MainLevel] [-Zombies=100,1000,10000] [-Traces=1000] [-Records=100]
+ *         [-WarmupTicks=90] [-ShotDistance=2000] [-Seed=1] [-SpawnRadius=5000] [-Output=Path/Without/Extension]
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieLagCompensationBenchmarkCommandlet : public UZombieHordeBenchmarkCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this commandlet's properties.
+	UZombieLagCompensationBenchmarkCommandlet();
+
+	/**
+	 * Runs the benchmark.
+	 */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/**
+	 * Spawns the horde, records its history and times the rewound shots against it.
+	 */
+	FZombieLagCompensationBenchmarkResult RunTraces(UWorld* World, int32 NumZombies);
+
+	/**
+	 * Writes the results to `OutputPath` as a CSV and a JSON file.
+	 */
+	void WriteTraceResults(const TArray<FZombieLagCompensationBenchmarkResult>& Results) const;
+
+protected:
+	// The number of shots to time and of history frames to time the recording of for each
+	// horde size.
+	int32 NumTraces = 1000;
+	int32 NumRecords = 100;
+
+	// How far from the zombies the shots are fired from.
+	float ShotDistance = 2000.f;
+};
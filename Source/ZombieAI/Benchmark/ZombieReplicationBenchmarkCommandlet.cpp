@@ -0,0 +1,260 @@
+#include "ZombieReplicationBenchmarkCommandlet.h"
+#include "../Zombie/ZombieCharacter.h"
+#include "../Zombie/ZombieReplicationSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogZombieReplicationBenchmark, Log, All);
+
+/**
+ * Sets default values for this commandlet's properties.
+ */
+UZombieReplicationBenchmarkCommandlet::UZombieReplicationBenchmarkCommandlet()
+{
+	// The clients' own player characters are what the zombies are relevant to.
+	NumBots = 0;
+}
+
+/**
+ * Runs the benchmark.
+ */
+int32 UZombieReplicationBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString MapName = TEXT("/Game/Levels/MainLevel");
+	FParse::Value(*Params, TEXT("Map="), MapName);
+
+	FString ZombieCounts = TEXT("100,1000");
+	FParse::Value(*Params, TEXT("Zombies="), ZombieCounts, false);
+
+	FParse::Value(*Params, TEXT("Clients="), NumClients);
+	FParse::Value(*Params, TEXT("Port="), Port);
+	FParse::Value(*Params, TEXT("Seconds="), MeasureSeconds);
+	FParse::Value(*Params, TEXT("WarmupSeconds="), WarmupSeconds);
+	FParse::Value(*Params, TEXT("ConnectTimeout="), ConnectTimeout);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("SpawnRadius="), SpawnRadius);
+
+	OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmark") / TEXT("ZombieReplication");
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	if (NumClients <= 0 || MeasureSeconds <= 0.f)
+	{
+		UE_LOG(LogZombieReplicationBenchmark, Error, TEXT("-Clients and -Seconds have to be greater than 0."));
+		return 1;
+	}
+
+	TArray<FString> CountStrings;
+	ZombieCounts.ParseIntoArray(CountStrings, TEXT(","));
+
+	UWorld* World = LoadWorld(MapName);
+	if (World == nullptr)
+	{
+		UE_LOG(LogZombieReplicationBenchmark, Error, TEXT("Couldn't load the map %s."), *MapName);
+		return 1;
+	}
+
+	FURL ListenURL;
+	ListenURL.Port = Port;
+	if (!World->Listen(ListenURL))
+	{
+		UE_LOG(LogZombieReplicationBenchmark, Error, TEXT("Couldn't listen on port %d."), Port);
+		UnloadWorld(World);
+		return 1;
+	}
+
+	TArray<FZombieReplicationBenchmarkResult> Results;
+	if (StartClients(World))
+	{
+		for (const FString& CountString : CountStrings)
+		{
+			const int32 NumZombies = FCString::Atoi(*CountString);
+			if (NumZombies <= 0) continue;
+
+			const FZombieReplicationBenchmarkResult& Result = Results.Add_GetRef(RunReplication(World, NumZombies));
+			UE_LOG(LogZombieReplicationBenchmark, Display, TEXT("%d zombies, %d clients: %lld bytes to zombie channels in %.1f s, %.1f relevant zombies, %.2f bytes per zombie per second."), Result.NumZombies, Result.NumClients, Result.ZombieBytes, Result.Seconds, Result.AverageRelevantZombies, Result.BytesPerZombiePerSecond);
+		}
+	}
+
+	StopClients();
+	GEngine->DestroyNamedNetDriver(World, NAME_GameNetDriver);
+	UnloadWorld(World);
+
+	if (Results.Num() == 0) return 1;
+
+	WriteReplicationResults(Results);
+
+	return 0;
+}
+
+/**
+ * Starts the client processes and ticks the world until all of them have joined.
+ *
+ * @return Whether every client joined before `ConnectTimeout` ran out.
+ */
+bool UZombieReplicationBenchmarkCommandlet::StartClients(UWorld* World)
+{
+	const FString ProjectPath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+
+	for (int32 ClientIndex = 0; ClientIndex < NumClients; ++ClientIndex)
+	{
+		const FString LogPath = FPaths::ConvertRelativePathToFull(OutputPath + FString::Printf(TEXT("_Client%d.log"), ClientIndex));
+		const FString ClientParams = FString::Printf(TEXT("\"%s\" 127.0.0.1:%d -game -nullrhi -nosound -nosplash -unattended -ABSLOG=\"%s\""), *ProjectPath, Port, *LogPath);
+
+		FProcHandle Process = FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *ClientParams, true, true, true, nullptr, 0, nullptr, nullptr);
+		if (!Process.IsValid())
+		{
+			UE_LOG(LogZombieReplicationBenchmark, Error, TEXT("Couldn't start client %d."), ClientIndex);
+			return false;
+		}
+
+		ClientProcesses.Add(Process);
+	}
+
+	const double Deadline = FPlatformTime::Seconds() + ConnectTimeout;
+	while (CountJoinedClients(World) < NumClients)
+	{
+		if (FPlatformTime::Seconds() > Deadline)
+		{
+			UE_LOG(LogZombieReplicationBenchmark, Error, TEXT("Only %d of %d clients joined within %.0f seconds."), CountJoinedClients(World), NumClients, ConnectTimeout);
+			return false;
+		}
+
+		TickWorldRealTime(World);
+	}
+
+	return true;
+}
+
+/**
+ * Closes the client processes.
+ */
+void UZombieReplicationBenchmarkCommandlet::StopClients()
+{
+	for (FProcHandle& Process : ClientProcesses)
+	{
+		if (FPlatformProcess::IsProcRunning(Process)) FPlatformProcess::TerminateProc(Process, true);
+		FPlatformProcess::CloseProc(Process);
+	}
+
+	ClientProcesses.Empty();
+}
+
+/**
+ * Returns the number of clients that have joined the game.
+ */
+int32 UZombieReplicationBenchmarkCommandlet::CountJoinedClients(UWorld* World)
+{
+	UNetDriver* NetDriver = World->GetNetDriver();
+	if (NetDriver == nullptr) return 0;
+
+	int32 NumJoined = 0;
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection != nullptr && Connection->PlayerController != nullptr) NumJoined++;
+	}
+
+	return NumJoined;
+}
+
+/**
+ * Spawns the horde, lets it replicate to the clients for a while and measures the bytes
+ * written to its actor channels.
+ */
+FZombieReplicationBenchmarkResult UZombieReplicationBenchmarkCommandlet::RunReplication(UWorld* World, int32 NumZombies)
+{
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+
+	SpawnHorde(World, NumZombies);
+
+	FZombieReplicationBenchmarkResult Result;
+	Result.NumZombies = Zombies.Num();
+	Result.NumClients = CountJoinedClients(World);
+
+	// Let every client receive the whole horde before measuring, since opening the channels costs
+	// much more than keeping them up to date.
+	const int32 NumWarmupSteps = FMath::CeilToInt(WarmupSeconds / DeltaTime);
+	for (int32 TickIndex = 0; TickIndex < NumWarmupSteps; ++TickIndex)
+	{
+		TickWorldRealTime(World);
+	}
+
+	UZombieReplicationSubsystem* Replication = World->GetSubsystem<UZombieReplicationSubsystem>();
+	if (Replication == nullptr)
+	{
+		ClearHorde(World);
+		return Result;
+	}
+
+	const int64 StartBytes = Replication->GetTotalZombieBytes();
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	double RelevantZombieSum = 0.0;
+	const int32 NumMeasureSteps = FMath::Max(FMath::CeilToInt(MeasureSeconds / DeltaTime), 1);
+	for (int32 TickIndex = 0; TickIndex < NumMeasureSteps; ++TickIndex)
+	{
+		TickWorldRealTime(World);
+		RelevantZombieSum += Replication->GetRelevantZombieCount();
+	}
+
+	Result.Seconds = FPlatformTime::Seconds() - StartSeconds;
+	Result.ZombieBytes = Replication->GetTotalZombieBytes() - StartBytes;
+	Result.AverageRelevantZombies = RelevantZombieSum / NumMeasureSteps;
+
+	if (Result.Seconds > 0.0 && Result.AverageRelevantZombies > 0.0)
+	{
+		Result.BytesPerZombiePerSecond = Result.ZombieBytes / Result.Seconds / Result.AverageRelevantZombies;
+	}
+
+	ClearHorde(World);
+
+	return Result;
+}
+
+/**
+ * Ticks the world once and then waits out the rest of `DeltaTime`, so that the server runs
+ * at the rate the clients expect.
+ */
+void UZombieReplicationBenchmarkCommandlet::TickWorldRealTime(UWorld* World)
+{
+	const double StartSeconds = FPlatformTime::Seconds();
+
+	TickWorld(World);
+	FTicker::GetCoreTicker().Tick(DeltaTime);
+
+	const double SecondsLeft = DeltaTime - (FPlatformTime::Seconds() - StartSeconds);
+	if (SecondsLeft > 0.0) FPlatformProcess::Sleep((float)SecondsLeft);
+}
+
+/**
+ * Writes the results to `OutputPath` as a CSV and a JSON file.
+ */
+void UZombieReplicationBenchmarkCommandlet::WriteReplicationResults(const TArray<FZombieReplicationBenchmarkResult>& Results) const
+{
+	FString Csv = TEXT("Zombies,Clients,Seconds,ZombieBytes,RelevantZombies,BytesPerZombiePerSecond\n");
+	FString Json = FString::Printf(TEXT("{\n\t\"seed\": %d,\n\t\"deltaTime\": %f,\n\t\"results\": [\n"), Seed, DeltaTime);
+
+	for (int32 ResultIndex = 0; ResultIndex < Results.Num(); ++ResultIndex)
+	{
+		const FZombieReplicationBenchmarkResult& Result = Results[ResultIndex];
+
+		Csv += FString::Printf(TEXT("%d,%d,%.2f,%lld,%.1f,%.2f\n"), Result.NumZombies, Result.NumClients, Result.Seconds, Result.ZombieBytes, Result.AverageRelevantZombies, Result.BytesPerZombiePerSecond);
+		Json += FString::Printf(TEXT("\t\t{ \"zombies\": %d, \"clients\": %d, \"seconds\": %.2f, \"zombieBytes\": %lld, \"relevantZombies\": %.1f, \"bytesPerZombiePerSecond\": %.2f }"), Result.NumZombies, Result.NumClients, Result.Seconds, Result.ZombieBytes, Result.AverageRelevantZombies, Result.BytesPerZombiePerSecond);
+		Json += (ResultIndex + 1 < Results.Num()) ? TEXT(",\n") : TEXT("\n");
+	}
+
+	Json += TEXT("\t]\n}\n");
+
+	const FString CsvPath = OutputPath + TEXT(".csv");
+	const FString JsonPath = OutputPath + TEXT(".json");
+	FFileHelper::SaveStringToFile(Csv, *CsvPath);
+	FFileHelper::SaveStringToFile(Json, *JsonPath);
+
+	UE_LOG(LogZombieReplicationBenchmark, Display, TEXT("Wrote the results to %s and %s."), *CsvPath, *JsonPath);
+}
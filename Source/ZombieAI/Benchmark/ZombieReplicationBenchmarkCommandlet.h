@@ -0,0 +1,108 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ZombieHordeBenchmarkCommandlet.h"
+#include "ZombieReplicationBenchmarkCommandlet.generated.h"
+
+/**
+ * The results of replicating one horde size.
+ */
+struct FZombieReplicationBenchmarkResult
+{
+	// The number of zombies that were spawned and the number of clients they were sent to.
+	int32 NumZombies = 0;
+	int32 NumClients = 0;
+
+	// The number of seconds that were measured.
+	double Seconds = 0.0;
+
+	// The bytes written to ZombieCharacter actor channels while measuring.
+	int64 ZombieBytes = 0;
+
+	// The number of zombies within the cull distance of a client, added up over every client
+	// and averaged over the measured ticks.
+	double AverageRelevantZombies = 0.0;
+
+	// The bytes written to ZombieCharacter actor channels per relevant zombie per second.
+	double BytesPerZombiePerSecond = 0.0;
+};
+
+/**
+ * The ZombieReplicationBenchmarkCommandlet measures what the horde costs to replicate. It loads
+ * a map, listens for clients, starts client processes of the game on the same machine that
+ * connect to it over loopback and then spawns hordes of different sizes like the
+ * ZombieHordeBenchmarkCommandlet. The world is ticked in real time so that the clients keep up,
+ * and the bytes written to ZombieCharacter actor channels are divided by the time and by the
+ * number of zombies that are relevant to a client, then written to a CSV and a JSON file.
+ *
+ * Run it with:
+ *
+ *     UE4Editor-Cmd ZombieAI.uproject -run=ZombieReplicationBenchmark -nullrhi -unattended
+ *         [-Map=/Game/Levels/MainLevel] [-Zombies=100,1000] [-Clients=4] [-Port=7777]
+ *         [-Seconds=20] [-WarmupSeconds=5] [-ConnectTimeout=60] [-Seed=1] [-SpawnRadius=5000]
+ *         [-Output=Path/Without/Extension]
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieReplicationBenchmarkCommandlet : public UZombieHordeBenchmarkCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this commandlet's properties.
+	UZombieReplicationBenchmarkCommandlet();
+
+	/**
+	 * Runs the benchmark.
+	 */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/**
+	 * Starts the client processes and ticks the world until all of them have joined.
+	 *
+	 * @return Whether every client joined before `ConnectTimeout` ran out.
+	 */
+	bool StartClients(UWorld* World);
+
+	/**
+	 * Closes the client processes.
+	 */
+	void StopClients();
+
+	/**
+	 * Returns the number of clients that have joined the game.
+	 */
+	static int32 CountJoinedClients(UWorld* World);
+
+	/**
+	 * Spawns the horde, lets it replicate to the clients for a while and measures the bytes
+	 * written to its actor channels.
+	 */
+	FZombieReplicationBenchmarkResult RunReplication(UWorld* World, int32 NumZombies);
+
+	/**
+	 * Ticks the world once and then waits out the rest of `DeltaTime`, so that the server runs
+	 * at the rate the clients expect.
+	 */
+	void TickWorldRealTime(UWorld* World);
+
+	/**
+	 * Writes the results to `OutputPath` as a CSV and a JSON file.
+	 */
+	void WriteReplicationResults(const TArray<FZombieReplicationBenchmarkResult>& Results) const;
+
+protected:
+	// The number of client processes to start and the port they connect to.
+	int32 NumClients = 4;
+	int32 Port = 7777;
+
+	// The number of seconds to measure each horde for, and to let it settle before that.
+	float MeasureSeconds = 20.f;
+	float WarmupSeconds = 5.f;
+
+	// The number of seconds to wait for every client to join.
+	float ConnectTimeout = 60.f;
+
+	// The client processes.
+	TArray<FProcHandle> ClientProcesses;
+};
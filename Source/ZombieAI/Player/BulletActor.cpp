@@ -1,5 +1,8 @@
 #include "BulletActor.h"
+#include "BulletPoolSubsystem.h"
 #include "../Zombie/ZombieCharacter.h"
+#include "TimerManager.h"
+#include "../ZombieAIStats.h"
 #include "Components/SphereComponent.h"
 #include "Components/StaticMeshComponent.h"
 #include "GameFramework/ProjectileMovementComponent.h"
@@ -38,8 +41,9 @@ ABulletActor::ABulletActor()
 	BulletMovement->bRotationFollowsVelocity = true;
 	BulletMovement->bShouldBounce = false;
 
-	// Set the BulletActor to die after 3 seconds.
-	InitialLifeSpan = 3.f;
+	// BulletActors are reused by the BulletPoolSubsystem so instead of using `InitialLifeSpan`,
+	// which would destroy them, `ActivateBullet` sets a timer that returns them to the pool.
+	InitialLifeSpan = 0.f;
 }
 
 /**
@@ -47,6 +51,8 @@ ABulletActor::ABulletActor()
  */
 void ABulletActor::OnBulletHitComponent(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
 {
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_OnBulletHitComponent);
+
 	// We want to return early if anything is null as it could cause a crash otherwise.
 	if ((OtherActor == nullptr) || (OtherActor == this) || (OtherComp == nullptr)) return;
 
@@ -55,7 +61,79 @@ void ABulletActor::OnBulletHitComponent(UPrimitiveComponent* HitComp, AActor* Ot
 	if (ZombieCharacter == nullptr) return;
 	ZombieCharacter->Hit(Damage);
 
-	// Finally destroy the the BulletActor so we don't end up with a bunch of bullets that
-	// litter the level and impact performance.
-	Destroy();
+	// Finally return the BulletActor to the pool so we don't end up with a bunch of bullets
+	// that litter the level and impact performance.
+	ReturnToPool();
+}
+
+/**
+ * Moves the BulletActor to the given transform, makes it visible and launches it.
+ *
+ * @param SpawnTransform The location and rotation to launch the BulletActor from.
+ * @param InDamage The damage the BulletActor should do.
+ */
+void ABulletActor::ActivateBullet(const FTransform& SpawnTransform, float InDamage)
+{
+	Damage = InDamage;
+	bIsBulletActive = true;
+
+	// Teleport the BulletActor to the spawn transform and turn it back on.
+	SetActorLocationAndRotation(SpawnTransform.GetLocation(), SpawnTransform.GetRotation(), false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// The ProjectileMovementComponent clears its updated component when it stops after a
+	// hit so we have to set it again and give it a fresh velocity in the new direction.
+	BulletMovement->SetUpdatedComponent(BulletSphereCollider);
+	BulletMovement->Velocity = SpawnTransform.GetRotation().Vector() * BulletMovement->InitialSpeed;
+	BulletMovement->UpdateComponentVelocity();
+	BulletMovement->Activate(true);
+
+	// Set the BulletActor to go back to the pool after `LifeSpanInSeconds`.
+	UWorld* World = GetWorld();
+	if (World == nullptr || LifeSpanInSeconds <= 0.f) return;
+	World->GetTimerManager().SetTimer(LifeSpanTimer, this, &ABulletActor::OnLifeSpanExpired, LifeSpanInSeconds, false);
+}
+
+/**
+ * Stops the BulletActor and hides it so that it can wait in the pool.
+ */
+void ABulletActor::DeactivateBullet()
+{
+	bIsBulletActive = false;
+
+	UWorld* World = GetWorld();
+	if (World != nullptr) World->GetTimerManager().ClearTimer(LifeSpanTimer);
+
+	BulletMovement->StopMovementImmediately();
+	BulletMovement->Deactivate();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+}
+
+/**
+ * Called when the BulletActor has been in flight for `LifeSpanInSeconds`.
+ */
+void ABulletActor::OnLifeSpanExpired()
+{
+	ReturnToPool();
+}
+
+/**
+ * Hands the BulletActor back to the BulletPoolSubsystem, or destroys it if there
+ * is no pool to go back to.
+ */
+void ABulletActor::ReturnToPool()
+{
+	UWorld* World = GetWorld();
+	UBulletPoolSubsystem* BulletPool = (World != nullptr) ? World->GetSubsystem<UBulletPoolSubsystem>() : nullptr;
+
+	if (BulletPool == nullptr)
+	{
+		Destroy();
+		return;
+	}
+
+	BulletPool->Release(this);
 }
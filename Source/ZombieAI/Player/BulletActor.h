@@ -32,10 +32,52 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	float Damage;
 
+	// The amount of time that the BulletActor stays in flight before it's returned to
+	// the BulletPoolSubsystem.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float LifeSpanInSeconds = 3.f;
+
+protected:
+	// Indicates whether the BulletActor is currently fired or waiting in the pool.
+	bool bIsBulletActive = false;
+
+	// The timer used to return the BulletActor to the pool once its life span is over.
+	FTimerHandle LifeSpanTimer;
+
 public:	
 	/**
 	 * Called when the BulletActor hits another component.
 	 */
 	UFUNCTION()
 	void OnBulletHitComponent(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	/**
+	 * Moves the BulletActor to the given transform, makes it visible and launches it.
+	 *
+	 * @param SpawnTransform The location and rotation to launch the BulletActor from.
+	 * @param InDamage The damage the BulletActor should do.
+	 */
+	void ActivateBullet(const FTransform& SpawnTransform, float InDamage);
+
+	/**
+	 * Stops the BulletActor and hides it so that it can wait in the pool.
+	 */
+	void DeactivateBullet();
+
+	/**
+	 * Returns whether the BulletActor is currently fired or waiting in the pool.
+	 */
+	bool IsBulletActive() const { return bIsBulletActive; }
+
+protected:
+	/**
+	 * Called when the BulletActor has been in flight for `LifeSpanInSeconds`.
+	 */
+	void OnLifeSpanExpired();
+
+	/**
+	 * Hands the BulletActor back to the BulletPoolSubsystem, or destroys it if there
+	 * is no pool to go back to.
+	 */
+	void ReturnToPool();
 };
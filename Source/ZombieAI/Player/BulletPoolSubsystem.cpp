@@ -0,0 +1,113 @@
+#include "BulletPoolSubsystem.h"
+#include "BulletActor.h"
+#include "Engine/World.h"
+
+/**
+ * Called when the world that owns the BulletPoolSubsystem is torn down.
+ */
+void UBulletPoolSubsystem::Deinitialize()
+{
+	// The BulletActors are destroyed along with the world so we just need to let go of them.
+	AllBullets.Empty();
+	FreeBullets.Empty();
+	Stats = FBulletPoolStats();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Spawns BulletActors until the pool holds at least `Count` of them.
+ *
+ * @param Count The number of BulletActors the pool should hold.
+ */
+void UBulletPoolSubsystem::Prewarm(int32 Count)
+{
+	while (AllBullets.Num() < Count)
+	{
+		ABulletActor* BulletActor = SpawnPooledBullet();
+		if (BulletActor == nullptr) return;
+
+		FreeBullets.Add(BulletActor);
+	}
+}
+
+/**
+ * Takes a BulletActor from the free list, or spawns a new one if the free list is
+ * empty, and launches it from the given transform.
+ *
+ * @param SpawnTransform The location and rotation to launch the BulletActor from.
+ * @param Damage The damage the BulletActor should do.
+ */
+ABulletActor* UBulletPoolSubsystem::Acquire(const FTransform& SpawnTransform, float Damage)
+{
+	ABulletActor* BulletActor = nullptr;
+
+	// Pop BulletActors off of the free list until we find one that is still usable. A
+	// BulletActor could have been destroyed by something outside of the pool, like a
+	// level streaming out, so we can't assume that every entry is valid.
+	while (FreeBullets.Num() > 0 && BulletActor == nullptr)
+	{
+		ABulletActor* FreeBullet = FreeBullets.Pop(false);
+		if (IsValid(FreeBullet)) BulletActor = FreeBullet;
+	}
+
+	if (BulletActor != nullptr)
+	{
+		Stats.Hits++;
+	}
+	else
+	{
+		// The free list was empty so the pool has to grow. Misses tell us that the pool
+		// should be pre-warmed with more BulletActors.
+		BulletActor = SpawnPooledBullet();
+		if (BulletActor == nullptr) return nullptr;
+
+		Stats.Misses++;
+	}
+
+	Stats.InUse++;
+	Stats.HighWater = FMath::Max(Stats.HighWater, Stats.InUse);
+
+	BulletActor->ActivateBullet(SpawnTransform, Damage);
+
+	return BulletActor;
+}
+
+/**
+ * Deactivates the BulletActor and puts it back on the free list.
+ *
+ * @param BulletActor The BulletActor to return to the pool.
+ */
+void UBulletPoolSubsystem::Release(ABulletActor* BulletActor)
+{
+	// Ignore BulletActors that are already back in the pool so that a hit and an expiry in
+	// the same frame don't add the same BulletActor to the free list twice.
+	if (!IsValid(BulletActor) || !BulletActor->IsBulletActive()) return;
+
+	BulletActor->DeactivateBullet();
+	FreeBullets.Add(BulletActor);
+
+	Stats.InUse = FMath::Max(Stats.InUse - 1, 0);
+}
+
+/**
+ * Spawns a new inactive BulletActor that is owned by the pool.
+ */
+ABulletActor* UBulletPoolSubsystem::SpawnPooledBullet()
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return nullptr;
+
+	// Pooled BulletActors are spawned out of the way and deactivated right away so we
+	// always want them to spawn even if something is in the way.
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ABulletActor* BulletActor = World->SpawnActor<ABulletActor>(ABulletActor::StaticClass(), FTransform::Identity, ActorSpawnParams);
+	if (BulletActor == nullptr) return nullptr;
+
+	BulletActor->DeactivateBullet();
+	AllBullets.Add(BulletActor);
+
+	return BulletActor;
+}
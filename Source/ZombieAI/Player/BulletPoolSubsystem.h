@@ -0,0 +1,98 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BulletPoolSubsystem.generated.h"
+
+class ABulletActor;
+
+/**
+ * The counters used to size the BulletPoolSubsystem.
+ */
+USTRUCT(BlueprintType)
+struct FBulletPoolStats
+{
+	GENERATED_BODY()
+
+	// The number of times a BulletActor was handed out from the free list.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = BulletPool)
+	int32 Hits = 0;
+
+	// The number of times the free list was empty and a new BulletActor had to be spawned.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = BulletPool)
+	int32 Misses = 0;
+
+	// The number of BulletActors that are currently in flight.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = BulletPool)
+	int32 InUse = 0;
+
+	// The highest number of BulletActors that have been in flight at the same time.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = BulletPool)
+	int32 HighWater = 0;
+};
+
+/**
+ * The BulletPoolSubsystem keeps a pool of pre-spawned BulletActors so that firing
+ * doesn't have to spawn and destroy an actor for every shot.
+ */
+UCLASS()
+class ZOMBIEAI_API UBulletPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the BulletPoolSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Spawns BulletActors until the pool holds at least `Count` of them.
+	 *
+	 * @param Count The number of BulletActors the pool should hold.
+	 */
+	UFUNCTION(BlueprintCallable, Category = BulletPool)
+	void Prewarm(int32 Count);
+
+	/**
+	 * Takes a BulletActor from the free list, or spawns a new one if the free list is
+	 * empty, and launches it from the given transform.
+	 *
+	 * @param SpawnTransform The location and rotation to launch the BulletActor from.
+	 * @param Damage The damage the BulletActor should do.
+	 */
+	UFUNCTION(BlueprintCallable, Category = BulletPool)
+	ABulletActor* Acquire(const FTransform& SpawnTransform, float Damage);
+
+	/**
+	 * Deactivates the BulletActor and puts it back on the free list.
+	 *
+	 * @param BulletActor The BulletActor to return to the pool.
+	 */
+	UFUNCTION(BlueprintCallable, Category = BulletPool)
+	void Release(ABulletActor* BulletActor);
+
+	/**
+	 * Returns the counters of the pool.
+	 */
+	UFUNCTION(BlueprintPure, Category = BulletPool)
+	FBulletPoolStats GetStats() const { return Stats; }
+
+protected:
+	/**
+	 * Spawns a new inactive BulletActor that is owned by the pool.
+	 */
+	ABulletActor* SpawnPooledBullet();
+
+protected:
+	// Every BulletActor that the pool has spawned, used to keep them from being garbage collected.
+	UPROPERTY()
+	TArray<ABulletActor*> AllBullets;
+
+	// The BulletActors that are waiting to be fired.
+	UPROPERTY()
+	TArray<ABulletActor*> FreeBullets;
+
+	// The counters of the pool.
+	FBulletPoolStats Stats;
+};
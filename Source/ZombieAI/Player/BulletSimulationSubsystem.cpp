@@ -0,0 +1,300 @@
+#include "BulletSimulationSubsystem.h"
+#include "BulletActor.h"
+#include "PlayerCharacter.h"
+#include "../Zombie/ZombieCharacter.h"
+#include "../Zombie/ZombieDamageSubsystem.h"
+#include "../Zombie/ZombieLagCompensationSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "Engine/StaticMesh.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+
+/**
+ * Called when the BulletSimulationSubsystem is created for a world.
+ */
+void UBulletSimulationSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Copy the flight settings from the default BulletActor so that simulated bullets fly
+	// the same way as BulletActors do.
+	const ABulletActor* DefaultBullet = GetDefault<ABulletActor>();
+	if (DefaultBullet == nullptr) return;
+
+	if (DefaultBullet->BulletMovement != nullptr)
+	{
+		BulletSpeed = DefaultBullet->BulletMovement->InitialSpeed;
+		BulletGravityScale = DefaultBullet->BulletMovement->ProjectileGravityScale;
+	}
+
+	if (DefaultBullet->BulletSphereCollider != nullptr)
+	{
+		BulletRadius = DefaultBullet->BulletSphereCollider->GetUnscaledSphereRadius();
+	}
+
+	if (DefaultBullet->BulletStaticMesh != nullptr)
+	{
+		BulletScale = DefaultBullet->BulletStaticMesh->GetRelativeScale3D();
+	}
+
+	BulletLifeSpan = DefaultBullet->LifeSpanInSeconds;
+}
+
+/**
+ * Called when the world that owns the BulletSimulationSubsystem is torn down.
+ */
+void UBulletSimulationSubsystem::Deinitialize()
+{
+	Bullets.Empty();
+	InstanceTransforms.Empty();
+	BulletHits.Empty();
+	BulletInstances = nullptr;
+
+	Super::Deinitialize();
+}
+
+/**
+ * Adds a new bullet to the simulation.
+ *
+ * @param Origin The location to fire the bullet from.
+ * @param Direction The direction to fire the bullet in.
+ * @param Damage The damage the bullet should do.
+ * @param Instigator The actor that fired the bullet. The bullet goes through it.
+ * @param RewindSeconds How far back to put the zombies the bullet is checked against. The
+ * bullet is still checked against the rest of the world as it is now.
+ */
+void UBulletSimulationSubsystem::FireBullet(const FVector& Origin, const FVector& Direction, float Damage, AActor* Instigator, float RewindSeconds)
+{
+	FSimulatedBullet& Bullet = Bullets.AddDefaulted_GetRef();
+	Bullet.Location = Origin;
+	Bullet.Velocity = Direction.GetSafeNormal() * BulletSpeed;
+	Bullet.Damage = Damage;
+	Bullet.Instigator = Instigator;
+	Bullet.Age = 0.f;
+	Bullet.RewindSeconds = RewindSeconds;
+}
+
+/**
+ * Called every frame while there are bullets in flight or instances left to clear.
+ */
+void UBulletSimulationSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::BULLETS);
+
+	SimulateBullets(DeltaTime);
+	RenderBullets();
+}
+
+/**
+ * Only tick while there is something to simulate or render.
+ */
+bool UBulletSimulationSubsystem::IsTickable() const
+{
+	if (IsTemplate()) return false;
+
+	return Bullets.Num() > 0 || (BulletInstances != nullptr && BulletInstances->GetInstanceCount() > 0);
+}
+
+TStatId UBulletSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBulletSimulationSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Moves every bullet, sweeps it against the world and removes the ones that hit
+ * something or ran out of life span.
+ */
+void UBulletSimulationSubsystem::SimulateBullets(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	const FVector Gravity(0.f, 0.f, World->GetGravityZ() * BulletGravityScale);
+	const FCollisionShape BulletShape = FCollisionShape::MakeSphere(BulletRadius);
+
+	// Bullets stop on the first static geometry, dynamic object, zombie or crowd steered zombie
+	// that they touch. They fly through PlayerCharacters, like BulletActors overlap them.
+	FCollisionObjectQueryParams ObjectQueryParams;
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Zombie);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(SimulatedBullet), false);
+
+	// Iterate backwards so that finished bullets can be swapped out of the array without
+	// skipping the bullet that takes their place.
+	for (int32 BulletIndex = Bullets.Num() - 1; BulletIndex >= 0; --BulletIndex)
+	{
+		FSimulatedBullet& Bullet = Bullets[BulletIndex];
+
+		Bullet.Age += DeltaTime;
+		if (Bullet.Age > BulletLifeSpan)
+		{
+			Bullets.RemoveAtSwap(BulletIndex, 1, false);
+			continue;
+		}
+
+		Bullet.Velocity += Gravity * DeltaTime;
+		const FVector Start = Bullet.Location;
+		const FVector End = Start + Bullet.Velocity * DeltaTime;
+
+		if (Bullet.RewindSeconds > 0.f)
+		{
+			FZombieHandle Zombie;
+			if (!SweepRewoundBullet(Bullet, Start, End, Zombie))
+			{
+				Bullet.Location = End;
+				continue;
+			}
+
+			UZombieDamageSubsystem* DamageSubsystem = Zombie.IsSet() ? World->GetSubsystem<UZombieDamageSubsystem>() : nullptr;
+			if (DamageSubsystem != nullptr) DamageSubsystem->QueueDamage(Zombie, Bullet.Damage);
+
+			Bullets.RemoveAtSwap(BulletIndex, 1, false);
+			continue;
+		}
+
+		// The bullet starts inside the shooter's capsule so it has to go through it.
+		QueryParams.ClearIgnoredActors();
+		QueryParams.AddIgnoredActor(Bullet.Instigator.Get());
+
+		World->SweepMultiByObjectType(BulletHits, Start, End, FQuat::Identity, ObjectQueryParams, BulletShape, QueryParams);
+
+		const FHitResult* FirstHit = nullptr;
+		for (const FHitResult& Hit : BulletHits)
+		{
+			if (Cast<APlayerCharacter>(Hit.GetActor()) != nullptr) continue;
+			if (FirstHit == nullptr || Hit.Time < FirstHit->Time) FirstHit = &Hit;
+		}
+
+		if (FirstHit == nullptr)
+		{
+			Bullet.Location = End;
+			continue;
+		}
+
+		// Do the same thing as `ABulletActor::OnBulletHitComponent` and damage the
+		// ZombieCharacter if that's what was hit.
+		AZombieCharacter* ZombieCharacter = Cast<AZombieCharacter>(FirstHit->GetActor());
+		if (ZombieCharacter != nullptr) ZombieCharacter->Hit(Bullet.Damage);
+
+		Bullets.RemoveAtSwap(BulletIndex, 1, false);
+	}
+}
+
+/**
+ * Sweeps a bullet that was fired with a rewind against the world without the zombies, and
+ * against the zombies where they were in the ZombieLagCompensationSubsystem's history.
+ *
+ * @param Bullet The bullet to sweep.
+ * @param Start Where the bullet was at the start of the tick.
+ * @param End Where the bullet is at the end of the tick if nothing stops it.
+ * @param OutZombie The zombie the bullet hit, if it hit one.
+ *
+ * @return Whether the bullet hit something.
+ */
+bool UBulletSimulationSubsystem::SweepRewoundBullet(const FSimulatedBullet& Bullet, const FVector& Start, const FVector& End, FZombieHandle& OutZombie)
+{
+	UWorld* World = GetWorld();
+	UZombieLagCompensationSubsystem* LagCompensation = World->GetSubsystem<UZombieLagCompensationSubsystem>();
+
+	// The zombies' capsules are where they are now, so every hit on one is skipped and the first
+	// of the rest stops the bullet. Crowd steered zombies aren't swept against at all, and
+	// PlayerCharacters are flown through.
+	FCollisionObjectQueryParams ObjectQueryParams;
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldStatic);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_WorldDynamic);
+	ObjectQueryParams.AddObjectTypesToQuery(ECC_Pawn);
+	// The bullet goes through the shooter's capsule, which it starts inside of.
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(RewoundBullet), false);
+	QueryParams.AddIgnoredActor(Bullet.Instigator.Get());
+
+	World->SweepMultiByObjectType(BulletHits, Start, End, FQuat::Identity, ObjectQueryParams, FCollisionShape::MakeSphere(BulletRadius), QueryParams);
+
+	float BlockingTime = 1.f;
+	bool bBlocked = false;
+	for (const FHitResult& Hit : BulletHits)
+	{
+		if (Hit.Time >= BlockingTime || Cast<AZombieCharacter>(Hit.GetActor()) != nullptr || Cast<APlayerCharacter>(Hit.GetActor()) != nullptr) continue;
+
+		BlockingTime = Hit.Time;
+		bBlocked = true;
+	}
+
+	// A zombie in front of whatever else the bullet hit, where it was when the bullet was fired
+	// on the shooter's screen, takes the hit instead.
+	FZombieRewindHit ZombieHit;
+	const float RewindTime = World->GetTimeSeconds() - Bullet.RewindSeconds;
+	if (LagCompensation != nullptr && LagCompensation->RewindTrace(Start, FMath::Lerp(Start, End, BlockingTime), RewindTime, BulletRadius, ZombieHit))
+	{
+		OutZombie = ZombieHit.Handle;
+		return true;
+	}
+
+	return bBlocked;
+}
+
+/**
+ * Updates the instanced static mesh so that there is one instance at the location
+ * of every bullet. There is no instanced static mesh on a dedicated server, so nothing
+ * is rendered there.
+ */
+void UBulletSimulationSubsystem::RenderBullets()
+{
+	if (BulletInstances == nullptr) CreateRenderer();
+	if (BulletInstances == nullptr) return;
+
+	// Grow or shrink the instances so there is exactly one for every bullet. Instances
+	// are removed from the end so that no other instance has to be moved.
+	const int32 NumBullets = Bullets.Num();
+	while (BulletInstances->GetInstanceCount() < NumBullets)
+	{
+		BulletInstances->AddInstance(FTransform::Identity);
+	}
+	while (BulletInstances->GetInstanceCount() > NumBullets)
+	{
+		BulletInstances->RemoveInstance(BulletInstances->GetInstanceCount() - 1);
+	}
+
+	if (NumBullets == 0) return;
+
+	InstanceTransforms.Reset(NumBullets);
+	for (const FSimulatedBullet& Bullet : Bullets)
+	{
+		InstanceTransforms.Add(FTransform(Bullet.Velocity.Rotation(), Bullet.Location, BulletScale));
+	}
+
+	BulletInstances->BatchUpdateInstancesTransforms(0, InstanceTransforms, true, true, true);
+}
+
+/**
+ * Spawns the actor that owns the instanced static mesh used to render the bullets.
+ */
+void UBulletSimulationSubsystem::CreateRenderer()
+{
+	// A dedicated server has nobody to draw the bullets for.
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->GetNetMode() == NM_DedicatedServer) return;
+
+	const ABulletActor* DefaultBullet = GetDefault<ABulletActor>();
+	if (DefaultBullet == nullptr || DefaultBullet->BulletStaticMesh == nullptr) return;
+
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AActor* Renderer = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, ActorSpawnParams);
+	if (Renderer == nullptr) return;
+
+	// The instances are only visual, collision is handled by the sweeps in `SimulateBullets`.
+	BulletInstances = NewObject<UInstancedStaticMeshComponent>(Renderer, TEXT("BulletInstances"));
+	BulletInstances->SetMobility(EComponentMobility::Movable);
+	BulletInstances->SetStaticMesh(DefaultBullet->BulletStaticMesh->GetStaticMesh());
+	BulletInstances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	BulletInstances->SetCastShadow(false);
+	Renderer->SetRootComponent(BulletInstances);
+	BulletInstances->RegisterComponent();
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "../Zombie/ZombieHandle.h"
+#include "BulletSimulationSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+
+/**
+ * A bullet that is simulated by the BulletSimulationSubsystem instead of being an actor.
+ */
+struct FSimulatedBullet
+{
+	// The current location of the bullet.
+	FVector Location;
+
+	// The current velocity of the bullet.
+	FVector Velocity;
+
+	// The damage the bullet should do.
+	float Damage;
+
+	// The actor that fired the bullet, which the bullet goes through.
+	TWeakObjectPtr<AActor> Instigator;
+
+	// The amount of time that the bullet has been in flight.
+	float Age;
+
+	// How far back the zombies are put for the bullet, for bullets fired by clients that saw
+	// the zombies late.
+	float RewindSeconds;
+};
+
+/**
+ * The BulletSimulationSubsystem moves every simulated bullet in one tick, sweeps them
+ * against the world and renders them all with one instanced static mesh. It uses the
+ * speed, size and life span of the default BulletActor so both fire modes behave the same.
+ */
+UCLASS()
+class ZOMBIEAI_API UBulletSimulationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the BulletSimulationSubsystem is created for a world.
+	 */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/**
+	 * Called when the world that owns the BulletSimulationSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Adds a new bullet to the simulation.
+	 *
+	 * @param Origin The location to fire the bullet from.
+	 * @param Direction The direction to fire the bullet in.
+	 * @param Damage The damage the bullet should do.
+	 * @param Instigator The actor that fired the bullet. The bullet goes through it.
+	 * @param RewindSeconds How far back to put the zombies the bullet is checked against. The
+	 * bullet is still checked against the rest of the world as it is now.
+	 */
+	UFUNCTION(BlueprintCallable, Category = BulletSimulation)
+	void FireBullet(const FVector& Origin, const FVector& Direction, float Damage, AActor* Instigator, float RewindSeconds = 0.f);
+
+	/**
+	 * Returns the number of bullets that are currently in flight.
+	 */
+	UFUNCTION(BlueprintPure, Category = BulletSimulation)
+	int32 GetNumBullets() const { return Bullets.Num(); }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Moves every bullet, sweeps it against the world and removes the ones that hit
+	 * something or ran out of life span.
+	 */
+	void SimulateBullets(float DeltaTime);
+
+	/**
+	 * Sweeps a bullet that was fired with a rewind against the world without the zombies, and
+	 * against the zombies where they were in the ZombieLagCompensationSubsystem's history.
+	 *
+	 * @param Bullet The bullet to sweep.
+	 * @param Start Where the bullet was at the start of the tick.
+	 * @param End Where the bullet is at the end of the tick if nothing stops it.
+	 * @param OutZombie The zombie the bullet hit, if it hit one.
+	 *
+	 * @return Whether the bullet hit something.
+	 */
+	bool SweepRewoundBullet(const FSimulatedBullet& Bullet, const FVector& Start, const FVector& End, FZombieHandle& OutZombie);
+
+	/**
+	 * Updates the instanced static mesh so that there is one instance at the location
+	 * of every bullet. There is no instanced static mesh on a dedicated server, so nothing
+	 * is rendered there.
+	 */
+	void RenderBullets();
+
+	/**
+	 * Spawns the actor that owns the instanced static mesh used to render the bullets.
+	 */
+	void CreateRenderer();
+
+protected:
+	// The bullets that are currently in flight, stored contiguously so that they can be
+	// updated in one pass.
+	TArray<FSimulatedBullet> Bullets;
+
+	// Scratch space for the instance transforms so that it doesn't have to be allocated
+	// every frame.
+	TArray<FTransform> InstanceTransforms;
+
+	// Scratch space for the hits of the bullet sweeps.
+	TArray<FHitResult> BulletHits;
+
+	// The instanced static mesh used to render every bullet.
+	UPROPERTY()
+	UInstancedStaticMeshComponent* BulletInstances;
+
+	// The speed that the bullets are fired at.
+	float BulletSpeed = 3000.f;
+
+	// The radius of the sphere that the bullets are swept with.
+	float BulletRadius = 20.f;
+
+	// The amount of time that a bullet stays in flight before it's removed.
+	float BulletLifeSpan = 3.f;
+
+	// How much of the world's gravity is applied to the bullets.
+	float BulletGravityScale = 1.f;
+
+	// The scale of the bullet mesh instances.
+	FVector BulletScale = FVector(0.1f, 0.1f, 0.1f);
+};
@@ -0,0 +1,120 @@
+#include "GrenadeActor.h"
+#include "Components/PointLightComponent.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Net/UnrealNetwork.h"
+#include "TimerManager.h"
+
+/**
+ * Sets the default values of the GrenadeActor.
+ */
+AGrenadeActor::AGrenadeActor()
+{
+	// Load the GrenadeActor's mesh, which is the same sphere that the BulletActor uses.
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> GrenadeStaticMeshAsset(TEXT("StaticMesh'/Game/FirstPerson/Meshes/FirstPersonProjectileMesh.FirstPersonProjectileMesh'"));
+
+	// The Projectile collision profile bounces off the world but passes through players and
+	// zombies, so the GrenadeActor doesn't stop on the PlayerCharacter that threw it.
+	GrenadeSphereCollider = CreateDefaultSubobject<USphereComponent>(TEXT("GrenadeSphereCollider"));
+	GrenadeSphereCollider->InitSphereRadius(10.f);
+	GrenadeSphereCollider->BodyInstance.SetCollisionProfileName(TEXT("Projectile"));
+	RootComponent = GrenadeSphereCollider;
+
+	GrenadeStaticMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("GrenadeStaticMesh"));
+	GrenadeStaticMesh->SetStaticMesh(GrenadeStaticMeshAsset.Object);
+	GrenadeStaticMesh->SetRelativeScale3D(FVector(0.15f, 0.15f, 0.15f));
+	GrenadeStaticMesh->BodyInstance.SetCollisionProfileName(TEXT("NoCollision"));
+	GrenadeStaticMesh->SetupAttachment(RootComponent);
+
+	// The light stays off until the GrenadeActor explodes.
+	ExplosionLight = CreateDefaultSubobject<UPointLightComponent>(TEXT("ExplosionLight"));
+	ExplosionLight->SetIntensity(50000.f);
+	ExplosionLight->SetAttenuationRadius(1000.f);
+	ExplosionLight->SetLightColor(FLinearColor(1.f, 0.6f, 0.2f));
+	ExplosionLight->SetVisibility(false);
+	ExplosionLight->SetupAttachment(RootComponent);
+
+	// Create the ProjectileMovementComponent. `Throw` gives it its velocity.
+	GrenadeMovement = CreateDefaultSubobject<UProjectileMovementComponent>(TEXT("GrenadeMovement"));
+	GrenadeMovement->UpdatedComponent = GrenadeSphereCollider;
+	GrenadeMovement->InitialSpeed = 0.f;
+	GrenadeMovement->MaxSpeed = 3000.f;
+	GrenadeMovement->bShouldBounce = true;
+	GrenadeMovement->Bounciness = 0.3f;
+	GrenadeMovement->Friction = 0.5f;
+
+	bReplicates = true;
+	SetReplicateMovement(true);
+}
+
+/**
+ * Launches the GrenadeActor and starts its fuse. Only called on the server.
+ *
+ * @param Velocity The velocity to launch the GrenadeActor with.
+ * @param InBlast The area that the GrenadeActor damages when it explodes. Its origin is
+ * wherever the GrenadeActor ends up.
+ * @param FuseInSeconds The number of seconds until the GrenadeActor explodes.
+ */
+void AGrenadeActor::Throw(const FVector& Velocity, const FZombieAreaDamage& InBlast, float FuseInSeconds)
+{
+	Blast = InBlast;
+
+	GrenadeMovement->Velocity = Velocity;
+	GrenadeMovement->UpdateComponentVelocity();
+
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+	World->GetTimerManager().SetTimer(FuseTimer, this, &AGrenadeActor::Explode, FMath::Max(FuseInSeconds, KINDA_SMALL_NUMBER), false);
+}
+
+/**
+ * Returns the properties of the GrenadeActor that are replicated to clients.
+ */
+void AGrenadeActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AGrenadeActor, bExploded);
+}
+
+/**
+ * Called on the server when the GrenadeActor's fuse runs out to damage the zombies around it.
+ */
+void AGrenadeActor::Explode()
+{
+	UWorld* World = GetWorld();
+	UZombieAreaDamageSubsystem* AreaDamage = (World != nullptr) ? World->GetSubsystem<UZombieAreaDamageSubsystem>() : nullptr;
+
+	Blast.Origin = GetActorLocation();
+	if (AreaDamage != nullptr) AreaDamage->ApplyAreaDamage(Blast);
+
+	// Clients play the explosion when `bExploded` reaches them, so the GrenadeActor sticks
+	// around for the length of the flash before it's destroyed.
+	bExploded = true;
+	PlayExplosion();
+	SetLifeSpan(FMath::Max(ExplosionFlashInSeconds, KINDA_SMALL_NUMBER));
+}
+
+/**
+ * Called on clients when the GrenadeActor explodes on the server.
+ */
+void AGrenadeActor::OnRep_Exploded()
+{
+	if (bExploded) PlayExplosion();
+}
+
+/**
+ * Stops the GrenadeActor, hides its mesh and shows the flash, the particle system and the
+ * sound of the explosion.
+ */
+void AGrenadeActor::PlayExplosion()
+{
+	GrenadeMovement->StopMovementImmediately();
+	GrenadeStaticMesh->SetVisibility(false);
+	ExplosionLight->SetVisibility(true);
+
+	if (ExplosionEffect != nullptr) UGameplayStatics::SpawnEmitterAtLocation(this, ExplosionEffect, GetActorLocation());
+	if (ExplosionSound != nullptr) UGameplayStatics::PlaySoundAtLocation(this, ExplosionSound, GetActorLocation());
+}
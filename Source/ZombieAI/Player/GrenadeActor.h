@@ -0,0 +1,94 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "../Zombie/ZombieAreaDamageSubsystem.h"
+#include "GrenadeActor.generated.h"
+
+/**
+ * The GrenadeActor is the grenade that the PlayerCharacter throws. The server launches it,
+ * lets it bounce around until its fuse runs out and then damages the zombies around it with
+ * the ZombieAreaDamageSubsystem. Everyone sees it fly and sees the flash when it explodes.
+ */
+UCLASS()
+class ZOMBIEAI_API AGrenadeActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties.
+	AGrenadeActor();
+
+	// The sphere collider of the GrenadeActor.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	class USphereComponent* GrenadeSphereCollider;
+
+	// The static mesh of the GrenadeActor.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	class UStaticMeshComponent* GrenadeStaticMesh;
+
+	// The projectile movement component of the GrenadeActor.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	class UProjectileMovementComponent* GrenadeMovement;
+
+	// The light that flashes when the GrenadeActor explodes.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	class UPointLightComponent* ExplosionLight;
+
+	// The particle system to play where the GrenadeActor explodes, if any.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	class UParticleSystem* ExplosionEffect;
+
+	// The sound to play where the GrenadeActor explodes, if any.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	class USoundBase* ExplosionSound;
+
+	// The number of seconds that the flash of the explosion lasts before the GrenadeActor is
+	// destroyed.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float ExplosionFlashInSeconds = 0.25f;
+
+	/**
+	 * Launches the GrenadeActor and starts its fuse. Only called on the server.
+	 *
+	 * @param Velocity The velocity to launch the GrenadeActor with.
+	 * @param InBlast The area that the GrenadeActor damages when it explodes. Its origin is
+	 * wherever the GrenadeActor ends up.
+	 * @param FuseInSeconds The number of seconds until the GrenadeActor explodes.
+	 */
+	void Throw(const FVector& Velocity, const FZombieAreaDamage& InBlast, float FuseInSeconds);
+
+	/**
+	 * Returns the properties of the GrenadeActor that are replicated to clients.
+	 */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+	/**
+	 * Called on the server when the GrenadeActor's fuse runs out to damage the zombies around it.
+	 */
+	void Explode();
+
+	/**
+	 * Called on clients when the GrenadeActor explodes on the server.
+	 */
+	UFUNCTION()
+	void OnRep_Exploded();
+
+	/**
+	 * Stops the GrenadeActor, hides its mesh and shows the flash, the particle system and the
+	 * sound of the explosion.
+	 */
+	void PlayExplosion();
+
+protected:
+	// Whether the GrenadeActor has exploded.
+	UPROPERTY(ReplicatedUsing = OnRep_Exploded)
+	bool bExploded = false;
+
+	// The area that the GrenadeActor damages when it explodes.
+	FZombieAreaDamage Blast;
+
+	// The timer used to explode the GrenadeActor once its fuse runs out.
+	FTimerHandle FuseTimer;
+};
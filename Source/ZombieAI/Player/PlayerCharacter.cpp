@@ -1,5 +1,12 @@
 #include "PlayerCharacter.h"
 #include "BulletActor.h"
+#include "BulletPoolSubsystem.h"
+#include "BulletSimulationSubsystem.h"
+#include "GrenadeActor.h"
+#include "../Zombie/ZombieSightSubsystem.h"
+#include "../Zombie/ZombieAttackRangeSubsystem.h"
+#include "../Zombie/ZombieAreaDamageSubsystem.h"
+#include "../Zombie/ZombieLagCompensationSubsystem.h"
 #include "Kismet/GameplayStatics.h"
 #include "Animation/AnimInstance.h"
 #include "Camera/CameraComponent.h"
@@ -8,8 +15,14 @@
 #include "Components/InputComponent.h"
 #include "GameFramework/InputSettings.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/GameStateBase.h"
 #include "Perception/AISense_Sight.h"
 #include "Perception/AIPerceptionStimuliSourceComponent.h"
+#include "TimerManager.h"
+
+// Shots and throws can reach the server closer together than a client sent them when the
+// network is jittery, so the server lets them through this many seconds early.
+static const float CooldownTolerance = 0.1f;
 
 /**
  * Sets the default value from the PlayerCharacter
@@ -75,6 +88,45 @@ APlayerCharacter::APlayerCharacter()
 	AutoPossessPlayer = EAutoReceiveInput::Player0;
 }
 
+/**
+ * Called when the game starts.
+ */
+void APlayerCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	// Let the zombies that use shared sight see the PlayerCharacter.
+	UZombieSightSubsystem* SightSubsystem = World->GetSubsystem<UZombieSightSubsystem>();
+	if (SightSubsystem != nullptr) SightSubsystem->RegisterPlayer(this);
+
+	// Let the zombies reach for the PlayerCharacter.
+	UZombieAttackRangeSubsystem* AttackRange = World->GetSubsystem<UZombieAttackRangeSubsystem>();
+	if (AttackRange != nullptr) AttackRange->RegisterPlayer(this);
+
+	// Fill the bullet pool up front so that the first shots don't have to spawn actors.
+	UBulletPoolSubsystem* BulletPool = World->GetSubsystem<UBulletPoolSubsystem>();
+	if (BulletPool == nullptr) return;
+	BulletPool->Prewarm(BulletPoolSize);
+}
+
+/**
+ * Called when the PlayerCharacter is removed from the world.
+ */
+void APlayerCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UWorld* World = GetWorld();
+	UZombieSightSubsystem* SightSubsystem = (World != nullptr) ? World->GetSubsystem<UZombieSightSubsystem>() : nullptr;
+	if (SightSubsystem != nullptr) SightSubsystem->UnregisterPlayer(this);
+
+	UZombieAttackRangeSubsystem* AttackRange = (World != nullptr) ? World->GetSubsystem<UZombieAttackRangeSubsystem>() : nullptr;
+	if (AttackRange != nullptr) AttackRange->UnregisterPlayer(this);
+
+	Super::EndPlay(EndPlayReason);
+}
+
 /**
  * Called to bind functionality to input.
  */
@@ -97,6 +149,10 @@ void APlayerCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCom
 
 	// Bind the fire input action to the `Fire` method.
 	PlayerInputComponent->BindAction("Fire", IE_Pressed, this, &APlayerCharacter::Fire);
+
+	// Bind the area damage weapons' input actions to the `FireShotgun` and `ThrowGrenade` methods.
+	PlayerInputComponent->BindAction("FireShotgun", IE_Pressed, this, &APlayerCharacter::FireShotgun);
+	PlayerInputComponent->BindAction("ThrowGrenade", IE_Pressed, this, &APlayerCharacter::ThrowGrenade);
 }
 
 /**
@@ -120,9 +176,11 @@ void APlayerCharacter::MoveLeftRight(float Value)
  */
 void APlayerCharacter::Fire()
 {
-	// Return early if `GetWorld()` returns a nullptr.
+	// The server ignores shots that come too soon, so a client doesn't fire them either. A client
+	// keeps its own time of the last shot, while the server's is set when the shot reaches it.
 	UWorld* const World = GetWorld();
-	if (World == nullptr) return;
+	if (World == nullptr || !HasCooledDown(LastFireTime, FireCooldownInSeconds)) return;
+	LastFireTime = World->GetTimeSeconds();
 
 	const FRotator SpawnRotation = GetControlRotation();
 
@@ -131,14 +189,27 @@ void APlayerCharacter::Fire()
 	// bullet spawn location.
 	const FVector SpawnLocation = ((BulletSpawnLocation != nullptr) ? BulletSpawnLocation->GetComponentLocation() : GetActorLocation()) + SpawnRotation.RotateVector(GunOffset);
 
-	// Set Spawn Collision Handling Override.
-	FActorSpawnParameters ActorSpawnParams;
-	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+	if (BulletMode == BulletModes::SIMULATED)
+	{
+		// Add a bullet to the simulation which moves and renders every bullet in one tick.
+		UBulletSimulationSubsystem* BulletSimulation = World->GetSubsystem<UBulletSimulationSubsystem>();
+		if (BulletSimulation != nullptr) BulletSimulation->FireBullet(SpawnLocation, SpawnRotation.Vector(), Damage, this);
+	}
+	else
+	{
+		// Take a BulletActor from the pool and launch it with the `Damage` value.
+		UBulletPoolSubsystem* BulletPool = World->GetSubsystem<UBulletPoolSubsystem>();
+		if (BulletPool != nullptr) BulletPool->Acquire(FTransform(SpawnRotation, SpawnLocation, FVector(1.f, 1.f, 1.f)), Damage);
+	}
 
-	// Spawn the BulletActor and pass the `Damage` value over to it.
-	ABulletActor* BulletActor = World->SpawnActorDeferred<ABulletActor>(ABulletActor::StaticClass(), FTransform::Identity, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding);
-	BulletActor->Damage = Damage;
-	UGameplayStatics::FinishSpawningActor(BulletActor, FTransform(SpawnRotation, SpawnLocation, FVector(1.f, 1.f, 1.f)));
+	// The bullet above only shows the shot on a client, since only the server damages zombies.
+	// The server gets the shot with the time the client saw so it can check it against the
+	// zombies where the client saw them.
+	if (!HasAuthority())
+	{
+		const AGameStateBase* GameState = World->GetGameState();
+		ServerFire(SpawnLocation, SpawnRotation.Vector(), (GameState != nullptr) ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds());
+	}
 
 	// Get the animation object for the PlayerCharacter's body mesh and play the fire animation.
 	UAnimInstance* AnimInstance = PlayerSkeletalMesh->GetAnimInstance();
@@ -146,3 +217,157 @@ void APlayerCharacter::Fire()
 
 	AnimInstance->Montage_Play(GunFireAnimation, 1.f);
 }
+
+/**
+ * Called on the server when a client fires. The bullet is simulated on the server and checked
+ * against where the zombies were on the client's screen when it fired. Shots that come before
+ * the gun has cooled down are ignored.
+ *
+ * @param Origin Where the bullet was fired from on the client.
+ * @param Direction The direction the bullet was fired in.
+ * @param ClientTime The server world time on the client when it fired.
+ */
+void APlayerCharacter::ServerFire_Implementation(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float ClientTime)
+{
+	UWorld* const World = GetWorld();
+	UBulletSimulationSubsystem* BulletSimulation = (World != nullptr) ? World->GetSubsystem<UBulletSimulationSubsystem>() : nullptr;
+	if (BulletSimulation == nullptr) return;
+
+	// The client's PlayerCharacter can be a little ahead of the server's, but not by much.
+	if (FVector::DistSquared(Origin, GetActorLocation()) > FMath::Square(MaxFireOriginDistance)) return;
+	if (!HasCooledDown(LastFireTime, FireCooldownInSeconds, CooldownTolerance)) return;
+	LastFireTime = World->GetTimeSeconds();
+
+	// Rewinding only works for bullets that the BulletSimulationSubsystem sweeps itself, so
+	// client shots are simulated no matter how the gun fires its own bullets.
+	UZombieLagCompensationSubsystem* LagCompensation = World->GetSubsystem<UZombieLagCompensationSubsystem>();
+	const float RewindSeconds = (LagCompensation != nullptr) ? LagCompensation->GetRewindSeconds(ClientTime) : 0.f;
+	BulletSimulation->FireBullet(Origin, Direction, Damage, this, RewindSeconds);
+}
+
+bool APlayerCharacter::ServerFire_Validate(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float ClientTime)
+{
+	return !Origin.ContainsNaN() && !Direction.IsNearlyZero() && FMath::IsFinite(ClientTime);
+}
+
+/**
+ * Called when the "FireShotgun" input action button is pressed.
+ */
+void APlayerCharacter::FireShotgun()
+{
+	// The server ignores shots that come too soon, so a client doesn't send them either. A client
+	// keeps its own time of the last shot, while the server's is set when the shot reaches it.
+	UWorld* const World = GetWorld();
+	if (World == nullptr || !HasCooledDown(LastShotgunFireTime, ShotgunCooldownInSeconds)) return;
+	if (!HasAuthority()) LastShotgunFireTime = World->GetTimeSeconds();
+
+	// The pellets spread out in a cone from the camera along the PlayerCharacter's aim. Only the
+	// server damages zombies, so the shot is sent there, and a listen server runs it right away.
+	const FVector Origin = (PlayerCamera != nullptr) ? PlayerCamera->GetComponentLocation() : GetActorLocation();
+	ServerFireShotgun(Origin, GetControlRotation().Vector());
+
+	UAnimInstance* AnimInstance = PlayerSkeletalMesh->GetAnimInstance();
+	if (AnimInstance == nullptr) return;
+
+	AnimInstance->Montage_Play(GunFireAnimation, 1.f);
+}
+
+/**
+ * Called on the server when the PlayerCharacter fires the shotgun, to damage the zombies in
+ * the cone of pellets that no wall is in front of. Shots that come before the shotgun has
+ * cooled down are ignored.
+ *
+ * @param Origin Where the shotgun was fired from on the client.
+ * @param Direction The direction the shotgun was fired in.
+ */
+void APlayerCharacter::ServerFireShotgun_Implementation(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction)
+{
+	UWorld* const World = GetWorld();
+	UZombieAreaDamageSubsystem* AreaDamage = (World != nullptr) ? World->GetSubsystem<UZombieAreaDamageSubsystem>() : nullptr;
+	if (AreaDamage == nullptr) return;
+
+	if (FVector::DistSquared(Origin, GetActorLocation()) > FMath::Square(MaxFireOriginDistance)) return;
+	if (!HasCooledDown(LastShotgunFireTime, ShotgunCooldownInSeconds, CooldownTolerance)) return;
+	LastShotgunFireTime = World->GetTimeSeconds();
+
+	FZombieAreaDamage Cone;
+	Cone.Origin = Origin;
+	Cone.Direction = Direction;
+	Cone.Radius = ShotgunRange;
+	Cone.ConeHalfAngleDegrees = ShotgunConeHalfAngleDegrees;
+	Cone.Damage = ShotgunDamage;
+	Cone.EdgeDamageScale = ShotgunEdgeDamageScale;
+	AreaDamage->ApplyAreaDamage(Cone);
+}
+
+bool APlayerCharacter::ServerFireShotgun_Validate(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction)
+{
+	return !Origin.ContainsNaN() && !Direction.IsNearlyZero();
+}
+
+/**
+ * Called when the "ThrowGrenade" input action button is pressed.
+ */
+void APlayerCharacter::ThrowGrenade()
+{
+	UWorld* const World = GetWorld();
+	if (World == nullptr || !HasCooledDown(LastGrenadeThrowTime, GrenadeCooldownInSeconds)) return;
+	if (!HasAuthority()) LastGrenadeThrowTime = World->GetTimeSeconds();
+
+	// Only the server damages zombies, so the grenade is thrown there, and a listen server
+	// throws it right away.
+	const FVector Origin = (PlayerCamera != nullptr) ? PlayerCamera->GetComponentLocation() : GetActorLocation();
+	ServerThrowGrenade(Origin, GetControlRotation().Vector());
+}
+
+/**
+ * Called on the server when the PlayerCharacter throws a grenade, to launch a GrenadeActor.
+ * Throws that come before the last grenade has cooled down are ignored.
+ *
+ * @param Origin Where the grenade was thrown from on the client.
+ * @param Direction The direction the grenade was thrown in.
+ */
+void APlayerCharacter::ServerThrowGrenade_Implementation(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction)
+{
+	UWorld* const World = GetWorld();
+	if (World == nullptr) return;
+
+	if (FVector::DistSquared(Origin, GetActorLocation()) > FMath::Square(MaxFireOriginDistance)) return;
+	if (!HasCooledDown(LastGrenadeThrowTime, GrenadeCooldownInSeconds, CooldownTolerance)) return;
+	LastGrenadeThrowTime = World->GetTimeSeconds();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
+	SpawnParams.Instigator = this;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AGrenadeActor* Grenade = World->SpawnActor<AGrenadeActor>(AGrenadeActor::StaticClass(), Origin, Direction.Rotation(), SpawnParams);
+	if (Grenade == nullptr) return;
+
+	FZombieAreaDamage Blast;
+	Blast.Radius = GrenadeRadius;
+	Blast.Damage = GrenadeDamage;
+	Blast.EdgeDamageScale = GrenadeEdgeDamageScale;
+	Grenade->Throw(Direction * GrenadeThrowSpeed + GetVelocity(), Blast, GrenadeFuseInSeconds);
+}
+
+bool APlayerCharacter::ServerThrowGrenade_Validate(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction)
+{
+	return !Origin.ContainsNaN() && !Direction.IsNearlyZero();
+}
+
+/**
+ * Returns whether the cooldown that started at the time has run out.
+ *
+ * @param LastTime The world time that the gun or the shotgun was last fired or a grenade last
+ * thrown.
+ * @param CooldownInSeconds The length of the cooldown.
+ * @param Tolerance The number of seconds early that the cooldown counts as run out.
+ */
+bool APlayerCharacter::HasCooledDown(float LastTime, float CooldownInSeconds, float Tolerance) const
+{
+	const UWorld* const World = GetWorld();
+	if (World == nullptr) return false;
+
+	return World->GetTimeSeconds() - LastTime >= CooldownInSeconds - Tolerance;
+}
@@ -6,6 +6,15 @@
 
 class USkeletalMeshComponent;
 
+/**
+ * The ways that the PlayerCharacter's gun can fire bullets.
+ */
+UENUM(BlueprintType)
+enum class BulletModes : uint8 {
+	ACTOR		UMETA(DisplayName = "ACTOR"),
+	SIMULATED	UMETA(DisplayName = "SIMULATED"),
+};
+
 /**
  * The PlayerCharacter is the main player of the game.
  */
@@ -51,7 +60,81 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
 	float Damage = 10.f;
 
+	// The number of BulletActors to pre-spawn in the BulletPoolSubsystem when the game
+	// starts. If the pool reports misses then this should be raised.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	int32 BulletPoolSize = 32;
+
+	// How the gun fires its bullets. ACTOR fires pooled BulletActors while SIMULATED fires
+	// bullets that are moved and rendered in bulk by the BulletSimulationSubsystem, which
+	// is much cheaper when there are a lot of bullets in flight.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	BulletModes BulletMode = BulletModes::ACTOR;
+
+	// The number of seconds the gun takes to be ready again after it's fired.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float FireCooldownInSeconds = 0.25f;
+
+	// The damage the shotgun does to zombies right in front of its muzzle.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float ShotgunDamage = 60.f;
+
+	// How far the shotgun's cone of pellets reaches.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float ShotgunRange = 1200.f;
+
+	// The angle between the aim and the side of the shotgun's cone of pellets.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float ShotgunConeHalfAngleDegrees = 15.f;
+
+	// The fraction of the shotgun's damage that's left at the end of its range.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float ShotgunEdgeDamageScale = 0.2f;
+
+	// The damage a grenade does to zombies right where it explodes.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float GrenadeDamage = 150.f;
+
+	// How far from where it explodes a grenade damages zombies.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float GrenadeRadius = 600.f;
+
+	// The fraction of a grenade's damage that's left at the edge of the blast.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float GrenadeEdgeDamageScale = 0.25f;
+
+	// How fast a grenade leaves the PlayerCharacter's hand.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float GrenadeThrowSpeed = 1500.f;
+
+	// The number of seconds between throwing a grenade and it exploding.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float GrenadeFuseInSeconds = 1.5f;
+
+	// The number of seconds the shotgun takes to be ready again after it's fired.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float ShotgunCooldownInSeconds = 1.f;
+
+	// The number of seconds before the PlayerCharacter can throw another grenade.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float GrenadeCooldownInSeconds = 2.f;
+
+	// How far from the PlayerCharacter on the server a client's shot can start before the server
+	// ignores it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Player)
+	float MaxFireOriginDistance = 500.f;
+
 protected:
+	/**
+	 * Called when the game starts.
+	 */
+	virtual void BeginPlay() override;
+
+	/**
+	 * Called when the PlayerCharacter is removed from the world.
+	 */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	/**
 	 * Called to bind functionality to input.
 	 */
@@ -71,4 +154,64 @@ protected:
 	 * Called when the "Fire" input action button is pressed.
 	 */
 	void Fire();
+
+	/**
+	 * Called on the server when a client fires. The bullet is simulated on the server and checked
+	 * against where the zombies were on the client's screen when it fired. Shots that come before
+	 * the gun has cooled down are ignored.
+	 *
+	 * @param Origin Where the bullet was fired from on the client.
+	 * @param Direction The direction the bullet was fired in.
+	 * @param ClientTime The server world time on the client when it fired.
+	 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFire(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction, float ClientTime);
+
+	/**
+	 * Called when the "FireShotgun" input action button is pressed.
+	 */
+	void FireShotgun();
+
+	/**
+	 * Called on the server when the PlayerCharacter fires the shotgun, to damage the zombies in
+	 * the cone of pellets that no wall is in front of. Shots that come before the shotgun has
+	 * cooled down are ignored.
+	 *
+	 * @param Origin Where the shotgun was fired from on the client.
+	 * @param Direction The direction the shotgun was fired in.
+	 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFireShotgun(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction);
+
+	/**
+	 * Called when the "ThrowGrenade" input action button is pressed.
+	 */
+	void ThrowGrenade();
+
+	/**
+	 * Called on the server when the PlayerCharacter throws a grenade, to launch a GrenadeActor.
+	 * Throws that come before the last grenade has cooled down are ignored.
+	 *
+	 * @param Origin Where the grenade was thrown from on the client.
+	 * @param Direction The direction the grenade was thrown in.
+	 */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerThrowGrenade(FVector_NetQuantize Origin, FVector_NetQuantizeNormal Direction);
+
+	/**
+	 * Returns whether the cooldown that started at the time has run out.
+	 *
+	 * @param LastTime The world time that the gun or the shotgun was last fired or a grenade last
+	 * thrown.
+	 * @param CooldownInSeconds The length of the cooldown.
+	 * @param Tolerance The number of seconds early that the cooldown counts as run out.
+	 */
+	bool HasCooledDown(float LastTime, float CooldownInSeconds, float Tolerance = 0.f) const;
+
+protected:
+	// The world time that the gun and the shotgun were last fired and a grenade was last thrown.
+	// The server keeps its own so that clients can't fire faster than the cooldowns allow.
+	float LastFireTime = -BIG_NUMBER;
+	float LastShotgunFireTime = -BIG_NUMBER;
+	float LastGrenadeThrowTime = -BIG_NUMBER;
 };
@@ -1,11 +1,29 @@
 #include "ZombieAIController.h"
 #include "ZombieCharacter.h"
+#include "ZombieBrain.h"
+#include "ZombieCrowdSubsystem.h"
+#include "ZombieLODSubsystem.h"
+#include "ZombieSightSubsystem.h"
+#include "ZombieFlowFieldSubsystem.h"
+#include "ZombieRoamPointSubsystem.h"
 #include "../Player/PlayerCharacter.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
 #include "Perception/AISense_Sight.h"
 #include "Perception/AISenseConfig_Sight.h"
 #include "Perception/AIPerceptionComponent.h"
-#include "Kismet/KismetMathLibrary.h"
-#include "Components/BoxComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "NavigationSystem.h"
+
+static TAutoConsoleVariable<int32> CVarZombiePathsAsync(
+	TEXT("zombie.Paths.Async"),
+	1,
+	TEXT("Whether roam paths are found on the navigation system's worker (1) or on the game thread as soon as they're asked for (0)."),
+	ECVF_Default);
 
 /**
  * Sets the default values for the ZombieAIController.
@@ -43,7 +61,30 @@ void AZombieAIController::BeginPlay()
 	Super::BeginPlay();
 
 	// Put the ZombieCharacter in the IDLE or ROAM state depending on whether they can roam or not.
-	IdleOrRoam();
+	// This goes through the ZombieThinkScheduler so that a wave of zombies starting at the same
+	// time doesn't make all of its decisions in one frame. Controllers spawned during play begin
+	// play before they take over their ZombieCharacter, so they do this in `OnPossess` instead.
+	if (GetPawn() != nullptr) RequestThink(ZombieThinkTypes::IDLE_OR_ROAM);
+}
+
+/**
+ * Called every frame. Chasing zombies steer along the flow field here.
+ */
+void AZombieAIController::Tick(float DeltaSeconds)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::MOVEMENT);
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_ControllerTick);
+
+	Super::Tick(DeltaSeconds);
+
+	if (ZombieCharacter == nullptr || !ChaseTarget.IsValid()) return;
+
+	// Zombies keep going after the PlayerCharacter while they attack, like they did when they
+	// followed a path.
+	const ZombieStates State = ZombieCharacter->GetState();
+	if (State != ZombieStates::CHASE && State != ZombieStates::ATTACK) return;
+
+	FollowChaseFlowField();
 }
 
 /**
@@ -58,43 +99,130 @@ void AZombieAIController::OnPossess(APawn* ZombiePawn)
 	// Attempt to cast the Pawn that was taken over to a ZombieCharacter and if
 	// successful then we assign it to our `ZombieCharacter` variable.
 	ZombieCharacter = Cast<AZombieCharacter>(ZombiePawn);
+	if (ZombieCharacter == nullptr) return;
+
+	// Seed the random choices from the ZombieCharacter's crowd slot so that a run with the same
+	// crowd seed makes the same choices, whatever else in the engine uses random numbers.
+	UZombieCrowdSubsystem* Crowd = GetWorld()->GetSubsystem<UZombieCrowdSubsystem>();
+	const FZombieHandle& CrowdHandle = ZombieCharacter->GetCrowdHandle();
+	RandomStream.Initialize(HashCombine(GetTypeHash((Crowd != nullptr) ? Crowd->GetRandomSeed() : 0), HashCombine(GetTypeHash(CrowdHandle.Index), GetTypeHash(CrowdHandle.Generation))));
+
+	ZombiePerception->SetSenseEnabled(UAISense_Sight::StaticClass(), true);
+	RegisterSharedSight();
 
-	// Bind the methods to respond to a component entering or exiting the ZombieCharacter's
-	// DamageCollider component.
-	ZombieCharacter->ZombieDamageCollider->OnComponentBeginOverlap.AddDynamic(this, &AZombieAIController::OnComponentEnterDamageCollider);
-	ZombieCharacter->ZombieDamageCollider->OnComponentEndOverlap.AddDynamic(this, &AZombieAIController::OnComponentLeaveDamageCollider);
+	// A controller taken from the ZombiePoolSubsystem has already begun play, so it decides
+	// what to do here.
+	if (HasActorBegunPlay()) RequestThink(ZombieThinkTypes::IDLE_OR_ROAM);
 }
 
 /**
- * Called when the AIController's perception is updated.
+ * Called when the ZombieAIController lets go of the ZombieCharacter. Everything the
+ * ZombieAIController was doing is dropped so that it can wait in the ZombiePoolSubsystem and
+ * take over another ZombieCharacter later.
  */
-void AZombieAIController::OnTargetPerceptionUpdate(AActor* Actor, FAIStimulus Stimulus)
+void AZombieAIController::OnUnPossess()
 {
-	// Get the Actors that have been perceived.
-	TArray<AActor*> PerceivedActors;
-	ZombiePerception->GetCurrentlyPerceivedActors(TSubclassOf<UAISense_Sight>(), PerceivedActors);
+	ResetState();
 
-	// Check to see if an Actor has been detected and is currently in the sight radius.
-	bool bPlayerIsInSight = PerceivedActors.Contains(Actor);
+	// Don't keep the level of detail tick rates of the old ZombieCharacter.
+	SetActorTickInterval(0.f);
+	if (GetPathFollowingComponent() != nullptr) GetPathFollowingComponent()->SetComponentTickInterval(0.f);
 
-	// If the Actor is not in the sight radius then we make sure to stop their movement
-	// and put them back in the IDLE or ROAM state.
-	if (!bPlayerIsInSight)
-	{
-		StopChase();
-		return;
-	}
+	ZombieCharacter = nullptr;
+
+	Super::OnUnPossess();
+}
+
+/**
+ * Drops everything the ZombieAIController is doing: its move, its timers, what it's chasing
+ * and what it has seen. Called when the ZombieCharacter dies and before the ZombieAIController
+ * goes back to the ZombiePoolSubsystem, so that it starts fresh with the next ZombieCharacter.
+ */
+void AZombieAIController::ResetState()
+{
+	StopMovement();
+	ClearIdleTimers();
 
-	// Return early if the ZombieCharacter is already chasing the PlayerCharacter.
-	if (ZombieCharacter->State == ZombieStates::CHASE) return;
+	ChaseTarget.Reset();
+	RoamPathQueryId = INVALID_NAVQUERYID;
 
-	// Now we check to see if we can cast the perceived Actor to a ZombieCharacter and
-	// if we can't then return early.
-	APlayerCharacter* PlayerCharacter = Cast<APlayerCharacter>(Actor);
-	if (PlayerCharacter == nullptr) return;
+	// Stop looking around and forget everything that was seen so the next ZombieCharacter
+	// doesn't start out knowing where the players are.
+	UnregisterSharedSight();
+	ZombiePerception->SetSenseEnabled(UAISense_Sight::StaticClass(), false);
+	ZombiePerception->ForgetAll();
 
-	// Otherwise we call the `Chase` method so the ZombieCharacter can chase the PlayerCharacter.
-	Chase(PlayerCharacter);
+	// Stopping the move above can queue a decision, so this goes last.
+	CancelThinkRequests();
+}
+
+/**
+ * Called when the ZombieAIController is removed from the world.
+ */
+void AZombieAIController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterSharedSight();
+	ClearIdleTimers();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+/**
+ * Sees with the ZombieSightSubsystem instead of the perception component if shared sight
+ * is turned on.
+ */
+void AZombieAIController::RegisterSharedSight()
+{
+	if (SightObserverIndex != INDEX_NONE || !UZombieSightSubsystem::IsSharedSightEnabled()) return;
+
+	UWorld* World = GetWorld();
+	UZombieSightSubsystem* SightSubsystem = (World != nullptr) ? World->GetSubsystem<UZombieSightSubsystem>() : nullptr;
+	if (SightSubsystem == nullptr) return;
+
+	SightObserverIndex = SightSubsystem->RegisterObserver(this);
+	if (SightObserverIndex == INDEX_NONE) return;
+
+	// Turn off the sight sense so that the perception system doesn't do the same work again.
+	ZombiePerception->SetSenseEnabled(UAISense_Sight::StaticClass(), false);
+}
+
+/**
+ * Stops seeing with the ZombieSightSubsystem.
+ */
+void AZombieAIController::UnregisterSharedSight()
+{
+	if (SightObserverIndex == INDEX_NONE) return;
+
+	UWorld* World = GetWorld();
+	UZombieSightSubsystem* SightSubsystem = (World != nullptr) ? World->GetSubsystem<UZombieSightSubsystem>() : nullptr;
+	if (SightSubsystem != nullptr) SightSubsystem->UnregisterObserver(SightObserverIndex);
+
+	SightObserverIndex = INDEX_NONE;
+	ZombiePerception->SetSenseEnabled(UAISense_Sight::StaticClass(), true);
+}
+
+/**
+ * Called by the ZombieSightSubsystem when the ZombieCharacter starts or stops seeing the
+ * PlayerCharacter.
+ *
+ * @param PlayerCharacter The PlayerCharacter that was seen or lost.
+ */
+void AZombieAIController::OnSharedSightUpdated(APlayerCharacter* PlayerCharacter)
+{
+	INC_DWORD_STAT(STAT_ZombieAI_PerceptionEvents);
+
+	RequestThink(ZombieThinkTypes::PERCEPTION_UPDATED, PlayerCharacter);
+}
+
+/**
+ * Called when the AIController's perception is updated.
+ */
+void AZombieAIController::OnTargetPerceptionUpdate(AActor* Actor, FAIStimulus Stimulus)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_OnTargetPerceptionUpdate);
+	INC_DWORD_STAT(STAT_ZombieAI_PerceptionEvents);
+
+	RequestThink(ZombieThinkTypes::PERCEPTION_UPDATED, Actor);
 }
 
 /**
@@ -102,142 +230,479 @@ void AZombieAIController::OnTargetPerceptionUpdate(AActor* Actor, FAIStimulus St
  */
 void AZombieAIController::OnMoveCompleted(FAIRequestID RequestID, const FPathFollowingResult& Result)
 {
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_OnMoveCompleted);
+
 	Super::OnMoveCompleted(RequestID, Result);
 
-	if (ZombieCharacter->State == ZombieStates::ROAM)
-	{
-		if (ZombieCharacter->RoamDelay > 0.f)
-		{
-			// If there is a roam delay, we need to set the ZombieCharacter to the idle state
-			// while we set a timer to run before `Roam` is called again.
-			ZombieCharacter->ToIdleState();
+	// Moves that were aborted were replaced or stopped on purpose, like every tick a flow field
+	// steers the ZombieCharacter, so only moves that ran their course need a new decision.
+	if (!RequestID.IsEquivalent(MoveRequestID)) return;
+	if (Result.Code != EPathFollowingResult::Success && Result.Code != EPathFollowingResult::Blocked && Result.Code != EPathFollowingResult::OffPath) return;
 
-			UWorld* World = GetWorld();
-			if (World != nullptr)
-			{
-				GetWorld()->GetTimerManager().SetTimer(RoamIdleTimer, this, &AZombieAIController::Roam, ZombieCharacter->RoamDelay, false);
-			}
-		}
-		else {
-			// Otherwise we can just call `Roam` again instantly.
-			Roam();
-		}
+	RequestThink(ZombieThinkTypes::MOVE_COMPLETED);
+}
+
+/**
+ * Starts a move and remembers it as the one whose completion is waited on.
+ */
+FPathFollowingRequestResult AZombieAIController::MoveTo(const FAIMoveRequest& MoveRequest, FNavPathSharedPtr* OutPath)
+{
+	// A move to where the ZombieCharacter already is completes before it returns, so any
+	// request is waited on until then.
+	MoveRequestID = FAIRequestID::AnyRequest;
+	const FPathFollowingRequestResult Result = Super::MoveTo(MoveRequest, OutPath);
+	MoveRequestID = Result.MoveId;
+
+	return Result;
+}
+
+/**
+ * Starts a move along a path that was already found and remembers it as the one whose
+ * completion is waited on.
+ */
+FAIRequestID AZombieAIController::RequestMove(const FAIMoveRequest& MoveRequest, FNavPathSharedPtr Path)
+{
+	MoveRequestID = FAIRequestID::AnyRequest;
+	MoveRequestID = Super::RequestMove(MoveRequest, Path);
+
+	return MoveRequestID;
+}
+
+/**
+ * Makes a decision that was queued by the ZombieThinkScheduler.
+ *
+ * @param Type The decision to make.
+ * @param Target The actor the decision is about.
+ */
+void AZombieAIController::Think(ZombieThinkTypes Type, AActor* Target)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Think);
+
+	FZombieThinkInput Input;
+	if (!GatherThinkInput(Type, Target, NextRandomSeed(), Input)) return;
+
+	CommitThinkResult(FZombieBrain::Decide(Input), Target);
+}
+
+/**
+ * Copies everything a decision depends on out of the ZombieCharacter. This has to be called
+ * on the game thread.
+ *
+ * @param Type The decision to make.
+ * @param Target The actor the decision is about.
+ * @param RandomSeed The seed used for any random choices in the decision.
+ * @param OutInput The input for `FZombieBrain::Decide`.
+ *
+ * @return Whether there is a decision to make.
+ */
+bool AZombieAIController::GatherThinkInput(ZombieThinkTypes Type, AActor* Target, int32 RandomSeed, FZombieThinkInput& OutInput) const
+{
+	// The ZombieCharacter could have died or gone back to the pool while the decision was
+	// waiting in the queue.
+	if (ZombieCharacter == nullptr || GetPawn() != ZombieCharacter) return false;
+	if (ZombieCharacter->GetState() == ZombieStates::DEAD) return false;
+
+	// Dormant zombies don't make decisions. They decide what to do when they wake up.
+	if (ZombieCharacter->GetLODTier() == ZombieLODTiers::DORMANT) return false;
+
+	// Perception updates without an actor have nothing to decide about.
+	if (Type == ZombieThinkTypes::PERCEPTION_UPDATED && Target == nullptr) return false;
+
+	OutInput.Type = Type;
+	OutInput.State = ZombieCharacter->GetState();
+	OutInput.PreviousState = ZombieCharacter->GetPreviousState();
+	OutInput.bCanRoam = ZombieCharacter->bCanRoam;
+	OutInput.RoamRadius = ZombieCharacter->RoamRadius;
+	OutInput.RoamDelay = ZombieCharacter->RoamDelay;
+	OutInput.AfterChaseDelay = ZombieCharacter->AfterChaseDelay;
+	OutInput.StartLocation = ZombieCharacter->GetStartLocation();
+	OutInput.CurrentLocation = ZombieCharacter->GetActorLocation();
+	OutInput.RandomSeed = RandomSeed;
+
+	if (Type == ZombieThinkTypes::PERCEPTION_UPDATED)
+	{
+		OutInput.bTargetInSight = IsTargetInSight(Target);
+		OutInput.bTargetIsPlayer = Cast<APlayerCharacter>(Target) != nullptr;
 	}
+
+	return true;
 }
 
 /**
- * Called to make the ZombieCharacter roam to a different location within its
- * roam radius.
+ * Applies the result of a decision to the ZombieCharacter. This has to be called on the
+ * game thread.
+ *
+ * @param Result The result of `FZombieBrain::Decide`.
+ * @param Target The actor the decision was about.
  */
-void AZombieAIController::Roam()
+void AZombieAIController::CommitThinkResult(const FZombieThinkResult& Result, AActor* Target)
 {
-	// Put the ZombieCharacter in the ROAM state if they are not already. This is important
-	// because when this move is complete, it gets put into an IDLE state so we need to put
-	// ourselves back into a ROAM state.
-	ZombieCharacter->ToRoamState();
+	if (ZombieCharacter == nullptr || GetPawn() != ZombieCharacter) return;
+
+	// Stop all movement first when the ZombieCharacter quits chasing the PlayerCharacter since
+	// they're not supposed to see them anymore.
+	if (Result.bStopMovement) StopMovement();
 
-	// Choose a random point within a bounding box with an origin of the ZombieCharacter's
-	// spawn location so that the ZombieCharacter will never roam to new places.
-	FVector RoamLocation = UKismetMathLibrary::RandomPointInBoundingBox(ZombieCharacter->StartLocation,
-		FVector(
-			ZombieCharacter->StartLocation.X + ZombieCharacter->RoamRadius,
-			ZombieCharacter->StartLocation.Y + ZombieCharacter->RoamRadius,
-			ZombieCharacter->StartLocation.Z
-		)
-	);
+	if (Result.bSetStartLocation) ZombieCharacter->SetStartLocation(Result.NewStartLocation);
 
-	MoveToLocation(RoamLocation);
+	UWorld* World = GetWorld();
+
+	switch (Result.Action)
+	{
+	case ZombieThinkActions::IDLE:
+		ZombieCharacter->SendEvent(ZombieEvents::REST);
+		break;
+	case ZombieThinkActions::ROAM:
+	{
+		// Roam to a reachable point from the ZombieRoamPointSubsystem instead of the random
+		// location if one is ready. It's only taken once the decision is known to roam so that
+		// decisions that end in IDLE don't use up the area's points.
+		FVector RoamLocation = Result.RoamLocation;
+		UZombieRoamPointSubsystem* RoamPoints = (World != nullptr) ? World->GetSubsystem<UZombieRoamPointSubsystem>() : nullptr;
+		if (RoamPoints != nullptr) RoamPoints->TakeRoamPoint(Result.RoamCenter, ZombieCharacter->RoamRadius, RoamLocation);
+		RoamTo(RoamLocation);
+		break;
+	}
+	case ZombieThinkActions::CHASE:
+	{
+		// The PlayerCharacter could have been destroyed since the decision was made.
+		APlayerCharacter* PlayerCharacter = Cast<APlayerCharacter>(Target);
+		if (PlayerCharacter != nullptr) Chase(PlayerCharacter);
+		break;
+	}
+	default:
+		break;
+	}
+
+	UZombieTimerSubsystem* ZombieTimers = (World != nullptr) ? World->GetSubsystem<UZombieTimerSubsystem>() : nullptr;
+	if (ZombieTimers == nullptr) return;
+
+	switch (Result.Delay)
+	{
+	case ZombieThinkDelays::ROAM_DELAY:
+		// Pause in the IDLE state until the `RoamIdleTimer` expires and the ZombieCharacter roams again.
+		ZombieTimers->SetTimer(RoamIdleTimer, ZombieTimerTypes::ROAM_DELAY, this, ZombieCharacter->RoamDelay);
+		break;
+	case ZombieThinkDelays::AFTER_CHASE_DELAY:
+		// Stay in the IDLE state until the `ChaseIdleTimer` expires and the ZombieCharacter
+		// decides whether to idle or roam.
+		ZombieTimers->SetTimer(ChaseIdleTimer, ZombieTimerTypes::AFTER_CHASE_DELAY, this, ZombieCharacter->AfterChaseDelay);
+		break;
+	default:
+		break;
+	}
 }
 
 /**
- * Called to make the ZombieCharacter chase the PlayerCharacter.
+ * Hands a decision to the ZombieThinkScheduler so that it's made when there's time for it.
  *
- * @param PlayerCharacter The PlayerCharacter to chase.
+ * @param Type The decision to make.
+ * @param Target The actor the decision is about.
  */
-void AZombieAIController::Chase(APlayerCharacter* PlayerCharacter)
+void AZombieAIController::RequestThink(ZombieThinkTypes Type, AActor* Target)
 {
-	ZombieCharacter->ToChaseState();
+	UWorld* World = GetWorld();
+	UZombieThinkScheduler* ThinkScheduler = (World != nullptr) ? World->GetSubsystem<UZombieThinkScheduler>() : nullptr;
 
-	MoveToActor(PlayerCharacter);
+	// Without a scheduler the decision is made right away.
+	if (ThinkScheduler == nullptr)
+	{
+		Think(Type, Target);
+		return;
+	}
+
+	ThinkScheduler->RequestThink(this, Type, Target);
 }
 
 /**
- * Called to make the ZombieCharacter stop chasing the PlayerCharacter and go
- * back to being idle/roaming.
+ * Drops the decisions the ZombieAIController still has waiting in the ZombieThinkScheduler.
  */
-void AZombieAIController::StopChase()
+void AZombieAIController::CancelThinkRequests()
 {
-	// First we have to stop all movement so the ZombieCharacter quits chasing the PlayerCharacter
-	// since they're not supposed to see them anymore.
-	StopMovement();
+	UWorld* World = GetWorld();
+	UZombieThinkScheduler* ThinkScheduler = (World != nullptr) ? World->GetSubsystem<UZombieThinkScheduler>() : nullptr;
+	if (ThinkScheduler != nullptr) ThinkScheduler->CancelRequests(this);
+}
+
+/**
+ * Called by the ZombieLODSubsystem when the ZombieCharacter moves to another level of detail
+ * tier.
+ *
+ * @param OldTier The tier the ZombieCharacter was in.
+ * @param NewTier The tier the ZombieCharacter is in now.
+ * @param TickInterval The tick interval, in seconds, of the ZombieCharacter in the new tier.
+ */
+void AZombieAIController::ApplyLODTier(ZombieLODTiers OldTier, ZombieLODTiers NewTier, float TickInterval)
+{
+	if (ZombieCharacter == nullptr) return;
 
-	if (ZombieCharacter->AfterChaseDelay > 0.f)
+	UCharacterMovementComponent* ZombieMovement = ZombieCharacter->GetCharacterMovement();
+	UPathFollowingComponent* PathFollowing = GetPathFollowingComponent();
+
+	// Zombies further away tick less often.
+	SetActorTickInterval(TickInterval);
+	ZombieCharacter->SetActorTickInterval(TickInterval);
+	if (ZombieMovement != nullptr) ZombieMovement->SetComponentTickInterval(TickInterval);
+	if (PathFollowing != nullptr) PathFollowing->SetComponentTickInterval(TickInterval);
+
+	if (NewTier == ZombieLODTiers::DORMANT)
 	{
-		UWorld* World = GetWorld();
-		if (World != nullptr)
+		// Stop everything that would make the ZombieCharacter move or think until it wakes up.
+		StopMovement();
+		ClearIdleTimers();
+
+		if (ZombieMovement != nullptr)
 		{
-			// If there is an after chase delay then we set the PlayerCharacter to the IDLE state until the
-			// `ChaseIdleTimer` expires and runs the `IdleOrRoam` method.
-			ZombieCharacter->ToIdleState();
-			GetWorld()->GetTimerManager().SetTimer(ChaseIdleTimer, this, &AZombieAIController::IdleOrRoam, ZombieCharacter->AfterChaseDelay, false);
+			ZombieMovement->StopMovementImmediately();
+			ZombieMovement->SetComponentTickEnabled(false);
 		}
+
+		// Dormant zombies are far away or off screen so their pose doesn't need to change.
+		ZombieCharacter->GetMesh()->SetComponentTickEnabled(false);
+
+		// Zombies using the ZombieSightSubsystem are skipped by it while they're dormant.
+		if (SightObserverIndex == INDEX_NONE) ZombiePerception->SetSenseEnabled(UAISense_Sight::StaticClass(), false);
+		return;
 	}
-	else
+
+	if (OldTier == ZombieLODTiers::DORMANT)
 	{
-		// Otherwise if there is no delay we can just go straight to the `IdleOrRoam` method.
-		IdleOrRoam();
+		if (ZombieMovement != nullptr) ZombieMovement->SetComponentTickEnabled(true);
+		ZombieCharacter->GetMesh()->SetComponentTickEnabled(true);
+		if (SightObserverIndex == INDEX_NONE) ZombiePerception->SetSenseEnabled(UAISense_Sight::StaticClass(), true);
+
+		WakeFromDormancy();
 	}
 }
 
 /**
- * Checks to see if the PlayerCharacter should be idling or roaming and then proceeds to do so. If
- * the ZombieCharacter's `PreviousState` was `CHASE` and the ZombieCharacter is supposed to roam then
- * the `StartLocation` will be updated to be the current location as we don't want the ZombieCharacter
- * to go all the way back to the initial `StartLocation`.
+ * Called when the ZombieCharacter leaves the DORMANT tier. The ZombieCharacter is put at a
+ * random location within its roam radius as if it had kept roaming while it was dormant, unless
+ * a player could see it disappear or appear, in which case it walks from where it is instead.
  */
-void AZombieAIController::IdleOrRoam()
+void AZombieAIController::WakeFromDormancy()
 {
+	// A corpse stays where it fell and has nothing left to think about.
+	if (ZombieCharacter->GetState() == ZombieStates::DEAD) return;
+
 	if (ZombieCharacter->bCanRoam)
 	{
-		// Check to see if the previous state was `CHASE` because if so we need to set the `StartLocation`
-		// to the ZombieCharacter's current location.
-		if (ZombieCharacter->PreviousState == ZombieStates::CHASE)
+		// Prefer a point that's known to be reachable.
+		UZombieRoamPointSubsystem* RoamPoints = GetWorld()->GetSubsystem<UZombieRoamPointSubsystem>();
+		FVector RoamLocation;
+		if (RoamPoints == nullptr || !RoamPoints->TakeRoamPoint(ZombieCharacter->GetStartLocation(), ZombieCharacter->RoamRadius, RoamLocation))
+		{
+			RoamLocation = FZombieBrain::ChooseRoamLocation(ZombieCharacter->GetStartLocation(), ZombieCharacter->RoamRadius, NextRandomSeed());
+		}
+
+		// Only move the ZombieCharacter if the location is somewhere it could have walked to, and
+		// only while no player can see it vanish or pop up. Zombies count as further away when
+		// they're off screen, so one can wake up just because a player turned towards it.
+		UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+		UZombieLODSubsystem* ZombieLOD = GetWorld()->GetSubsystem<UZombieLODSubsystem>();
+		FNavLocation NavLocation;
+		if (NavigationSystem != nullptr && NavigationSystem->ProjectPointToNavigation(RoamLocation, NavLocation))
 		{
-			ZombieCharacter->StartLocation = ZombieCharacter->GetActorLocation();
+			const float HalfHeight = ZombieCharacter->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+			const FVector TeleportLocation = NavLocation.Location + FVector(0.f, 0.f, HalfHeight);
+			if (ZombieLOD == nullptr || (!ZombieLOD->CanAnyPlayerSee(ZombieCharacter->GetActorLocation()) && !ZombieLOD->CanAnyPlayerSee(TeleportLocation)))
+			{
+				ZombieCharacter->TeleportTo(TeleportLocation, ZombieCharacter->GetActorRotation(), false, true);
+			}
 		}
+	}
+
+	RequestThink(ZombieThinkTypes::IDLE_OR_ROAM);
+}
+
+/**
+ * Stops the `RoamIdleTimer` and the `ChaseIdleTimer`.
+ */
+void AZombieAIController::ClearIdleTimers()
+{
+	UWorld* World = GetWorld();
+	UZombieTimerSubsystem* ZombieTimers = (World != nullptr) ? World->GetSubsystem<UZombieTimerSubsystem>() : nullptr;
+	if (ZombieTimers == nullptr) return;
+
+	ZombieTimers->ClearTimer(RoamIdleTimer);
+	ZombieTimers->ClearTimer(ChaseIdleTimer);
+}
+
+/**
+ * Called by the ZombieTimerSubsystem when the `RoamIdleTimer` expires.
+ */
+void AZombieAIController::OnRoamIdleTimerExpired()
+{
+	RequestThink(ZombieThinkTypes::ROAM);
+}
+
+/**
+ * Called by the ZombieTimerSubsystem when the `ChaseIdleTimer` expires.
+ */
+void AZombieAIController::OnChaseIdleTimerExpired()
+{
+	RequestThink(ZombieThinkTypes::IDLE_OR_ROAM);
+}
+
+/**
+ * Called to make the ZombieCharacter roam to a location within its roam radius.
+ *
+ * @param RoamLocation The location to roam to.
+ */
+void AZombieAIController::RoamTo(const FVector& RoamLocation)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Roam);
 
-		// Call the `Roam` method so the ZombieCharacter starts roaming.
-		Roam();
+	// Put the ZombieCharacter in the ROAM state if they are not already. This is important
+	// because when this move is complete, it gets put into an IDLE state so we need to put
+	// ourselves back into a ROAM state. Archetypes that don't roam stay where they are.
+	ZombieCharacter->SendEvent(ZombieEvents::ROAM);
+	if (ZombieCharacter->GetState() != ZombieStates::ROAM) return;
+
+	// Find the path on the navigation system's worker instead of on the game thread. If a path
+	// query can't be made, or paths have to arrive in the same frame every run, then move the
+	// old way.
+	UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	INC_DWORD_STAT(STAT_ZombieAI_PathRequests);
+	RoamMoveRequest = FAIMoveRequest(RoamLocation);
+	FPathFindingQuery Query;
+	if (NavigationSystem == nullptr || CVarZombiePathsAsync.GetValueOnGameThread() == 0 || !BuildPathfindingQuery(RoamMoveRequest, Query))
+	{
+		MoveToLocation(RoamLocation);
+		return;
+	}
+
+	// A new roam replaces any query still on its way.
+	RoamPathQueryId = NavigationSystem->FindPathAsync(GetNavAgentPropertiesRef(), Query, FNavPathQueryDelegate::CreateUObject(this, &AZombieAIController::OnRoamPathFound));
+}
+
+/**
+ * Called when the path to the location the ZombieCharacter is roaming to has been found.
+ */
+void AZombieAIController::OnRoamPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Roam);
+
+	if (QueryId != RoamPathQueryId) return;
+	RoamPathQueryId = INVALID_NAVQUERYID;
+
+	// The ZombieCharacter could have started chasing, died or gone dormant in the meantime.
+	if (ZombieCharacter == nullptr || GetPawn() != ZombieCharacter) return;
+	if (ZombieCharacter->GetState() != ZombieStates::ROAM || ZombieCharacter->GetLODTier() == ZombieLODTiers::DORMANT) return;
+
+	// Treat a location that can't be reached like a finished move so the ZombieCharacter picks
+	// somewhere else.
+	if (Result != ENavigationQueryResult::Success || !Path.IsValid())
+	{
+		RequestThink(ZombieThinkTypes::MOVE_COMPLETED);
+		return;
+	}
+
+	RequestMove(RoamMoveRequest, Path);
+}
+
+/**
+ * Called to make the ZombieCharacter chase the PlayerCharacter.
+ *
+ * @param PlayerCharacter The PlayerCharacter to chase.
+ * @param Event The event that made the ZombieCharacter chase.
+ */
+void AZombieAIController::Chase(APlayerCharacter* PlayerCharacter, ZombieEvents Event)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Chase);
+
+	// Archetypes that don't chase stay where they are.
+	ZombieCharacter->SendEvent(Event);
+	const ZombieStates State = ZombieCharacter->GetState();
+	if (State != ZombieStates::CHASE && State != ZombieStates::ATTACK) return;
+
+	ChaseTarget = PlayerCharacter;
+
+	// With flow fields the ZombieCharacter is steered every tick instead of following a path of
+	// its own.
+	UWorld* World = GetWorld();
+	UZombieFlowFieldSubsystem* FlowField = (World != nullptr) ? World->GetSubsystem<UZombieFlowFieldSubsystem>() : nullptr;
+	if (FlowField != nullptr && UZombieFlowFieldSubsystem::IsFlowFieldEnabled())
+	{
+		FlowField->RequestField(PlayerCharacter);
+		return;
 	}
-	else
+
+	INC_DWORD_STAT(STAT_ZombieAI_PathRequests);
+	MoveToActor(PlayerCharacter);
+}
+
+/**
+ * Moves the ZombieCharacter one step along the flow field towards the chased PlayerCharacter,
+ * or falls back to finding a path if the flow field doesn't reach the ZombieCharacter.
+ */
+void AZombieAIController::FollowChaseFlowField()
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Chase);
+
+	UWorld* World = GetWorld();
+	UZombieFlowFieldSubsystem* FlowField = (World != nullptr) ? World->GetSubsystem<UZombieFlowFieldSubsystem>() : nullptr;
+
+	// Without flow fields the path started in `Chase` does the work.
+	if (FlowField == nullptr || !UZombieFlowFieldSubsystem::IsFlowFieldEnabled()) return;
+
+	APlayerCharacter* PlayerCharacter = ChaseTarget.Get();
+
+	// The field is laid out on the navmesh, so it's looked up from the ZombieCharacter's feet.
+	FVector Direction;
+	if (FlowField->GetFlowDirection(PlayerCharacter, ZombieCharacter->GetNavAgentLocation(), Direction))
 	{
-		ZombieCharacter->ToIdleState();
+		// Drop any path from a fallback so it doesn't fight the flow field.
+		if (GetMoveStatus() != EPathFollowingStatus::Idle) StopMovement();
+
+		ZombieCharacter->AddMovementInput(Direction);
+		return;
 	}
+
+	// The field hasn't been built yet or the ZombieCharacter is outside of it, so find a path
+	// the old way until it is.
+	FlowField->RequestField(PlayerCharacter);
+	if (GetMoveStatus() != EPathFollowingStatus::Idle) return;
+
+	INC_DWORD_STAT(STAT_ZombieAI_PathRequests);
+	MoveToActor(PlayerCharacter);
 }
 
 /**
- * Called when an actor enters the ZombieCharacter's DamageCollider.
+ * Returns whether the Actor is currently seen by the ZombieCharacter.
+ *
+ * @param Actor The actor to check.
  */
-void AZombieAIController::OnComponentEnterDamageCollider(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+bool AZombieAIController::IsTargetInSight(AActor* Actor) const
 {
-	// Try to cast the `OtherActor` to our `PlayerCharacter` and if we can then we
-	// switch the ZombieCharacter to be in the ATTACK state.
-	APlayerCharacter* PlayerCharacter = Cast<APlayerCharacter>(OtherActor);
-	if (PlayerCharacter == nullptr) return;
+	// Zombies that see through the ZombieSightSubsystem don't have anything in their perception
+	// component.
+	if (SightObserverIndex != INDEX_NONE)
+	{
+		const UWorld* World = GetWorld();
+		const UZombieSightSubsystem* SightSubsystem = (World != nullptr) ? World->GetSubsystem<UZombieSightSubsystem>() : nullptr;
+		return SightSubsystem != nullptr && SightSubsystem->IsActorSensed(SightObserverIndex, Actor);
+	}
 
-	ZombieCharacter->ToAttackState();
+	// Get the Actors that have been perceived and check to see if the Actor has been
+	// detected and is currently in the sight radius.
+	TArray<AActor*> PerceivedActors;
+	ZombiePerception->GetCurrentlyPerceivedActors(TSubclassOf<UAISense_Sight>(), PerceivedActors);
+
+	return PerceivedActors.Contains(Actor);
 }
 
 /**
- * Called when an actor leaves the ZombieCharacter's DamageCollider.
+ * Called by the ZombieAttackRangeSubsystem when the PlayerCharacter gets out of reach of the
+ * ZombieCharacter's arms.
+ *
+ * @param PlayerCharacter The PlayerCharacter that got away.
  */
-void AZombieAIController::OnComponentLeaveDamageCollider(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+void AZombieAIController::OnPlayerLeftAttackRange(APlayerCharacter* PlayerCharacter)
 {
-	// Try to cast the `OtherActor` to our `PlayerCharacter` and if we can then we
-	// switch the ZombieCharacter to be in the CHASE state since it means that the
-	// PlayerCharacter is running away.
-	APlayerCharacter* PlayerCharacter = Cast<APlayerCharacter>(OtherActor);
-	if (PlayerCharacter == nullptr) return;
+	// The PlayerCharacter is running away so the ZombieCharacter goes back to the CHASE state.
+	if (ZombieCharacter == nullptr || PlayerCharacter == nullptr) return;
 
-	Chase(PlayerCharacter);
+	Chase(PlayerCharacter, ZombieEvents::TARGET_ESCAPED);
 }
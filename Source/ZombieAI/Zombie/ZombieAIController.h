@@ -2,7 +2,11 @@
 
 #include "CoreMinimal.h"
 #include "AIController.h"
+#include "AI/Navigation/NavigationTypes.h"
 #include "Perception/AIPerceptionTypes.h"
+#include "ZombieThinkScheduler.h"
+#include "ZombieTimerSubsystem.h"
+#include "ZombieCharacter.h"
 #include "ZombieAIController.generated.h"
 
 /**
@@ -43,10 +47,114 @@ public:
 	float ZombieSightMaxAge = 5.f;
 
 	// The timer used to pause between `Roam` calls.
-	FTimerHandle RoamIdleTimer;
+	FZombieTimerHandle RoamIdleTimer;
 
 	// The timer handle used to pause between chasing and roaming.
-	FTimerHandle ChaseIdleTimer;
+	FZombieTimerHandle ChaseIdleTimer;
+
+	// The index of the ZombieAIController in the ZombieSightSubsystem, or INDEX_NONE if the
+	// ZombieCharacter sees with its own perception component.
+	int32 SightObserverIndex = INDEX_NONE;
+
+	// The PlayerCharacter that the ZombieCharacter was last told to chase.
+	TWeakObjectPtr<class APlayerCharacter> ChaseTarget;
+
+	// The async path query for the location the ZombieCharacter is about to roam to.
+	uint32 RoamPathQueryId = INVALID_NAVQUERYID;
+
+	// The move that's started once the roam path query comes back.
+	FAIMoveRequest RoamMoveRequest;
+
+	// The move the ZombieCharacter was last sent on. Only its completion asks for a new decision.
+	FAIRequestID MoveRequestID = FAIRequestID::InvalidRequest;
+
+	// The stream that the ZombieAIController's random choices come from. It's seeded when the
+	// ZombieAIController takes over a ZombieCharacter.
+	FRandomStream RandomStream;
+
+public:
+	/**
+	 * Makes a decision that was queued by the ZombieThinkScheduler.
+	 *
+	 * @param Type The decision to make.
+	 * @param Target The actor the decision is about.
+	 */
+	void Think(ZombieThinkTypes Type, AActor* Target);
+
+	/**
+	 * Copies everything a decision depends on out of the ZombieCharacter. This has to be called
+	 * on the game thread.
+	 *
+	 * @param Type The decision to make.
+	 * @param Target The actor the decision is about.
+	 * @param RandomSeed The seed used for any random choices in the decision.
+	 * @param OutInput The input for `FZombieBrain::Decide`.
+	 *
+	 * @return Whether there is a decision to make.
+	 */
+	bool GatherThinkInput(ZombieThinkTypes Type, AActor* Target, int32 RandomSeed, struct FZombieThinkInput& OutInput) const;
+
+	/**
+	 * Returns the seed for the random choices of the next decision.
+	 */
+	int32 NextRandomSeed() const { return (int32)RandomStream.GetUnsignedInt(); }
+
+	/**
+	 * Applies the result of a decision to the ZombieCharacter. This has to be called on the
+	 * game thread.
+	 *
+	 * @param Result The result of `FZombieBrain::Decide`.
+	 * @param Target The actor the decision was about.
+	 */
+	void CommitThinkResult(const struct FZombieThinkResult& Result, AActor* Target);
+
+	/**
+	 * Called by the ZombieSightSubsystem when the ZombieCharacter starts or stops seeing the
+	 * PlayerCharacter.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter that was seen or lost.
+	 */
+	void OnSharedSightUpdated(class APlayerCharacter* PlayerCharacter);
+
+	/**
+	 * Called by the ZombieLODSubsystem when the ZombieCharacter moves to another level of detail
+	 * tier.
+	 *
+	 * @param OldTier The tier the ZombieCharacter was in.
+	 * @param NewTier The tier the ZombieCharacter is in now.
+	 * @param TickInterval The tick interval, in seconds, of the ZombieCharacter in the new tier.
+	 */
+	void ApplyLODTier(ZombieLODTiers OldTier, ZombieLODTiers NewTier, float TickInterval);
+
+	/**
+	 * Drops everything the ZombieAIController is doing: its move, its timers, what it's chasing
+	 * and what it has seen. Called when the ZombieCharacter dies and before the ZombieAIController
+	 * goes back to the ZombiePoolSubsystem, so that it starts fresh with the next ZombieCharacter.
+	 */
+	void ResetState();
+
+	/**
+	 * Drops the decisions the ZombieAIController still has waiting in the ZombieThinkScheduler.
+	 */
+	void CancelThinkRequests();
+
+	/**
+	 * Called by the ZombieTimerSubsystem when the `RoamIdleTimer` expires.
+	 */
+	void OnRoamIdleTimerExpired();
+
+	/**
+	 * Called by the ZombieTimerSubsystem when the `ChaseIdleTimer` expires.
+	 */
+	void OnChaseIdleTimerExpired();
+
+	/**
+	 * Called by the ZombieAttackRangeSubsystem when the PlayerCharacter gets out of reach of the
+	 * ZombieCharacter's arms.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter that got away.
+	 */
+	void OnPlayerLeftAttackRange(class APlayerCharacter* PlayerCharacter);
 
 protected:
 	/**
@@ -54,6 +162,11 @@ protected:
 	 */
 	virtual void BeginPlay() override;
 
+	/**
+	 * Called every frame. Chasing zombies steer along the flow field here.
+	 */
+	virtual void Tick(float DeltaSeconds) override;
+
 	/**
 	 * Called when the ZombieAIController takes over the ZombieCharacter.
 	 *
@@ -61,6 +174,27 @@ protected:
 	 */
 	virtual void OnPossess(APawn* ZombiePawn) override;
 
+	/**
+	 * Called when the ZombieAIController lets go of the ZombieCharacter.
+	 */
+	virtual void OnUnPossess() override;
+
+	/**
+	 * Called when the ZombieAIController is removed from the world.
+	 */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/**
+	 * Sees with the ZombieSightSubsystem instead of the perception component if shared sight
+	 * is turned on.
+	 */
+	void RegisterSharedSight();
+
+	/**
+	 * Stops seeing with the ZombieSightSubsystem.
+	 */
+	void UnregisterSharedSight();
+
 	/**
 	 * Called when the AIController's perception is updated.
 	 */
@@ -73,41 +207,65 @@ protected:
 	virtual void OnMoveCompleted(FAIRequestID RequestID, const FPathFollowingResult& Result) override;
 
 	/**
-	 * Checks to see if the PlayerCharacter should be idling or roaming and then proceeds to do so. If
-	 * the ZombieCharacter's `PreviousState` was `CHASE` and the ZombieCharacter is supposed to roam then
-	 * the `StartLocation` will be updated to be the current location as we don't want the ZombieCharacter
-	 * to go all the way back to the initial `StartLocation`.
+	 * Starts a move and remembers it as the one whose completion is waited on.
 	 */
-	void IdleOrRoam();
+	virtual FPathFollowingRequestResult MoveTo(const FAIMoveRequest& MoveRequest, FNavPathSharedPtr* OutPath = nullptr) override;
 
 	/**
-	 * Called to make the ZombieCharacter roam to a different location within its
-	 * roam radius.
+	 * Starts a move along a path that was already found and remembers it as the one whose
+	 * completion is waited on.
 	 */
-	void Roam();
+	virtual FAIRequestID RequestMove(const FAIMoveRequest& MoveRequest, FNavPathSharedPtr Path) override;
 
 	/**
-	 * Called to make the ZombieCharacter chase the PlayerCharacter.
+	 * Hands a decision to the ZombieThinkScheduler so that it's made when there's time for it.
 	 *
-	 * @param PlayerCharacter The PlayerCharacter to chase.
+	 * @param Type The decision to make.
+	 * @param Target The actor the decision is about.
 	 */
-	void Chase(class APlayerCharacter* PlayerCharacter);
+	void RequestThink(ZombieThinkTypes Type, AActor* Target = nullptr);
 
 	/**
-	 * Called to make the ZombieCharacter stop chasing the PlayerCharacter and go
-	 * back to being idle/roaming.
+	 * Called when the ZombieCharacter leaves the DORMANT tier. The ZombieCharacter is put at a
+	 * random location within its roam radius as if it had kept roaming while it was dormant.
 	 */
-	void StopChase();
+	void WakeFromDormancy();
 
 	/**
-	 * Called when an actor enters the ZombieCharacter's DamageCollider.
+	 * Stops the `RoamIdleTimer` and the `ChaseIdleTimer`.
 	 */
-	UFUNCTION()
-	void OnComponentEnterDamageCollider(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	void ClearIdleTimers();
 
 	/**
-	 * Called when an actor leaves the ZombieCharacter's DamageCollider.
+	 * Called to make the ZombieCharacter roam to a location within its roam radius.
+	 *
+	 * @param RoamLocation The location to roam to.
 	 */
-	UFUNCTION()
-	void OnComponentLeaveDamageCollider(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+	void RoamTo(const FVector& RoamLocation);
+
+	/**
+	 * Called when the path to the location the ZombieCharacter is roaming to has been found.
+	 */
+	void OnRoamPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	/**
+	 * Called to make the ZombieCharacter chase the PlayerCharacter.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter to chase.
+	 * @param Event The event that made the ZombieCharacter chase.
+	 */
+	void Chase(class APlayerCharacter* PlayerCharacter, ZombieEvents Event = ZombieEvents::TARGET_SEEN);
+
+	/**
+	 * Moves the ZombieCharacter one step along the flow field towards the chased PlayerCharacter,
+	 * or falls back to finding a path if the flow field doesn't reach the ZombieCharacter.
+	 */
+	void FollowChaseFlowField();
+
+	/**
+	 * Returns whether the Actor is currently seen by the ZombieCharacter.
+	 *
+	 * @param Actor The actor to check.
+	 */
+	bool IsTargetInSight(AActor* Actor) const;
 };
@@ -1,29 +1,51 @@
 #include "ZombieAnimInstance.h"
 #include "ZombieCharacter.h"
-#include "../Player/PlayerCharacter.h"
-#include "Math/Rotator.h"
-#include "Components/BoxComponent.h"
-#include "Components/CapsuleComponent.h"
-#include "GameFramework/CharacterMovementComponent.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
 
 /**
- * Used by the animation blueprint to update the animation properties above
- * and decide what animations to play.
+ * Called when the animation instance is created. This is where the ZombieCharacter being
+ * animated is looked up once.
  */
-void UZombieAnimInstance::UpdateAnimationProperties()
+void UZombieAnimInstance::NativeInitializeAnimation()
 {
-	// Try to get the Pawn being animated and return if a nullptr.
-	APawn* ZombiePawn = TryGetPawnOwner();
-	if (ZombiePawn == nullptr) return;
+	Super::NativeInitializeAnimation();
 
 	// Try to cast the Pawn to our ZombieCharacter since that's the only
 	// thing we want to animate.
-	AZombieCharacter* ZombieCharacter = Cast<AZombieCharacter>(ZombiePawn);
+	ZombieCharacter = Cast<AZombieCharacter>(TryGetPawnOwner());
 	if (ZombieCharacter == nullptr) return;
 
-	// Set the variables that are dependent on states.
-	bIsRoaming = ZombieCharacter->State == ZombieStates::ROAM;
-	bIsChasing = ZombieCharacter->State == ZombieStates::CHASE;
-	bIsAttacking = ZombieCharacter->State == ZombieStates::ATTACK;
-	bIsDying = ZombieCharacter->State == ZombieStates::DEAD;
+	// Start from the state the ZombieCharacter is already in.
+	SetZombieState(ZombieCharacter->GetState());
+}
+
+/**
+ * Called by the ZombieCharacter when its state changes to update the animation properties.
+ *
+ * @param State The new state of the ZombieCharacter.
+ */
+void UZombieAnimInstance::SetZombieState(ZombieStates State)
+{
+	bIsRoaming = State == ZombieStates::ROAM;
+	bIsChasing = State == ZombieStates::CHASE;
+	bIsAttacking = State == ZombieStates::ATTACK;
+	bIsDying = State == ZombieStates::DEAD;
+
+	bHasZombieState = true;
+}
+
+/**
+ * Used by the animation blueprint to update the animation properties above
+ * and decide what animations to play. The properties are kept up to date by
+ * `SetZombieState` so this only has to do anything if no state has been pushed yet.
+ */
+void UZombieAnimInstance::UpdateAnimationProperties()
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::ANIMATION);
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_UpdateAnimationProperties);
+
+	if (bHasZombieState || ZombieCharacter == nullptr) return;
+
+	SetZombieState(ZombieCharacter->GetState());
 }
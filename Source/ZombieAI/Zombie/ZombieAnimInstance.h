@@ -2,11 +2,13 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "ZombieCharacter.h"
 #include "ZombieAnimInstance.generated.h"
 
 /**
  * Manages the booleans needed by the animation blueprint to decide what
- * animation needs to be run.
+ * animation needs to be run. The ZombieCharacter pushes its state in here whenever
+ * it changes so nothing has to be looked up while the animation updates.
  */
 UCLASS()
 class ZOMBIEAI_API UZombieAnimInstance : public UAnimInstance
@@ -30,8 +32,31 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	bool bIsDying;
 
+	/**
+	 * Called when the animation instance is created. This is where the ZombieCharacter being
+	 * animated is looked up once.
+	 */
+	virtual void NativeInitializeAnimation() override;
+
+	/**
+	 * Called by the ZombieCharacter when its state changes to update the animation properties
+	 * above.
+	 *
+	 * @param State The new state of the ZombieCharacter.
+	 */
+	void SetZombieState(ZombieStates State);
+
 	// Used by the animation blueprint to update the animation properties above
-	// and decide what animations to play.
+	// and decide what animations to play. The properties are kept up to date by
+	// `SetZombieState` so this only has to do anything if no state has been pushed yet.
 	UFUNCTION(BlueprintCallable, Category = "UpdateAnimationProperties")
 	void UpdateAnimationProperties();
+
+protected:
+	// The ZombieCharacter being animated.
+	UPROPERTY(Transient)
+	AZombieCharacter* ZombieCharacter;
+
+	// Whether the ZombieCharacter has pushed its state in here yet.
+	bool bHasZombieState = false;
 };
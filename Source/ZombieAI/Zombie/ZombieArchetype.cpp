@@ -0,0 +1,50 @@
+#include "ZombieArchetype.h"
+
+/**
+ * Fills the table with the default state machine.
+ */
+FZombieStateTable::FZombieStateTable()
+{
+	// Shorter names for the entries of the default state machine below.
+	const uint8 I = (uint8)ZombieStates::IDLE;
+	const uint8 R = (uint8)ZombieStates::ROAM;
+	const uint8 C = (uint8)ZombieStates::CHASE;
+	const uint8 A = (uint8)ZombieStates::ATTACK;
+	const uint8 D = (uint8)ZombieStates::DEAD;
+	const uint8 X = NoTransition;
+
+	// Every row is a state and every column is an event, in the order REST, ROAM, TARGET_SEEN,
+	// TARGET_REACHED, TARGET_ESCAPED, KILLED. Dead zombies ignore everything.
+	static const uint8 DefaultNextStates[NumStates][NumEvents] = {
+		/* IDLE */		{ I, R, C, A, C, D },
+		/* ROAM */		{ I, R, C, A, C, D },
+		/* CHASE */		{ I, R, C, A, C, D },
+		/* ATTACK */	{ I, R, C, A, C, D },
+		/* DEAD */		{ X, X, X, X, X, X },
+	};
+
+	FMemory::Memcpy(NextStates, DefaultNextStates, sizeof(NextStates));
+}
+
+/**
+ * Replaces one entry of the table.
+ */
+void FZombieStateTable::SetTransition(const FZombieStateTransition& Transition)
+{
+	NextStates[(int32)Transition.From * NumEvents + (int32)Transition.Event] = Transition.bIgnore ? NoTransition : (uint8)Transition.To;
+}
+
+/**
+ * Compiles the default state machine with the ZombieArchetype's transitions into a table.
+ */
+FZombieStateTable UZombieArchetype::CompileStateTable() const
+{
+	FZombieStateTable Table;
+
+	for (const FZombieStateTransition& Transition : Transitions)
+	{
+		Table.SetTransition(Transition);
+	}
+
+	return Table;
+}
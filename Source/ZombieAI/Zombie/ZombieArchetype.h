@@ -0,0 +1,101 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ZombieCharacter.h"
+#include "ZombieArchetype.generated.h"
+
+/**
+ * One row of a zombie state machine: the state that an event moves a ZombieCharacter to from
+ * another state.
+ */
+USTRUCT(BlueprintType)
+struct FZombieStateTransition
+{
+	GENERATED_BODY()
+
+	// The state the ZombieCharacter is in when the event happens.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = StateMachine)
+	ZombieStates From = ZombieStates::IDLE;
+
+	// The event that happens.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = StateMachine)
+	ZombieEvents Event = ZombieEvents::REST;
+
+	// The state the ZombieCharacter moves to.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = StateMachine)
+	ZombieStates To = ZombieStates::IDLE;
+
+	// If set the event is ignored and the ZombieCharacter stays in the state it's in.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = StateMachine)
+	bool bIgnore = false;
+};
+
+/**
+ * A zombie state machine compiled into a flat table that's indexed by the current state and
+ * the event, so moving a ZombieCharacter to its next state is a single lookup.
+ */
+struct ZOMBIEAI_API FZombieStateTable
+{
+	// The number of states and events that the table has rows and columns for.
+	static const int32 NumStates = (int32)ZombieStates::DEAD + 1;
+	static const int32 NumEvents = (int32)ZombieEvents::KILLED + 1;
+
+	// The value of an entry whose event is ignored.
+	static const uint8 NoTransition = 0xFF;
+
+	// The next state for every state and event, or `NoTransition`.
+	uint8 NextStates[NumStates * NumEvents];
+
+	/**
+	 * Fills the table with the default state machine.
+	 */
+	FZombieStateTable();
+
+	/**
+	 * Finds the state that the event moves a ZombieCharacter in the state to.
+	 *
+	 * @param State The state the ZombieCharacter is in.
+	 * @param Event The event that happened.
+	 * @param OutState The state to move to.
+	 *
+	 * @return Whether the event moves the ZombieCharacter to a state at all.
+	 */
+	bool GetNextState(ZombieStates State, ZombieEvents Event, ZombieStates& OutState) const
+	{
+		const uint8 NextState = NextStates[(int32)State * NumEvents + (int32)Event];
+		if (NextState == NoTransition) return false;
+
+		OutState = (ZombieStates)NextState;
+		return true;
+	}
+
+	/**
+	 * Replaces one entry of the table.
+	 */
+	void SetTransition(const FZombieStateTransition& Transition);
+};
+
+/**
+ * The ZombieArchetype describes how a kind of zombie behaves by changing entries of the default
+ * state machine. Only the transitions that differ from the default need to be listed, for
+ * example a zombie that never gives up on a chase ignores the REST event in the CHASE state.
+ *
+ * Every ZombieArchetype is compiled into a FZombieStateTable the first time a ZombieCharacter
+ * that uses it joins the ZombieCrowdSubsystem.
+ */
+UCLASS(BlueprintType)
+class ZOMBIEAI_API UZombieArchetype : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// The transitions that replace the ones in the default state machine.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = StateMachine)
+	TArray<FZombieStateTransition> Transitions;
+
+	/**
+	 * Compiles the default state machine with the ZombieArchetype's transitions into a table.
+	 */
+	FZombieStateTable CompileStateTable() const;
+};
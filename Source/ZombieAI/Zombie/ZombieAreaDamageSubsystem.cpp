@@ -0,0 +1,202 @@
+#include "ZombieAreaDamageSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieCrowdSubsystem.h"
+#include "ZombieDamageSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "Math/VectorRegister.h"
+
+// Where free slots and dead zombies are put so that no area ever reaches them.
+static const float UnreachableLocation = 1.e10f;
+
+/**
+ * Called when the world that owns the ZombieAreaDamageSubsystem is torn down.
+ */
+void UZombieAreaDamageSubsystem::Deinitialize()
+{
+	LocationsX.Empty();
+	LocationsY.Empty();
+	LocationsZ.Empty();
+	Damages.Empty();
+	HitHandles.Empty();
+	HitDamage.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Damages every zombie in the area that no wall is in front of.
+ *
+ * @param Area The area to damage.
+ *
+ * @return The number of zombies that were damaged.
+ */
+int32 UZombieAreaDamageSubsystem::ApplyAreaDamage(const FZombieAreaDamage& Area)
+{
+	UWorld* World = GetWorld();
+	UZombieDamageSubsystem* DamageSubsystem = (World != nullptr) ? World->GetSubsystem<UZombieDamageSubsystem>() : nullptr;
+	if (DamageSubsystem == nullptr) return 0;
+
+	const int32 NumHits = FindZombiesInArea(Area, HitHandles, HitDamage);
+
+	// Zombies and players ignore the visibility channel, so only the world blocks the traces.
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ZombieAreaDamageOcclusion), false);
+
+	int32 NumDamaged = 0;
+	for (int32 HitIndex = 0; HitIndex < NumHits; ++HitIndex)
+	{
+		const int32 Index = HitHandles[HitIndex].Index;
+		const FVector Location(LocationsX[Index], LocationsY[Index], LocationsZ[Index]);
+		if (Area.bBlockedByWalls && World->LineTraceTestByChannel(Area.Origin, Location, ECC_Visibility, QueryParams)) continue;
+
+		// The zombies die in the ZombieDamageSubsystem's pass like zombies that were shot.
+		DamageSubsystem->QueueDamage(HitHandles[HitIndex], HitDamage[HitIndex]);
+		NumDamaged++;
+	}
+
+	return NumDamaged;
+}
+
+/**
+ * Finds every zombie in the area and the damage it would take, without damaging it.
+ *
+ * @param Area The area to test.
+ * @param OutHandles The slots in the ZombieCrowdSubsystem of the zombies in the area.
+ * @param OutDamage The damage each of the zombies would take.
+ *
+ * @return The number of zombies in the area.
+ */
+int32 UZombieAreaDamageSubsystem::FindZombiesInArea(const FZombieAreaDamage& Area, TArray<FZombieHandle>& OutHandles, TArray<float>& OutDamage)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::BULLETS);
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_AreaDamage);
+
+	OutHandles.Reset();
+	OutDamage.Reset();
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return 0;
+
+	// Zombies only move between frames, so every area in a frame shares the same locations
+	// unless zombies were added to the crowd in between.
+	if (GatheredFrame != GFrameCounter || NumGatheredSlots != Crowd->GetNumSlots()) GatherLocations();
+
+	const int32 NumLocations = LocationsX.Num();
+	Damages.SetNumUninitialized(NumLocations, false);
+	ComputeAreaDamage(LocationsX.GetData(), LocationsY.GetData(), LocationsZ.GetData(), NumLocations, Area, Damages.GetData());
+
+	for (int32 Index = 0; Index < NumGatheredSlots; ++Index)
+	{
+		if (Damages[Index] <= 0.f) continue;
+
+		OutHandles.Add(Crowd->GetHandleAt(Index));
+		OutDamage.Add(Damages[Index]);
+	}
+
+	return OutHandles.Num();
+}
+
+/**
+ * Copies the location of every zombie in the ZombieCrowdSubsystem into the location arrays.
+ * This happens on its own the first time an area is tested in a frame.
+ */
+void UZombieAreaDamageSubsystem::GatherLocations()
+{
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return;
+
+	NumGatheredSlots = Crowd->GetNumSlots();
+	GatheredFrame = GFrameCounter;
+
+	// The kernel does four locations at a time, so the padding is filled with locations that are
+	// never in an area.
+	const int32 NumLocations = Align(NumGatheredSlots, 4);
+	LocationsX.SetNumUninitialized(NumLocations, false);
+	LocationsY.SetNumUninitialized(NumLocations, false);
+	LocationsZ.SetNumUninitialized(NumLocations, false);
+
+	const TArray<ZombieStates>& States = Crowd->GetStates();
+
+	for (int32 Index = 0; Index < NumLocations; ++Index)
+	{
+		const AZombieCharacter* ZombieCharacter = (Index < NumGatheredSlots) ? Crowd->GetCharacterAt(Index) : nullptr;
+		if (ZombieCharacter == nullptr || States[Index] == ZombieStates::DEAD)
+		{
+			LocationsX[Index] = UnreachableLocation;
+			LocationsY[Index] = UnreachableLocation;
+			LocationsZ[Index] = UnreachableLocation;
+			continue;
+		}
+
+		const FVector Location = ZombieCharacter->GetActorLocation();
+		LocationsX[Index] = Location.X;
+		LocationsY[Index] = Location.Y;
+		LocationsZ[Index] = Location.Z;
+	}
+}
+
+/**
+ * Works out the damage of the area at every location. This is the SIMD kernel that does
+ * four locations at a time.
+ *
+ * @param LocationsX The X of every location, 16 byte aligned.
+ * @param LocationsY The Y of every location, 16 byte aligned.
+ * @param LocationsZ The Z of every location, 16 byte aligned.
+ * @param NumLocations The number of locations, which has to be a multiple of four.
+ * @param Area The area to test.
+ * @param OutDamage The damage at every location, or 0 outside of the area, 16 byte aligned.
+ */
+void UZombieAreaDamageSubsystem::ComputeAreaDamage(const float* LocationsX, const float* LocationsY, const float* LocationsZ, int32 NumLocations, const FZombieAreaDamage& Area, float* OutDamage)
+{
+	check(NumLocations % 4 == 0);
+
+	const FVector Direction = Area.Direction.GetSafeNormal();
+	const float Radius = FMath::Max(Area.Radius, KINDA_SMALL_NUMBER);
+
+	// A zombie is in the cone when the angle between the direction and the zombie is small
+	// enough, which is when its distance along the direction is at least the cosine of the cone
+	// angle times its distance from the origin. A sphere uses -2 instead of the cosine of 180
+	// degrees so that zombies right behind the origin aren't lost to the rounding of the distance.
+	const float ConeCos = (Area.ConeHalfAngleDegrees >= 180.f || Direction.IsZero()) ? -2.f : FMath::Cos(FMath::DegreesToRadians(Area.ConeHalfAngleDegrees));
+
+	// The damage falls off from `Damage` at the origin to `Damage * EdgeDamageScale` at the edge.
+	const float Falloff = Area.Damage * (1.f - Area.EdgeDamageScale) / Radius;
+
+	const VectorRegister OriginX = VectorSetFloat1(Area.Origin.X);
+	const VectorRegister OriginY = VectorSetFloat1(Area.Origin.Y);
+	const VectorRegister OriginZ = VectorSetFloat1(Area.Origin.Z);
+	const VectorRegister DirectionX = VectorSetFloat1(Direction.X);
+	const VectorRegister DirectionY = VectorSetFloat1(Direction.Y);
+	const VectorRegister DirectionZ = VectorSetFloat1(Direction.Z);
+	const VectorRegister RadiusSquared = VectorSetFloat1(FMath::Square(Radius));
+	const VectorRegister Cos = VectorSetFloat1(ConeCos);
+	const VectorRegister Damage = VectorSetFloat1(Area.Damage);
+	const VectorRegister NegativeFalloff = VectorSetFloat1(-Falloff);
+	const VectorRegister TinyDistanceSquared = VectorSetFloat1(SMALL_NUMBER);
+
+	for (int32 Index = 0; Index < NumLocations; Index += 4)
+	{
+		const VectorRegister ToX = VectorSubtract(VectorLoadAligned(LocationsX + Index), OriginX);
+		const VectorRegister ToY = VectorSubtract(VectorLoadAligned(LocationsY + Index), OriginY);
+		const VectorRegister ToZ = VectorSubtract(VectorLoadAligned(LocationsZ + Index), OriginZ);
+
+		const VectorRegister DistanceSquared = VectorMultiplyAdd(ToZ, ToZ, VectorMultiplyAdd(ToY, ToY, VectorMultiply(ToX, ToX)));
+
+		// Zombies right on the origin are given a tiny distance so the square root of the
+		// reciprocal doesn't blow up. The distance is the squared distance over its square root.
+		const VectorRegister SafeDistanceSquared = VectorMax(DistanceSquared, TinyDistanceSquared);
+		const VectorRegister Distance = VectorMultiply(SafeDistanceSquared, VectorReciprocalSqrt(SafeDistanceSquared));
+
+		const VectorRegister Along = VectorMultiplyAdd(ToZ, DirectionZ, VectorMultiplyAdd(ToY, DirectionY, VectorMultiply(ToX, DirectionX)));
+
+		const VectorRegister InSphere = VectorCompareGE(RadiusSquared, DistanceSquared);
+		const VectorRegister InCone = VectorCompareGE(Along, VectorMultiply(Cos, Distance));
+
+		const VectorRegister LocationDamage = VectorMultiplyAdd(NegativeFalloff, Distance, Damage);
+
+		VectorStoreAligned(VectorSelect(VectorBitwiseAnd(InSphere, InCone), LocationDamage, VectorZero()), OutDamage + Index);
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieHandle.h"
+#include "ZombieAreaDamageSubsystem.generated.h"
+
+/**
+ * An area that damages every zombie inside of it, like a grenade blast or a shotgun cone.
+ */
+USTRUCT(BlueprintType)
+struct FZombieAreaDamage
+{
+	GENERATED_BODY()
+
+	// The center of the blast or the muzzle of the shotgun.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AreaDamage)
+	FVector Origin = FVector::ZeroVector;
+
+	// The direction the cone points in. Not used when the cone angle is 180 degrees.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AreaDamage)
+	FVector Direction = FVector::ForwardVector;
+
+	// How far from the origin zombies are damaged.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AreaDamage)
+	float Radius = 500.f;
+
+	// The angle between the direction and the side of the cone. 180 degrees damages the whole
+	// sphere around the origin.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AreaDamage)
+	float ConeHalfAngleDegrees = 180.f;
+
+	// The damage done to a zombie at the origin.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AreaDamage)
+	float Damage = 100.f;
+
+	// The fraction of the damage done to a zombie at the edge of the area. The damage falls off
+	// in a straight line from the origin to the edge.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AreaDamage)
+	float EdgeDamageScale = 0.25f;
+
+	// Whether walls between the origin and a zombie keep it from being damaged. Every zombie in
+	// the area costs a line trace when this is on.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AreaDamage)
+	bool bBlockedByWalls = true;
+};
+
+/**
+ * The ZombieAreaDamageSubsystem damages every zombie in a sphere or a cone at once. Instead of
+ * asking physics for the overlapping components and casting each of them to a ZombieCharacter,
+ * it copies the location of every zombie in the ZombieCrowdSubsystem into aligned arrays once
+ * per frame and tests four zombies at a time against the area with SIMD instructions. Only the
+ * zombies in the area are then traced to, so that walls shield the zombies behind them. The
+ * damage is handed to the ZombieDamageSubsystem so zombies die the same way as when they're
+ * shot.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieAreaDamageSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieAreaDamageSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Damages every zombie in the area that no wall is in front of.
+	 *
+	 * @param Area The area to damage.
+	 *
+	 * @return The number of zombies that were damaged.
+	 */
+	UFUNCTION(BlueprintCallable, Category = AreaDamage)
+	int32 ApplyAreaDamage(const FZombieAreaDamage& Area);
+
+	/**
+	 * Finds every zombie in the area and the damage it would take, without damaging it.
+	 *
+	 * @param Area The area to test.
+	 * @param OutHandles The slots in the ZombieCrowdSubsystem of the zombies in the area.
+	 * @param OutDamage The damage each of the zombies would take.
+	 *
+	 * @return The number of zombies in the area.
+	 */
+	int32 FindZombiesInArea(const FZombieAreaDamage& Area, TArray<FZombieHandle>& OutHandles, TArray<float>& OutDamage);
+
+	/**
+	 * Copies the location of every zombie in the ZombieCrowdSubsystem into the location arrays.
+	 * This happens on its own the first time an area is tested in a frame.
+	 */
+	void GatherLocations();
+
+	/**
+	 * Works out the damage of the area at every location. This is the SIMD kernel that does
+	 * four locations at a time.
+	 *
+	 * @param LocationsX The X of every location, 16 byte aligned.
+	 * @param LocationsY The Y of every location, 16 byte aligned.
+	 * @param LocationsZ The Z of every location, 16 byte aligned.
+	 * @param NumLocations The number of locations, which has to be a multiple of four.
+	 * @param Area The area to test.
+	 * @param OutDamage The damage at every location, or 0 outside of the area, 16 byte aligned.
+	 */
+	static void ComputeAreaDamage(const float* LocationsX, const float* LocationsY, const float* LocationsZ, int32 NumLocations, const FZombieAreaDamage& Area, float* OutDamage);
+
+protected:
+	// The location of the zombie in every slot of the ZombieCrowdSubsystem, padded to a multiple
+	// of four. Free slots and dead zombies are put far away so that they're never in an area.
+	TArray<float, TAlignedHeapAllocator<16>> LocationsX;
+	TArray<float, TAlignedHeapAllocator<16>> LocationsY;
+	TArray<float, TAlignedHeapAllocator<16>> LocationsZ;
+
+	// The damage of the last area at every location.
+	TArray<float, TAlignedHeapAllocator<16>> Damages;
+
+	// The number of slots of the ZombieCrowdSubsystem when the locations were gathered.
+	int32 NumGatheredSlots = 0;
+
+	// The frame the locations were gathered in.
+	uint64 GatheredFrame = MAX_uint64;
+
+	// Scratch space for `ApplyAreaDamage`.
+	TArray<FZombieHandle> HitHandles;
+	TArray<float> HitDamage;
+};
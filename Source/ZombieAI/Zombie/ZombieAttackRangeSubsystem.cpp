@@ -0,0 +1,233 @@
+#include "ZombieAttackRangeSubsystem.h"
+#include "ZombieAIController.h"
+#include "ZombieCharacter.h"
+#include "ZombieCrowdSubsystem.h"
+#include "../Player/PlayerCharacter.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarZombieAttackRangeInterval(
+	TEXT("zombie.AttackRange.Interval"),
+	0.05f,
+	TEXT("The number of seconds between the passes that find the PlayerCharacters within reach of every zombie."),
+	ECVF_Default);
+
+/**
+ * Called when the world that owns the ZombieAttackRangeSubsystem is torn down.
+ */
+void UZombieAttackRangeSubsystem::Deinitialize()
+{
+	Players.Empty();
+	PlayerLocations.Empty();
+	PlayerRadii.Empty();
+	PlayerHalfHeights.Empty();
+	PlayersInReach.Empty();
+	SlotGenerations.Empty();
+	ReachedHandles.Empty();
+	EscapedPlayers.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Adds the PlayerCharacter to the things zombies can reach. Only the first 32
+ * PlayerCharacters can be reached.
+ *
+ * @param PlayerCharacter The PlayerCharacter to add.
+ */
+void UZombieAttackRangeSubsystem::RegisterPlayer(APlayerCharacter* PlayerCharacter)
+{
+	Players.Add(PlayerCharacter);
+}
+
+/**
+ * Removes the PlayerCharacter from the things zombies can reach.
+ *
+ * @param PlayerCharacter The PlayerCharacter to remove.
+ */
+void UZombieAttackRangeSubsystem::UnregisterPlayer(APlayerCharacter* PlayerCharacter)
+{
+	Players.Remove(PlayerCharacter, PlayersInReach);
+}
+
+/**
+ * Called every frame to run a pass once enough time has passed since the last one.
+ */
+void UZombieAttackRangeSubsystem::Tick(float DeltaTime)
+{
+	// Only the server decides when zombies reach a PlayerCharacter. Clients get the states it
+	// leads to replicated.
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->GetNetMode() == NM_Client) return;
+
+	TimeSinceLastPass += DeltaTime;
+	if (TimeSinceLastPass < CVarZombieAttackRangeInterval.GetValueOnGameThread()) return;
+	TimeSinceLastPass = 0.f;
+
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::PERCEPTION);
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_AttackRange);
+
+	UpdateAttackRanges();
+}
+
+TStatId UZombieAttackRangeSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieAttackRangeSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Tests every zombie in the ZombieCrowdSubsystem against every PlayerCharacter and raises
+ * the events of the zombies whose PlayerCharacters within reach changed.
+ */
+void UZombieAttackRangeSubsystem::UpdateAttackRanges()
+{
+	LastPassTestCount = 0;
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return;
+
+	// Read the PlayerCharacters' capsules once instead of once per zombie.
+	const int32 NumPlayers = Players.Num();
+	PlayerLocations.SetNumUninitialized(NumPlayers, false);
+	PlayerRadii.SetNumUninitialized(NumPlayers, false);
+	PlayerHalfHeights.SetNumUninitialized(NumPlayers, false);
+	uint32 ValidPlayers = 0;
+	for (int32 PlayerIndex = 0; PlayerIndex < NumPlayers; ++PlayerIndex)
+	{
+		const APlayerCharacter* PlayerCharacter = Players[PlayerIndex];
+		if (PlayerCharacter == nullptr) continue;
+
+		const UCapsuleComponent* Capsule = PlayerCharacter->GetCapsuleComponent();
+		PlayerLocations[PlayerIndex] = Capsule->GetComponentLocation();
+		PlayerRadii[PlayerIndex] = Capsule->GetScaledCapsuleRadius();
+		PlayerHalfHeights[PlayerIndex] = Capsule->GetScaledCapsuleHalfHeight();
+		ValidPlayers |= 1u << PlayerIndex;
+	}
+
+	const int32 NumSlots = Crowd->GetNumSlots();
+	while (PlayersInReach.Num() < NumSlots)
+	{
+		PlayersInReach.Add(0);
+		SlotGenerations.Add(INDEX_NONE);
+	}
+
+	const TArray<ZombieStates>& States = Crowd->GetStates();
+
+	for (int32 Index = 0; Index < NumSlots; ++Index)
+	{
+		const AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		// A zombie that took over the slot since the last pass starts with nothing in reach.
+		const FZombieHandle Handle = Crowd->GetHandleAt(Index);
+		if (SlotGenerations[Index] != Handle.Generation)
+		{
+			SlotGenerations[Index] = Handle.Generation;
+			PlayersInReach[Index] = 0;
+		}
+
+		// Dead zombies don't reach for anything, and the PlayerCharacters they had within reach
+		// are let go of quietly so that they don't give chase.
+		if (States[Index] == ZombieStates::DEAD)
+		{
+			PlayersInReach[Index] = 0;
+			continue;
+		}
+
+		// The arm reach box turns with the zombie around the vertical axis.
+		const FVector Location = ZombieCharacter->GetActorLocation();
+		const FVector2D AxisX = FVector2D(ZombieCharacter->GetActorForwardVector()).GetSafeNormal();
+		const FVector2D AxisY(-AxisX.Y, AxisX.X);
+		const FVector& Offset = ZombieCharacter->AttackReachOffset;
+		const FVector& Extent = ZombieCharacter->AttackReachExtent;
+		const FVector BoxCenter(
+			Location.X + AxisX.X * Offset.X + AxisY.X * Offset.Y,
+			Location.Y + AxisX.Y * Offset.X + AxisY.Y * Offset.Y,
+			Location.Z + Offset.Z
+		);
+		const float BoxRadius = Extent.Size();
+
+		const uint32 OldPlayersInReach = PlayersInReach[Index];
+		uint32 NewPlayersInReach = 0;
+
+		uint32 RemainingPlayers = ValidPlayers;
+		while (RemainingPlayers != 0)
+		{
+			const int32 PlayerIndex = FMath::CountTrailingZeros(RemainingPlayers);
+			RemainingPlayers &= RemainingPlayers - 1;
+
+			// Skip PlayerCharacters that are too far away for the bounds of the box and capsule
+			// to touch before doing the exact test.
+			const float MaxDistance = BoxRadius + PlayerRadii[PlayerIndex] + PlayerHalfHeights[PlayerIndex];
+			if (FVector::DistSquared(BoxCenter, PlayerLocations[PlayerIndex]) > FMath::Square(MaxDistance)) continue;
+
+			LastPassTestCount++;
+			if (BoxOverlapsCapsule(BoxCenter, AxisX, Extent, PlayerLocations[PlayerIndex], PlayerRadii[PlayerIndex], PlayerHalfHeights[PlayerIndex]))
+			{
+				NewPlayersInReach |= 1u << PlayerIndex;
+			}
+		}
+
+		PlayersInReach[Index] = NewPlayersInReach;
+
+		if ((NewPlayersInReach & ~OldPlayersInReach) != 0) ReachedHandles.Add(Handle);
+
+		uint32 EscapedMask = OldPlayersInReach & ~NewPlayersInReach;
+		while (EscapedMask != 0)
+		{
+			const int32 PlayerIndex = FMath::CountTrailingZeros(EscapedMask);
+			EscapedMask &= EscapedMask - 1;
+
+			EscapedPlayers.Emplace(Handle, PlayerIndex);
+		}
+	}
+
+	// The events are raised once every zombie has been tested since they can change the states
+	// the pass reads.
+	if (ReachedHandles.Num() > 0) Crowd->SendEvents(ReachedHandles, ZombieEvents::TARGET_REACHED);
+
+	for (const TPair<FZombieHandle, int32>& Escaped : EscapedPlayers)
+	{
+		if (!Crowd->IsValidHandle(Escaped.Key) || Players[Escaped.Value] == nullptr) continue;
+
+		AZombieAIController* ZombieAIController = Cast<AZombieAIController>(Crowd->GetCharacter(Escaped.Key)->GetController());
+		if (ZombieAIController != nullptr) ZombieAIController->OnPlayerLeftAttackRange(Players[Escaped.Value]);
+	}
+
+	ReachedHandles.Reset();
+	EscapedPlayers.Reset();
+}
+
+/**
+ * Returns whether the upright capsule overlaps the box. The box is only turned around the
+ * vertical axis, so the distance between them is found separately on the ground and along
+ * the vertical axis.
+ *
+ * @param BoxCenter The center of the box.
+ * @param BoxAxisX The direction of the box's forward axis on the ground.
+ * @param BoxExtent The half size of the box along its forward, right and up axes.
+ * @param CapsuleCenter The center of the capsule.
+ * @param CapsuleRadius The radius of the capsule.
+ * @param CapsuleHalfHeight The half height of the capsule, including its rounded ends.
+ */
+bool UZombieAttackRangeSubsystem::BoxOverlapsCapsule(const FVector& BoxCenter, const FVector2D& BoxAxisX, const FVector& BoxExtent, const FVector& CapsuleCenter, float CapsuleRadius, float CapsuleHalfHeight)
+{
+	const FVector ToCapsule = CapsuleCenter - BoxCenter;
+
+	// The capsule's center line in the box's space.
+	const float LocalX = ToCapsule.X * BoxAxisX.X + ToCapsule.Y * BoxAxisX.Y;
+	const float LocalY = ToCapsule.Y * BoxAxisX.X - ToCapsule.X * BoxAxisX.Y;
+	const float SegmentHalfHeight = FMath::Max(CapsuleHalfHeight - CapsuleRadius, 0.f);
+
+	// The distance from the center line to the box on each axis. The line is vertical so along
+	// that axis it's the gap between the line's span and the box's.
+	const float DistanceX = FMath::Max(FMath::Abs(LocalX) - BoxExtent.X, 0.f);
+	const float DistanceY = FMath::Max(FMath::Abs(LocalY) - BoxExtent.Y, 0.f);
+	const float DistanceZ = FMath::Max(FMath::Abs(ToCapsule.Z) - BoxExtent.Z - SegmentHalfHeight, 0.f);
+
+	return FMath::Square(DistanceX) + FMath::Square(DistanceY) + FMath::Square(DistanceZ) <= FMath::Square(CapsuleRadius);
+}
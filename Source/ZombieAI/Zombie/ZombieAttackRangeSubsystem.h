@@ -0,0 +1,115 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieHandle.h"
+#include "ZombiePlayerSlots.h"
+#include "ZombieAttackRangeSubsystem.generated.h"
+
+class APlayerCharacter;
+
+/**
+ * The ZombieAttackRangeSubsystem finds the PlayerCharacters that are within reach of each
+ * zombie's arms. It replaces a trigger box on every ZombieCharacter, whose overlaps had to be
+ * kept up to date by physics every time the zombie moved, with one pass over the whole
+ * ZombieCrowdSubsystem that tests each zombie's arm reach box against the PlayerCharacters'
+ * capsules a fixed number of times per second.
+ *
+ * Zombies that get a PlayerCharacter within reach are sent TARGET_REACHED together, and the
+ * ZombieAIControllers of zombies that lose one are told so that they give chase again, just
+ * like when the trigger box's overlap began and ended.
+ *
+ * The time between passes is set with `zombie.AttackRange.Interval`.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieAttackRangeSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieAttackRangeSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Adds the PlayerCharacter to the things zombies can reach. Only the first 32
+	 * PlayerCharacters can be reached.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter to add.
+	 */
+	void RegisterPlayer(APlayerCharacter* PlayerCharacter);
+
+	/**
+	 * Removes the PlayerCharacter from the things zombies can reach.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter to remove.
+	 */
+	void UnregisterPlayer(APlayerCharacter* PlayerCharacter);
+
+	/**
+	 * Returns the number of zombie and PlayerCharacter pairs that were tested in the last pass.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieAttackRange)
+	int32 GetLastPassTestCount() const { return LastPassTestCount; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Tests every zombie in the ZombieCrowdSubsystem against every PlayerCharacter and raises
+	 * the events of the zombies whose PlayerCharacters within reach changed.
+	 */
+	void UpdateAttackRanges();
+
+	/**
+	 * Returns whether the upright capsule overlaps the box. The box is only turned around the
+	 * vertical axis, so the distance between them is found separately on the ground and along
+	 * the vertical axis.
+	 *
+	 * @param BoxCenter The center of the box.
+	 * @param BoxAxisX The direction of the box's forward axis on the ground.
+	 * @param BoxExtent The half size of the box along its forward, right and up axes.
+	 * @param CapsuleCenter The center of the capsule.
+	 * @param CapsuleRadius The radius of the capsule.
+	 * @param CapsuleHalfHeight The half height of the capsule, including its rounded ends.
+	 */
+	static bool BoxOverlapsCapsule(const FVector& BoxCenter, const FVector2D& BoxAxisX, const FVector& BoxExtent, const FVector& CapsuleCenter, float CapsuleRadius, float CapsuleHalfHeight);
+
+protected:
+	// The PlayerCharacters that can be reached. The index of a PlayerCharacter is its bit in the
+	// `PlayersInReach` masks.
+	UPROPERTY()
+	FZombiePlayerSlots Players;
+
+	// The location, radius and half height of each PlayerCharacter's capsule, gathered at the
+	// start of every pass.
+	TArray<FVector> PlayerLocations;
+	TArray<float> PlayerRadii;
+	TArray<float> PlayerHalfHeights;
+
+	// A bit for every PlayerCharacter that is within reach of the zombie in each slot of the
+	// ZombieCrowdSubsystem.
+	TArray<uint32> PlayersInReach;
+
+	// The generation of the crowd slot that each entry of `PlayersInReach` belongs to, so that a
+	// zombie that takes over a slot starts without any PlayerCharacters in reach.
+	TArray<int32> SlotGenerations;
+
+	// The zombies that got a PlayerCharacter within reach in this pass.
+	TArray<FZombieHandle> ReachedHandles;
+
+	// The zombies that lost a PlayerCharacter in this pass and the index of that PlayerCharacter.
+	TArray<TPair<FZombieHandle, int32>> EscapedPlayers;
+
+	// The time that has passed since the last pass.
+	float TimeSinceLastPass = 0.f;
+
+	// The number of zombie and PlayerCharacter pairs that were tested in the last pass.
+	int32 LastPassTestCount = 0;
+};
@@ -0,0 +1,152 @@
+#include "ZombieBrain.h"
+#include "Math/RandomStream.h"
+
+/**
+ * Makes the decision described by the input.
+ *
+ * @param Input Everything the decision depends on.
+ */
+FZombieThinkResult FZombieBrain::Decide(const FZombieThinkInput& Input)
+{
+	switch (Input.Type)
+	{
+	case ZombieThinkTypes::PERCEPTION_UPDATED:
+		return DecidePerception(Input);
+	case ZombieThinkTypes::MOVE_COMPLETED:
+		return DecideMoveCompleted(Input);
+	case ZombieThinkTypes::ROAM:
+	{
+		FZombieThinkResult Result;
+		PickRoamLocation(Input, Input.StartLocation, Result);
+		return Result;
+	}
+	case ZombieThinkTypes::IDLE_OR_ROAM:
+		return DecideIdleOrRoam(Input);
+	}
+
+	return FZombieThinkResult();
+}
+
+/**
+ * Decides whether to start or stop chasing after the perception of an actor changed.
+ */
+FZombieThinkResult FZombieBrain::DecidePerception(const FZombieThinkInput& Input)
+{
+	// If the actor is not in the sight radius then we make sure to stop the ZombieCharacter's
+	// movement and put them back in the IDLE or ROAM state.
+	if (!Input.bTargetInSight) return DecideStopChase(Input);
+
+	// Nothing to do if the ZombieCharacter is already chasing or if what it saw isn't a
+	// PlayerCharacter.
+	FZombieThinkResult Result;
+	if (Input.State == ZombieStates::CHASE || !Input.bTargetIsPlayer) return Result;
+
+	Result.Action = ZombieThinkActions::CHASE;
+	return Result;
+}
+
+/**
+ * Decides what to do after a move request has been completed. Roaming zombies pause for
+ * `RoamDelay` before roaming again, or roam again right away if there is no delay.
+ */
+FZombieThinkResult FZombieBrain::DecideMoveCompleted(const FZombieThinkInput& Input)
+{
+	FZombieThinkResult Result;
+	if (Input.State != ZombieStates::ROAM) return Result;
+
+	if (Input.RoamDelay > 0.f)
+	{
+		Result.Action = ZombieThinkActions::IDLE;
+		Result.Delay = ZombieThinkDelays::ROAM_DELAY;
+	}
+	else
+	{
+		PickRoamLocation(Input, Input.StartLocation, Result);
+	}
+
+	return Result;
+}
+
+/**
+ * Decides whether the ZombieCharacter should be idling or roaming. If the ZombieCharacter's
+ * previous state was CHASE and the ZombieCharacter is supposed to roam then the start location
+ * is moved to the current location as we don't want the ZombieCharacter to go all the way back
+ * to where it started.
+ */
+FZombieThinkResult FZombieBrain::DecideIdleOrRoam(const FZombieThinkInput& Input)
+{
+	FZombieThinkResult Result;
+
+	if (!Input.bCanRoam)
+	{
+		Result.Action = ZombieThinkActions::IDLE;
+		return Result;
+	}
+
+	FVector StartLocation = Input.StartLocation;
+	if (Input.PreviousState == ZombieStates::CHASE)
+	{
+		StartLocation = Input.CurrentLocation;
+		Result.bSetStartLocation = true;
+		Result.NewStartLocation = StartLocation;
+	}
+
+	PickRoamLocation(Input, StartLocation, Result);
+	return Result;
+}
+
+/**
+ * Decides how the ZombieCharacter stops chasing. The ZombieCharacter stops moving and then
+ * either idles for `AfterChaseDelay` or goes straight back to idling or roaming.
+ */
+FZombieThinkResult FZombieBrain::DecideStopChase(const FZombieThinkInput& Input)
+{
+	FZombieThinkResult Result;
+
+	if (Input.AfterChaseDelay > 0.f)
+	{
+		Result.Action = ZombieThinkActions::IDLE;
+		Result.Delay = ZombieThinkDelays::AFTER_CHASE_DELAY;
+	}
+	else
+	{
+		Result = DecideIdleOrRoam(Input);
+	}
+
+	Result.bStopMovement = true;
+	return Result;
+}
+
+/**
+ * Makes the result roam to a random location around the start location.
+ *
+ * @param Input Everything the decision depends on.
+ * @param StartLocation The location to roam around.
+ * @param OutResult The result to make roam.
+ */
+void FZombieBrain::PickRoamLocation(const FZombieThinkInput& Input, const FVector& StartLocation, FZombieThinkResult& OutResult)
+{
+	OutResult.Action = ZombieThinkActions::ROAM;
+	OutResult.RoamCenter = StartLocation;
+	OutResult.RoamLocation = ChooseRoamLocation(StartLocation, Input.RoamRadius, Input.RandomSeed);
+}
+
+/**
+ * Picks a random location within the roam radius around the start location.
+ *
+ * @param StartLocation The location to roam around.
+ * @param RoamRadius How far from the start location the ZombieCharacter can roam.
+ * @param RandomSeed The seed used to pick the location.
+ */
+FVector FZombieBrain::ChooseRoamLocation(const FVector& StartLocation, float RoamRadius, int32 RandomSeed)
+{
+	// Choose a random point within a box centered on the start location so that the
+	// ZombieCharacter will never roam to new places.
+	const FRandomStream RandomStream(RandomSeed);
+
+	return FVector(
+		StartLocation.X + RandomStream.FRandRange(-RoamRadius, RoamRadius),
+		StartLocation.Y + RandomStream.FRandRange(-RoamRadius, RoamRadius),
+		StartLocation.Z
+	);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ZombieThinkTypes.h"
+
+/**
+ * The decision making of the ZombieAIController written as pure functions of a FZombieThinkInput
+ * so that decisions for the whole horde can be made in parallel.
+ */
+struct ZOMBIEAI_API FZombieBrain
+{
+	/**
+	 * Makes the decision described by the input.
+	 *
+	 * @param Input Everything the decision depends on.
+	 */
+	static FZombieThinkResult Decide(const FZombieThinkInput& Input);
+
+	/**
+	 * Decides whether to start or stop chasing after the perception of an actor changed.
+	 */
+	static FZombieThinkResult DecidePerception(const FZombieThinkInput& Input);
+
+	/**
+	 * Decides what to do after a move request has been completed. Roaming zombies pause for
+	 * `RoamDelay` before roaming again, or roam again right away if there is no delay.
+	 */
+	static FZombieThinkResult DecideMoveCompleted(const FZombieThinkInput& Input);
+
+	/**
+	 * Decides whether the ZombieCharacter should be idling or roaming. If the ZombieCharacter's
+	 * previous state was CHASE and the ZombieCharacter is supposed to roam then the start location
+	 * is moved to the current location as we don't want the ZombieCharacter to go all the way back
+	 * to where it started.
+	 */
+	static FZombieThinkResult DecideIdleOrRoam(const FZombieThinkInput& Input);
+
+	/**
+	 * Decides how the ZombieCharacter stops chasing. The ZombieCharacter stops moving and then
+	 * either idles for `AfterChaseDelay` or goes straight back to idling or roaming.
+	 */
+	static FZombieThinkResult DecideStopChase(const FZombieThinkInput& Input);
+
+	/**
+	 * Makes the result roam to a random location around the start location.
+	 *
+	 * @param Input Everything the decision depends on.
+	 * @param StartLocation The location to roam around.
+	 * @param OutResult The result to make roam.
+	 */
+	static void PickRoamLocation(const FZombieThinkInput& Input, const FVector& StartLocation, FZombieThinkResult& OutResult);
+
+	/**
+	 * Picks a random location within the roam radius around the start location.
+	 *
+	 * @param StartLocation The location to roam around.
+	 * @param RoamRadius How far from the start location the ZombieCharacter can roam.
+	 * @param RandomSeed The seed used to pick the location.
+	 */
+	static FVector ChooseRoamLocation(const FVector& StartLocation, float RoamRadius, int32 RandomSeed);
+};
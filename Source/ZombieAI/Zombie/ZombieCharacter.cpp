@@ -1,13 +1,54 @@
 #include "ZombieCharacter.h"
 #include "ZombieAIController.h"
-#include "Components/BoxComponent.h"
+#include "ZombieCrowdSubsystem.h"
+#include "ZombieDamageSubsystem.h"
+#include "ZombieAnimInstance.h"
+#include "ZombieLocomotionSubsystem.h"
+#include "ZombieMovementComponent.h"
+#include "ZombiePoolSubsystem.h"
+#include "ZombieReplicationSubsystem.h"
+#include "ZombieTimerSubsystem.h"
+#include "ZombieVertexAnimationData.h"
+#include "Components/CapsuleComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "Net/DataBunch.h"
+#include "Net/UnrealNetwork.h"
+
+/**
+ * Writes the state in three bits, whether the ZombieCharacter is pooled in one bit and the
+ * health in as few bytes as it needs.
+ */
+bool FZombieReplicatedStatus::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	static_assert((uint8)ZombieStates::DEAD < 8, "The zombie states have to fit in three bits.");
+
+	uint8 StateBits = (uint8)State;
+	Ar.SerializeBits(&StateBits, 3);
+
+	uint8 PooledBit = bIsPooled ? 1 : 0;
+	Ar.SerializeBits(&PooledBit, 1);
+
+	// Health is written seven bits at a time, so a zombie with 100 health sends one byte.
+	uint32 PackedHealth = Health;
+	Ar.SerializeIntPacked(PackedHealth);
+
+	if (Ar.IsLoading())
+	{
+		State = (ZombieStates)FMath::Min<uint8>(StateBits, (uint8)ZombieStates::DEAD);
+		bIsPooled = PooledBit != 0;
+		Health = (uint16)FMath::Min<uint32>(PackedHealth, MAX_uint16);
+	}
+
+	bOutSuccess = true;
+	return true;
+}
 
 /**
  * Sets the default values for the ZombieCharacter.
  */
-AZombieCharacter::AZombieCharacter()
+AZombieCharacter::AZombieCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UZombieMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Load the assets needed for the ZombieCharacter.
 	static ConstructorHelpers::FObjectFinder<USkeletalMesh>ZombieSkeletalMeshAsset(TEXT("SkeletalMesh'/Game/Models/ZombieJill/jill.jill'"));
@@ -20,14 +61,17 @@ AZombieCharacter::AZombieCharacter()
 	ZombieSkeletalMesh->SetAnimInstanceClass(ZombieAnimAsset.Object->GeneratedClass);
 	ZombieSkeletalMesh->SetupAttachment(RootComponent);
 
-	// Create the DamageCollider and set it so that it extends out about as far as the
-	// ZombieCharacter's arm would extend when attacking.
-	ZombieDamageCollider = CreateDefaultSubobject<UBoxComponent>(TEXT("ZombieDamageCollider"));
-	ZombieDamageCollider->SetRelativeLocation(FVector(70.f, 0.f, 40.f));
-	ZombieDamageCollider->SetBoxExtent(FVector(30.f, 30.f, 20.f));
-	ZombieDamageCollider->SetGenerateOverlapEvents(true);
-	ZombieDamageCollider->SetCollisionProfileName(TEXT("Trigger"));
-	ZombieDamageCollider->SetupAttachment(RootComponent);
+	// Draw the ZombieCharacter as an impostor when it's far away once its animations have been
+	// baked by the ZombieVertexAnimationBakeCommandlet. Until then it always uses its skeletal mesh.
+	static ConstructorHelpers::FObjectFinderOptional<UZombieVertexAnimationData>ZombieVertexAnimationAsset(TEXT("ZombieVertexAnimationData'/Game/VertexAnimation/ZombieJill/DA_ZombieJill_VertexAnimation.DA_ZombieJill_VertexAnimation'"), LOAD_NoWarn | LOAD_Quiet);
+	VertexAnimationData = ZombieVertexAnimationAsset.Get();
+
+	// Let the engine update the animation less often the smaller the ZombieCharacter is on
+	// screen and interpolate the frames in between, and stop posing it when it isn't rendered.
+	// The rates are set in `OnAnimUpdateRateParamsCreated`.
+	ZombieSkeletalMesh->bEnableUpdateRateOptimizations = true;
+	ZombieSkeletalMesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+	ZombieSkeletalMesh->OnAnimUpdateRateParamsCreated.BindUObject(this, &AZombieCharacter::OnAnimUpdateRateParamsCreated);
 
 	// Helps orient the PatrolCharacter so that when it walks it doesn't face the
 	// Waypoint but instead the direction that it's walking.
@@ -40,125 +84,432 @@ AZombieCharacter::AZombieCharacter()
 	// Set the default AIController of the class.
 	AIControllerClass = AZombieAIController::StaticClass();
 	AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
+
+	// Zombies only walk around and turn, so their location and velocity are rounded to whole
+	// units and their rotation to a byte per axis. They aren't sent to players further away
+	// than the cull distance, and the ZombieReplicationSubsystem lowers how often they're sent
+	// to players that are far away.
+	FRepMovement& ZombieRepMovement = GetReplicatedMovement_Mutable();
+	ZombieRepMovement.LocationQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	ZombieRepMovement.VelocityQuantizationLevel = EVectorQuantization::RoundWholeNumber;
+	ZombieRepMovement.RotationQuantizationLevel = ERotatorQuantization::ByteComponents;
+	NetCullDistanceSquared = FMath::Square(8000.f);
+	NetUpdateFrequency = 20.f;
+	MinNetUpdateFrequency = 2.f;
 }
 
 /**
- * Called when the game starts.
+ * Returns the properties of the ZombieCharacter that are replicated to clients.
  */
-void AZombieCharacter::BeginPlay()
+void AZombieCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	Super::BeginPlay();
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	// Set the starting location of the ZombieCharacter.
-	StartLocation = GetActorLocation();
+	// The status is only sent when it changes, but every time it arrives it's copied into the
+	// client's ZombieCrowdSubsystem.
+	DOREPLIFETIME_CONDITION_NOTIFY(AZombieCharacter, ReplicatedStatus, COND_None, REPNOTIFY_Always);
 }
 
 /**
- * Called to make the ZombieCharacter take damage and check to see if the
- * ZombieCharacter needs to die.
+ * Called after the ZombieCharacter's components have been initialized. This is where the
+ * ZombieCharacter joins the ZombieCrowdSubsystem so that its state is ready before the
+ * ZombieAIController takes it over.
  */
-void AZombieCharacter::Hit(float Damage)
+void AZombieCharacter::PostInitializeComponents()
 {
-	// Take the damage to apply from the ZombieCharacter's damage.
-	Health -= Damage;
+	// Join the crowd before calling `Super` since that is where the ZombieAIController is
+	// spawned and takes over the ZombieCharacter. The crowd also sets the starting location
+	// of the ZombieCharacter to where it currently is.
+	JoinCrowd();
 
-	// If the ZombieCharacter's `Health` is at or below zero then we have take care of disabling the
-	// ZombieAIController.
-	if (Health <= 0.f)
-	{
-		// Have the ZombieAIController un possess the ZombieCharacter and then destroy the
-		// ZombieAIController so it doesn't give any more input to the ZombieCharacter.
-		AAIController* ZombieAIController = Cast<AAIController>(GetController());
-		if (ZombieAIController == nullptr) return;
-		ZombieAIController->UnPossess();
-		ZombieAIController->Destroy();
-
-		// Put the ZombieCharacter in the `DEAD` state so that the animation blueprint will play
-		// the zombie dying animation.
-		ToDeadState();
-
-		// Now we set a timer for the length of the dying animation to make sure that if we have to
-		// destroy the ZombieCharacter, we don't do it until the animation has finished playing.
-		UWorld* World = GetWorld();
-		if (World == nullptr) return;
-		World->GetTimerManager().SetTimer(DeathAnimationTimer, this, &AZombieCharacter::AfterDeathAnimationFinished, DyingAnimationLengthInSeconds);
-	}
+	Super::PostInitializeComponents();
 }
 
 /**
- * Called after the death animation finishes playing.
+ * Called when the ZombieCharacter is removed from the world.
  */
-void AZombieCharacter::AfterDeathAnimationFinished()
+void AZombieCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	// Now that the dying animation has finished playing we can see if we need to Destroy
-	// the ZombieCharacter.
-	if (SecondsAfterDeathBeforeDestroy == 0.f)
-	{
-		// The ZombieCharacter should be destroyed immediately so we don't need to set a
-		// timer.
-		Destroy();
-	}
-	else if (SecondsAfterDeathBeforeDestroy > 0.f)
-	{
-		// We have to wait some time before the ZombieCharacter should be Destroyed so we
-		// set a timer that runs the method to destroy the ZombieCharacter.
-		SetLifeSpan(SecondsAfterDeathBeforeDestroy);
-	}
+	ClearDeathAnimationTimer();
+	LeaveCrowd();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+/**
+ * Called on the server right before the ZombieCharacter is replicated to copy its state and
+ * health out of the ZombieCrowdSubsystem.
+ */
+void AZombieCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	ReplicatedStatus.State = GetState();
+	ReplicatedStatus.Health = (uint16)FMath::Clamp(FMath::CeilToInt(GetHealth()), 0, (int32)MAX_uint16);
+	ReplicatedStatus.bIsPooled = bIsPooled;
+}
+
+/**
+ * Called on the server after the ZombieCharacter's properties are written to a client's actor
+ * channel. Once its components are written as well, the bunch holds everything sent about
+ * the ZombieCharacter to that client this time, which the ZombieReplicationSubsystem adds up.
+ */
+bool AZombieCharacter::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	const bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
+
+	UWorld* World = GetWorld();
+	UZombieReplicationSubsystem* Replication = (World != nullptr) ? World->GetSubsystem<UZombieReplicationSubsystem>() : nullptr;
+	if (Replication != nullptr && Bunch != nullptr) Replication->AddZombieChannelBits(Bunch->GetNumBits());
+
+	return bWroteSomething;
+}
+
+/**
+ * Called on clients when the ZombieCharacter's state, health or pooling changed on the server.
+ */
+void AZombieCharacter::OnRep_ReplicatedStatus()
+{
+	// The server hides pooled ZombieCharacters for everyone, but collision isn't replicated.
+	SetActorEnableCollision(!ReplicatedStatus.bIsPooled);
+
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return;
+
+	// Setting the state runs the same hooks as on the server, which sets the movement speed and
+	// tells the animation instance about it.
+	Crowd->SetHealth(CrowdHandle, ReplicatedStatus.Health);
+	if (Crowd->GetState(CrowdHandle) != ReplicatedStatus.State) Crowd->SetState(CrowdHandle, ReplicatedStatus.State);
+}
+
+/**
+ * Gives the ZombieCharacter a slot in the ZombieCrowdSubsystem, starting from its
+ * default values at its current location.
+ */
+void AZombieCharacter::JoinCrowd()
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || !World->IsGameWorld()) return;
+
+	Crowd = World->GetSubsystem<UZombieCrowdSubsystem>();
+	if (Crowd != nullptr) CrowdHandle = Crowd->RegisterZombie(this);
+
+	// Stop blocking other zombies when they keep apart by crowd steering instead. The
+	// ZombieLocomotionSubsystem switches the profile back if steering is turned off.
+	if (UZombieLocomotionSubsystem::IsSteeringEnabled()) GetCapsuleComponent()->SetCollisionProfileName(TEXT("Zombie"));
 }
 
 /**
- * Called to transition the ZombieCharacter to the IDLE state.
+ * Frees the ZombieCharacter's slot in the ZombieCrowdSubsystem.
  */
-void AZombieCharacter::ToIdleState()
+void AZombieCharacter::LeaveCrowd()
 {
-	PreviousState = State;
-	State = ZombieStates::IDLE;
+	if (Crowd != nullptr) Crowd->UnregisterZombie(CrowdHandle);
+	CrowdHandle = FZombieHandle();
+
+	// Decisions queued for the old crowd slot shouldn't be made once it's gone.
+	AZombieAIController* ZombieAIController = Cast<AZombieAIController>(GetController());
+	if (ZombieAIController != nullptr) ZombieAIController->CancelThinkRequests();
+}
+
+/**
+ * Stops the `DeathAnimationTimer`.
+ */
+void AZombieCharacter::ClearDeathAnimationTimer()
+{
+	UWorld* World = GetWorld();
+	UZombieTimerSubsystem* ZombieTimers = (World != nullptr) ? World->GetSubsystem<UZombieTimerSubsystem>() : nullptr;
+	if (ZombieTimers != nullptr) ZombieTimers->ClearTimer(DeathAnimationTimer);
 }
 
 /**
- * Called to transition the ZombieCharacter to the ROAM state.
+ * Takes the ZombieCharacter out of play so that it can wait in the ZombiePoolSubsystem. It
+ * leaves the crowd and stops ticking, colliding and rendering.
  */
-void AZombieCharacter::ToRoamState()
+void AZombieCharacter::EnterPool()
 {
-	PreviousState = State;
-	State = ZombieStates::ROAM;
+	bIsPooled = true;
+
+	ClearDeathAnimationTimer();
+
+	LeaveCrowd();
 
 	UCharacterMovementComponent* ZombieMovement = GetCharacterMovement();
-	if (ZombieMovement != nullptr)
+	ZombieMovement->StopMovementImmediately();
+	ZombieMovement->DisableMovement();
+	ZombieMovement->SetComponentTickEnabled(false);
+	ZombieSkeletalMesh->SetComponentTickEnabled(false);
+	SetActorTickEnabled(false);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+
+	// Nothing about a pooled ZombieCharacter changes, so it stops being considered for
+	// replication once clients have been told it's hidden.
+	SetNetDormancy(DORM_DormantAll);
+}
+
+/**
+ * Brings the ZombieCharacter back into play from the ZombiePoolSubsystem at the given
+ * transform, with its starting health and state, before a ZombieAIController takes it over.
+ *
+ * @param SpawnTransform The location and rotation to put the ZombieCharacter at.
+ */
+void AZombieCharacter::LeavePool(const FTransform& SpawnTransform)
+{
+	bIsPooled = false;
+
+	SetNetDormancy(DORM_Awake);
+
+	TeleportTo(SpawnTransform.GetLocation(), SpawnTransform.Rotator(), false, true);
+
+	// Undo anything the level of detail tiers and the impostors did to the ZombieCharacter
+	// before it went into the pool, since it comes back in the FULL tier.
+	UCharacterMovementComponent* ZombieMovement = GetCharacterMovement();
+	SetActorTickInterval(0.f);
+	ZombieMovement->SetComponentTickInterval(0.f);
+	ZombieMovement->SetComponentTickEnabled(true);
+	ZombieMovement->SetMovementMode(MOVE_Walking);
+	ZombieSkeletalMesh->SetComponentTickEnabled(true);
+	ZombieSkeletalMesh->SetVisibility(true);
+	SetActorTickEnabled(true);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// Rejoining the crowd resets the health, state and start location of the ZombieCharacter.
+	JoinCrowd();
+	OnStateChanged(GetState());
+}
+
+/**
+ * Returns the current state of the ZombieCharacter.
+ */
+ZombieStates AZombieCharacter::GetState() const
+{
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return ZombieStates::IDLE;
+
+	return Crowd->GetState(CrowdHandle);
+}
+
+/**
+ * Returns the previous state of the ZombieCharacter.
+ */
+ZombieStates AZombieCharacter::GetPreviousState() const
+{
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return ZombieStates::IDLE;
+
+	return Crowd->GetPreviousState(CrowdHandle);
+}
+
+/**
+ * Returns the amount of health the ZombieCharacter has left.
+ */
+float AZombieCharacter::GetHealth() const
+{
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return Health;
+
+	return Crowd->GetHealth(CrowdHandle);
+}
+
+/**
+ * Returns the location that the ZombieCharacter roams around.
+ */
+FVector AZombieCharacter::GetStartLocation() const
+{
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return GetActorLocation();
+
+	return Crowd->GetStartLocation(CrowdHandle);
+}
+
+/**
+ * Returns the level of detail tier that the ZombieCharacter is in.
+ */
+ZombieLODTiers AZombieCharacter::GetLODTier() const
+{
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return ZombieLODTiers::FULL;
+
+	return Crowd->GetLODTier(CrowdHandle);
+}
+
+/**
+ * Sets the location that the ZombieCharacter roams around.
+ */
+void AZombieCharacter::SetStartLocation(const FVector& NewStartLocation)
+{
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return;
+
+	Crowd->SetStartLocation(CrowdHandle, NewStartLocation);
+}
+
+/**
+ * Sets whether the ZombieCharacter is able to roam, here and in the ZombieCrowdSubsystem.
+ */
+void AZombieCharacter::SetCanRoam(bool bNewCanRoam)
+{
+	bCanRoam = bNewCanRoam;
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return;
+
+	Crowd->SetCanRoam(CrowdHandle, bNewCanRoam);
+}
+
+/**
+ * Sets the area around its start location that the ZombieCharacter can roam, here and in
+ * the ZombieCrowdSubsystem.
+ */
+void AZombieCharacter::SetRoamRadius(float NewRoamRadius)
+{
+	RoamRadius = NewRoamRadius;
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return;
+
+	Crowd->SetRoamRadius(CrowdHandle, NewRoamRadius);
+}
+
+/**
+ * Sets the max speed of the ZombieCharacter in the ROAM state, here and in the
+ * ZombieCrowdSubsystem. A roaming ZombieCharacter speeds up or slows down right away.
+ */
+void AZombieCharacter::SetRoamSpeed(float NewRoamSpeed)
+{
+	RoamSpeed = NewRoamSpeed;
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return;
+
+	Crowd->SetRoamSpeed(CrowdHandle, NewRoamSpeed);
+	if (GetState() == ZombieStates::ROAM) GetCharacterMovement()->MaxWalkSpeed = NewRoamSpeed;
+}
+
+/**
+ * Sets the max speed of the ZombieCharacter in the CHASE state, here and in the
+ * ZombieCrowdSubsystem. A chasing ZombieCharacter speeds up or slows down right away.
+ */
+void AZombieCharacter::SetChaseSpeed(float NewChaseSpeed)
+{
+	ChaseSpeed = NewChaseSpeed;
+	if (Crowd == nullptr || !Crowd->IsValidHandle(CrowdHandle)) return;
+
+	Crowd->SetChaseSpeed(CrowdHandle, NewChaseSpeed);
+	if (GetState() == ZombieStates::CHASE) GetCharacterMovement()->MaxWalkSpeed = NewChaseSpeed;
+}
+
+/**
+ * Called to make the ZombieCharacter take damage. The damage is queued in the
+ * ZombieDamageSubsystem, which takes it from the ZombieCharacter's health along with the
+ * other hits of the frame and checks to see if the ZombieCharacter needs to die.
+ */
+void AZombieCharacter::Hit(float Damage)
+{
+	UWorld* World = GetWorld();
+	UZombieDamageSubsystem* ZombieDamage = (World != nullptr) ? World->GetSubsystem<UZombieDamageSubsystem>() : nullptr;
+	if (ZombieDamage == nullptr) return;
+
+	ZombieDamage->QueueHit(this, Damage);
+}
+
+/**
+ * Called by the ZombieDamageSubsystem after the ZombieCharacter ran out of health and was
+ * put in the `DEAD` state.
+ */
+void AZombieCharacter::OnKilled()
+{
+	// Have the ZombieAIController drop everything it's doing so it doesn't give any more
+	// input to the ZombieCharacter. It stays with the ZombieCharacter and goes back to the
+	// ZombiePoolSubsystem along with it, so dying doesn't create or destroy any objects.
+	AZombieAIController* ZombieAIController = Cast<AZombieAIController>(GetController());
+	if (ZombieAIController != nullptr) ZombieAIController->ResetState();
+
+	// Now we set a timer for the length of the dying animation to make sure that if we have to
+	// destroy the ZombieCharacter, we don't do it until the animation has finished playing.
+	UWorld* World = GetWorld();
+	UZombieTimerSubsystem* ZombieTimers = (World != nullptr) ? World->GetSubsystem<UZombieTimerSubsystem>() : nullptr;
+	if (ZombieTimers == nullptr) return;
+	ZombieTimers->SetTimer(DeathAnimationTimer, ZombieTimerTypes::DYING_ANIMATION, this, DyingAnimationLengthInSeconds);
+}
+
+/**
+ * Called by the ZombieTimerSubsystem after the death animation finishes playing.
+ */
+void AZombieCharacter::AfterDeathAnimationFinished()
+{
+	// Now that the dying animation has finished playing we can see if we need to take the
+	// ZombieCharacter out of the world.
+	if (SecondsAfterDeathBeforeDestroy == 0.f)
 	{
-		ZombieMovement->MaxWalkSpeed = RoamSpeed;
+		// The ZombieCharacter should be removed immediately so we don't need to set a timer.
+		ReturnToPool();
+	}
+	else if (SecondsAfterDeathBeforeDestroy > 0.f)
+	{
+		// We have to wait some time before the ZombieCharacter should be removed so we set a
+		// timer that runs the method to remove the ZombieCharacter.
+		UWorld* World = GetWorld();
+		UZombieTimerSubsystem* ZombieTimers = (World != nullptr) ? World->GetSubsystem<UZombieTimerSubsystem>() : nullptr;
+		if (ZombieTimers == nullptr) return;
+		ZombieTimers->SetTimer(DeathAnimationTimer, ZombieTimerTypes::REMOVE_AFTER_DEATH, this, SecondsAfterDeathBeforeDestroy);
 	}
 }
 
 /**
- * Called to transition the ZombieCharacter to the CHASE state.
+ * Hands the dead ZombieCharacter back to the ZombiePoolSubsystem so that it can be reused
+ * by a later wave, or destroys it if there is no pool to go back to.
  */
-void AZombieCharacter::ToChaseState()
+void AZombieCharacter::ReturnToPool()
 {
-	PreviousState = State;
-	State = ZombieStates::CHASE;
+	UWorld* World = GetWorld();
+	UZombiePoolSubsystem* ZombiePool = (World != nullptr) ? World->GetSubsystem<UZombiePoolSubsystem>() : nullptr;
 
-	UCharacterMovementComponent* ZombieMovement = GetCharacterMovement();
-	if (ZombieMovement != nullptr)
+	if (ZombiePool == nullptr)
 	{
-		ZombieMovement->MaxWalkSpeed = ChaseSpeed;
+		Destroy();
+		return;
 	}
+
+	ZombiePool->Release(this);
 }
 
 /**
- * Called to transition the ZombieCharacter to the ATTACK state.
+ * Called when the skeletal mesh sets up its animation update rate so that the ZombieCharacter
+ * can skip more animation updates when it's small on screen or not rendered at all.
  */
-void AZombieCharacter::ToAttackState()
+void AZombieCharacter::OnAnimUpdateRateParamsCreated(FAnimUpdateRateParameters* Params)
 {
-	PreviousState = State;
-	State = ZombieStates::ATTACK;
+	if (Params == nullptr) return;
+
+	// Zombies that aren't rendered only update every eighth frame, and frames that are skipped
+	// on screen are interpolated for up to every fourth frame so the horde still moves smoothly.
+	Params->BaseNonRenderedUpdateRate = 8;
+	Params->MaxEvalRateForInterpolation = 4;
+
+	// The screen sizes below which the animation is updated every second, third and fourth frame.
+	Params->BaseVisibleDistanceFactorThesholds.Empty(3);
+	Params->BaseVisibleDistanceFactorThesholds.Add(0.4f);
+	Params->BaseVisibleDistanceFactorThesholds.Add(0.2f);
+	Params->BaseVisibleDistanceFactorThesholds.Add(0.1f);
+}
+
+/**
+ * Called by the ZombieCrowdSubsystem after the ZombieCharacter's state has changed so that
+ * the animation instance doesn't have to check the state every frame.
+ *
+ * @param NewState The state the ZombieCharacter is in now.
+ */
+void AZombieCharacter::OnStateChanged(ZombieStates NewState)
+{
+	UZombieAnimInstance* ZombieAnimInstance = Cast<UZombieAnimInstance>(ZombieSkeletalMesh->GetAnimInstance());
+	if (ZombieAnimInstance == nullptr) return;
+
+	ZombieAnimInstance->SetZombieState(NewState);
 }
 
 /**
- * Called to transition the ZombieCharacter to the DEAD state.
+ * Moves the ZombieCharacter to the state that the event leads to from its current state.
+ *
+ * @param Event The event that happened.
+ *
+ * @return Whether the ZombieCharacter changed state. Events that the state machine ignores
+ * in the current state leave the ZombieCharacter where it is.
  */
-void AZombieCharacter::ToDeadState()
+bool AZombieCharacter::SendEvent(ZombieEvents Event)
 {
-	PreviousState = State;
-	State = ZombieStates::DEAD;
-}
\ No newline at end of file
+	if (Crowd == nullptr) return false;
+
+	return Crowd->SendEvent(CrowdHandle, Event);
+}
@@ -2,8 +2,14 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "ZombieHandle.h"
+#include "ZombieTimerSubsystem.h"
 #include "ZombieCharacter.generated.h"
 
+// The object channel of the zombies' capsules while they keep apart by crowd steering. It's
+// set up as "Zombie" in the collision settings.
+#define ECC_Zombie ECC_GameTraceChannel2
+
 /**
  * The states that the ZombieCharacter can be in.
  */
@@ -16,6 +22,70 @@ enum class ZombieStates : uint8 {
 	DEAD	UMETA(DisplayName = "DEAD"),
 };
 
+/**
+ * The events that move the ZombieCharacter from one state to another. Which state each event
+ * leads to is looked up in the state table of the ZombieCharacter's ZombieArchetype.
+ */
+UENUM(BlueprintType)
+enum class ZombieEvents : uint8 {
+	REST			UMETA(DisplayName = "REST"),
+	ROAM			UMETA(DisplayName = "ROAM"),
+	TARGET_SEEN		UMETA(DisplayName = "TARGET_SEEN"),
+	TARGET_REACHED	UMETA(DisplayName = "TARGET_REACHED"),
+	TARGET_ESCAPED	UMETA(DisplayName = "TARGET_ESCAPED"),
+	KILLED			UMETA(DisplayName = "KILLED"),
+};
+
+/**
+ * How much work is spent on the ZombieCharacter, based on how far it is from the players and
+ * whether they can see it.
+ */
+UENUM(BlueprintType)
+enum class ZombieLODTiers : uint8 {
+	FULL	UMETA(DisplayName = "FULL"),
+	REDUCED	UMETA(DisplayName = "REDUCED"),
+	DORMANT	UMETA(DisplayName = "DORMANT"),
+};
+
+/**
+ * The part of the ZombieCharacter's state that clients need, packed into as few bits as
+ * possible. It's only sent when one of its values changes, so a zombie walking around with full
+ * health doesn't send anything but its movement.
+ */
+USTRUCT()
+struct FZombieReplicatedStatus
+{
+	GENERATED_BODY()
+
+	// The state of the ZombieCharacter.
+	UPROPERTY()
+	ZombieStates State = ZombieStates::IDLE;
+
+	// The ZombieCharacter's health in whole points, rounded up so that a ZombieCharacter with a
+	// sliver of health left doesn't look dead.
+	UPROPERTY()
+	uint16 Health = 0;
+
+	// Whether the ZombieCharacter is waiting in the ZombiePoolSubsystem.
+	UPROPERTY()
+	bool bIsPooled = false;
+
+	/**
+	 * Writes the state in three bits, whether the ZombieCharacter is pooled in one bit and the
+	 * health in as few bytes as it needs.
+	 */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FZombieReplicatedStatus> : public TStructOpsTypeTraitsBase2<FZombieReplicatedStatus>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
 UCLASS()
 class ZOMBIEAI_API AZombieCharacter : public ACharacter
 {
@@ -23,43 +93,30 @@ class ZOMBIEAI_API AZombieCharacter : public ACharacter
 
 public:
 	// Sets default values for this character's properties.
-	AZombieCharacter();
+	AZombieCharacter(const FObjectInitializer& ObjectInitializer);
 
 	// The skeletal mesh of the ZombieCharacter.
 	UPROPERTY(VisibleDefaultsOnly)
 	class USkeletalMeshComponent* ZombieSkeletalMesh;
 
-	// When the ZombieCharacter attacks we check to see if the PlayerCharacter
-	// is inside of this collider.
-	UPROPERTY(VisibleDefaultsOnly);
-	class UBoxComponent* ZombieDamageCollider;
-
-	// The current state of the ZombieCharacter.
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Zombie)
-	ZombieStates State = ZombieStates::IDLE;
-
-	// The previous state of the ZombieCharacter.
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Zombie)
-	ZombieStates PreviousState = State;
-
-	// The amount of health the ZombieCharacter has.
+	// The amount of health the ZombieCharacter starts with. The current health is kept in
+	// the ZombieCrowdSubsystem and can be read with `GetHealth`.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Zombie)
 	float Health = 100.f;
 
-	// The starting location of the ZombieCharacter, used when roaming.
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = RoamState)
-	FVector StartLocation;
-
-	// Indicates whether the ZombieCharacter should be able to roam or not.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = RoamState)
+	// Indicates whether the ZombieCharacter should be able to roam or not. This, the
+	// roam radius and the roam and chase speeds below are copied into the
+	// ZombieCrowdSubsystem when the ZombieCharacter is initialized. Change them at runtime
+	// through their setters so that the crowd sees the new values too.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, BlueprintSetter = SetCanRoam, Category = RoamState)
 	bool bCanRoam = true;
 
 	// The max speed of the ZombieCharacter in the ROAM state.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = RoamState)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, BlueprintSetter = SetRoamSpeed, Category = RoamState)
 	float RoamSpeed = 50.f;
 
 	// The area around its spawn point that the ZombieCharacter can roam.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = RoamState)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, BlueprintSetter = SetRoamRadius, Category = RoamState)
 	float RoamRadius = 400.f;
 
 	// The amount of time to pause in between `Roam` calls. If set to 0 there will
@@ -68,7 +125,7 @@ public:
 	float RoamDelay = 3.f;
 
 	// The max speed of the ZombieCharacter in the CHASE state.
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = ChaseState)
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, BlueprintSetter = SetChaseSpeed, Category = ChaseState)
 	float ChaseSpeed = 300.f;
 
 	// The amount of delay after a chase after which the ZombieCharacter will
@@ -77,64 +134,248 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = ChaseState)
 	float AfterChaseDelay = 3.f;
 
+	// The center of the box that the ZombieCharacter can reach with its arms, relative to the
+	// center of its capsule and facing the same way. The ZombieCharacter attacks a
+	// PlayerCharacter whose capsule is inside of this box.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AttackState)
+	FVector AttackReachOffset = FVector(70.f, 0.f, 40.f);
+
+	// Half the size of the box that the ZombieCharacter can reach with its arms.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AttackState)
+	FVector AttackReachExtent = FVector(30.f, 30.f, 20.f);
+
 	// The amount of seconds long that the zombie dying animation is. This is used with
 	// the `SecondsAfterDeathBeforeDestroy` variable to make sure that the dying animation
 	// plays out fully before the ZombieCharacter is destroyed.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = DyingState)
 	float DyingAnimationLengthInSeconds = 3.f;
 
-	// The amount of time after the ZombieCharacter dies that they will destroy. A value
-	// of 0 means that the ZombieCharacter will be destroyed immediately after the dying
-	// animation plays. A value below 0 means that the ZombieCharacter will never be destroyed.
+	// The amount of time after the ZombieCharacter dies that they will be removed and handed
+	// back to the ZombiePoolSubsystem. A value of 0 means that the ZombieCharacter will be
+	// removed immediately after the dying animation plays. A value below 0 means that the
+	// ZombieCharacter will never be removed.
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = DyingState)
 	float SecondsAfterDeathBeforeDestroy = 5.f;
 
+	// The state machine of the ZombieCharacter. If not set the default state machine is used.
+	// This is copied into the ZombieCrowdSubsystem when the ZombieCharacter is initialized.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Zombie)
+	class UZombieArchetype* Archetype;
+
+	// The baked vertex animations used to draw the ZombieCharacter as an impostor when it's far
+	// away. If not set the ZombieCharacter always uses its skeletal mesh.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Impostor)
+	class UZombieVertexAnimationData* VertexAnimationData;
+
 protected:
 	/**
-	 * The timer used to wait until the dying animation has finished playing.
+	 * The timer used to wait until the dying animation has finished playing, and then until
+	 * the ZombieCharacter is removed.
 	 */
-	FTimerHandle DeathAnimationTimer;
+	FZombieTimerHandle DeathAnimationTimer;
+
+	// The ZombieCrowdSubsystem that holds the state of the ZombieCharacter.
+	UPROPERTY(Transient)
+	class UZombieCrowdSubsystem* Crowd;
+
+	// The ZombieCharacter's slot in the ZombieCrowdSubsystem.
+	FZombieHandle CrowdHandle;
+
+	// Whether the ZombieCharacter is waiting in the ZombiePoolSubsystem.
+	bool bIsPooled = false;
+
+	// The state, health and pooling of the ZombieCharacter as the clients see it. The server
+	// copies it out of the ZombieCrowdSubsystem right before replicating, and clients copy it
+	// back into theirs.
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedStatus)
+	FZombieReplicatedStatus ReplicatedStatus;
 
 protected:
 	/**
-	 * Called when the game starts.
+	 * Called after the ZombieCharacter's components have been initialized. This is where the
+	 * ZombieCharacter joins the ZombieCrowdSubsystem so that its state is ready before the
+	 * ZombieAIController takes it over.
 	 */
-	virtual void BeginPlay() override;
+	virtual void PostInitializeComponents() override;
 
 	/**
-	 * Called after the death animation finishes playing.
+	 * Called when the ZombieCharacter is removed from the world.
 	 */
-	void AfterDeathAnimationFinished();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/**
+	 * Called on the server right before the ZombieCharacter is replicated to copy its state and
+	 * health out of the ZombieCrowdSubsystem.
+	 */
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/**
+	 * Called on the server after the ZombieCharacter's properties are written to a client's actor
+	 * channel. Once its components are written as well, the bunch holds everything sent about
+	 * the ZombieCharacter to that client this time, which the ZombieReplicationSubsystem adds up.
+	 */
+	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
+
+	/**
+	 * Called on clients when the ZombieCharacter's state, health or pooling changed on the server.
+	 */
+	UFUNCTION()
+	void OnRep_ReplicatedStatus();
+
+	/**
+	 * Gives the ZombieCharacter a slot in the ZombieCrowdSubsystem, starting from its
+	 * default values at its current location.
+	 */
+	void JoinCrowd();
+
+	/**
+	 * Frees the ZombieCharacter's slot in the ZombieCrowdSubsystem.
+	 */
+	void LeaveCrowd();
+
+	/**
+	 * Stops the `DeathAnimationTimer`.
+	 */
+	void ClearDeathAnimationTimer();
+
+	/**
+	 * Called when the skeletal mesh sets up its animation update rate so that the ZombieCharacter
+	 * can skip more animation updates when it's small on screen or not rendered at all.
+	 */
+	void OnAnimUpdateRateParamsCreated(struct FAnimUpdateRateParameters* Params);
 
 public:
 	/**
-	 * Called to transition the ZombieCharacter to the IDLE state.
+	 * Returns the properties of the ZombieCharacter that are replicated to clients.
+	 */
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/**
+	 * Returns the ZombieCharacter's slot in the ZombieCrowdSubsystem.
+	 */
+	const FZombieHandle& GetCrowdHandle() const { return CrowdHandle; }
+
+	/**
+	 * Returns the current state of the ZombieCharacter.
+	 */
+	UFUNCTION(BlueprintPure, Category = Zombie)
+	ZombieStates GetState() const;
+
+	/**
+	 * Returns the previous state of the ZombieCharacter.
+	 */
+	UFUNCTION(BlueprintPure, Category = Zombie)
+	ZombieStates GetPreviousState() const;
+
+	/**
+	 * Returns the amount of health the ZombieCharacter has left.
+	 */
+	UFUNCTION(BlueprintPure, Category = Zombie)
+	float GetHealth() const;
+
+	/**
+	 * Returns the location that the ZombieCharacter roams around.
+	 */
+	UFUNCTION(BlueprintPure, Category = RoamState)
+	FVector GetStartLocation() const;
+
+	/**
+	 * Returns the level of detail tier that the ZombieCharacter is in.
 	 */
-	void ToIdleState();
+	UFUNCTION(BlueprintPure, Category = Zombie)
+	ZombieLODTiers GetLODTier() const;
 
 	/**
-	 * Called to transition the ZombieCharacter to the ROAM state.
+	 * Sets the location that the ZombieCharacter roams around.
 	 */
-	void ToRoamState();
+	void SetStartLocation(const FVector& NewStartLocation);
 
 	/**
-	 * Called to transition the ZombieCharacter to the CHASE state.
+	 * Sets whether the ZombieCharacter is able to roam, here and in the ZombieCrowdSubsystem.
 	 */
-	void ToChaseState();
+	UFUNCTION(BlueprintSetter)
+	void SetCanRoam(bool bNewCanRoam);
 
 	/**
-	 * Called to transition the ZombieCharacter to the ATTACK state.
+	 * Sets the area around its start location that the ZombieCharacter can roam, here and in
+	 * the ZombieCrowdSubsystem.
 	 */
-	void ToAttackState();
+	UFUNCTION(BlueprintSetter)
+	void SetRoamRadius(float NewRoamRadius);
 
 	/**
-	 * Called to transition the ZombieCharacter to the DEAD state.
+	 * Sets the max speed of the ZombieCharacter in the ROAM state, here and in the
+	 * ZombieCrowdSubsystem. A roaming ZombieCharacter speeds up or slows down right away.
 	 */
-	void ToDeadState();
+	UFUNCTION(BlueprintSetter)
+	void SetRoamSpeed(float NewRoamSpeed);
 
 	/**
-	 * Called to make the ZombieCharacter take damage and check to see if the
-	 * ZombieCharacter needs to die.
+	 * Sets the max speed of the ZombieCharacter in the CHASE state, here and in the
+	 * ZombieCrowdSubsystem. A chasing ZombieCharacter speeds up or slows down right away.
+	 */
+	UFUNCTION(BlueprintSetter)
+	void SetChaseSpeed(float NewChaseSpeed);
+
+	/**
+	 * Takes the ZombieCharacter out of play so that it can wait in the ZombiePoolSubsystem. It
+	 * leaves the crowd and stops ticking, colliding and rendering.
+	 */
+	void EnterPool();
+
+	/**
+	 * Brings the ZombieCharacter back into play from the ZombiePoolSubsystem at the given
+	 * transform, with its starting health and state, before a ZombieAIController takes it over.
+	 *
+	 * @param SpawnTransform The location and rotation to put the ZombieCharacter at.
+	 */
+	void LeavePool(const FTransform& SpawnTransform);
+
+	/**
+	 * Called by the ZombieTimerSubsystem after the death animation finishes playing.
+	 */
+	void AfterDeathAnimationFinished();
+
+	/**
+	 * Hands the dead ZombieCharacter back to the ZombiePoolSubsystem so that it can be reused
+	 * by a later wave, or destroys it if there is no pool to go back to.
+	 */
+	void ReturnToPool();
+
+	/**
+	 * Returns whether the ZombieCharacter is waiting in the ZombiePoolSubsystem.
+	 */
+	bool IsPooled() const { return bIsPooled; }
+
+	/**
+	 * Called by the ZombieCrowdSubsystem after the ZombieCharacter's state has changed so that
+	 * the animation instance doesn't have to check the state every frame.
+	 *
+	 * @param NewState The state the ZombieCharacter is in now.
+	 */
+	void OnStateChanged(ZombieStates NewState);
+
+	/**
+	 * Moves the ZombieCharacter to the state that the event leads to from its current state.
+	 *
+	 * @param Event The event that happened.
+	 *
+	 * @return Whether the ZombieCharacter changed state. Events that the state machine ignores
+	 * in the current state leave the ZombieCharacter where it is.
+	 */
+	UFUNCTION(BlueprintCallable, Category = Zombie)
+	bool SendEvent(ZombieEvents Event);
+
+	/**
+	 * Called to make the ZombieCharacter take damage. The damage is queued in the
+	 * ZombieDamageSubsystem, which takes it from the ZombieCharacter's health along with the
+	 * other hits of the frame and checks to see if the ZombieCharacter needs to die.
 	 */
 	void Hit(float Damage);
+
+	/**
+	 * Called by the ZombieDamageSubsystem after the ZombieCharacter ran out of health and was
+	 * put in the `DEAD` state.
+	 */
+	void OnKilled();
 };
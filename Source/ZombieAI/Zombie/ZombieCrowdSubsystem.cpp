@@ -0,0 +1,356 @@
+#include "ZombieCrowdSubsystem.h"
+#include "../ZombieAIStats.h"
+#include "GameFramework/CharacterMovementComponent.h"
+
+// The hooks of each state, in the order IDLE, ROAM, CHASE, ATTACK, DEAD.
+const FZombieStateHook UZombieCrowdSubsystem::EnterHooks[FZombieStateTable::NumStates] = {
+	nullptr,
+	&UZombieCrowdSubsystem::EnterRoam,
+	&UZombieCrowdSubsystem::EnterChase,
+	nullptr,
+	&UZombieCrowdSubsystem::EnterDead,
+};
+
+const FZombieStateHook UZombieCrowdSubsystem::ExitHooks[FZombieStateTable::NumStates] = {
+	nullptr,
+	nullptr,
+	nullptr,
+	nullptr,
+	&UZombieCrowdSubsystem::ExitDead,
+};
+
+/**
+ * Adds to the number of zombies shown in `stat ZombieAI` for the state.
+ */
+static void AddToZombieStateStat(ZombieStates State, int32 Amount)
+{
+	switch (State)
+	{
+	case ZombieStates::IDLE:
+		INC_DWORD_STAT_BY(STAT_ZombieAI_IdleZombies, Amount);
+		break;
+	case ZombieStates::ROAM:
+		INC_DWORD_STAT_BY(STAT_ZombieAI_RoamingZombies, Amount);
+		break;
+	case ZombieStates::CHASE:
+		INC_DWORD_STAT_BY(STAT_ZombieAI_ChasingZombies, Amount);
+		break;
+	case ZombieStates::ATTACK:
+		INC_DWORD_STAT_BY(STAT_ZombieAI_AttackingZombies, Amount);
+		break;
+	case ZombieStates::DEAD:
+		INC_DWORD_STAT_BY(STAT_ZombieAI_DeadZombies, Amount);
+		break;
+	}
+}
+
+/**
+ * Called when the world that owns the ZombieCrowdSubsystem is torn down.
+ */
+void UZombieCrowdSubsystem::Deinitialize()
+{
+	Characters.Empty();
+	Generations.Empty();
+	States.Empty();
+	PreviousStates.Empty();
+	StateStartTimes.Empty();
+	Healths.Empty();
+	StartLocations.Empty();
+	bCanRoam.Empty();
+	RoamRadii.Empty();
+	RoamSpeeds.Empty();
+	ChaseSpeeds.Empty();
+	LODTiers.Empty();
+	StateTableIndices.Empty();
+	StateTables.Empty();
+	ArchetypeTableIndices.Empty();
+	FreeIndices.Empty();
+
+	// Take the zombies of this world back out of the state stats.
+	for (int32 State = 0; State < FZombieStateTable::NumStates; ++State)
+	{
+		AddToZombieStateStat((ZombieStates)State, -StateCounts[State]);
+		StateCounts[State] = 0;
+	}
+
+	NumZombies = 0;
+
+	Super::Deinitialize();
+}
+
+/**
+ * Gives the ZombieCharacter a slot in the crowd and copies its starting values into it.
+ *
+ * @param ZombieCharacter The ZombieCharacter to add to the crowd.
+ */
+FZombieHandle UZombieCrowdSubsystem::RegisterZombie(AZombieCharacter* ZombieCharacter)
+{
+	if (ZombieCharacter == nullptr) return FZombieHandle();
+
+	// Reuse a free slot if there is one, otherwise grow every array by one.
+	int32 Index;
+	if (FreeIndices.Num() > 0)
+	{
+		Index = FreeIndices.Pop(false);
+	}
+	else
+	{
+		Index = Characters.Add(nullptr);
+		Generations.Add(0);
+		States.AddDefaulted();
+		PreviousStates.AddDefaulted();
+		StateStartTimes.AddDefaulted();
+		Healths.AddDefaulted();
+		StartLocations.AddDefaulted();
+		bCanRoam.AddDefaulted();
+		RoamRadii.AddDefaulted();
+		RoamSpeeds.AddDefaulted();
+		ChaseSpeeds.AddDefaulted();
+		LODTiers.AddDefaulted();
+		StateTableIndices.AddDefaulted();
+	}
+
+	Characters[Index] = ZombieCharacter;
+	States[Index] = ZombieStates::IDLE;
+	PreviousStates[Index] = ZombieStates::IDLE;
+	StateStartTimes[Index] = GetWorld()->GetTimeSeconds();
+	Healths[Index] = ZombieCharacter->Health;
+	StartLocations[Index] = ZombieCharacter->GetActorLocation();
+	bCanRoam[Index] = ZombieCharacter->bCanRoam;
+	RoamRadii[Index] = ZombieCharacter->RoamRadius;
+	RoamSpeeds[Index] = ZombieCharacter->RoamSpeed;
+	ChaseSpeeds[Index] = ZombieCharacter->ChaseSpeed;
+	LODTiers[Index] = ZombieLODTiers::FULL;
+	StateTableIndices[Index] = GetStateTableIndex(ZombieCharacter->Archetype);
+
+	StateCounts[(int32)ZombieStates::IDLE]++;
+	AddToZombieStateStat(ZombieStates::IDLE, 1);
+
+	NumZombies++;
+
+	return FZombieHandle{ Index, Generations[Index] };
+}
+
+/**
+ * Frees the slot of the ZombieCharacter so that it can be reused.
+ *
+ * @param Handle The handle of the ZombieCharacter to remove from the crowd.
+ */
+void UZombieCrowdSubsystem::UnregisterZombie(const FZombieHandle& Handle)
+{
+	if (!IsValidHandle(Handle)) return;
+
+	// Bump the generation so that any handle to the old ZombieCharacter stops being valid.
+	Characters[Handle.Index] = nullptr;
+	Generations[Handle.Index]++;
+	FreeIndices.Add(Handle.Index);
+
+	StateCounts[(int32)States[Handle.Index]]--;
+	AddToZombieStateStat(States[Handle.Index], -1);
+
+	NumZombies--;
+}
+
+/**
+ * Moves a ZombieCharacter to the state that the event leads to in its state table, and runs
+ * the exit logic of its old state and the entry logic of its new one.
+ *
+ * @param Handle The handle of the ZombieCharacter.
+ * @param Event The event that happened.
+ *
+ * @return Whether the ZombieCharacter changed state.
+ */
+bool UZombieCrowdSubsystem::SendEvent(const FZombieHandle& Handle, ZombieEvents Event)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_SendEvents);
+
+	if (!IsValidHandle(Handle)) return false;
+
+	ZombieStates NewState;
+	if (!StateTables[StateTableIndices[Handle.Index]].GetNextState(States[Handle.Index], Event, NewState)) return false;
+
+	WriteState(Handle.Index, NewState, GetWorld()->GetTimeSeconds());
+	RunStateHooks(Handle.Index);
+	return true;
+}
+
+/**
+ * Sends the same event to a batch of ZombieCharacters. The states are looked up and written
+ * in one pass, and the exit and entry logic is run in a second pass.
+ *
+ * @param Handles The handles of the ZombieCharacters.
+ * @param Event The event that happened.
+ * @param OutChangedHandles If given, filled with the handles of the ZombieCharacters that changed state.
+ */
+void UZombieCrowdSubsystem::SendEvents(TArrayView<const FZombieHandle> Handles, ZombieEvents Event, TArray<FZombieHandle>* OutChangedHandles)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_SendEvents);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if (OutChangedHandles != nullptr) OutChangedHandles->Reset();
+
+	// Remember which ZombieCharacters actually changed state so that the hooks only run for them.
+	TArray<int32, TInlineAllocator<64>> ChangedIndices;
+	for (const FZombieHandle& Handle : Handles)
+	{
+		if (!IsValidHandle(Handle)) continue;
+
+		ZombieStates NewState;
+		if (!StateTables[StateTableIndices[Handle.Index]].GetNextState(States[Handle.Index], Event, NewState)) continue;
+
+		WriteState(Handle.Index, NewState, Now);
+		ChangedIndices.Add(Handle.Index);
+		if (OutChangedHandles != nullptr) OutChangedHandles->Add(Handle);
+	}
+
+	for (const int32 Index : ChangedIndices)
+	{
+		RunStateHooks(Index);
+	}
+}
+
+/**
+ * Transitions a ZombieCharacter to a new state without looking at its state table, and runs
+ * the exit logic of its old state and the entry logic of its new one.
+ *
+ * @param Handle The handle of the ZombieCharacter.
+ * @param NewState The state to transition to.
+ */
+void UZombieCrowdSubsystem::SetState(const FZombieHandle& Handle, ZombieStates NewState)
+{
+	if (!IsValidHandle(Handle)) return;
+
+	WriteState(Handle.Index, NewState, GetWorld()->GetTimeSeconds());
+	RunStateHooks(Handle.Index);
+}
+
+/**
+ * Collects the handles of every ZombieCharacter that is in the given state.
+ *
+ * @param State The state to look for.
+ * @param OutHandles The handles of the ZombieCharacters in that state.
+ */
+void UZombieCrowdSubsystem::GetHandlesInState(ZombieStates State, TArray<FZombieHandle>& OutHandles) const
+{
+	OutHandles.Reset();
+
+	for (int32 Index = 0; Index < States.Num(); ++Index)
+	{
+		if (States[Index] == State && Characters[Index] != nullptr) OutHandles.Add(GetHandleAt(Index));
+	}
+}
+
+/**
+ * Returns the number of ZombieCharacters that are in the given state.
+ */
+int32 UZombieCrowdSubsystem::CountInState(ZombieStates State) const
+{
+	return StateCounts[(int32)State];
+}
+
+/**
+ * Returns the index of the compiled state table of the ZombieArchetype, compiling it the
+ * first time it's used.
+ */
+uint8 UZombieCrowdSubsystem::GetStateTableIndex(UZombieArchetype* Archetype)
+{
+	// The default state machine is always the first table.
+	if (StateTables.Num() == 0) StateTables.AddDefaulted();
+	if (Archetype == nullptr) return 0;
+
+	const uint8* TableIndex = ArchetypeTableIndices.Find(Archetype);
+	if (TableIndex != nullptr) return *TableIndex;
+
+	// The indices are kept in a byte, so any more archetypes than that use the default.
+	if (StateTables.Num() > MAX_uint8) return 0;
+
+	const uint8 NewTableIndex = (uint8)StateTables.Add(Archetype->CompileStateTable());
+	ArchetypeTableIndices.Add(Archetype, NewTableIndex);
+	return NewTableIndex;
+}
+
+/**
+ * Writes the new state of a ZombieCharacter without running any of its logic.
+ */
+void UZombieCrowdSubsystem::WriteState(int32 Index, ZombieStates NewState, float Now)
+{
+	StateCounts[(int32)States[Index]]--;
+	StateCounts[(int32)NewState]++;
+	AddToZombieStateStat(States[Index], -1);
+	AddToZombieStateStat(NewState, 1);
+
+	PreviousStates[Index] = States[Index];
+	States[Index] = NewState;
+	StateStartTimes[Index] = Now;
+
+	// Count the transitions over whole seconds so the rate doesn't jump around from frame to frame.
+	INC_DWORD_STAT(STAT_ZombieAI_Transitions);
+	if (Now - TransitionWindowStartTime >= 1.f)
+	{
+		LastTransitionsPerSecond = FMath::RoundToInt(TransitionsInWindow / (Now - TransitionWindowStartTime));
+		SET_DWORD_STAT(STAT_ZombieAI_TransitionsPerSecond, LastTransitionsPerSecond);
+
+		TransitionsInWindow = 0;
+		TransitionWindowStartTime = Now;
+	}
+	TransitionsInWindow++;
+}
+
+/**
+ * Runs the logic that happens when a ZombieCharacter leaves its previous state and enters
+ * its current state, like changing its movement speed and telling its animation about it.
+ *
+ * @param Index The slot of the ZombieCharacter.
+ */
+void UZombieCrowdSubsystem::RunStateHooks(int32 Index)
+{
+	AZombieCharacter* ZombieCharacter = Characters[Index];
+	if (ZombieCharacter == nullptr) return;
+
+	const FZombieStateHook ExitHook = ExitHooks[(int32)PreviousStates[Index]];
+	if (ExitHook != nullptr && PreviousStates[Index] != States[Index]) ExitHook(*this, Index);
+
+	const FZombieStateHook EnterHook = EnterHooks[(int32)States[Index]];
+	if (EnterHook != nullptr) EnterHook(*this, Index);
+
+	ZombieCharacter->OnStateChanged(States[Index]);
+}
+
+/**
+ * Sets the ZombieCharacter's max speed to its roam speed.
+ */
+void UZombieCrowdSubsystem::EnterRoam(UZombieCrowdSubsystem& Crowd, int32 Index)
+{
+	UCharacterMovementComponent* ZombieMovement = Crowd.Characters[Index]->GetCharacterMovement();
+	if (ZombieMovement != nullptr) ZombieMovement->MaxWalkSpeed = Crowd.RoamSpeeds[Index];
+}
+
+/**
+ * Sets the ZombieCharacter's max speed to its chase speed.
+ */
+void UZombieCrowdSubsystem::EnterChase(UZombieCrowdSubsystem& Crowd, int32 Index)
+{
+	UCharacterMovementComponent* ZombieMovement = Crowd.Characters[Index]->GetCharacterMovement();
+	if (ZombieMovement != nullptr) ZombieMovement->MaxWalkSpeed = Crowd.ChaseSpeeds[Index];
+}
+
+/**
+ * Stops the ZombieCharacter where it fell.
+ */
+void UZombieCrowdSubsystem::EnterDead(UZombieCrowdSubsystem& Crowd, int32 Index)
+{
+	UCharacterMovementComponent* ZombieMovement = Crowd.Characters[Index]->GetCharacterMovement();
+	if (ZombieMovement == nullptr) return;
+
+	ZombieMovement->StopMovementImmediately();
+	ZombieMovement->DisableMovement();
+}
+
+/**
+ * Lets the ZombieCharacter walk again.
+ */
+void UZombieCrowdSubsystem::ExitDead(UZombieCrowdSubsystem& Crowd, int32 Index)
+{
+	UCharacterMovementComponent* ZombieMovement = Crowd.Characters[Index]->GetCharacterMovement();
+	if (ZombieMovement != nullptr) ZombieMovement->SetMovementMode(MOVE_Walking);
+}
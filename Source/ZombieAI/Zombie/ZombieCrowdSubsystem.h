@@ -0,0 +1,279 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieHandle.h"
+#include "ZombieCharacter.h"
+#include "ZombieArchetype.h"
+#include "ZombieCrowdSubsystem.generated.h"
+
+/**
+ * A function run when a ZombieCharacter enters or leaves a state.
+ */
+typedef void (*FZombieStateHook)(class UZombieCrowdSubsystem& Crowd, int32 Index);
+
+/**
+ * The ZombieCrowdSubsystem keeps the frequently used state of every ZombieCharacter in
+ * the world in structure-of-arrays buffers indexed by a FZombieHandle. ZombieCharacters
+ * and ZombieAIControllers read and write their state through here so that systems that
+ * work on the whole horde can walk contiguous memory instead of chasing actor pointers.
+ *
+ * The ZombieCrowdSubsystem also runs the zombies' state machine. Events are looked up in the
+ * compiled FZombieStateTable of each ZombieCharacter's ZombieArchetype, and the logic of
+ * entering and leaving a state is found in a table of hooks indexed by the state.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieCrowdSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieCrowdSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Gives the ZombieCharacter a slot in the crowd and copies its starting values into it.
+	 *
+	 * @param ZombieCharacter The ZombieCharacter to add to the crowd.
+	 */
+	FZombieHandle RegisterZombie(AZombieCharacter* ZombieCharacter);
+
+	/**
+	 * Frees the slot of the ZombieCharacter so that it can be reused.
+	 *
+	 * @param Handle The handle of the ZombieCharacter to remove from the crowd.
+	 */
+	void UnregisterZombie(const FZombieHandle& Handle);
+
+	/**
+	 * Returns whether the handle points to a slot that is still in use by the same ZombieCharacter.
+	 */
+	bool IsValidHandle(const FZombieHandle& Handle) const
+	{
+		return Generations.IsValidIndex(Handle.Index) && Generations[Handle.Index] == Handle.Generation && Characters[Handle.Index] != nullptr;
+	}
+
+	/**
+	 * Moves a ZombieCharacter to the state that the event leads to in its state table, and runs
+	 * the exit logic of its old state and the entry logic of its new one.
+	 *
+	 * @param Handle The handle of the ZombieCharacter.
+	 * @param Event The event that happened.
+	 *
+	 * @return Whether the ZombieCharacter changed state.
+	 */
+	bool SendEvent(const FZombieHandle& Handle, ZombieEvents Event);
+
+	/**
+	 * Sends the same event to a batch of ZombieCharacters. The states are looked up and written
+	 * in one pass, and the exit and entry logic is run in a second pass.
+	 *
+	 * @param Handles The handles of the ZombieCharacters.
+	 * @param Event The event that happened.
+	 * @param OutChangedHandles If given, filled with the handles of the ZombieCharacters that changed state.
+	 */
+	void SendEvents(TArrayView<const FZombieHandle> Handles, ZombieEvents Event, TArray<FZombieHandle>* OutChangedHandles = nullptr);
+
+	/**
+	 * Transitions a ZombieCharacter to a new state without looking at its state table, and runs
+	 * the exit logic of its old state and the entry logic of its new one.
+	 *
+	 * @param Handle The handle of the ZombieCharacter.
+	 * @param NewState The state to transition to.
+	 */
+	void SetState(const FZombieHandle& Handle, ZombieStates NewState);
+
+	/**
+	 * Collects the handles of every ZombieCharacter that is in the given state.
+	 *
+	 * @param State The state to look for.
+	 * @param OutHandles The handles of the ZombieCharacters in that state.
+	 */
+	void GetHandlesInState(ZombieStates State, TArray<FZombieHandle>& OutHandles) const;
+
+	/**
+	 * Returns the number of ZombieCharacters that are in the given state.
+	 */
+	int32 CountInState(ZombieStates State) const;
+
+	/**
+	 * Returns the number of state transitions per second, measured over the last whole second
+	 * that had any.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieCrowd)
+	int32 GetTransitionsPerSecond() const { return LastTransitionsPerSecond; }
+
+	/**
+	 * Sets the seed that the random choices of every ZombieAIController start from. Runs with the
+	 * same seed make the same choices, so benchmarks set it before they spawn their hordes.
+	 */
+	void SetRandomSeed(int32 NewRandomSeed) { RandomSeed = NewRandomSeed; }
+
+	/**
+	 * Returns the seed that the random choices of every ZombieAIController start from.
+	 */
+	int32 GetRandomSeed() const { return RandomSeed; }
+
+	/**
+	 * Returns the number of ZombieCharacters in the crowd.
+	 */
+	int32 GetNumZombies() const { return NumZombies; }
+
+	/**
+	 * Returns the number of slots in the crowd, including the free ones. Loops over the
+	 * raw arrays should go up to this and skip slots without a ZombieCharacter.
+	 */
+	int32 GetNumSlots() const { return Characters.Num(); }
+
+	/**
+	 * Returns the handle of the ZombieCharacter in the given slot.
+	 */
+	FZombieHandle GetHandleAt(int32 Index) const { return FZombieHandle{ Index, Generations[Index] }; }
+
+	AZombieCharacter* GetCharacter(const FZombieHandle& Handle) const { return Characters[Handle.Index]; }
+	AZombieCharacter* GetCharacterAt(int32 Index) const { return Characters[Index]; }
+
+	ZombieStates GetState(const FZombieHandle& Handle) const { return States[Handle.Index]; }
+	ZombieStates GetPreviousState(const FZombieHandle& Handle) const { return PreviousStates[Handle.Index]; }
+	float GetStateStartTime(const FZombieHandle& Handle) const { return StateStartTimes[Handle.Index]; }
+
+	float GetHealth(const FZombieHandle& Handle) const { return Healths[Handle.Index]; }
+	void SetHealth(const FZombieHandle& Handle, float Health) { Healths[Handle.Index] = Health; }
+
+	const FVector& GetStartLocation(const FZombieHandle& Handle) const { return StartLocations[Handle.Index]; }
+	void SetStartLocation(const FZombieHandle& Handle, const FVector& StartLocation) { StartLocations[Handle.Index] = StartLocation; }
+
+	bool CanRoam(const FZombieHandle& Handle) const { return bCanRoam[Handle.Index]; }
+	void SetCanRoam(const FZombieHandle& Handle, bool bNewCanRoam) { bCanRoam[Handle.Index] = bNewCanRoam; }
+	float GetRoamRadius(const FZombieHandle& Handle) const { return RoamRadii[Handle.Index]; }
+	void SetRoamRadius(const FZombieHandle& Handle, float RoamRadius) { RoamRadii[Handle.Index] = RoamRadius; }
+	float GetRoamSpeed(const FZombieHandle& Handle) const { return RoamSpeeds[Handle.Index]; }
+	void SetRoamSpeed(const FZombieHandle& Handle, float RoamSpeed) { RoamSpeeds[Handle.Index] = RoamSpeed; }
+	float GetChaseSpeed(const FZombieHandle& Handle) const { return ChaseSpeeds[Handle.Index]; }
+	void SetChaseSpeed(const FZombieHandle& Handle, float ChaseSpeed) { ChaseSpeeds[Handle.Index] = ChaseSpeed; }
+
+	ZombieLODTiers GetLODTier(const FZombieHandle& Handle) const { return LODTiers[Handle.Index]; }
+	void SetLODTier(const FZombieHandle& Handle, ZombieLODTiers LODTier) { LODTiers[Handle.Index] = LODTier; }
+
+	// The raw state buffers, used by systems that process the whole crowd at once.
+	const TArray<ZombieStates>& GetStates() const { return States; }
+	const TArray<float>& GetStateStartTimes() const { return StateStartTimes; }
+	const TArray<float>& GetHealths() const { return Healths; }
+	const TArray<FVector>& GetStartLocations() const { return StartLocations; }
+	const TArray<ZombieLODTiers>& GetLODTiers() const { return LODTiers; }
+
+protected:
+	/**
+	 * Returns the index of the compiled state table of the ZombieArchetype, compiling it the
+	 * first time it's used.
+	 */
+	uint8 GetStateTableIndex(UZombieArchetype* Archetype);
+
+	/**
+	 * Writes the new state of a ZombieCharacter without running any of its logic.
+	 */
+	void WriteState(int32 Index, ZombieStates NewState, float Now);
+
+	/**
+	 * Runs the logic that happens when a ZombieCharacter leaves its previous state and enters
+	 * its current state, like changing its movement speed and telling its animation about it.
+	 *
+	 * @param Index The slot of the ZombieCharacter.
+	 */
+	void RunStateHooks(int32 Index);
+
+	/**
+	 * Sets the ZombieCharacter's max speed to its roam speed.
+	 */
+	static void EnterRoam(UZombieCrowdSubsystem& Crowd, int32 Index);
+
+	/**
+	 * Sets the ZombieCharacter's max speed to its chase speed.
+	 */
+	static void EnterChase(UZombieCrowdSubsystem& Crowd, int32 Index);
+
+	/**
+	 * Stops the ZombieCharacter where it fell.
+	 */
+	static void EnterDead(UZombieCrowdSubsystem& Crowd, int32 Index);
+
+	/**
+	 * Lets the ZombieCharacter walk again.
+	 */
+	static void ExitDead(UZombieCrowdSubsystem& Crowd, int32 Index);
+
+protected:
+	// The hook run when a ZombieCharacter enters and leaves each state, or nullptr if there's
+	// nothing to do.
+	static const FZombieStateHook EnterHooks[FZombieStateTable::NumStates];
+	static const FZombieStateHook ExitHooks[FZombieStateTable::NumStates];
+
+protected:
+	// The ZombieCharacter in each slot, or nullptr if the slot is free.
+	UPROPERTY()
+	TArray<AZombieCharacter*> Characters;
+
+	// The generation of each slot.
+	TArray<int32> Generations;
+
+	// The current state of each ZombieCharacter.
+	TArray<ZombieStates> States;
+
+	// The previous state of each ZombieCharacter.
+	TArray<ZombieStates> PreviousStates;
+
+	// The world time that each ZombieCharacter entered its current state.
+	TArray<float> StateStartTimes;
+
+	// The current health of each ZombieCharacter.
+	TArray<float> Healths;
+
+	// The location each ZombieCharacter roams around.
+	TArray<FVector> StartLocations;
+
+	// Whether each ZombieCharacter is allowed to roam.
+	TArray<bool> bCanRoam;
+
+	// The radius each ZombieCharacter roams within.
+	TArray<float> RoamRadii;
+
+	// The max speed of each ZombieCharacter in the ROAM state.
+	TArray<float> RoamSpeeds;
+
+	// The max speed of each ZombieCharacter in the CHASE state.
+	TArray<float> ChaseSpeeds;
+
+	// The level of detail tier of each ZombieCharacter.
+	TArray<ZombieLODTiers> LODTiers;
+
+	// The index into `StateTables` of each ZombieCharacter's state table.
+	TArray<uint8> StateTableIndices;
+
+	// The compiled state tables. The first one is the default state machine.
+	TArray<FZombieStateTable> StateTables;
+
+	// The index into `StateTables` of every ZombieArchetype that has been compiled.
+	UPROPERTY(Transient)
+	TMap<UZombieArchetype*, uint8> ArchetypeTableIndices;
+
+	// The slots that are free to be reused.
+	TArray<int32> FreeIndices;
+
+	// The number of ZombieCharacters in each state.
+	int32 StateCounts[FZombieStateTable::NumStates] = {};
+
+	// When the current second of counting transitions started and the transitions counted in it.
+	float TransitionWindowStartTime = 0.f;
+	int32 TransitionsInWindow = 0;
+
+	// The number of transitions per second over the last whole second.
+	int32 LastTransitionsPerSecond = 0;
+
+	// The number of slots that are in use.
+	int32 NumZombies = 0;
+
+	// The seed that the random choices of every ZombieAIController start from.
+	int32 RandomSeed = 0;
+};
@@ -0,0 +1,210 @@
+#include "ZombieDamageSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieCrowdSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarZombieDamageQueued(
+	TEXT("zombie.Damage.Queued"),
+	1,
+	TEXT("Whether hits on zombies are queued and applied together once per frame (1) or applied as soon as they happen (0)."),
+	ECVF_Default);
+
+/**
+ * Applies the damage queued in the ZombieDamageSubsystem.
+ */
+void FZombieDamageTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target != nullptr) Target->ApplyQueuedDamage();
+}
+
+FString FZombieDamageTickFunction::DiagnosticMessage()
+{
+	return TEXT("FZombieDamageTickFunction");
+}
+
+/**
+ * Called when the world that owns the ZombieDamageSubsystem is torn down.
+ */
+void UZombieDamageSubsystem::Deinitialize()
+{
+	if (DamageTickFunction.IsTickFunctionRegistered()) DamageTickFunction.UnRegisterTickFunction();
+	DamageTickFunction.Target = nullptr;
+
+	PendingDamage.Empty();
+	PendingIndices.Empty();
+	KilledHandles.Empty();
+	DiedHandles.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Queues damage on the ZombieCharacter, or applies it right away if queuing is turned off.
+ *
+ * @param ZombieCharacter The ZombieCharacter that was hit.
+ * @param Damage The damage of the hit.
+ */
+void UZombieDamageSubsystem::QueueHit(AZombieCharacter* ZombieCharacter, float Damage)
+{
+	if (ZombieCharacter == nullptr) return;
+
+	QueueDamage(ZombieCharacter->GetCrowdHandle(), Damage);
+}
+
+/**
+ * Queues damage on the ZombieCharacter in the slot of the ZombieCrowdSubsystem, or applies it
+ * right away if queuing is turned off.
+ *
+ * @param Handle The ZombieCharacter's slot in the ZombieCrowdSubsystem.
+ * @param Damage The damage of the hit.
+ */
+void UZombieDamageSubsystem::QueueDamage(const FZombieHandle& Handle, float Damage)
+{
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr || !Crowd->IsValidHandle(Handle)) return;
+
+	// Health is owned by the server and replicated to clients, so hits clients see are ignored.
+	if (World->GetNetMode() == NM_Client) return;
+
+	FrameHitCount++;
+	INC_DWORD_STAT(STAT_ZombieAI_Hits);
+
+	// Without the tick function there is nothing to apply the queue, so the hit is applied
+	// right away like it is when queuing is turned off.
+	const bool bTickRegistered = RegisterDamageTick();
+	if (!bTickRegistered || CVarZombieDamageQueued.GetValueOnGameThread() == 0)
+	{
+		if (ApplyDamage(Crowd, Handle, Damage)) KilledHandles.Add(Handle);
+		KillZombies(Crowd);
+		return;
+	}
+
+	if (PendingIndices.Num() < Crowd->GetNumSlots())
+	{
+		PendingIndices.Reserve(Crowd->GetNumSlots());
+		while (PendingIndices.Num() < Crowd->GetNumSlots()) PendingIndices.Add(INDEX_NONE);
+	}
+
+	// Add the damage to the ZombieCharacter's earlier hits this frame. The slot could have been
+	// taken over by another ZombieCharacter since then, in which case it gets its own entry and
+	// the old one is skipped when the queue is applied.
+	int32& PendingIndex = PendingIndices[Handle.Index];
+	if (PendingIndex != INDEX_NONE && PendingDamage[PendingIndex].Handle == Handle)
+	{
+		PendingDamage[PendingIndex].Damage += Damage;
+		return;
+	}
+
+	FZombiePendingDamage& NewDamage = PendingDamage.AddDefaulted_GetRef();
+	NewDamage.Handle = Handle;
+	NewDamage.Damage = Damage;
+	PendingIndex = PendingDamage.Num() - 1;
+}
+
+/**
+ * Applies the damage of every hit queued since the last time and kills the ZombieCharacters
+ * that ran out of health.
+ */
+void UZombieDamageSubsystem::ApplyQueuedDamage()
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::BULLETS);
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_ApplyDamage);
+
+	if (PendingDamage.Num() > 0)
+	{
+		UWorld* World = GetWorld();
+		UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+
+		// Walk the crowd's health in the order it's laid out in memory.
+		PendingDamage.Sort([](const FZombiePendingDamage& A, const FZombiePendingDamage& B) { return A.Handle.Index < B.Handle.Index; });
+
+		for (const FZombiePendingDamage& Pending : PendingDamage)
+		{
+			PendingIndices[Pending.Handle.Index] = INDEX_NONE;
+
+			if (Crowd != nullptr && ApplyDamage(Crowd, Pending.Handle, Pending.Damage)) KilledHandles.Add(Pending.Handle);
+		}
+		PendingDamage.Reset();
+
+		if (Crowd != nullptr) KillZombies(Crowd);
+	}
+
+	LastFrameHitCount = FrameHitCount;
+	LastFrameDeathCount = FrameDeathCount;
+	FrameHitCount = 0;
+	FrameDeathCount = 0;
+}
+
+/**
+ * Registers the tick function in the world's persistent level the first time damage is queued.
+ *
+ * @return Whether the tick function is registered.
+ */
+bool UZombieDamageSubsystem::RegisterDamageTick()
+{
+	if (DamageTickFunction.IsTickFunctionRegistered()) return true;
+
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->PersistentLevel == nullptr) return false;
+
+	// Bullets hit zombies while the physics scene is simulated and fetched, so the damage is
+	// applied once that's done.
+	DamageTickFunction.Target = this;
+	DamageTickFunction.TickGroup = TG_PostPhysics;
+	DamageTickFunction.bCanEverTick = true;
+	DamageTickFunction.bStartWithTickEnabled = true;
+	DamageTickFunction.RegisterTickFunction(World->PersistentLevel);
+
+	return DamageTickFunction.IsTickFunctionRegistered();
+}
+
+/**
+ * Takes the damage from the ZombieCharacter's health.
+ *
+ * @param Crowd The ZombieCrowdSubsystem that holds the ZombieCharacter's health.
+ * @param Handle The ZombieCharacter's slot in the ZombieCrowdSubsystem.
+ * @param Damage The damage to take.
+ *
+ * @return Whether the ZombieCharacter ran out of health. ZombieCharacters that are already
+ * dead don't take any damage.
+ */
+bool UZombieDamageSubsystem::ApplyDamage(UZombieCrowdSubsystem* Crowd, const FZombieHandle& Handle, float Damage)
+{
+	if (!Crowd->IsValidHandle(Handle)) return false;
+
+	// Bullets that hit the body of a dead ZombieCharacter don't kill it again.
+	if (Crowd->GetState(Handle) == ZombieStates::DEAD) return false;
+
+	const float RemainingHealth = Crowd->GetHealth(Handle) - Damage;
+	Crowd->SetHealth(Handle, RemainingHealth);
+
+	return RemainingHealth <= 0.f;
+}
+
+/**
+ * Kills the ZombieCharacters in `KilledHandles`.
+ */
+void UZombieDamageSubsystem::KillZombies(UZombieCrowdSubsystem* Crowd)
+{
+	if (KilledHandles.Num() == 0) return;
+
+	// Put the ZombieCharacters in the `DEAD` state together so that the animation blueprint
+	// plays the zombie dying animation, then let each of them stop thinking. ZombieCharacters
+	// whose state table ignores KILLED keep going.
+	Crowd->SendEvents(KilledHandles, ZombieEvents::KILLED, &DiedHandles);
+
+	for (const FZombieHandle& Handle : DiedHandles)
+	{
+		if (Crowd->IsValidHandle(Handle)) Crowd->GetCharacter(Handle)->OnKilled();
+	}
+
+	FrameDeathCount += DiedHandles.Num();
+	INC_DWORD_STAT_BY(STAT_ZombieAI_Deaths, DiedHandles.Num());
+
+	KilledHandles.Reset();
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieHandle.h"
+#include "ZombieDamageSubsystem.generated.h"
+
+class AZombieCharacter;
+class UZombieDamageSubsystem;
+
+/**
+ * The tick function that applies the damage queued in the ZombieDamageSubsystem. It runs in
+ * the TG_PostPhysics tick group so that every hit from the frame's physics has been queued and
+ * zombies die before anything reads their state in the late tick groups.
+ */
+struct FZombieDamageTickFunction : public FTickFunction
+{
+	// The ZombieDamageSubsystem to apply the damage of.
+	UZombieDamageSubsystem* Target = nullptr;
+
+	// FTickFunction
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+/**
+ * The damage that one ZombieCharacter has taken this frame.
+ */
+struct FZombiePendingDamage
+{
+	// The ZombieCharacter's slot in the ZombieCrowdSubsystem.
+	FZombieHandle Handle;
+
+	// The total damage of every hit.
+	float Damage = 0.f;
+};
+
+/**
+ * The ZombieDamageSubsystem collects the hits zombies take during the frame instead of
+ * changing their health and killing them inside of the physics callbacks that found the hits.
+ * Hits on the same zombie are added together, and once per frame the health of every hit zombie
+ * is changed in one pass in the order of their slots in the ZombieCrowdSubsystem, after which
+ * every zombie that died is sent KILLED together.
+ *
+ * The damage can be applied as soon as it's taken, like before, with `zombie.Damage.Queued 0`.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieDamageSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieDamageSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Queues damage on the ZombieCharacter, or applies it right away if queuing is turned off.
+	 *
+	 * @param ZombieCharacter The ZombieCharacter that was hit.
+	 * @param Damage The damage of the hit.
+	 */
+	void QueueHit(AZombieCharacter* ZombieCharacter, float Damage);
+
+	/**
+	 * Queues damage on the ZombieCharacter in the slot of the ZombieCrowdSubsystem, or applies it
+	 * right away if queuing is turned off.
+	 *
+	 * @param Handle The ZombieCharacter's slot in the ZombieCrowdSubsystem.
+	 * @param Damage The damage of the hit.
+	 */
+	void QueueDamage(const FZombieHandle& Handle, float Damage);
+
+	/**
+	 * Applies the damage of every hit queued since the last time and kills the ZombieCharacters
+	 * that ran out of health.
+	 */
+	void ApplyQueuedDamage();
+
+	/**
+	 * Returns the number of hits that were applied in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieDamage)
+	int32 GetLastFrameHitCount() const { return LastFrameHitCount; }
+
+	/**
+	 * Returns the number of ZombieCharacters that died in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieDamage)
+	int32 GetLastFrameDeathCount() const { return LastFrameDeathCount; }
+
+protected:
+	/**
+	 * Registers the tick function in the world's persistent level the first time damage is queued.
+	 *
+	 * @return Whether the tick function is registered.
+	 */
+	bool RegisterDamageTick();
+
+	/**
+	 * Takes the damage from the ZombieCharacter's health.
+	 *
+	 * @param Crowd The ZombieCrowdSubsystem that holds the ZombieCharacter's health.
+	 * @param Handle The ZombieCharacter's slot in the ZombieCrowdSubsystem.
+	 * @param Damage The damage to take.
+	 *
+	 * @return Whether the ZombieCharacter ran out of health. ZombieCharacters that are already
+	 * dead don't take any damage.
+	 */
+	static bool ApplyDamage(class UZombieCrowdSubsystem* Crowd, const FZombieHandle& Handle, float Damage);
+
+	/**
+	 * Kills the ZombieCharacters in `KilledHandles`.
+	 */
+	void KillZombies(class UZombieCrowdSubsystem* Crowd);
+
+protected:
+	// The tick function that applies the queued damage.
+	FZombieDamageTickFunction DamageTickFunction;
+
+	// The damage of every ZombieCharacter that was hit this frame.
+	TArray<FZombiePendingDamage> PendingDamage;
+
+	// The index into `PendingDamage` of each slot of the ZombieCrowdSubsystem, or INDEX_NONE if the
+	// ZombieCharacter in the slot hasn't been hit this frame.
+	TArray<int32> PendingIndices;
+
+	// The ZombieCharacters that ran out of health in this pass.
+	TArray<FZombieHandle> KilledHandles;
+
+	// The ZombieCharacters whose state table let them die in this pass.
+	TArray<FZombieHandle> DiedHandles;
+
+	// The number of hits taken and the number of ZombieCharacters that died since the last pass.
+	int32 FrameHitCount = 0;
+	int32 FrameDeathCount = 0;
+
+	// The number of hits that were applied and the number of ZombieCharacters that died in the
+	// last frame.
+	int32 LastFrameHitCount = 0;
+	int32 LastFrameDeathCount = 0;
+};
@@ -0,0 +1,366 @@
+#include "ZombieFlowFieldSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "NavigationSystem.h"
+
+static TAutoConsoleVariable<int32> CVarZombieFlowFieldEnabled(
+	TEXT("zombie.FlowField.Enabled"),
+	1,
+	TEXT("Whether chasing zombies follow a shared flow field instead of finding their own path to the player."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieFlowFieldCellSize(
+	TEXT("zombie.FlowField.CellSize"),
+	100.f,
+	TEXT("The size of the flow field grid cells."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieFlowFieldRadius(
+	TEXT("zombie.FlowField.Radius"),
+	48,
+	TEXT("The number of cells a flow field reaches out from the player in each direction."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieFlowFieldMaxRebuildsPerFrame(
+	TEXT("zombie.FlowField.MaxRebuildsPerFrame"),
+	2,
+	TEXT("The number of flow fields that can be rebuilt in one frame. The rest are rebuilt in the following frames."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieFlowFieldMaxNavQueriesPerFrame(
+	TEXT("zombie.FlowField.MaxNavQueriesPerFrame"),
+	1024,
+	TEXT("The number of uncached cells that flow fields can look for the navmesh in during one frame. Fields that need more are finished in the following frames."),
+	ECVF_Default);
+
+// The largest step in navmesh height between two cells that a zombie can walk across.
+static const float MaxHeightDifference = 60.f;
+
+// The number of seconds a flow field is kept after the last zombie asked for a direction from it.
+static const float FieldLifetime = 2.f;
+
+// The height of the bands the navmesh cells are cached in. The navmesh is looked for up to this
+// far above and below the middle of the band.
+static const float NavCellBandHeight = 200.f;
+
+/**
+ * Called when the world that owns the ZombieFlowFieldSubsystem is torn down.
+ */
+void UZombieFlowFieldSubsystem::Deinitialize()
+{
+	Fields.Empty();
+	NavCells.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Returns whether chasing zombies should follow flow fields instead of finding their own path.
+ */
+bool UZombieFlowFieldSubsystem::IsFlowFieldEnabled()
+{
+	return CVarZombieFlowFieldEnabled.GetValueOnGameThread() != 0;
+}
+
+/**
+ * Makes sure that there is a flow field leading to the actor. The field is built on the next tick.
+ *
+ * @param Target The actor to lead to.
+ */
+void UZombieFlowFieldSubsystem::RequestField(AActor* Target)
+{
+	if (Target == nullptr) return;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	FZombieFlowField* Field = FindField(Target);
+	if (Field != nullptr)
+	{
+		Field->LastUsedTime = Now;
+		return;
+	}
+
+	FZombieFlowField& NewField = Fields.AddDefaulted_GetRef();
+	NewField.Target = Target;
+	NewField.LastUsedTime = Now;
+}
+
+/**
+ * Finds the direction to go in from the location to reach the actor.
+ *
+ * @param Target The actor to reach.
+ * @param Location The location on the navmesh to go from, such as the feet of a zombie.
+ * @param OutDirection The direction to go in.
+ *
+ * @return Whether there is a field for the actor that reaches the location. A location on
+ * another floor than the field's cell under it isn't reached.
+ */
+bool UZombieFlowFieldSubsystem::GetFlowDirection(const AActor* Target, const FVector& Location, FVector& OutDirection)
+{
+	FZombieFlowField* Field = FindField(Target);
+	if (Field == nullptr || !Field->bBuilt) return false;
+
+	Field->LastUsedTime = GetWorld()->GetTimeSeconds();
+
+	const FIntPoint Cell = GetCell(Location);
+	const int32 X = Cell.X - Field->MinCell.X;
+	const int32 Y = Cell.Y - Field->MinCell.Y;
+	if (X < 0 || Y < 0 || X >= Field->Size || Y >= Field->Size) return false;
+
+	const int32 Distance = Field->Distances[Y * Field->Size + X];
+	if (Distance == INDEX_NONE) return false;
+
+	// The field only covers one floor, so a location above or below the cell is somewhere else.
+	if (FMath::Abs(Location.Z - Field->Heights[Y * Field->Size + X]) > MaxHeightDifference) return false;
+
+	// In the same cell as the target so just head straight for it.
+	if (Distance == 0)
+	{
+		OutDirection = (Target->GetActorLocation() - Location).GetSafeNormal2D();
+		return true;
+	}
+
+	// Head for the neighbouring cell closest to the target. Diagonal cells are only used if both
+	// cells beside them are open so that zombies don't cut corners.
+	int32 BestDistance = Distance;
+	FIntPoint BestOffset = FIntPoint::ZeroValue;
+	for (int32 OffsetY = -1; OffsetY <= 1; ++OffsetY)
+	{
+		for (int32 OffsetX = -1; OffsetX <= 1; ++OffsetX)
+		{
+			const int32 NeighbourX = X + OffsetX;
+			const int32 NeighbourY = Y + OffsetY;
+			if (NeighbourX < 0 || NeighbourY < 0 || NeighbourX >= Field->Size || NeighbourY >= Field->Size) continue;
+
+			const int32 NeighbourDistance = Field->Distances[NeighbourY * Field->Size + NeighbourX];
+			if (NeighbourDistance == INDEX_NONE || NeighbourDistance >= BestDistance) continue;
+
+			if (OffsetX != 0 && OffsetY != 0)
+			{
+				if (Field->Distances[Y * Field->Size + NeighbourX] == INDEX_NONE) continue;
+				if (Field->Distances[NeighbourY * Field->Size + X] == INDEX_NONE) continue;
+			}
+
+			BestDistance = NeighbourDistance;
+			BestOffset = FIntPoint(OffsetX, OffsetY);
+		}
+	}
+
+	if (BestOffset == FIntPoint::ZeroValue) return false;
+
+	const FVector NextCellCenter((Cell.X + BestOffset.X + 0.5f) * CellSize, (Cell.Y + BestOffset.Y + 0.5f) * CellSize, Location.Z);
+	OutDirection = (NextCellCenter - Location).GetSafeNormal2D();
+	return true;
+}
+
+/**
+ * Called every frame to drop unused fields and rebuild the ones whose target moved to
+ * another cell, carrying on with the rebuilds that didn't finish last frame.
+ */
+void UZombieFlowFieldSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::MOVEMENT);
+
+	LastFrameRebuildCount = 0;
+
+	// Everything cached is for the old cell size so start over.
+	const float NewCellSize = FMath::Max(CVarZombieFlowFieldCellSize.GetValueOnGameThread(), 10.f);
+	if (NewCellSize != CellSize)
+	{
+		CellSize = NewCellSize;
+		NavCells.Empty();
+		for (FZombieFlowField& Field : Fields)
+		{
+			Field.bBuilt = false;
+			Field.bBuilding = false;
+		}
+	}
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	const int32 MaxRebuilds = FMath::Max(CVarZombieFlowFieldMaxRebuildsPerFrame.GetValueOnGameThread(), 1);
+	NavQueriesLeft = FMath::Max(CVarZombieFlowFieldMaxNavQueriesPerFrame.GetValueOnGameThread(), 1);
+
+	for (int32 FieldIndex = Fields.Num() - 1; FieldIndex >= 0; --FieldIndex)
+	{
+		FZombieFlowField& Field = Fields[FieldIndex];
+
+		const AActor* Target = Field.Target.Get();
+		if (Target == nullptr || Now - Field.LastUsedTime > FieldLifetime)
+		{
+			Fields.RemoveAtSwap(FieldIndex, 1, false);
+			continue;
+		}
+
+		if (LastFrameRebuildCount >= MaxRebuilds) continue;
+
+		// Only rebuild when the target has moved into another cell since the field would come
+		// out the same otherwise. A rebuild that's under way is finished first even if the
+		// target has moved on again, so that a fast target doesn't keep it from ever finishing.
+		if (!Field.bBuilding)
+		{
+			const FVector TargetLocation = Target->GetActorLocation();
+			const FIntPoint TargetCell = GetCell(TargetLocation);
+			if (Field.bBuilt && TargetCell == Field.TargetCell) continue;
+
+			FZombieFlowCell NavCell;
+			if (!GetNavCell(TargetCell, TargetLocation.Z, NavCell)) continue;
+
+			StartBuild(Field, TargetCell, NavCell.bWalkable ? NavCell.Height : TargetLocation.Z);
+		}
+
+		ContinueBuild(Field);
+		LastFrameRebuildCount++;
+	}
+}
+
+TStatId UZombieFlowFieldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieFlowFieldSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Starts a new breadth first search of the field from the cell its target is in.
+ */
+void UZombieFlowFieldSubsystem::StartBuild(FZombieFlowField& Field, const FIntPoint& TargetCell, float TargetHeight)
+{
+	const int32 Radius = FMath::Max(CVarZombieFlowFieldRadius.GetValueOnGameThread(), 1);
+	const int32 Size = Radius * 2 + 1;
+
+	Field.bBuilding = true;
+	Field.BuildTargetCell = TargetCell;
+	Field.BuildMinCell = TargetCell - FIntPoint(Radius, Radius);
+	Field.BuildSize = Size;
+	Field.BuildDistances.Init(INDEX_NONE, Size * Size);
+	Field.BuildHeights.Init(0.f, Size * Size);
+	Field.OpenCells.Reset();
+	Field.OpenHead = 0;
+
+	const int32 StartIndex = Radius * Size + Radius;
+	Field.BuildDistances[StartIndex] = 0;
+	Field.BuildHeights[StartIndex] = TargetHeight;
+	Field.OpenCells.Add(StartIndex);
+}
+
+/**
+ * Carries on with the breadth first search of the field until it's done or this frame's
+ * navmesh queries run out.
+ *
+ * @return Whether the search is done.
+ */
+bool UZombieFlowFieldSubsystem::ContinueBuild(FZombieFlowField& Field)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_BuildFlowField);
+
+	const int32 Size = Field.BuildSize;
+
+	static const FIntPoint Directions[] = { FIntPoint(1, 0), FIntPoint(-1, 0), FIntPoint(0, 1), FIntPoint(0, -1) };
+
+	// Visit the cells in order of distance from the target. The queue only ever grows so a head
+	// index is used instead of removing from the front.
+	for (; Field.OpenHead < Field.OpenCells.Num(); ++Field.OpenHead)
+	{
+		const int32 CellIndex = Field.OpenCells[Field.OpenHead];
+		const int32 X = CellIndex % Size;
+		const int32 Y = CellIndex / Size;
+		const float Height = Field.BuildHeights[CellIndex];
+
+		for (const FIntPoint& Direction : Directions)
+		{
+			const int32 NeighbourX = X + Direction.X;
+			const int32 NeighbourY = Y + Direction.Y;
+			if (NeighbourX < 0 || NeighbourY < 0 || NeighbourX >= Size || NeighbourY >= Size) continue;
+
+			const int32 NeighbourIndex = NeighbourY * Size + NeighbourX;
+			if (Field.BuildDistances[NeighbourIndex] != INDEX_NONE) continue;
+
+			// Stop here for this frame if the queries have run out. The neighbours already
+			// visited are skipped when the cell is picked up again next frame.
+			FZombieFlowCell NavCell;
+			if (!GetNavCell(Field.BuildMinCell + FIntPoint(NeighbourX, NeighbourY), Height, NavCell)) return false;
+
+			// Only walk onto cells with navmesh that aren't a wall or a drop away.
+			if (!NavCell.bWalkable || FMath::Abs(NavCell.Height - Height) > MaxHeightDifference) continue;
+
+			Field.BuildDistances[NeighbourIndex] = Field.BuildDistances[CellIndex] + 1;
+			Field.BuildHeights[NeighbourIndex] = NavCell.Height;
+			Field.OpenCells.Add(NeighbourIndex);
+		}
+	}
+
+	// Swap the finished search in, keeping the old distances' and heights' memory for the next one.
+	Field.TargetCell = Field.BuildTargetCell;
+	Field.MinCell = Field.BuildMinCell;
+	Field.Size = Size;
+	Swap(Field.Distances, Field.BuildDistances);
+	Swap(Field.Heights, Field.BuildHeights);
+	Field.bBuilt = true;
+	Field.bBuilding = false;
+
+	return true;
+}
+
+/**
+ * Finds whether the navmesh is in the cell, looking for it around the height given. The
+ * result is cached since the navmesh doesn't change during play.
+ *
+ * @param Cell The cell to look in.
+ * @param NearHeight The height to look around.
+ * @param OutCell Whether the cell is walkable and at what height.
+ *
+ * @return Whether the cell was found, or false if it isn't cached and this frame's navmesh
+ *         queries have run out.
+ */
+bool UZombieFlowFieldSubsystem::GetNavCell(const FIntPoint& Cell, float NearHeight, FZombieFlowCell& OutCell)
+{
+	const FIntVector Key(Cell.X, Cell.Y, FMath::FloorToInt(NearHeight / NavCellBandHeight));
+
+	const FZombieFlowCell* CachedCell = NavCells.Find(Key);
+	if (CachedCell != nullptr)
+	{
+		OutCell = *CachedCell;
+		return true;
+	}
+
+	if (NavQueriesLeft <= 0) return false;
+	NavQueriesLeft--;
+
+	FZombieFlowCell NavCell;
+
+	UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavigationSystem != nullptr)
+	{
+		// Look for navmesh anywhere in the cell around the middle of the height band, which is
+		// always at least half a band above and below the height given.
+		const FVector CellCenter((Cell.X + 0.5f) * CellSize, (Cell.Y + 0.5f) * CellSize, (Key.Z + 0.5f) * NavCellBandHeight);
+		const FVector QueryExtent(CellSize * 0.5f, CellSize * 0.5f, NavCellBandHeight);
+
+		FNavLocation NavLocation;
+		if (NavigationSystem->ProjectPointToNavigation(CellCenter, NavLocation, QueryExtent))
+		{
+			NavCell.bWalkable = true;
+			NavCell.Height = NavLocation.Location.Z;
+		}
+	}
+
+	NavCells.Add(Key, NavCell);
+	OutCell = NavCell;
+	return true;
+}
+
+/**
+ * Returns the field leading to the actor, or nullptr if there isn't one.
+ */
+FZombieFlowField* UZombieFlowFieldSubsystem::FindField(const AActor* Target)
+{
+	return Fields.FindByPredicate([Target](const FZombieFlowField& Field) { return Field.Target.Get() == Target; });
+}
+
+/**
+ * Returns the grid cell that contains the location.
+ */
+FIntPoint UZombieFlowFieldSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
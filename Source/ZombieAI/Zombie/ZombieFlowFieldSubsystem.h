@@ -0,0 +1,184 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieFlowFieldSubsystem.generated.h"
+
+/**
+ * Whether a grid cell is on the navmesh, and at what height.
+ */
+struct FZombieFlowCell
+{
+	// Whether the cell has navmesh in it.
+	bool bWalkable = false;
+
+	// The height of the navmesh in the cell.
+	float Height = 0.f;
+};
+
+/**
+ * The distance from every grid cell around an actor to the actor, measured in cells along
+ * the navmesh.
+ */
+struct FZombieFlowField
+{
+	// The actor that the field leads to.
+	TWeakObjectPtr<AActor> Target;
+
+	// The cell the actor was in when the field was built.
+	FIntPoint TargetCell = FIntPoint::ZeroValue;
+
+	// The cell in the corner of the field with the smallest coordinates.
+	FIntPoint MinCell = FIntPoint::ZeroValue;
+
+	// The number of cells along each side of the field.
+	int32 Size = 0;
+
+	// The distance of every cell to the target cell, or INDEX_NONE if the target can't be
+	// reached from it.
+	TArray<int32> Distances;
+
+	// The height of the navmesh in every cell that the target can be reached from, so that a
+	// zombie on another floor above or below it isn't steered by it.
+	TArray<float> Heights;
+
+	// The last time a zombie asked for a direction from the field.
+	float LastUsedTime = 0.f;
+
+	// Whether the field has been built at least once.
+	bool bBuilt = false;
+
+	// Whether a new search of the field is in progress. It's spread over as many frames as the
+	// navmesh queries take and replaces the field once it's done, so the old field is still
+	// followed in the meantime.
+	bool bBuilding = false;
+
+	// The target cell, corner cell and size of the search in progress.
+	FIntPoint BuildTargetCell = FIntPoint::ZeroValue;
+	FIntPoint BuildMinCell = FIntPoint::ZeroValue;
+	int32 BuildSize = 0;
+
+	// The distances and navmesh heights the search in progress has found so far.
+	TArray<int32> BuildDistances;
+	TArray<float> BuildHeights;
+
+	// The cells waiting to be visited by the search in progress, and the index of the next one.
+	TArray<int32> OpenCells;
+	int32 OpenHead = 0;
+};
+
+/**
+ * The ZombieFlowFieldSubsystem keeps one flow field for every actor that zombies are chasing.
+ * A field is a breadth first search over a grid of navmesh cells around the actor, done once
+ * for all the zombies chasing it and only redone when the actor moves into another cell. A chasing
+ * zombie then finds the way to go by looking at the cells around it, so the cost of pathfinding
+ * depends on the number of players rather than the number of zombies.
+ *
+ * Fields that nobody has asked for in a while are thrown away. The size of the cells and of the
+ * fields are set with `zombie.FlowField.CellSize` and `zombie.FlowField.Radius`. Looking for the
+ * navmesh in cells that haven't been seen before is capped by `zombie.FlowField.MaxNavQueriesPerFrame`,
+ * so a big field is built over a few frames.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieFlowFieldSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieFlowFieldSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns whether chasing zombies should follow flow fields instead of finding their own path.
+	 */
+	static bool IsFlowFieldEnabled();
+
+	/**
+	 * Makes sure that there is a flow field leading to the actor. The field is built on the next tick.
+	 *
+	 * @param Target The actor to lead to.
+	 */
+	void RequestField(AActor* Target);
+
+	/**
+	 * Finds the direction to go in from the location to reach the actor.
+	 *
+	 * @param Target The actor to reach.
+	 * @param Location The location on the navmesh to go from, such as the feet of a zombie.
+	 * @param OutDirection The direction to go in.
+	 *
+	 * @return Whether there is a field for the actor that reaches the location. A location on
+	 * another floor than the field's cell under it isn't reached.
+	 */
+	bool GetFlowDirection(const AActor* Target, const FVector& Location, FVector& OutDirection);
+
+	/**
+	 * Returns the number of flow fields that were worked on in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieFlowField)
+	int32 GetLastFrameRebuildCount() const { return LastFrameRebuildCount; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Starts a new breadth first search of the field from the cell its target is in.
+	 */
+	void StartBuild(FZombieFlowField& Field, const FIntPoint& TargetCell, float TargetHeight);
+
+	/**
+	 * Carries on with the breadth first search of the field until it's done or this frame's
+	 * navmesh queries run out.
+	 *
+	 * @return Whether the search is done.
+	 */
+	bool ContinueBuild(FZombieFlowField& Field);
+
+	/**
+	 * Finds whether the navmesh is in the cell, looking for it around the height given. The
+	 * result is cached since the navmesh doesn't change during play.
+	 *
+	 * @param Cell The cell to look in.
+	 * @param NearHeight The height to look around.
+	 * @param OutCell Whether the cell is walkable and at what height.
+	 *
+	 * @return Whether the cell was found, or false if it isn't cached and this frame's navmesh
+	 *         queries have run out.
+	 */
+	bool GetNavCell(const FIntPoint& Cell, float NearHeight, FZombieFlowCell& OutCell);
+
+	/**
+	 * Returns the field leading to the actor, or nullptr if there isn't one.
+	 */
+	FZombieFlowField* FindField(const AActor* Target);
+
+	/**
+	 * Returns the grid cell that contains the location.
+	 */
+	FIntPoint GetCell(const FVector& Location) const;
+
+protected:
+	// The fields leading to every actor that's being chased.
+	TArray<FZombieFlowField> Fields;
+
+	// Whether the navmesh is in each grid cell that has been looked at, keyed by the cell and
+	// the band of heights it was looked for in so that floors above each other aren't mixed up.
+	TMap<FIntVector, FZombieFlowCell> NavCells;
+
+	// The number of navmesh queries that can still be made this frame.
+	int32 NavQueriesLeft = 0;
+
+	// The size of a grid cell when the fields were last built. The cached cells are thrown
+	// away if it changes.
+	float CellSize = 0.f;
+
+	// The number of flow fields that were worked on in the last frame.
+	int32 LastFrameRebuildCount = 0;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Identifies a ZombieCharacter's slot in the ZombieCrowdSubsystem. The generation is
+ * bumped every time a slot is reused so that stale handles can be detected.
+ */
+struct FZombieHandle
+{
+	// The index of the slot in the ZombieCrowdSubsystem's arrays.
+	int32 Index = INDEX_NONE;
+
+	// The generation of the slot when this handle was given out.
+	int32 Generation = 0;
+
+	bool IsSet() const { return Index != INDEX_NONE; }
+
+	bool operator==(const FZombieHandle& Other) const { return Index == Other.Index && Generation == Other.Generation; }
+	bool operator!=(const FZombieHandle& Other) const { return !(*this == Other); }
+};
@@ -0,0 +1,160 @@
+#include "ZombieImpostorSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieCrowdSubsystem.h"
+#include "ZombieVertexAnimationData.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+static TAutoConsoleVariable<int32> CVarZombieImpostorEnabled(
+	TEXT("zombie.Impostor.Enabled"),
+	1,
+	TEXT("Whether zombies outside the FULL level of detail tier are drawn as vertex animated impostors."),
+	ECVF_Default);
+
+// The number of per-instance custom data floats the vertex animation material reads.
+static const int32 NumImpostorCustomData = 5;
+
+/**
+ * Called when the world that owns the ZombieImpostorSubsystem is torn down.
+ */
+void UZombieImpostorSubsystem::Deinitialize()
+{
+	Renderers.Empty();
+	HiddenCharacters.Empty();
+	ImpostorSlots.Empty();
+	InstanceTransforms.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Called every frame to swap zombies between their skeletal mesh and their impostor and to
+ * move the impostors.
+ */
+void UZombieImpostorSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::ANIMATION);
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return;
+
+	const bool bEnabled = CVarZombieImpostorEnabled.GetValueOnGameThread() != 0;
+	const TArray<ZombieLODTiers>& LODTiers = Crowd->GetLODTiers();
+
+	HiddenCharacters.SetNum(Crowd->GetNumSlots());
+	ImpostorSlots.Reset();
+
+	for (int32 Index = 0; Index < Crowd->GetNumSlots(); ++Index)
+	{
+		AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		UZombieVertexAnimationData* Data = ZombieCharacter->VertexAnimationData;
+		const bool bWantsImpostor = bEnabled && Data != nullptr && Data->Mesh != nullptr && LODTiers[Index] != ZombieLODTiers::FULL;
+		const bool bIsImpostor = HiddenCharacters[Index].Get() == ZombieCharacter;
+
+		// Only touch the skeletal mesh when the ZombieCharacter swaps so that its render state
+		// isn't rebuilt every frame.
+		if (bWantsImpostor != bIsImpostor)
+		{
+			ZombieCharacter->GetMesh()->SetVisibility(!bWantsImpostor);
+			HiddenCharacters[Index] = bWantsImpostor ? ZombieCharacter : nullptr;
+		}
+
+		if (!bWantsImpostor) continue;
+
+		ImpostorSlots.Add(Index);
+		if (!Renderers.Contains(Data)) CreateRenderer(Data);
+	}
+
+	for (const TPair<UZombieVertexAnimationData*, UInstancedStaticMeshComponent*>& Renderer : Renderers)
+	{
+		if (Renderer.Key != nullptr && Renderer.Value != nullptr) UpdateInstances(Renderer.Key, Renderer.Value);
+	}
+}
+
+TStatId UZombieImpostorSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieImpostorSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Updates the instances of the ZombieVertexAnimationData so that there is one instance for
+ * every ZombieCharacter drawn with it.
+ *
+ * @param Data The ZombieVertexAnimationData the instances are drawn with.
+ * @param Instances The instanced static mesh of the ZombieVertexAnimationData.
+ */
+void UZombieImpostorSubsystem::UpdateInstances(const UZombieVertexAnimationData* Data, UInstancedStaticMeshComponent* Instances)
+{
+	const UWorld* World = GetWorld();
+	const UZombieCrowdSubsystem* Crowd = World->GetSubsystem<UZombieCrowdSubsystem>();
+
+	const TArray<ZombieStates>& States = Crowd->GetStates();
+	const TArray<float>& StateStartTimes = Crowd->GetStateStartTimes();
+
+	InstanceTransforms.Reset(ImpostorSlots.Num());
+	for (const int32 Index : ImpostorSlots)
+	{
+		const AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter->VertexAnimationData != Data) continue;
+
+		// The impostor goes where the skeletal mesh would have been drawn.
+		const int32 InstanceIndex = InstanceTransforms.Add(ZombieCharacter->GetMesh()->GetComponentTransform());
+
+		// Grow the instances as they're needed. Instances are only ever removed from the end
+		// so that no other instance has to be moved.
+		if (InstanceIndex >= Instances->GetInstanceCount()) Instances->AddInstanceWorldSpace(InstanceTransforms[InstanceIndex]);
+
+		// Tell the material which clip to play and when it started.
+		const FZombieVertexAnimationClip& Clip = Data->GetClip(States[Index]);
+		Instances->SetCustomDataValue(InstanceIndex, 0, (float)Clip.StartFrame, false);
+		Instances->SetCustomDataValue(InstanceIndex, 1, (float)Clip.NumFrames, false);
+		Instances->SetCustomDataValue(InstanceIndex, 2, Clip.FramesPerSecond, false);
+		Instances->SetCustomDataValue(InstanceIndex, 3, Clip.bLoop ? 1.f : 0.f, false);
+		Instances->SetCustomDataValue(InstanceIndex, 4, StateStartTimes[Index], false);
+	}
+
+	const int32 NumInstances = InstanceTransforms.Num();
+	while (Instances->GetInstanceCount() > NumInstances)
+	{
+		Instances->RemoveInstance(Instances->GetInstanceCount() - 1);
+	}
+
+	if (NumInstances == 0) return;
+
+	Instances->BatchUpdateInstancesTransforms(0, InstanceTransforms, true, true, true);
+}
+
+/**
+ * Spawns the actor that owns the instanced static mesh used to draw the ZombieVertexAnimationData.
+ */
+UInstancedStaticMeshComponent* UZombieImpostorSubsystem::CreateRenderer(UZombieVertexAnimationData* Data)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return nullptr;
+
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AActor* Renderer = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, ActorSpawnParams);
+	if (Renderer == nullptr) return nullptr;
+
+	// The impostors are only visual, the ZombieCharacters keep their own collision.
+	UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(Renderer, TEXT("ZombieImpostors"));
+	Instances->SetMobility(EComponentMobility::Movable);
+	Instances->SetStaticMesh(Data->Mesh);
+	Instances->NumCustomDataFloats = NumImpostorCustomData;
+	Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Renderer->SetRootComponent(Instances);
+	Instances->RegisterComponent();
+
+	Renderers.Add(Data, Instances);
+
+	return Instances;
+}
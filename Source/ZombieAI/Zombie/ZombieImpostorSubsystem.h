@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieImpostorSubsystem.generated.h"
+
+class AZombieCharacter;
+class UInstancedStaticMeshComponent;
+class UZombieVertexAnimationData;
+
+/**
+ * The ZombieImpostorSubsystem draws every ZombieCharacter that isn't in the FULL level of detail
+ * tier as an instance of a static mesh that plays baked vertex animations, and hides its
+ * skeletal mesh. There is one instanced static mesh for every ZombieVertexAnimationData so a
+ * whole horde of far away zombies costs a handful of draw calls and no skinning. Once a
+ * ZombieCharacter is back in the FULL tier its skeletal mesh is shown again.
+ *
+ * Only ZombieCharacters with a `VertexAnimationData` are drawn as impostors, and impostors can be
+ * turned off with `zombie.Impostor.Enabled 0`.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieImpostorSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieImpostorSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns the number of ZombieCharacters that are drawn as impostors.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieImpostor)
+	int32 GetNumImpostors() const { return ImpostorSlots.Num(); }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Updates the instances of the ZombieVertexAnimationData so that there is one instance for
+	 * every ZombieCharacter drawn with it.
+	 *
+	 * @param Data The ZombieVertexAnimationData the instances are drawn with.
+	 * @param Instances The instanced static mesh of the ZombieVertexAnimationData.
+	 */
+	void UpdateInstances(const UZombieVertexAnimationData* Data, UInstancedStaticMeshComponent* Instances);
+
+	/**
+	 * Spawns the actor that owns the instanced static mesh used to draw the ZombieVertexAnimationData.
+	 */
+	UInstancedStaticMeshComponent* CreateRenderer(UZombieVertexAnimationData* Data);
+
+protected:
+	// The instanced static mesh of every ZombieVertexAnimationData in use.
+	UPROPERTY()
+	TMap<UZombieVertexAnimationData*, UInstancedStaticMeshComponent*> Renderers;
+
+	// The ZombieCharacter whose skeletal mesh is hidden in each slot of the ZombieCrowdSubsystem.
+	TArray<TWeakObjectPtr<AZombieCharacter>> HiddenCharacters;
+
+	// The slots of the ZombieCharacters drawn as impostors this frame.
+	TArray<int32> ImpostorSlots;
+
+	// Scratch space for the instance transforms so that it doesn't have to be allocated
+	// every frame.
+	TArray<FTransform> InstanceTransforms;
+};
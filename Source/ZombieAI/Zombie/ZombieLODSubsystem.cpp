@@ -0,0 +1,256 @@
+#include "ZombieLODSubsystem.h"
+#include "ZombieAIController.h"
+#include "ZombieCrowdSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarZombieLODEnabled(
+	TEXT("zombie.LOD.Enabled"),
+	1,
+	TEXT("Whether zombies are moved between level of detail tiers. When 0 every zombie is in the FULL tier."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLODFullDistance(
+	TEXT("zombie.LOD.FullDistance"),
+	3000.f,
+	TEXT("The distance from the closest player within which zombies are in the FULL tier."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLODDormantDistance(
+	TEXT("zombie.LOD.DormantDistance"),
+	8000.f,
+	TEXT("The distance from the closest player past which zombies are in the DORMANT tier."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLODHysteresis(
+	TEXT("zombie.LOD.Hysteresis"),
+	0.15f,
+	TEXT("How far past a tier's distance, as a fraction of it, a zombie has to be before it drops to a lower tier."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLODOffScreenScale(
+	TEXT("zombie.LOD.OffScreenScale"),
+	2.f,
+	TEXT("How much further away zombies that no player is looking towards are treated as being."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLODReducedTickInterval(
+	TEXT("zombie.LOD.ReducedTickInterval"),
+	0.2f,
+	TEXT("The tick interval, in seconds, of zombies in the REDUCED tier."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLODUpdateInterval(
+	TEXT("zombie.LOD.UpdateInterval"),
+	0.25f,
+	TEXT("The number of seconds between level of detail updates."),
+	ECVF_Default);
+
+// The cosine of the half angle of the cone in front of a player that counts as on screen.
+static const float OnScreenCosine = 0.5f;
+
+/**
+ * Called when the world that owns the ZombieLODSubsystem is torn down.
+ */
+void UZombieLODSubsystem::Deinitialize()
+{
+	Viewpoints.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Picks the tier a ZombieCharacter should be in.
+ *
+ * @param CurrentTier The tier the ZombieCharacter is in now.
+ * @param Distance The distance to the closest player, scaled up if the ZombieCharacter is off screen.
+ * @param FullDistance The distance within which ZombieCharacters are in the FULL tier.
+ * @param DormantDistance The distance past which ZombieCharacters are in the DORMANT tier.
+ * @param Hysteresis How far past a distance, as a fraction of it, a ZombieCharacter has to be
+ * before it drops to a lower tier.
+ */
+ZombieLODTiers UZombieLODSubsystem::ChooseTier(ZombieLODTiers CurrentTier, float Distance, float FullDistance, float DormantDistance, float Hysteresis)
+{
+	// Moving up a tier happens as soon as the ZombieCharacter crosses the distance, moving down
+	// only once it's gone a bit further.
+	const float LeaveScale = 1.f + Hysteresis;
+
+	switch (CurrentTier)
+	{
+	case ZombieLODTiers::FULL:
+		if (Distance > DormantDistance * LeaveScale) return ZombieLODTiers::DORMANT;
+		if (Distance > FullDistance * LeaveScale) return ZombieLODTiers::REDUCED;
+		return ZombieLODTiers::FULL;
+	case ZombieLODTiers::REDUCED:
+		if (Distance < FullDistance) return ZombieLODTiers::FULL;
+		if (Distance > DormantDistance * LeaveScale) return ZombieLODTiers::DORMANT;
+		return ZombieLODTiers::REDUCED;
+	case ZombieLODTiers::DORMANT:
+		if (Distance < FullDistance) return ZombieLODTiers::FULL;
+		if (Distance < DormantDistance) return ZombieLODTiers::REDUCED;
+		return ZombieLODTiers::DORMANT;
+	}
+
+	return ZombieLODTiers::FULL;
+}
+
+/**
+ * Returns the number of ZombieCharacters in the tier.
+ */
+int32 UZombieLODSubsystem::CountInTier(ZombieLODTiers Tier) const
+{
+	const UWorld* World = GetWorld();
+	const UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return 0;
+
+	int32 Count = 0;
+
+	const TArray<ZombieLODTiers>& LODTiers = Crowd->GetLODTiers();
+	for (int32 Index = 0; Index < LODTiers.Num(); ++Index)
+	{
+		if (LODTiers[Index] == Tier && Crowd->GetCharacterAt(Index) != nullptr) Count++;
+	}
+
+	return Count;
+}
+
+/**
+ * Called every frame to move zombies between tiers.
+ */
+void UZombieLODSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::DECISION);
+
+	// The tiers don't have to react instantly so they're only updated every so often.
+	TimeUntilUpdate -= DeltaTime;
+	if (TimeUntilUpdate > 0.f) return;
+	TimeUntilUpdate = CVarZombieLODUpdateInterval.GetValueOnGameThread();
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return;
+
+	GatherViewpoints();
+
+	const bool bEnabled = CVarZombieLODEnabled.GetValueOnGameThread() != 0 && Viewpoints.Num() > 0;
+	const float FullDistance = CVarZombieLODFullDistance.GetValueOnGameThread();
+	const float DormantDistance = FMath::Max(CVarZombieLODDormantDistance.GetValueOnGameThread(), FullDistance);
+	const float Hysteresis = FMath::Max(CVarZombieLODHysteresis.GetValueOnGameThread(), 0.f);
+	const float ReducedTickInterval = CVarZombieLODReducedTickInterval.GetValueOnGameThread();
+
+	const TArray<ZombieStates>& States = Crowd->GetStates();
+	const TArray<ZombieLODTiers>& LODTiers = Crowd->GetLODTiers();
+
+	for (int32 Index = 0; Index < Crowd->GetNumSlots(); ++Index)
+	{
+		AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		AZombieAIController* Controller = Cast<AZombieAIController>(ZombieCharacter->GetController());
+		if (Controller == nullptr) continue;
+
+		const ZombieLODTiers OldTier = LODTiers[Index];
+
+		// Dead zombies keep their ZombieAIController until they're pooled, but a corpse has nothing
+		// to scale down. One that died outside of the FULL tier is put back in it once so that its
+		// death animation isn't frozen halfway, and is left alone after that.
+		if (States[Index] == ZombieStates::DEAD)
+		{
+			if (OldTier == ZombieLODTiers::FULL) continue;
+
+			Crowd->SetLODTier(Crowd->GetHandleAt(Index), ZombieLODTiers::FULL);
+			Controller->ApplyLODTier(OldTier, ZombieLODTiers::FULL, 0.f);
+			continue;
+		}
+
+		ZombieLODTiers NewTier = ZombieLODTiers::FULL;
+
+		// Zombies that are chasing or attacking are always close to a player so they're kept at
+		// full detail no matter where the player is looking.
+		if (bEnabled && States[Index] != ZombieStates::CHASE && States[Index] != ZombieStates::ATTACK)
+		{
+			NewTier = ChooseTier(OldTier, GetSignificanceDistance(ZombieCharacter->GetActorLocation()), FullDistance, DormantDistance, Hysteresis);
+		}
+
+		if (NewTier == OldTier) continue;
+
+		const FZombieHandle Handle = Crowd->GetHandleAt(Index);
+		Crowd->SetLODTier(Handle, NewTier);
+		Controller->ApplyLODTier(OldTier, NewTier, (NewTier == ZombieLODTiers::REDUCED) ? ReducedTickInterval : 0.f);
+	}
+}
+
+TStatId UZombieLODSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieLODSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Collects where every player is looking from.
+ */
+void UZombieLODSubsystem::GatherViewpoints()
+{
+	Viewpoints.Reset();
+
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		Viewpoints.Add(FZombieLODViewpoint{ ViewLocation, ViewRotation.Vector() });
+	}
+}
+
+/**
+ * Returns whether any player is looking towards the location and has nothing but other
+ * characters in the way. A dormant zombie that wakes up is only moved while no player can see
+ * where it is or where it would end up.
+ */
+bool UZombieLODSubsystem::CanAnyPlayerSee(const FVector& Location) const
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return false;
+
+	// Characters don't block the visibility channel, so only the level can hide the location.
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ZombieLODVisibility), false);
+	for (const FZombieLODViewpoint& Viewpoint : Viewpoints)
+	{
+		const FVector ToLocation = Location - Viewpoint.Location;
+		if (FVector::DotProduct(Viewpoint.Forward, ToLocation.GetSafeNormal()) < OnScreenCosine) continue;
+
+		if (!World->LineTraceTestByChannel(Viewpoint.Location, Location, ECC_Visibility, QueryParams)) return true;
+	}
+
+	return false;
+}
+
+/**
+ * Returns the distance from the ZombieCharacter to the closest player, scaled up if none of
+ * the players are looking towards it.
+ */
+float UZombieLODSubsystem::GetSignificanceDistance(const FVector& Location) const
+{
+	const float OffScreenScale = FMath::Max(CVarZombieLODOffScreenScale.GetValueOnGameThread(), 1.f);
+
+	float ClosestDistance = MAX_flt;
+	for (const FZombieLODViewpoint& Viewpoint : Viewpoints)
+	{
+		const FVector ToZombie = Location - Viewpoint.Location;
+		const float Distance = ToZombie.Size();
+		const bool bOnScreen = FVector::DotProduct(Viewpoint.Forward, ToZombie.GetSafeNormal()) >= OnScreenCosine;
+
+		ClosestDistance = FMath::Min(ClosestDistance, bOnScreen ? Distance : Distance * OffScreenScale);
+	}
+
+	return ClosestDistance;
+}
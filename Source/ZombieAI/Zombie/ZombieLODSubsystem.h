@@ -0,0 +1,89 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieLODSubsystem.generated.h"
+
+/**
+ * A point that the players are looking from.
+ */
+struct FZombieLODViewpoint
+{
+	FVector Location;
+	FVector Forward;
+};
+
+/**
+ * The ZombieLODSubsystem puts every ZombieCharacter in a level of detail tier based on how far
+ * it is from the closest player and whether it's in front of them. Zombies in the FULL tier
+ * behave normally, zombies in the REDUCED tier tick less often and look around less often, and
+ * zombies in the DORMANT tier stop moving and thinking altogether. A dormant zombie that wakes
+ * up is put somewhere random within its roam radius as if it had been roaming the whole time,
+ * unless a player can see it or that location.
+ *
+ * A zombie has to go a bit past a tier's distance before it drops to the next tier so that
+ * zombies near the edge don't keep flipping between tiers.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieLODSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieLODSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Picks the tier a ZombieCharacter should be in.
+	 *
+	 * @param CurrentTier The tier the ZombieCharacter is in now.
+	 * @param Distance The distance to the closest player, scaled up if the ZombieCharacter is off screen.
+	 * @param FullDistance The distance within which ZombieCharacters are in the FULL tier.
+	 * @param DormantDistance The distance past which ZombieCharacters are in the DORMANT tier.
+	 * @param Hysteresis How far past a distance, as a fraction of it, a ZombieCharacter has to be
+	 * before it drops to a lower tier.
+	 */
+	static ZombieLODTiers ChooseTier(ZombieLODTiers CurrentTier, float Distance, float FullDistance, float DormantDistance, float Hysteresis);
+
+	/**
+	 * Returns the number of ZombieCharacters in the tier.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieLOD)
+	int32 CountInTier(ZombieLODTiers Tier) const;
+
+	/**
+	 * Returns whether any player is looking towards the location and has nothing but other
+	 * characters in the way. A dormant zombie that wakes up is only moved while no player can see
+	 * where it is or where it would end up.
+	 */
+	bool CanAnyPlayerSee(const FVector& Location) const;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Collects where every player is looking from.
+	 */
+	void GatherViewpoints();
+
+	/**
+	 * Returns the distance from the ZombieCharacter to the closest player, scaled up if none of
+	 * the players are looking towards it.
+	 */
+	float GetSignificanceDistance(const FVector& Location) const;
+
+protected:
+	// Where every player is looking from, gathered on every update.
+	TArray<FZombieLODViewpoint> Viewpoints;
+
+	// The time left until the next update.
+	float TimeUntilUpdate = 0.f;
+};
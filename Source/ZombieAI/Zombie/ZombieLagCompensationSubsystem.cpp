@@ -0,0 +1,371 @@
+#include "ZombieLagCompensationSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieCrowdSubsystem.h"
+#include "../ZombieAIStats.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarZombieLagCompensationRecord(
+	TEXT("zombie.LagCompensation.Record"),
+	1,
+	TEXT("When the zombie pose history is recorded. 0 never, 1 on servers, 2 always."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLagCompensationHistorySeconds(
+	TEXT("zombie.LagCompensation.HistorySeconds"),
+	1.f,
+	TEXT("The number of seconds of zombie poses to keep for rewinding shots."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLagCompensationSampleRate(
+	TEXT("zombie.LagCompensation.SampleRate"),
+	30.f,
+	TEXT("The number of times per second the zombie poses are recorded. Shots between two frames are checked against the zombies moved part of the way from one to the other."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLagCompensationMaxRewind(
+	TEXT("zombie.LagCompensation.MaxRewind"),
+	0.5f,
+	TEXT("The most seconds a shot is rewound, so that clients with a very high latency can't hit zombies that have long since moved on."),
+	ECVF_Default);
+
+/**
+ * Called when the world that owns the ZombieLagCompensationSubsystem is torn down.
+ */
+void UZombieLagCompensationSubsystem::Deinitialize()
+{
+	History.Empty();
+	FrameTimes.Empty();
+	SlotGenerations.Empty();
+	SlotStartTimes.Empty();
+	CapsuleSizes.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Returns how far back a shot should be rewound, given the server time the client saw when
+ * it fired. It's never more than the history covers or than `zombie.LagCompensation.MaxRewind`.
+ *
+ * @param ClientTime The server world time on the client when it fired.
+ */
+float UZombieLagCompensationSubsystem::GetRewindSeconds(float ClientTime) const
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return 0.f;
+
+	// The client's idea of the server time comes from the game state, which reaches it as late
+	// as the zombies do, so the difference is how old the zombies on its screen were.
+	const float MaxRewind = FMath::Min(CVarZombieLagCompensationMaxRewind.GetValueOnGameThread(), GetRecordedSeconds());
+	return FMath::Clamp(World->GetTimeSeconds() - ClientTime, 0.f, FMath::Max(MaxRewind, 0.f));
+}
+
+/**
+ * Traces a sphere against the capsules of the live zombies where they were at the time.
+ *
+ * @param Start Where the trace starts.
+ * @param End Where the trace ends.
+ * @param Time The world time to put the zombies back to.
+ * @param Radius The radius of the sphere. 0 traces a line.
+ * @param OutHit The closest zombie along the trace.
+ *
+ * @return Whether a zombie was hit.
+ */
+bool UZombieLagCompensationSubsystem::RewindTrace(const FVector& Start, const FVector& End, float Time, float Radius, FZombieRewindHit& OutHit)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_RewindTrace);
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return false;
+
+	int32 OlderFrame;
+	int32 NewerFrame;
+	float Alpha;
+	if (!FindFrames(Time, OlderFrame, NewerFrame, Alpha)) return false;
+
+	const FVector TraceMin = Start.ComponentMin(End);
+	const FVector TraceMax = Start.ComponentMax(End);
+	const FVector TraceDelta = End - Start;
+	const float TraceLengthSquared = TraceDelta.SizeSquared();
+
+	const TArray<ZombieStates>& States = Crowd->GetStates();
+	const int32 NumSlots = FMath::Min(Crowd->GetNumSlots(), SlotGenerations.Num());
+
+	OutHit = FZombieRewindHit();
+	bool bHit = false;
+
+	for (int32 Index = 0; Index < NumSlots; ++Index)
+	{
+		// Skip empty slots, dead zombies and zombies that weren't there yet.
+		if (SlotGenerations[Index] == INDEX_NONE || SlotGenerations[Index] != Crowd->GetHandleAt(Index).Generation) continue;
+		if (Crowd->GetCharacterAt(Index) == nullptr || States[Index] == ZombieStates::DEAD || Time < SlotStartTimes[Index]) continue;
+
+		const FVector Location = GetSlotLocation(Crowd, Index, OlderFrame, NewerFrame, Alpha);
+
+		// Throw out the zombies whose capsule is nowhere near the box around the trace before
+		// working out the distance to it.
+		const FVector2D& CapsuleSize = CapsuleSizes[Index];
+		const float HitRadius = CapsuleSize.X + Radius;
+		const FVector Extent(HitRadius, HitRadius, CapsuleSize.Y + Radius);
+		if (Location.X + Extent.X < TraceMin.X || Location.X - Extent.X > TraceMax.X) continue;
+		if (Location.Y + Extent.Y < TraceMin.Y || Location.Y - Extent.Y > TraceMax.Y) continue;
+		if (Location.Z + Extent.Z < TraceMin.Z || Location.Z - Extent.Z > TraceMax.Z) continue;
+
+		// The trace touches the capsule when it comes within the radius of the line between the
+		// centers of the capsule's two end spheres.
+		const FVector AxisOffset(0.f, 0.f, FMath::Max(CapsuleSize.Y - CapsuleSize.X, 0.f));
+		FVector OnTrace;
+		FVector OnAxis;
+		FMath::SegmentDistToSegmentSafe(Start, End, Location - AxisOffset, Location + AxisOffset, OnTrace, OnAxis);
+		if (FVector::DistSquared(OnTrace, OnAxis) > FMath::Square(HitRadius)) continue;
+
+		// Hits are ordered by where the trace passes closest to each capsule, which is close
+		// enough to where it goes in for the short steps of a bullet.
+		const float HitTime = (TraceLengthSquared > SMALL_NUMBER) ? FVector::DotProduct(OnTrace - Start, TraceDelta) / TraceLengthSquared : 0.f;
+		if (bHit && HitTime >= OutHit.Time) continue;
+
+		OutHit.Handle = Crowd->GetHandleAt(Index);
+		OutHit.Location = Location;
+		OutHit.Time = HitTime;
+		bHit = true;
+	}
+
+	return bHit;
+}
+
+/**
+ * Finds where the center of the zombie's capsule was at the time.
+ *
+ * @param Handle The zombie's slot in the ZombieCrowdSubsystem.
+ * @param Time The world time to put the zombie back to.
+ * @param OutLocation Where the center of the zombie's capsule was.
+ *
+ * @return Whether the zombie's history goes back to the time.
+ */
+bool UZombieLagCompensationSubsystem::GetRewoundLocation(const FZombieHandle& Handle, float Time, FVector& OutLocation)
+{
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr || !Crowd->IsValidHandle(Handle) || !SlotGenerations.IsValidIndex(Handle.Index)) return false;
+	if (SlotGenerations[Handle.Index] != Handle.Generation || Time < SlotStartTimes[Handle.Index]) return false;
+
+	int32 OlderFrame;
+	int32 NewerFrame;
+	float Alpha;
+	if (!FindFrames(Time, OlderFrame, NewerFrame, Alpha)) return false;
+
+	OutLocation = GetSlotLocation(Crowd, Handle.Index, OlderFrame, NewerFrame, Alpha);
+
+	return true;
+}
+
+/**
+ * Records the location of every zombie as the newest frame of the history. This happens
+ * on its own at `zombie.LagCompensation.SampleRate` while recording.
+ */
+void UZombieLagCompensationSubsystem::RecordPoses()
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_RecordPoses);
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return;
+
+	ResizeHistory();
+
+	const float Now = World->GetTimeSeconds();
+	const int32 NumSlots = Crowd->GetNumSlots();
+
+	// Slots are only ever added to the crowd, so new slots go on the end of the history.
+	if (SlotGenerations.Num() < NumSlots)
+	{
+		const int32 NumNewSlots = NumSlots - SlotGenerations.Num();
+		History.AddUninitialized(NumNewSlots * NumFrames);
+		SlotStartTimes.AddZeroed(NumNewSlots);
+		CapsuleSizes.AddZeroed(NumNewSlots);
+
+		while (SlotGenerations.Num() < NumSlots)
+		{
+			SlotGenerations.Add(INDEX_NONE);
+		}
+	}
+
+	NewestFrame = (NewestFrame + 1) % NumFrames;
+	NumRecordedFrames = FMath::Min(NumRecordedFrames + 1, NumFrames);
+	FrameTimes[NewestFrame] = Now;
+
+	for (int32 Index = 0; Index < NumSlots; ++Index)
+	{
+		const AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr)
+		{
+			SlotGenerations[Index] = INDEX_NONE;
+			continue;
+		}
+
+		FVector* SlotHistory = &History[Index * NumFrames];
+		const FVector Location = ZombieCharacter->GetActorLocation();
+
+		// A zombie that's new to the slot has no past, so its whole history is where it is now
+		// and `SlotStartTimes` keeps traces from before it arrived from seeing it.
+		const int32 Generation = Crowd->GetHandleAt(Index).Generation;
+		if (SlotGenerations[Index] != Generation)
+		{
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				SlotHistory[Frame] = Location;
+			}
+
+			const UCapsuleComponent* Capsule = ZombieCharacter->GetCapsuleComponent();
+			CapsuleSizes[Index] = FVector2D(Capsule->GetScaledCapsuleRadius(), Capsule->GetScaledCapsuleHalfHeight());
+			SlotGenerations[Index] = Generation;
+			SlotStartTimes[Index] = Now;
+		}
+
+		SlotHistory[NewestFrame] = Location;
+	}
+
+	SET_MEMORY_STAT(STAT_ZombieAI_PoseHistoryMemory, GetHistoryAllocatedSize());
+}
+
+/**
+ * Returns the number of bytes the history takes up.
+ */
+SIZE_T UZombieLagCompensationSubsystem::GetHistoryAllocatedSize() const
+{
+	return History.GetAllocatedSize() + FrameTimes.GetAllocatedSize() + SlotGenerations.GetAllocatedSize() + SlotStartTimes.GetAllocatedSize() + CapsuleSizes.GetAllocatedSize();
+}
+
+/**
+ * Returns the number of seconds the recorded frames cover.
+ */
+float UZombieLagCompensationSubsystem::GetRecordedSeconds() const
+{
+	if (NumRecordedFrames == 0) return 0.f;
+
+	const int32 OldestFrame = (NewestFrame - NumRecordedFrames + 1 + NumFrames) % NumFrames;
+	return FrameTimes[NewestFrame] - FrameTimes[OldestFrame];
+}
+
+/**
+ * Called every frame to record the zombies once enough time has passed since the last frame.
+ * Tickable objects tick after every actor, so the zombies have already moved this frame.
+ */
+void UZombieLagCompensationSubsystem::Tick(float DeltaTime)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || !ShouldRecord(World)) return;
+
+	ResizeHistory();
+
+	// A little slack keeps a server ticking at the sample rate from skipping every other tick.
+	if (NumRecordedFrames > 0 && World->GetTimeSeconds() - FrameTimes[NewestFrame] < SampleInterval * 0.9f) return;
+
+	RecordPoses();
+}
+
+TStatId UZombieLagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieLagCompensationSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Returns whether the history should be recorded in the world.
+ */
+bool UZombieLagCompensationSubsystem::ShouldRecord(const UWorld* World)
+{
+	switch (CVarZombieLagCompensationRecord.GetValueOnGameThread())
+	{
+	case 0:
+		return false;
+	case 1:
+		return World->GetNetMode() == NM_DedicatedServer || World->GetNetMode() == NM_ListenServer;
+	default:
+		return true;
+	}
+}
+
+/**
+ * Sizes the history for `zombie.LagCompensation.HistorySeconds` at
+ * `zombie.LagCompensation.SampleRate`, throwing the recorded frames away if that changed.
+ */
+void UZombieLagCompensationSubsystem::ResizeHistory()
+{
+	const float SampleRate = FMath::Max(CVarZombieLagCompensationSampleRate.GetValueOnGameThread(), 1.f);
+	const float HistorySeconds = FMath::Max(CVarZombieLagCompensationHistorySeconds.GetValueOnGameThread(), 0.f);
+
+	// One frame more than the seconds take up so that the oldest frame is a whole history ago.
+	const int32 NewNumFrames = FMath::CeilToInt(HistorySeconds * SampleRate) + 1;
+	SampleInterval = 1.f / SampleRate;
+	if (NewNumFrames == NumFrames) return;
+
+	NumFrames = NewNumFrames;
+	NewestFrame = INDEX_NONE;
+	NumRecordedFrames = 0;
+
+	FrameTimes.SetNumZeroed(NumFrames);
+	History.Empty();
+	SlotGenerations.Empty();
+	SlotStartTimes.Empty();
+	CapsuleSizes.Empty();
+}
+
+/**
+ * Finds the two frames the time is between.
+ *
+ * @param Time The world time to find.
+ * @param OutOlderFrame The frame at or before the time.
+ * @param OutNewerFrame The frame after the time, or INDEX_NONE if the time is after the newest
+ * frame and the zombies' current locations should be used instead.
+ * @param OutAlpha How far the time is from the older frame to the newer one.
+ *
+ * @return Whether anything has been recorded.
+ */
+bool UZombieLagCompensationSubsystem::FindFrames(float Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const
+{
+	if (NumRecordedFrames == 0) return false;
+
+	// Between the newest frame and now the zombies are moved toward where they are now.
+	const float NewestTime = FrameTimes[NewestFrame];
+	if (Time >= NewestTime)
+	{
+		const float Now = GetWorld()->GetTimeSeconds();
+		OutOlderFrame = NewestFrame;
+		OutNewerFrame = INDEX_NONE;
+		OutAlpha = (Now > NewestTime) ? FMath::Clamp((Time - NewestTime) / (Now - NewestTime), 0.f, 1.f) : 1.f;
+		return true;
+	}
+
+	for (int32 Age = 1; Age < NumRecordedFrames; ++Age)
+	{
+		const int32 Frame = (NewestFrame - Age + NumFrames) % NumFrames;
+		if (Time < FrameTimes[Frame]) continue;
+
+		const int32 NextFrame = (Frame + 1) % NumFrames;
+		OutOlderFrame = Frame;
+		OutNewerFrame = NextFrame;
+		OutAlpha = (Time - FrameTimes[Frame]) / FMath::Max(FrameTimes[NextFrame] - FrameTimes[Frame], SMALL_NUMBER);
+		return true;
+	}
+
+	// Times from before the history are clamped to the oldest frame.
+	OutOlderFrame = (NewestFrame - NumRecordedFrames + 1 + NumFrames) % NumFrames;
+	OutNewerFrame = OutOlderFrame;
+	OutAlpha = 0.f;
+
+	return true;
+}
+
+/**
+ * Returns where the center of the capsule of the zombie in the slot was, between the frames
+ * found by `FindFrames`.
+ */
+FVector UZombieLagCompensationSubsystem::GetSlotLocation(const UZombieCrowdSubsystem* Crowd, int32 Index, int32 OlderFrame, int32 NewerFrame, float Alpha) const
+{
+	const FVector* SlotHistory = &History[Index * NumFrames];
+	const FVector NewerLocation = (NewerFrame != INDEX_NONE) ? SlotHistory[NewerFrame] : Crowd->GetCharacterAt(Index)->GetActorLocation();
+
+	return FMath::Lerp(SlotHistory[OlderFrame], NewerLocation, Alpha);
+}
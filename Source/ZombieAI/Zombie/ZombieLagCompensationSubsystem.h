@@ -0,0 +1,167 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieHandle.h"
+#include "ZombieLagCompensationSubsystem.generated.h"
+
+class UZombieCrowdSubsystem;
+
+/**
+ * The zombie a rewound trace hit.
+ */
+struct FZombieRewindHit
+{
+	// The zombie's slot in the ZombieCrowdSubsystem.
+	FZombieHandle Handle;
+
+	// Where the center of the zombie's capsule was at the time the trace was rewound to.
+	FVector Location = FVector::ZeroVector;
+
+	// How far along the trace the hit is, from 0 at the start to 1 at the end.
+	float Time = 1.f;
+};
+
+/**
+ * The ZombieLagCompensationSubsystem lets a server check a client's shot against where the
+ * zombies were on that client's screen instead of where they are on the server, which is
+ * behind by the client's latency.
+ *
+ * A few dozen times a second it records the center of every zombie's capsule into a ring
+ * buffer covering about a second. Zombie capsules stay upright and are the same size for
+ * the zombie's whole life, so the center is all that's needed to put the capsule back, and
+ * each zombie's history is one contiguous block of locations that a trace reads from front
+ * to back. A new zombie in a slot of the ZombieCrowdSubsystem starts a new history, and
+ * traces rewound to before it arrived don't see it.
+ *
+ * It only records on servers. `zombie.LagCompensation.Record 2` records everywhere, which the
+ * ZombieLagCompensationBenchmarkCommandlet uses to measure the memory and trace cost.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieLagCompensationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieLagCompensationSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns how far back a shot should be rewound, given the server time the client saw when
+	 * it fired. It's never more than the history covers or than `zombie.LagCompensation.MaxRewind`.
+	 *
+	 * @param ClientTime The server world time on the client when it fired.
+	 */
+	float GetRewindSeconds(float ClientTime) const;
+
+	/**
+	 * Traces a sphere against the capsules of the live zombies where they were at the time.
+	 *
+	 * @param Start Where the trace starts.
+	 * @param End Where the trace ends.
+	 * @param Time The world time to put the zombies back to.
+	 * @param Radius The radius of the sphere. 0 traces a line.
+	 * @param OutHit The closest zombie along the trace.
+	 *
+	 * @return Whether a zombie was hit.
+	 */
+	bool RewindTrace(const FVector& Start, const FVector& End, float Time, float Radius, FZombieRewindHit& OutHit);
+
+	/**
+	 * Finds where the center of the zombie's capsule was at the time.
+	 *
+	 * @param Handle The zombie's slot in the ZombieCrowdSubsystem.
+	 * @param Time The world time to put the zombie back to.
+	 * @param OutLocation Where the center of the zombie's capsule was.
+	 *
+	 * @return Whether the zombie's history goes back to the time.
+	 */
+	bool GetRewoundLocation(const FZombieHandle& Handle, float Time, FVector& OutLocation);
+
+	/**
+	 * Records the location of every zombie as the newest frame of the history. This happens
+	 * on its own at `zombie.LagCompensation.SampleRate` while recording.
+	 */
+	void RecordPoses();
+
+	/**
+	 * Returns the number of bytes the history takes up.
+	 */
+	SIZE_T GetHistoryAllocatedSize() const;
+
+	/**
+	 * Returns the number of frames each zombie's history holds.
+	 */
+	int32 GetNumHistoryFrames() const { return NumFrames; }
+
+	/**
+	 * Returns the number of seconds the recorded frames cover.
+	 */
+	float GetRecordedSeconds() const;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Returns whether the history should be recorded in the world.
+	 */
+	static bool ShouldRecord(const UWorld* World);
+
+	/**
+	 * Sizes the history for `zombie.LagCompensation.HistorySeconds` at
+	 * `zombie.LagCompensation.SampleRate`, throwing the recorded frames away if that changed.
+	 */
+	void ResizeHistory();
+
+	/**
+	 * Finds the two frames the time is between.
+	 *
+	 * @param Time The world time to find.
+	 * @param OutOlderFrame The frame at or before the time.
+	 * @param OutNewerFrame The frame after the time, or INDEX_NONE if the time is after the newest
+	 * frame and the zombies' current locations should be used instead.
+	 * @param OutAlpha How far the time is from the older frame to the newer one.
+	 *
+	 * @return Whether anything has been recorded.
+	 */
+	bool FindFrames(float Time, int32& OutOlderFrame, int32& OutNewerFrame, float& OutAlpha) const;
+
+	/**
+	 * Returns where the center of the capsule of the zombie in the slot was, between the frames
+	 * found by `FindFrames`.
+	 */
+	FVector GetSlotLocation(const UZombieCrowdSubsystem* Crowd, int32 Index, int32 OlderFrame, int32 NewerFrame, float Alpha) const;
+
+protected:
+	// The location of every zombie in every frame. The frames of the zombie in a slot of the
+	// ZombieCrowdSubsystem are `NumFrames` locations in a row starting at `Index * NumFrames`.
+	TArray<FVector> History;
+
+	// The world time of every frame, shared by every zombie since they're recorded together.
+	TArray<float> FrameTimes;
+
+	// The generation of the slot that each zombie's history belongs to, or INDEX_NONE if the
+	// slot was empty in the newest frame.
+	TArray<int32> SlotGenerations;
+
+	// The world time the zombie in each slot was first recorded at.
+	TArray<float> SlotStartTimes;
+
+	// The radius and half height of the capsule of the zombie in each slot.
+	TArray<FVector2D> CapsuleSizes;
+
+	// The number of frames in the ring buffer and the time between them.
+	int32 NumFrames = 0;
+	float SampleInterval = 0.f;
+
+	// The frame that was recorded last and the number of frames that have been recorded.
+	int32 NewestFrame = INDEX_NONE;
+	int32 NumRecordedFrames = 0;
+};
@@ -0,0 +1,208 @@
+#include "ZombieLineOfSightSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarZombieLineOfSightAsync(
+	TEXT("zombie.LineOfSight.Async"),
+	1,
+	TEXT("Whether the ZombieSightSubsystem uses cached async traces from the ZombieLineOfSightSubsystem instead of synchronous traces."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieLineOfSightCacheFrames(
+	TEXT("zombie.LineOfSight.CacheFrames"),
+	4,
+	TEXT("The number of frames that a line of sight result is reused for."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieLineOfSightCellSize(
+	TEXT("zombie.LineOfSight.CellSize"),
+	100.f,
+	TEXT("The size of the grid cells that line of sight results are cached by. Bigger cells share more traces but are less accurate."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieLineOfSightMaxTracesPerFrame(
+	TEXT("zombie.LineOfSight.MaxTracesPerFrame"),
+	256,
+	TEXT("The number of async line of sight traces that are submitted per frame. The rest wait for the following frames."),
+	ECVF_Default);
+
+/**
+ * Called when the world that owns the ZombieLineOfSightSubsystem is torn down.
+ */
+void UZombieLineOfSightSubsystem::Deinitialize()
+{
+	Results.Empty();
+	QueuedTraces.Empty();
+	PendingTraces.Empty();
+	RequestedKeys.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Returns whether zombies should use the ZombieLineOfSightSubsystem instead of synchronous traces.
+ */
+bool UZombieLineOfSightSubsystem::IsAsyncLineOfSightEnabled()
+{
+	return CVarZombieLineOfSightAsync.GetValueOnGameThread() != 0;
+}
+
+/**
+ * Looks up whether nothing blocks the view between the two locations. If there's no recent
+ * enough result then a trace is queued and the result is available in a later frame.
+ *
+ * @param From The location to look from.
+ * @param To The location to look at.
+ * @param MaxAge How old, in seconds, a cached result can be and still be used.
+ * @param bOutVisible Whether nothing blocks the view, if a result was found.
+ *
+ * @return Whether a result was found.
+ */
+bool UZombieLineOfSightSubsystem::QueryLineOfSight(const FVector& From, const FVector& To, float MaxAge, bool& bOutVisible)
+{
+	const UWorld* World = GetWorld();
+	if (World == nullptr) return false;
+
+	const FZombieLineOfSightKey Key = { GetCell(From), GetCell(To) };
+
+	// A result is only used while it's younger than both the cache lifetime and the zombie's
+	// sight max age, so the cache never makes a zombie remember a PlayerCharacter for longer
+	// than its perception would have.
+	const FZombieLineOfSightResult* Result = Results.Find(Key);
+	if (Result != nullptr)
+	{
+		const uint64 CacheFrames = (uint64)FMath::Max(CVarZombieLineOfSightCacheFrames.GetValueOnGameThread(), 0);
+		if (GFrameCounter - Result->Frame <= CacheFrames && World->GetTimeSeconds() - Result->Time <= MaxAge)
+		{
+			CacheHitCount++;
+			bOutVisible = Result->bVisible;
+			return true;
+		}
+	}
+
+	CacheMissCount++;
+
+	// Only ask for the trace once no matter how many zombies in the same cell want it.
+	bool bAlreadyRequested = false;
+	RequestedKeys.Add(Key, &bAlreadyRequested);
+	if (bAlreadyRequested) return false;
+
+	FZombieLineOfSightTrace Trace;
+	Trace.Key = Key;
+	Trace.From = From;
+	Trace.To = To;
+	QueuedTraces.Add(Trace);
+
+	return false;
+}
+
+/**
+ * Called every frame to collect finished traces and submit queued ones.
+ */
+void UZombieLineOfSightSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::PERCEPTION);
+
+	LastFrameCacheHitCount = CacheHitCount;
+	LastFrameCacheMissCount = CacheMissCount;
+	CacheHitCount = 0;
+	CacheMissCount = 0;
+
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	CollectFinishedTraces(World);
+	EvictExpiredResults();
+	SubmitQueuedTraces(World);
+}
+
+TStatId UZombieLineOfSightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieLineOfSightSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Moves the results of the traces that have finished into the cache.
+ */
+void UZombieLineOfSightSubsystem::CollectFinishedTraces(UWorld* World)
+{
+	const uint64 Frame = GFrameCounter;
+	const float Time = World->GetTimeSeconds();
+
+	for (int32 TraceIndex = PendingTraces.Num() - 1; TraceIndex >= 0; --TraceIndex)
+	{
+		const FZombieLineOfSightTrace& Trace = PendingTraces[TraceIndex];
+
+		FTraceDatum TraceDatum;
+		if (World->QueryTraceData(Trace.Handle, TraceDatum))
+		{
+			FZombieLineOfSightResult& Result = Results.FindOrAdd(Trace.Key);
+			Result.bVisible = !TraceDatum.OutHits.ContainsByPredicate([](const FHitResult& Hit) { return Hit.bBlockingHit; });
+			Result.Frame = Frame;
+			Result.Time = Time;
+		}
+		else if (World->IsTraceHandleValid(Trace.Handle, false))
+		{
+			// Still running.
+			continue;
+		}
+
+		// The trace either finished or its data was thrown away, in which case the next query
+		// asks for it again.
+		RequestedKeys.Remove(Trace.Key);
+		PendingTraces.RemoveAtSwap(TraceIndex, 1, false);
+	}
+}
+
+/**
+ * Submits the queued traces, up to the per-frame limit.
+ */
+void UZombieLineOfSightSubsystem::SubmitQueuedTraces(UWorld* World)
+{
+	const int32 NumTraces = FMath::Min(QueuedTraces.Num(), FMath::Max(CVarZombieLineOfSightMaxTracesPerFrame.GetValueOnGameThread(), 0));
+	LastFrameTraceCount = NumTraces;
+	if (NumTraces == 0) return;
+
+	// Use the visibility channel like the sight sense does. Pawns ignore it, so neither the
+	// zombie nor the PlayerCharacter has to be ignored and the result holds for every zombie
+	// in the same cell.
+	static const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ZombieLineOfSight), true);
+
+	for (int32 TraceIndex = 0; TraceIndex < NumTraces; ++TraceIndex)
+	{
+		FZombieLineOfSightTrace& Trace = QueuedTraces[TraceIndex];
+		Trace.Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Test, Trace.From, Trace.To, ECC_Visibility, QueryParams);
+		PendingTraces.Add(Trace);
+	}
+
+	QueuedTraces.RemoveAt(0, NumTraces, false);
+}
+
+/**
+ * Removes the cached results that are too old to be used.
+ */
+void UZombieLineOfSightSubsystem::EvictExpiredResults()
+{
+	const uint64 CacheFrames = (uint64)FMath::Max(CVarZombieLineOfSightCacheFrames.GetValueOnGameThread(), 0);
+
+	for (auto It = Results.CreateIterator(); It; ++It)
+	{
+		if (GFrameCounter - It.Value().Frame > CacheFrames) It.RemoveCurrent();
+	}
+}
+
+/**
+ * Returns the grid cell that contains the location.
+ */
+FIntVector UZombieLineOfSightSubsystem::GetCell(const FVector& Location) const
+{
+	const float CellSize = FMath::Max(CVarZombieLineOfSightCellSize.GetValueOnGameThread(), 1.f);
+
+	return FIntVector(
+		FMath::FloorToInt(Location.X / CellSize),
+		FMath::FloorToInt(Location.Y / CellSize),
+		FMath::FloorToInt(Location.Z / CellSize)
+	);
+}
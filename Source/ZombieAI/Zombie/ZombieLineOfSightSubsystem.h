@@ -0,0 +1,163 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "WorldCollision.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieLineOfSightSubsystem.generated.h"
+
+/**
+ * Identifies a line of sight query by the grid cells that its two ends are in, so that zombies
+ * standing close together and looking at the same PlayerCharacter share one trace.
+ */
+struct FZombieLineOfSightKey
+{
+	// The cell that the trace starts in.
+	FIntVector FromCell;
+
+	// The cell that the trace ends in.
+	FIntVector ToCell;
+
+	bool operator==(const FZombieLineOfSightKey& Other) const { return FromCell == Other.FromCell && ToCell == Other.ToCell; }
+
+	friend uint32 GetTypeHash(const FZombieLineOfSightKey& Key) { return HashCombine(GetTypeHash(Key.FromCell), GetTypeHash(Key.ToCell)); }
+};
+
+/**
+ * The result of a line of sight trace that has finished.
+ */
+struct FZombieLineOfSightResult
+{
+	// Whether nothing blocked the trace.
+	bool bVisible = false;
+
+	// The frame that the result came in.
+	uint64 Frame = 0;
+
+	// The world time that the result came in.
+	float Time = 0.f;
+};
+
+/**
+ * A line of sight trace that's waiting to be submitted or to finish.
+ */
+struct FZombieLineOfSightTrace
+{
+	// The key that the result will be cached under.
+	FZombieLineOfSightKey Key;
+
+	// Where the trace starts and ends.
+	FVector From;
+	FVector To;
+
+	// The handle of the async trace once it's been submitted.
+	FTraceHandle Handle;
+};
+
+/**
+ * The ZombieLineOfSightSubsystem answers whether a zombie can see a location without doing a
+ * synchronous trace. Queries are answered from results cached for a few frames by grid cell,
+ * and queries that miss the cache are deduplicated and submitted as async visibility traces in
+ * batches once per frame. Their results are picked up on a later frame.
+ *
+ * The number of frames results are kept for is set with `zombie.LineOfSight.CacheFrames` and the
+ * number of traces submitted per frame with `zombie.LineOfSight.MaxTracesPerFrame`.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieLineOfSightSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieLineOfSightSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns whether zombies should use the ZombieLineOfSightSubsystem instead of synchronous traces.
+	 */
+	static bool IsAsyncLineOfSightEnabled();
+
+	/**
+	 * Looks up whether nothing blocks the view between the two locations. If there's no recent
+	 * enough result then a trace is queued and the result is available in a later frame.
+	 *
+	 * @param From The location to look from.
+	 * @param To The location to look at.
+	 * @param MaxAge How old, in seconds, a cached result can be and still be used.
+	 * @param bOutVisible Whether nothing blocks the view, if a result was found.
+	 *
+	 * @return Whether a result was found.
+	 */
+	bool QueryLineOfSight(const FVector& From, const FVector& To, float MaxAge, bool& bOutVisible);
+
+	/**
+	 * Returns the number of queries that were answered from the cache in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieLineOfSight)
+	int32 GetLastFrameCacheHitCount() const { return LastFrameCacheHitCount; }
+
+	/**
+	 * Returns the number of queries that missed the cache in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieLineOfSight)
+	int32 GetLastFrameCacheMissCount() const { return LastFrameCacheMissCount; }
+
+	/**
+	 * Returns the number of traces that were submitted in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieLineOfSight)
+	int32 GetLastFrameTraceCount() const { return LastFrameTraceCount; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Moves the results of the traces that have finished into the cache.
+	 */
+	void CollectFinishedTraces(UWorld* World);
+
+	/**
+	 * Submits the queued traces, up to the per-frame limit.
+	 */
+	void SubmitQueuedTraces(UWorld* World);
+
+	/**
+	 * Removes the cached results that are too old to be used.
+	 */
+	void EvictExpiredResults();
+
+	/**
+	 * Returns the grid cell that contains the location.
+	 */
+	FIntVector GetCell(const FVector& Location) const;
+
+protected:
+	// The results of the traces that have finished.
+	TMap<FZombieLineOfSightKey, FZombieLineOfSightResult> Results;
+
+	// The traces that have been asked for but not submitted yet.
+	TArray<FZombieLineOfSightTrace> QueuedTraces;
+
+	// The traces that have been submitted and haven't finished yet.
+	TArray<FZombieLineOfSightTrace> PendingTraces;
+
+	// The keys of every queued or pending trace so that the same trace isn't asked for twice.
+	TSet<FZombieLineOfSightKey> RequestedKeys;
+
+	// The number of queries answered from the cache and the number that missed it this frame.
+	int32 CacheHitCount = 0;
+	int32 CacheMissCount = 0;
+
+	// The number of queries answered from the cache and the number that missed it in the last frame.
+	int32 LastFrameCacheHitCount = 0;
+	int32 LastFrameCacheMissCount = 0;
+
+	// The number of traces that were submitted in the last frame.
+	int32 LastFrameTraceCount = 0;
+};
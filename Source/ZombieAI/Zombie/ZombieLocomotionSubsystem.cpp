@@ -0,0 +1,470 @@
+#include "ZombieLocomotionSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieCrowdSubsystem.h"
+#include "ZombieMovementComponent.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "NavigationSystem.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "Components/CapsuleComponent.h"
+
+static TAutoConsoleVariable<int32> CVarZombieSteeringEnabled(
+	TEXT("zombie.Steering.Enabled"),
+	1,
+	TEXT("Whether zombies keep apart by crowd steering (1) or by capsule collisions with each other (0)."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieSteeringRadius(
+	TEXT("zombie.Steering.Radius"),
+	90.f,
+	TEXT("The distance that zombies try to keep between each other."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieSteeringStrength(
+	TEXT("zombie.Steering.Strength"),
+	0.75f,
+	TEXT("The largest steering velocity as a fraction of a zombie's max speed."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieSteeringLookAhead(
+	TEXT("zombie.Steering.LookAhead"),
+	0.5f,
+	TEXT("The number of seconds ahead that zombies look for neighbours they're about to run into."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieSteeringMaxNeighbours(
+	TEXT("zombie.Steering.MaxNeighbours"),
+	8,
+	TEXT("The number of neighbours a zombie steers away from in one frame."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieMovementSimple(
+	TEXT("zombie.Movement.Simple"),
+	1,
+	TEXT("Whether walking zombies are moved in one batch along the navmesh (1) or by their own CharacterMovementComponent (0)."),
+	ECVF_Default);
+
+// The height of a navmesh cell, for navigation data that isn't a recast navmesh.
+static const float DefaultNavCellHeight = 10.f;
+
+// The names of the collision profiles the zombies' capsules use with and without crowd steering.
+static const FName ZombieProfileName(TEXT("Zombie"));
+static const FName PawnProfileName(TEXT("Pawn"));
+
+/**
+ * Called when the world that owns the ZombieLocomotionSubsystem is torn down.
+ */
+void UZombieLocomotionSubsystem::Deinitialize()
+{
+	AgentSlots.Empty();
+	AgentMovements.Empty();
+	AgentLocations.Empty();
+	AgentVelocities.Empty();
+	AgentMaxSpeeds.Empty();
+	AgentSteering.Empty();
+	SortedAgents.Empty();
+	AgentCells.Empty();
+	CellRanges.Empty();
+
+	Moves.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Returns whether zombies should keep apart by crowd steering instead of capsule collisions.
+ */
+bool UZombieLocomotionSubsystem::IsSteeringEnabled()
+{
+	return CVarZombieSteeringEnabled.GetValueOnGameThread() != 0;
+}
+
+/**
+ * Returns whether walking zombies should be moved in one batch along the navmesh instead of by
+ * their own CharacterMovementComponent.
+ */
+bool UZombieLocomotionSubsystem::IsSimpleMovementEnabled()
+{
+	return CVarZombieMovementSimple.GetValueOnGameThread() != 0;
+}
+
+/**
+ * Called every frame to work out the steering of every moving zombie and to move the ones
+ * using the simplified movement, each in one batch.
+ */
+void UZombieLocomotionSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::MOVEMENT);
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return;
+
+	const bool bSteering = IsSteeringEnabled();
+	if (bSteering != bWasSteeringEnabled)
+	{
+		ApplyCollisionProfiles(Crowd, bSteering);
+		bWasSteeringEnabled = bSteering;
+	}
+
+	// Only the server moves zombies. Clients get their movement replicated and smoothed by the
+	// full CharacterMovementComponent.
+	if (World->GetNetMode() == NM_Client)
+	{
+		AgentSlots.Reset();
+		AgentMovements.Reset();
+		Moves.Reset();
+		return;
+	}
+
+	if (bSteering)
+	{
+		SteerAgents(Crowd);
+	}
+	else
+	{
+		AgentSlots.Reset();
+		AgentMovements.Reset();
+	}
+
+	if (IsSimpleMovementEnabled())
+	{
+		MoveAgents(Crowd);
+	}
+	else
+	{
+		Moves.Reset();
+	}
+}
+
+TStatId UZombieLocomotionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieLocomotionSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Works out the steering of every moving zombie in one batch and hands it to their
+ * ZombieMovementComponents.
+ */
+void UZombieLocomotionSubsystem::SteerAgents(UZombieCrowdSubsystem* Crowd)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Steering);
+
+	GatherAgents(Crowd);
+
+	const int32 NumAgents = AgentSlots.Num();
+	if (NumAgents == 0) return;
+
+	const float Radius = FMath::Max(CVarZombieSteeringRadius.GetValueOnGameThread(), 1.f);
+	const float LookAhead = FMath::Max(CVarZombieSteeringLookAhead.GetValueOnGameThread(), 0.f);
+	const float Strength = FMath::Max(CVarZombieSteeringStrength.GetValueOnGameThread(), 0.f);
+	const int32 MaxNeighbours = FMath::Max(CVarZombieSteeringMaxNeighbours.GetValueOnGameThread(), 1);
+
+	// Neighbours up to twice the radius away are looked at so that ones closing in are seen
+	// before they're too close, and the cells are that size so only the 3x3 cells around an
+	// agent need to be searched.
+	BuildGrid(Radius * 2.f);
+
+	// Every agent only reads the shared arrays and writes its own steering so the agents can be
+	// solved on the task graph without any locking.
+	AgentSteering.SetNum(NumAgents, false);
+	ParallelFor(NumAgents, [this, Radius, LookAhead, Strength, MaxNeighbours](int32 AgentIndex)
+	{
+		const FVector Push = SolveAgent(AgentIndex, Radius, LookAhead, MaxNeighbours);
+		const float MaxSteering = AgentMaxSpeeds[AgentIndex] * Strength;
+		AgentSteering[AgentIndex] = (Push * MaxSteering).GetClampedToMaxSize(MaxSteering);
+	});
+
+	// Hand the steering back to the movement components on the game thread.
+	for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+	{
+		AgentMovements[AgentIndex]->SetSteeringVelocity(AgentSteering[AgentIndex]);
+	}
+}
+
+/**
+ * Moves every zombie that's using the simplified movement in one batch. The new velocities,
+ * locations and rotations are worked out on the task graph and then kept on the navmesh on
+ * the game thread.
+ */
+void UZombieLocomotionSubsystem::MoveAgents(UZombieCrowdSubsystem* Crowd)
+{
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_SimpleMovement);
+
+	UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavigationSystem == nullptr) return;
+
+	Moves.Reset();
+	for (int32 Index = 0; Index < Crowd->GetNumSlots(); ++Index)
+	{
+		AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		UZombieMovementComponent* Movement = Cast<UZombieMovementComponent>(ZombieCharacter->GetCharacterMovement());
+		if (Movement == nullptr || !Movement->CanUseSimpleMovement()) continue;
+
+		// Only zombies whose movement ticked since the last move are moved, which leaves out the
+		// dormant ones and the ones waiting out their tick interval.
+		float MoveTime = 0.f;
+		const FVector DesiredVelocity = Movement->ConsumeSimpleMove(MoveTime);
+		if (MoveTime <= 0.f) continue;
+
+		FZombieSimpleMove& Move = Moves.AddDefaulted_GetRef();
+		Move.Movement = Movement;
+		Move.DeltaTime = MoveTime;
+		Move.DesiredVelocity = DesiredVelocity;
+		Move.Velocity = Movement->Velocity;
+		Move.SteeringVelocity = Movement->GetSteeringVelocity();
+		Move.Location = ZombieCharacter->GetActorLocation();
+		Move.Rotation = ZombieCharacter->GetActorRotation();
+		Move.MaxSpeed = Movement->GetMaxSpeed();
+		Move.MaxAcceleration = Movement->GetMaxAcceleration();
+		Move.BrakingDeceleration = Movement->GetMaxBrakingDeceleration();
+		Move.YawRate = Movement->bOrientRotationToMovement ? Movement->RotationRate.Yaw : 0.f;
+	}
+
+	if (Moves.Num() == 0) return;
+
+	// Every move only reads and writes its own entry so they can all be done on the task graph.
+	ParallelFor(Moves.Num(), [this](int32 MoveIndex)
+	{
+		StepMove(Moves[MoveIndex]);
+	});
+
+	for (const FZombieSimpleMove& Move : Moves)
+	{
+		const ACharacter* CharacterOwner = Move.Movement->GetCharacterOwner();
+		const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
+		const float HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+		const float Radius = Capsule->GetScaledCapsuleRadius();
+
+		// Put the feet back on the navmesh instead of looking for the floor. The navmesh already
+		// keeps clear of walls and only covers floors the zombie can stand on, so this does the
+		// job of the capsule sweeps for a zombie that stays on it.
+		const ANavigationData* NavData = NavigationSystem->GetNavDataForProps(Move.Movement->GetNavAgentPropertiesRef());
+		const FVector FeetLocation = Move.NewLocation - FVector(0.f, 0.f, HalfHeight);
+		const FVector QueryExtent(Radius, Radius, Move.Movement->MaxStepHeight + HalfHeight);
+
+		FNavLocation NavLocation;
+		if (NavData == nullptr || !NavData->ProjectPoint(FeetLocation, NavLocation, QueryExtent))
+		{
+			Move.Movement->BlockSimpleMovement();
+			continue;
+		}
+
+		// The navmesh is only within a cell height of the real floor, and on stairs and slopes it
+		// can be a lot further off, so a zombie whose navmesh height jumped by more than that
+		// looks for the floor itself instead of floating above it or sinking into it.
+		const ARecastNavMesh* NavMesh = Cast<ARecastNavMesh>(NavData);
+		const float CellHeight = (NavMesh != nullptr) ? NavMesh->CellHeight : DefaultNavCellHeight;
+
+		FVector NewFeetLocation = NavLocation.Location;
+		float FloorZ = 0.f;
+		if (FMath::Abs(NavLocation.Location.Z - FeetLocation.Z) > CellHeight && Move.Movement->TraceSimpleMoveFloor(NavLocation.Location, FloorZ))
+		{
+			NewFeetLocation.Z = FloorZ;
+		}
+
+		Move.Movement->ApplySimpleMove(NewFeetLocation + FVector(0.f, 0.f, HalfHeight), Move.Rotation, Move.NewVelocity);
+	}
+}
+
+/**
+ * Works out the new velocity, location and rotation of a zombie the same way the
+ * CharacterMovementComponent does when walking: the velocity speeds up or brakes towards the
+ * velocity that was asked for, the steering is added on top, and the zombie turns to face the
+ * way it wants to go at its rotation rate.
+ */
+void UZombieLocomotionSubsystem::StepMove(FZombieSimpleMove& Move)
+{
+	const bool bAccelerating = !Move.DesiredVelocity.IsNearlyZero();
+	const float Rate = bAccelerating ? Move.MaxAcceleration : Move.BrakingDeceleration;
+
+	FVector Velocity = FMath::VInterpConstantTo(FVector(Move.Velocity.X, Move.Velocity.Y, 0.f), Move.DesiredVelocity, Move.DeltaTime, Rate);
+	if (!Move.SteeringVelocity.IsZero()) Velocity = (Velocity + Move.SteeringVelocity).GetClampedToMaxSize(Move.MaxSpeed);
+	Velocity.Z = 0.f;
+
+	Move.NewVelocity = Velocity;
+	Move.NewLocation = Move.Location + Velocity * Move.DeltaTime;
+
+	if (bAccelerating && Move.YawRate > 0.f)
+	{
+		const float TargetYaw = Move.DesiredVelocity.Rotation().Yaw;
+		Move.Rotation.Yaw = FMath::FixedTurn(Move.Rotation.Yaw, TargetYaw, Move.YawRate * Move.DeltaTime);
+	}
+}
+
+/**
+ * Copies the location and velocity of every zombie that's moving into the agent arrays and
+ * clears the steering of the ones that aren't.
+ */
+void UZombieLocomotionSubsystem::GatherAgents(UZombieCrowdSubsystem* Crowd)
+{
+	const TArray<ZombieStates>& States = Crowd->GetStates();
+	const TArray<ZombieLODTiers>& LODTiers = Crowd->GetLODTiers();
+
+	AgentSlots.Reset();
+	AgentMovements.Reset();
+	AgentLocations.Reset();
+	AgentVelocities.Reset();
+	AgentMaxSpeeds.Reset();
+
+	for (int32 Index = 0; Index < Crowd->GetNumSlots(); ++Index)
+	{
+		AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		UZombieMovementComponent* Movement = Cast<UZombieMovementComponent>(ZombieCharacter->GetCharacterMovement());
+		if (Movement == nullptr) continue;
+
+		// Dead and dormant zombies don't move so they're neither steered nor steered around.
+		if (States[Index] == ZombieStates::DEAD || LODTiers[Index] == ZombieLODTiers::DORMANT)
+		{
+			Movement->SetSteeringVelocity(FVector::ZeroVector);
+			continue;
+		}
+
+		AgentSlots.Add(Index);
+		AgentMovements.Add(Movement);
+		AgentLocations.Add(ZombieCharacter->GetActorLocation());
+		AgentVelocities.Add(Movement->Velocity);
+		AgentMaxSpeeds.Add(Movement->GetMaxSpeed());
+	}
+}
+
+/**
+ * Sorts the agents into the cells of the neighbour grid.
+ */
+void UZombieLocomotionSubsystem::BuildGrid(float CellSize)
+{
+	const int32 NumAgents = AgentSlots.Num();
+
+	AgentCells.SetNum(NumAgents, false);
+	SortedAgents.SetNum(NumAgents, false);
+	for (int32 AgentIndex = 0; AgentIndex < NumAgents; ++AgentIndex)
+	{
+		AgentCells[AgentIndex] = GetCell(AgentLocations[AgentIndex], CellSize);
+		SortedAgents[AgentIndex] = AgentIndex;
+	}
+
+	// Sorting keeps the agents of a cell next to each other so that every cell is just a range
+	// of the sorted array.
+	SortedAgents.Sort([this](int32 A, int32 B)
+	{
+		const FIntPoint& CellA = AgentCells[A];
+		const FIntPoint& CellB = AgentCells[B];
+		return CellA.X != CellB.X ? CellA.X < CellB.X : CellA.Y < CellB.Y;
+	});
+
+	CellRanges.Reset();
+	for (int32 SortedIndex = 0; SortedIndex < NumAgents; ++SortedIndex)
+	{
+		const FIntPoint& Cell = AgentCells[SortedAgents[SortedIndex]];
+		FIntPoint* Range = CellRanges.Find(Cell);
+		if (Range != nullptr) Range->Y++;
+		else CellRanges.Add(Cell, FIntPoint(SortedIndex, 1));
+	}
+}
+
+/**
+ * Works out the steering velocity of the agent from the neighbours around it.
+ *
+ * The agent is pushed away from every neighbour inside the radius, harder the closer it is,
+ * and also away from where every neighbour will be at their closest approach within the look
+ * ahead time. The second push is what makes zombies turn aside before they bump into each other
+ * instead of after. The result is a direction scaled from 0 to 1.
+ */
+FVector UZombieLocomotionSubsystem::SolveAgent(int32 AgentIndex, float Radius, float LookAhead, int32 MaxNeighbours) const
+{
+	const FVector& Location = AgentLocations[AgentIndex];
+	const FVector& Velocity = AgentVelocities[AgentIndex];
+	const FIntPoint& Cell = AgentCells[AgentIndex];
+
+	FVector Push = FVector::ZeroVector;
+	int32 NumNeighbours = 0;
+
+	for (int32 OffsetY = -1; OffsetY <= 1; ++OffsetY)
+	{
+		for (int32 OffsetX = -1; OffsetX <= 1; ++OffsetX)
+		{
+			const FIntPoint* Range = CellRanges.Find(Cell + FIntPoint(OffsetX, OffsetY));
+			if (Range == nullptr) continue;
+
+			for (int32 SortedIndex = Range->X; SortedIndex < Range->X + Range->Y; ++SortedIndex)
+			{
+				const int32 OtherIndex = SortedAgents[SortedIndex];
+				if (OtherIndex == AgentIndex) continue;
+
+				// Zombies on another floor aren't in the way.
+				const FVector& OtherLocation = AgentLocations[OtherIndex];
+				if (FMath::Abs(OtherLocation.Z - Location.Z) > Radius) continue;
+
+				const FVector ToOther(OtherLocation.X - Location.X, OtherLocation.Y - Location.Y, 0.f);
+				const float Distance = ToOther.Size();
+				if (Distance >= Radius * 2.f) continue;
+
+				// Two zombies on the exact same spot are split apart in a direction based on
+				// their index so that they don't both pick the same way.
+				if (Distance < KINDA_SMALL_NUMBER)
+				{
+					const float Angle = AgentIndex * 2.399963f;
+					Push += FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+				}
+				else if (Distance < Radius)
+				{
+					Push -= ToOther / Distance * (1.f - Distance / Radius);
+				}
+
+				// Find where the neighbour will be relative to the agent when they're closest.
+				const FVector RelativeVelocity = AgentVelocities[OtherIndex] - Velocity;
+				const float RelativeSpeedSquared = RelativeVelocity.SizeSquared2D();
+				if (RelativeSpeedSquared > KINDA_SMALL_NUMBER && LookAhead > 0.f)
+				{
+					const float TimeToClosest = FMath::Clamp(-(ToOther | RelativeVelocity) / RelativeSpeedSquared, 0.f, LookAhead);
+					const FVector Closest(ToOther.X + RelativeVelocity.X * TimeToClosest, ToOther.Y + RelativeVelocity.Y * TimeToClosest, 0.f);
+					const float ClosestDistance = Closest.Size();
+
+					// Near collisions that are further off in time are pushed away from less.
+					if (ClosestDistance > KINDA_SMALL_NUMBER && ClosestDistance < Radius)
+					{
+						const float Urgency = 1.f - TimeToClosest / LookAhead;
+						Push -= Closest / ClosestDistance * (1.f - ClosestDistance / Radius) * Urgency;
+					}
+				}
+
+				if (++NumNeighbours >= MaxNeighbours) return Push.GetClampedToMaxSize(1.f);
+			}
+		}
+	}
+
+	return Push.GetClampedToMaxSize(1.f);
+}
+
+/**
+ * Switches the capsules of every zombie between the "Zombie" and "Pawn" collision profiles.
+ */
+void UZombieLocomotionSubsystem::ApplyCollisionProfiles(UZombieCrowdSubsystem* Crowd, bool bSteering)
+{
+	for (int32 Index = 0; Index < Crowd->GetNumSlots(); ++Index)
+	{
+		AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		ZombieCharacter->GetCapsuleComponent()->SetCollisionProfileName(bSteering ? ZombieProfileName : PawnProfileName);
+
+		// Clear what the last frame handed out so that nobody keeps drifting once steering is off.
+		UZombieMovementComponent* Movement = Cast<UZombieMovementComponent>(ZombieCharacter->GetCharacterMovement());
+		if (Movement != nullptr && !bSteering) Movement->SetSteeringVelocity(FVector::ZeroVector);
+	}
+}
+
+/**
+ * Returns the grid cell that contains the location.
+ */
+FIntPoint UZombieLocomotionSubsystem::GetCell(const FVector& Location, float CellSize) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieLocomotionSubsystem.generated.h"
+
+/**
+ * One zombie's simplified move for a frame, with everything the move needs copied out of its
+ * ZombieMovementComponent so that the move can be done off the game thread.
+ */
+struct FZombieSimpleMove
+{
+	// The movement component of the zombie.
+	class UZombieMovementComponent* Movement = nullptr;
+
+	// The amount of time to move for.
+	float DeltaTime = 0.f;
+
+	// The velocity the zombie wants to move at, its current velocity and its steering velocity.
+	FVector DesiredVelocity = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	FVector SteeringVelocity = FVector::ZeroVector;
+
+	// The location of the zombie, and its rotation which is turned in place by the move.
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	// The movement settings of the zombie.
+	float MaxSpeed = 0.f;
+	float MaxAcceleration = 0.f;
+	float BrakingDeceleration = 0.f;
+
+	// How fast the zombie turns to face the way it's going, or 0 if it doesn't.
+	float YawRate = 0.f;
+
+	// The location and velocity of the zombie after the move.
+	FVector NewLocation = FVector::ZeroVector;
+	FVector NewVelocity = FVector::ZeroVector;
+};
+
+/**
+ * The ZombieLocomotionSubsystem keeps the zombies of a horde apart with crowd steering instead of
+ * capsule collisions. Every frame it puts all the moving zombies into one shared grid and works
+ * out, in a single batch spread over the worker threads, how each zombie should steer away from
+ * the neighbours it's about to run into. The result is handed to each zombie's
+ * ZombieMovementComponent and added to its velocity.
+ *
+ * While crowd steering is on the zombies' capsules use the "Zombie" collision profile, which
+ * doesn't block other zombies, so a horde crowding one player no longer spends its movement
+ * sweeps hitting and sliding off each other.
+ *
+ * It also moves every walking zombie in one batch when `zombie.Movement.Simple` is on. Instead of
+ * every ZombieMovementComponent doing its full move, the new locations are worked out on the task
+ * graph and then projected onto the navmesh. Each zombie then does one capsule sweep for whatever
+ * is in its way, and only looks for the floor when the navmesh height under it jumps.
+ *
+ * Crowd steering is turned on and off with `zombie.Steering.Enabled`.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieLocomotionSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieLocomotionSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns whether zombies should keep apart by crowd steering instead of capsule collisions.
+	 */
+	static bool IsSteeringEnabled();
+
+	/**
+	 * Returns whether walking zombies should be moved in one batch along the navmesh instead of by
+	 * their own CharacterMovementComponent.
+	 */
+	static bool IsSimpleMovementEnabled();
+
+	/**
+	 * Returns the number of zombies that were steered in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieLocomotion)
+	int32 GetLastFrameAgentCount() const { return AgentSlots.Num(); }
+
+	/**
+	 * Returns the number of zombies that were moved by the batched update in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieLocomotion)
+	int32 GetLastFrameMoveCount() const { return Moves.Num(); }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Works out the steering of every moving zombie in one batch and hands it to their
+	 * ZombieMovementComponents.
+	 */
+	void SteerAgents(class UZombieCrowdSubsystem* Crowd);
+
+	/**
+	 * Moves every zombie that's using the simplified movement in one batch. The new velocities,
+	 * locations and rotations are worked out on the task graph and then kept on the navmesh on
+	 * the game thread.
+	 */
+	void MoveAgents(class UZombieCrowdSubsystem* Crowd);
+
+	/**
+	 * Works out the new velocity, location and rotation of a zombie the same way the
+	 * CharacterMovementComponent does when walking: the velocity speeds up or brakes towards the
+	 * velocity that was asked for, the steering is added on top, and the zombie turns to face the
+	 * way it wants to go at its rotation rate.
+	 */
+	static void StepMove(FZombieSimpleMove& Move);
+
+	/**
+	 * Copies the location and velocity of every zombie that's moving into the agent arrays and
+	 * clears the steering of the ones that aren't.
+	 */
+	void GatherAgents(class UZombieCrowdSubsystem* Crowd);
+
+	/**
+	 * Sorts the agents into the cells of the neighbour grid.
+	 */
+	void BuildGrid(float CellSize);
+
+	/**
+	 * Works out the steering velocity of the agent from the neighbours around it.
+	 *
+	 * The agent is pushed away from every neighbour inside the radius, harder the closer it is,
+	 * and also away from where every neighbour will be at their closest approach within the look
+	 * ahead time. The second push is what makes zombies turn aside before they bump into each other
+	 * instead of after. The result is a direction scaled from 0 to 1.
+	 */
+	FVector SolveAgent(int32 AgentIndex, float Radius, float LookAhead, int32 MaxNeighbours) const;
+
+	/**
+	 * Switches the capsules of every zombie between the "Zombie" and "Pawn" collision profiles.
+	 */
+	void ApplyCollisionProfiles(class UZombieCrowdSubsystem* Crowd, bool bSteering);
+
+	/**
+	 * Returns the grid cell that contains the location.
+	 */
+	FIntPoint GetCell(const FVector& Location, float CellSize) const;
+
+protected:
+	// The crowd slot, movement component, location and velocity of every zombie being steered.
+	TArray<int32> AgentSlots;
+	TArray<class UZombieMovementComponent*> AgentMovements;
+	TArray<FVector> AgentLocations;
+	TArray<FVector> AgentVelocities;
+
+	// The max speed of every zombie being steered.
+	TArray<float> AgentMaxSpeeds;
+
+	// The steering velocity worked out for every zombie being steered.
+	TArray<FVector> AgentSteering;
+
+	// The agents sorted by the grid cell they're in.
+	TArray<int32> SortedAgents;
+
+	// The grid cell of every agent.
+	TArray<FIntPoint> AgentCells;
+
+	// The index into `SortedAgents` of the first agent in every cell and the number of agents
+	// in the cell.
+	TMap<FIntPoint, FIntPoint> CellRanges;
+
+	// The simplified moves of the last frame.
+	TArray<FZombieSimpleMove> Moves;
+
+	// Whether crowd steering was on in the last frame.
+	bool bWasSteeringEnabled = false;
+};
@@ -0,0 +1,236 @@
+#include "ZombieMovementComponent.h"
+#include "ZombieLocomotionSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+
+// The number of seconds the full CharacterMovementComponent is used for after the simplified
+// move couldn't find the navmesh.
+static const float SimpleMovementBlockTime = 1.f;
+
+/**
+ * Works out the velocity of the ZombieCharacter for this move and adds the steering velocity
+ * to it.
+ */
+void UZombieMovementComponent::CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration)
+{
+	Super::CalcVelocity(DeltaTime, Friction, bFluid, BrakingDeceleration);
+
+	// Only steer on the ground so that falling zombies keep their momentum.
+	if (SteeringVelocity.IsZero() || !IsMovingOnGround()) return;
+
+	// Steering only changes where the ZombieCharacter goes, never how fast it can go.
+	Velocity = (Velocity + SteeringVelocity).GetClampedToMaxSize(GetMaxSpeed());
+}
+
+/**
+ * Called every time the ZombieMovementComponent ticks. When the simplified movement can be
+ * used this only collects the velocity the ZombieCharacter wants to move at for the
+ * ZombieLocomotionSubsystem, otherwise it does the full CharacterMovementComponent move.
+ */
+void UZombieMovementComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::MOVEMENT);
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_MovementTick);
+
+	if (!CanUseSimpleMovement())
+	{
+		PendingSimpleMoveTime = 0.f;
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+		return;
+	}
+
+	// The path following asks for a velocity directly while the flow field adds movement input,
+	// so take whichever one was given this tick.
+	const float MaxSpeed = GetMaxSpeed();
+	const FVector InputVector = ConsumeInputVector();
+	if (bHasRequestedVelocity)
+	{
+		SimpleMoveVelocity = bRequestedMoveWithMaxSpeed ? RequestedVelocity.GetSafeNormal() * MaxSpeed : RequestedVelocity.GetClampedToMaxSize(MaxSpeed);
+		bHasRequestedVelocity = false;
+	}
+	else
+	{
+		SimpleMoveVelocity = InputVector.GetClampedToMaxSize(1.f) * MaxSpeed;
+	}
+	SimpleMoveVelocity.Z = 0.f;
+
+	// Keep adding up the time so that the batched move still respects the tick interval that
+	// the level of detail tier set.
+	PendingSimpleMoveTime += DeltaTime;
+}
+
+/**
+ * Called when the path following stops the ZombieCharacter.
+ */
+void UZombieMovementComponent::StopActiveMovement()
+{
+	Super::StopActiveMovement();
+
+	SimpleMoveVelocity = FVector::ZeroVector;
+}
+
+/**
+ * Stops the ZombieCharacter dead, without braking.
+ */
+void UZombieMovementComponent::StopMovementImmediately()
+{
+	Super::StopMovementImmediately();
+
+	SimpleMoveVelocity = FVector::ZeroVector;
+	PendingSimpleMoveTime = 0.f;
+}
+
+/**
+ * Returns whether the ZombieCharacter can be moved by the ZombieLocomotionSubsystem's batched
+ * update instead of the full CharacterMovementComponent.
+ */
+bool UZombieMovementComponent::CanUseSimpleMovement() const
+{
+	if (!UZombieLocomotionSubsystem::IsSimpleMovementEnabled()) return false;
+	if (CharacterOwner == nullptr || UpdatedComponent == nullptr) return false;
+
+	// Simulated zombies on clients have to go through the full move to be smoothed between the
+	// updates from the server.
+	if (CharacterOwner->GetLocalRole() != ROLE_Authority) return false;
+
+	// Falling, root motion and anything else that isn't plain walking needs the full move.
+	if (MovementMode != MOVE_Walking || HasAnimRootMotion()) return false;
+
+	const UWorld* World = GetWorld();
+	return World != nullptr && World->GetTimeSeconds() >= SimpleMovementBlockedUntil;
+}
+
+/**
+ * Returns the velocity the ZombieCharacter wants to move at and the amount of time it has
+ * ticked for since the last simplified move, and clears both.
+ *
+ * @param OutDeltaTime The amount of time to move for. 0 if the ZombieMovementComponent
+ * hasn't ticked since the last simplified move.
+ *
+ * @return The velocity the ZombieCharacter wants to move at.
+ */
+FVector UZombieMovementComponent::ConsumeSimpleMove(float& OutDeltaTime)
+{
+	OutDeltaTime = PendingSimpleMoveTime;
+	PendingSimpleMoveTime = 0.f;
+
+	return SimpleMoveVelocity;
+}
+
+/**
+ * Moves the ZombieCharacter to where the simplified move put it. The navmesh already keeps
+ * it off walls, so it's only swept against pawns and dynamic objects, and slides along the
+ * first one in the way instead of walking through it.
+ *
+ * @param NewLocation The new location of the ZombieCharacter.
+ * @param NewRotation The new rotation of the ZombieCharacter.
+ * @param NewVelocity The new velocity of the ZombieCharacter.
+ */
+void UZombieMovementComponent::ApplySimpleMove(const FVector& NewLocation, const FRotator& NewRotation, const FVector& NewVelocity)
+{
+	if (UpdatedComponent == nullptr || CharacterOwner == nullptr) return;
+
+	FVector Location = NewLocation;
+	FVector MoveVelocity = NewVelocity;
+
+	FHitResult Hit;
+	if (SweepForBlockers(UpdatedComponent->GetComponentLocation(), NewLocation, Hit))
+	{
+		// Slide the rest of the way along whatever is in the way, and stop wherever the slide is
+		// blocked too, like against a PlayerCharacter that's being attacked.
+		const FVector Normal = Hit.Normal.GetSafeNormal2D();
+		const FVector SlideEnd = Hit.Location + FVector::VectorPlaneProject(NewLocation - Hit.Location, Normal);
+
+		FHitResult SlideHit;
+		if (Normal.IsZero()) Location = Hit.Location;
+		else Location = SweepForBlockers(Hit.Location, SlideEnd, SlideHit) ? SlideHit.Location : SlideEnd;
+		MoveVelocity = FVector::VectorPlaneProject(NewVelocity, Normal);
+	}
+
+	UpdatedComponent->SetWorldLocationAndRotation(Location, NewRotation.Quaternion(), false, nullptr, ETeleportType::None);
+	Velocity = MoveVelocity;
+	UpdateComponentVelocity();
+}
+
+/**
+ * Sweeps the ZombieCharacter's capsule against everything its capsule blocks except static
+ * geometry, with its bottom raised by the step height so that it doesn't catch on the floor.
+ *
+ * @param Start Where the center of the capsule starts.
+ * @param End Where the center of the capsule ends.
+ * @param OutHit The first blocking hit.
+ *
+ * @return Whether something is in the way.
+ */
+bool UZombieMovementComponent::SweepForBlockers(const FVector& Start, const FVector& End, FHitResult& OutHit) const
+{
+	const UWorld* World = GetWorld();
+	if (World == nullptr || Start.Equals(End)) return false;
+
+	// Sweep on the capsule's own channel with its own responses so that triggers and anything
+	// else it only overlaps don't stop it, the same as they wouldn't stop the full move. Static
+	// geometry is left out because the navmesh already goes around it, and crowd steered zombies
+	// are left out by their own profile since they keep apart by steering.
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ZombieSimpleMove), false, CharacterOwner);
+	FCollisionResponseParams ResponseParams;
+	InitCollisionParams(QueryParams, ResponseParams);
+	ResponseParams.CollisionResponse.SetResponse(ECC_WorldStatic, ECR_Ignore);
+
+	// Zombies that start a move touching something are let out of it rather than stuck.
+	QueryParams.bFindInitialOverlaps = false;
+
+	const UCapsuleComponent* Capsule = CharacterOwner->GetCapsuleComponent();
+	const float Radius = Capsule->GetScaledCapsuleRadius();
+	const float HalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+	const float Lift = FMath::Min(MaxStepHeight, FMath::Max(HalfHeight - Radius, 0.f) * 2.f) * 0.5f;
+	const FVector Offset(0.f, 0.f, Lift);
+
+	if (!World->SweepSingleByChannel(OutHit, Start + Offset, End + Offset, FQuat::Identity, Capsule->GetCollisionObjectType(), FCollisionShape::MakeCapsule(Radius, HalfHeight - Lift), QueryParams, ResponseParams)) return false;
+
+	OutHit.Location -= Offset;
+	return true;
+}
+
+/**
+ * Looks for the floor under the ZombieCharacter's feet, for when the navmesh is too far off the
+ * real floor to stand on, like on stairs and steep slopes.
+ *
+ * @param FeetLocation Where the feet of the ZombieCharacter are on the navmesh.
+ * @param OutFloorZ The height of the floor, if a walkable one was found.
+ *
+ * @return Whether a walkable floor was found within the step height of the navmesh.
+ */
+bool UZombieMovementComponent::TraceSimpleMoveFloor(const FVector& FeetLocation, float& OutFloorZ) const
+{
+	const UWorld* World = GetWorld();
+	if (World == nullptr || UpdatedPrimitive == nullptr) return false;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ZombieSimpleMoveFloor), false, CharacterOwner);
+	FCollisionResponseParams ResponseParams;
+	InitCollisionParams(QueryParams, ResponseParams);
+
+	const FVector Reach(0.f, 0.f, MaxStepHeight);
+	FHitResult Hit;
+	if (!World->LineTraceSingleByChannel(Hit, FeetLocation + Reach, FeetLocation - Reach, UpdatedPrimitive->GetCollisionObjectType(), QueryParams, ResponseParams)) return false;
+	if (Hit.bStartPenetrating || !IsWalkable(Hit)) return false;
+
+	OutFloorZ = Hit.ImpactPoint.Z;
+	return true;
+}
+
+/**
+ * Hands the ZombieCharacter back to the full CharacterMovementComponent for a while, for when
+ * the simplified move couldn't find the navmesh.
+ */
+void UZombieMovementComponent::BlockSimpleMovement()
+{
+	const UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	// Let the full move find the floor again, or fall if there isn't one.
+	SimpleMovementBlockedUntil = World->GetTimeSeconds() + SimpleMovementBlockTime;
+	PendingSimpleMoveTime = 0.f;
+}
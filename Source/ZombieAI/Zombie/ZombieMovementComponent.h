@@ -0,0 +1,132 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "ZombieMovementComponent.generated.h"
+
+/**
+ * The ZombieMovementComponent is the movement component of the ZombieCharacter. It moves like a
+ * CharacterMovementComponent except that a steering velocity worked out by the
+ * ZombieLocomotionSubsystem is added on top of the velocity that the path following asks for,
+ * which is what keeps the zombies of a horde apart from each other.
+ *
+ * While the ZombieCharacter walks on the navmesh it can also skip the CharacterMovementComponent
+ * altogether. Its tick then only collects the velocity that was asked for, and the
+ * ZombieLocomotionSubsystem moves every zombie in one batched update that keeps them on the
+ * navmesh. That move only does one capsule sweep against what's in the way and only looks for
+ * the floor where the navmesh height jumps, instead of the full move's step ups, floor finds and
+ * repeated slides. Anything the simplified move can't handle, like falling or stepping off the
+ * navmesh, goes back to the full CharacterMovementComponent for a while.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Sets the velocity added to the ZombieCharacter's movement to keep it away from the
+	 * zombies around it.
+	 */
+	void SetSteeringVelocity(const FVector& NewSteeringVelocity) { SteeringVelocity = NewSteeringVelocity; }
+
+	/**
+	 * Returns the velocity added to the ZombieCharacter's movement to keep it away from the
+	 * zombies around it.
+	 */
+	const FVector& GetSteeringVelocity() const { return SteeringVelocity; }
+
+	/**
+	 * Works out the velocity of the ZombieCharacter for this move and adds the steering velocity
+	 * to it.
+	 */
+	virtual void CalcVelocity(float DeltaTime, float Friction, bool bFluid, float BrakingDeceleration) override;
+
+	/**
+	 * Called every time the ZombieMovementComponent ticks. When the simplified movement can be
+	 * used this only collects the velocity the ZombieCharacter wants to move at for the
+	 * ZombieLocomotionSubsystem, otherwise it does the full CharacterMovementComponent move.
+	 */
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/**
+	 * Called when the path following stops the ZombieCharacter.
+	 */
+	virtual void StopActiveMovement() override;
+
+	/**
+	 * Stops the ZombieCharacter dead, without braking.
+	 */
+	virtual void StopMovementImmediately() override;
+
+	/**
+	 * Returns whether the ZombieCharacter can be moved by the ZombieLocomotionSubsystem's batched
+	 * update instead of the full CharacterMovementComponent.
+	 */
+	bool CanUseSimpleMovement() const;
+
+	/**
+	 * Returns the velocity the ZombieCharacter wants to move at and the amount of time it has
+	 * ticked for since the last simplified move, and clears both.
+	 *
+	 * @param OutDeltaTime The amount of time to move for. 0 if the ZombieMovementComponent
+	 * hasn't ticked since the last simplified move.
+	 *
+	 * @return The velocity the ZombieCharacter wants to move at.
+	 */
+	FVector ConsumeSimpleMove(float& OutDeltaTime);
+
+	/**
+	 * Moves the ZombieCharacter to where the simplified move put it. The navmesh already keeps
+	 * it off walls, so it's only swept against what its capsule blocks other than static
+	 * geometry, and slides along the first one in the way instead of walking through it.
+	 *
+	 * @param NewLocation The new location of the ZombieCharacter.
+	 * @param NewRotation The new rotation of the ZombieCharacter.
+	 * @param NewVelocity The new velocity of the ZombieCharacter.
+	 */
+	void ApplySimpleMove(const FVector& NewLocation, const FRotator& NewRotation, const FVector& NewVelocity);
+
+	/**
+	 * Hands the ZombieCharacter back to the full CharacterMovementComponent for a while, for when
+	 * the simplified move couldn't find the navmesh.
+	 */
+	void BlockSimpleMovement();
+
+	/**
+	 * Looks for the floor under the ZombieCharacter's feet, for when the navmesh is too far off the
+	 * real floor to stand on, like on stairs and steep slopes.
+	 *
+	 * @param FeetLocation Where the feet of the ZombieCharacter are on the navmesh.
+	 * @param OutFloorZ The height of the floor, if a walkable one was found.
+	 *
+	 * @return Whether a walkable floor was found within the step height of the navmesh.
+	 */
+	bool TraceSimpleMoveFloor(const FVector& FeetLocation, float& OutFloorZ) const;
+
+protected:
+	/**
+	 * Sweeps the ZombieCharacter's capsule against everything its capsule blocks except static
+	 * geometry, with its bottom raised by the step height so that it doesn't catch on the floor.
+	 *
+	 * @param Start Where the center of the capsule starts.
+	 * @param End Where the center of the capsule ends.
+	 * @param OutHit The first blocking hit.
+	 *
+	 * @return Whether something is in the way.
+	 */
+	bool SweepForBlockers(const FVector& Start, const FVector& End, FHitResult& OutHit) const;
+
+	// The velocity added to the ZombieCharacter's movement to keep it away from the zombies
+	// around it.
+	FVector SteeringVelocity = FVector::ZeroVector;
+
+	// The velocity the ZombieCharacter wants to move at, collected for the next simplified move.
+	FVector SimpleMoveVelocity = FVector::ZeroVector;
+
+	// The amount of time the ZombieMovementComponent has ticked for since the last simplified move.
+	float PendingSimpleMoveTime = 0.f;
+
+	// The time until which the full CharacterMovementComponent is used.
+	float SimpleMovementBlockedUntil = 0.f;
+};
@@ -0,0 +1,53 @@
+#include "ZombiePlayerSlots.h"
+#include "../Player/PlayerCharacter.h"
+
+/**
+ * Gives the PlayerCharacter a slot if it doesn't have one yet and there is one left.
+ *
+ * @param PlayerCharacter The PlayerCharacter to add.
+ */
+void FZombiePlayerSlots::Add(APlayerCharacter* PlayerCharacter)
+{
+	if (PlayerCharacter == nullptr || Players.Contains(PlayerCharacter)) return;
+
+	// Reuse the slot of a PlayerCharacter that left so that the bits of the other
+	// PlayerCharacters don't move.
+	const int32 FreeIndex = Players.Find(nullptr);
+	if (FreeIndex != INDEX_NONE)
+	{
+		Players[FreeIndex] = PlayerCharacter;
+		return;
+	}
+
+	if (Players.Num() >= MaxPlayers) return;
+	Players.Add(PlayerCharacter);
+}
+
+/**
+ * Frees the PlayerCharacter's slot and clears its bit in the masks.
+ *
+ * @param PlayerCharacter The PlayerCharacter to remove.
+ * @param Masks The masks that have a bit for every slot.
+ */
+void FZombiePlayerSlots::Remove(APlayerCharacter* PlayerCharacter, TArray<uint32>& Masks)
+{
+	const int32 PlayerIndex = Players.Find(PlayerCharacter);
+	if (PlayerIndex == INDEX_NONE) return;
+
+	Players[PlayerIndex] = nullptr;
+
+	// Forget the PlayerCharacter so that whoever takes the slot next doesn't get its bits.
+	const uint32 PlayerBit = 1u << PlayerIndex;
+	for (uint32& Mask : Masks)
+	{
+		Mask &= ~PlayerBit;
+	}
+}
+
+/**
+ * Returns the slot of the actor, or INDEX_NONE if it doesn't have one.
+ */
+int32 FZombiePlayerSlots::IndexOf(const AActor* Actor) const
+{
+	return Players.IndexOfByKey(Actor);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ZombiePlayerSlots.generated.h"
+
+class APlayerCharacter;
+
+/**
+ * Gives every PlayerCharacter a slot whose index is its bit in the masks that systems keep for
+ * each zombie, like the PlayerCharacters it sees or has within reach. Only the first
+ * `MaxPlayers` PlayerCharacters get a slot.
+ */
+USTRUCT()
+struct ZOMBIEAI_API FZombiePlayerSlots
+{
+	GENERATED_BODY()
+
+	// The number of bits in a mask.
+	static const int32 MaxPlayers = 32;
+
+	/**
+	 * Gives the PlayerCharacter a slot if it doesn't have one yet and there is one left.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter to add.
+	 */
+	void Add(APlayerCharacter* PlayerCharacter);
+
+	/**
+	 * Frees the PlayerCharacter's slot and clears its bit in the masks.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter to remove.
+	 * @param Masks The masks that have a bit for every slot.
+	 */
+	void Remove(APlayerCharacter* PlayerCharacter, TArray<uint32>& Masks);
+
+	/**
+	 * Returns the slot of the actor, or INDEX_NONE if it doesn't have one.
+	 */
+	int32 IndexOf(const AActor* Actor) const;
+
+	/**
+	 * Returns the number of slots, including the free ones.
+	 */
+	int32 Num() const { return Players.Num(); }
+
+	/**
+	 * Returns the PlayerCharacter in the slot, or nullptr if the slot is free.
+	 */
+	APlayerCharacter* operator[](int32 Index) const { return Players[Index]; }
+
+	/**
+	 * Frees every slot.
+	 */
+	void Empty() { Players.Empty(); }
+
+	// The PlayerCharacter in each slot, or nullptr for a free slot.
+	UPROPERTY()
+	TArray<APlayerCharacter*> Players;
+};
@@ -0,0 +1,199 @@
+#include "ZombiePoolSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieAIController.h"
+#include "Engine/World.h"
+
+// Where pre-warmed ZombieCharacters are spawned, far below the level so that nobody sees them or
+// bumps into them before they're put in the pool.
+static const FVector PoolStagingLocation(0.f, 0.f, -50000.f);
+
+/**
+ * Called when the world that owns the ZombiePoolSubsystem is torn down.
+ */
+void UZombiePoolSubsystem::Deinitialize()
+{
+	// The ZombieCharacters and ZombieAIControllers are destroyed along with the world so we
+	// just need to let go of them.
+	AllZombies.Empty();
+	FreeZombies.Empty();
+	FreeControllers.Empty();
+	Stats = FZombiePoolStats();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Spawns ZombieCharacters of the class, along with their ZombieAIControllers, until the
+ * pool has at least `Count` of them waiting.
+ *
+ * @param ZombieClass The class of ZombieCharacter to spawn.
+ * @param Count The number of ZombieCharacters the pool should have waiting.
+ */
+void UZombiePoolSubsystem::Prewarm(TSubclassOf<AZombieCharacter> ZombieClass, int32 Count)
+{
+	while (GetNumFree(ZombieClass) < Count)
+	{
+		if (!AddPooledZombie(ZombieClass)) return;
+	}
+}
+
+/**
+ * Spawns one ZombieCharacter of the class, along with its ZombieAIController, and puts it
+ * in the pool. Used to spread pre-warming over several frames.
+ *
+ * @param ZombieClass The class of ZombieCharacter to spawn.
+ *
+ * @return Whether a ZombieCharacter was added.
+ */
+bool UZombiePoolSubsystem::AddPooledZombie(TSubclassOf<AZombieCharacter> ZombieClass)
+{
+	AZombieCharacter* ZombieCharacter = SpawnPooledZombie(ZombieClass, FTransform(PoolStagingLocation));
+	if (ZombieCharacter == nullptr) return false;
+
+	AddToFreeList(ZombieCharacter);
+	return true;
+}
+
+/**
+ * Takes a ZombieCharacter of the class from the free list, or spawns a new one if there
+ * isn't one, and brings it into play at the given transform with a ZombieAIController.
+ *
+ * @param ZombieClass The class of ZombieCharacter to take.
+ * @param SpawnTransform The location and rotation to put the ZombieCharacter at.
+ */
+AZombieCharacter* UZombiePoolSubsystem::Acquire(TSubclassOf<AZombieCharacter> ZombieClass, const FTransform& SpawnTransform)
+{
+	if (ZombieClass == nullptr) return nullptr;
+
+	// Take a ZombieCharacter from the back of the class's free list. A ZombieCharacter could have
+	// been destroyed by something outside of the pool, like a level streaming out, so we skip
+	// invalid ones.
+	AZombieCharacter* ZombieCharacter = nullptr;
+	FZombieFreeList* FreeList = FreeZombies.Find(ZombieClass);
+	while (FreeList != nullptr && FreeList->Zombies.Num() > 0 && ZombieCharacter == nullptr)
+	{
+		AZombieCharacter* FreeZombie = FreeList->Zombies.Pop(false);
+		if (IsValid(FreeZombie)) ZombieCharacter = FreeZombie;
+	}
+
+	if (ZombieCharacter != nullptr)
+	{
+		Stats.Hits++;
+		ZombieCharacter->LeavePool(SpawnTransform);
+		PossessWithPooledController(ZombieCharacter);
+	}
+	else
+	{
+		// The free list was empty so the pool has to grow. Misses tell us that the pool
+		// should be pre-warmed with more ZombieCharacters.
+		ZombieCharacter = SpawnPooledZombie(ZombieClass, SpawnTransform);
+		if (ZombieCharacter == nullptr) return nullptr;
+
+		Stats.Misses++;
+	}
+
+	Stats.InUse++;
+	Stats.HighWater = FMath::Max(Stats.HighWater, Stats.InUse);
+
+	return ZombieCharacter;
+}
+
+/**
+ * Takes the ZombieCharacter out of play and puts it and its ZombieAIController back on the
+ * free lists.
+ *
+ * @param ZombieCharacter The ZombieCharacter to return to the pool.
+ */
+void UZombiePoolSubsystem::Release(AZombieCharacter* ZombieCharacter)
+{
+	// Ignore ZombieCharacters that are already back in the pool.
+	if (!IsValid(ZombieCharacter) || ZombieCharacter->IsPooled()) return;
+
+	// Placed ZombieCharacters join the pool the first time they die.
+	AllZombies.Add(ZombieCharacter);
+
+	if (ZombieCharacter->GetState() == ZombieStates::DEAD) Stats.Recycled++;
+
+	AddToFreeList(ZombieCharacter);
+
+	Stats.InUse = FMath::Max(Stats.InUse - 1, 0);
+}
+
+/**
+ * Returns the number of ZombieCharacters of the class that are waiting in the pool.
+ */
+int32 UZombiePoolSubsystem::GetNumFree(TSubclassOf<AZombieCharacter> ZombieClass) const
+{
+	const FZombieFreeList* FreeList = FreeZombies.Find(ZombieClass);
+	return (FreeList != nullptr) ? FreeList->Zombies.Num() : 0;
+}
+
+/**
+ * Spawns a new ZombieCharacter that is owned by the pool.
+ *
+ * @param ZombieClass The class of ZombieCharacter to spawn.
+ * @param SpawnTransform The location and rotation to spawn the ZombieCharacter at.
+ */
+AZombieCharacter* UZombiePoolSubsystem::SpawnPooledZombie(TSubclassOf<AZombieCharacter> ZombieClass, const FTransform& SpawnTransform)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || ZombieClass == nullptr) return nullptr;
+
+	// Pre-warmed ZombieCharacters are spawned out of the way and put in the pool right away, and
+	// the ones spawned when the pool is empty are placed like any other wave spawn, so we always
+	// want them to spawn even if something is in the way.
+	FActorSpawnParameters ActorSpawnParams;
+	ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AZombieCharacter* ZombieCharacter = World->SpawnActor<AZombieCharacter>(ZombieClass, SpawnTransform, ActorSpawnParams);
+	if (ZombieCharacter == nullptr) return nullptr;
+
+	// The ZombieCharacter spawns its own ZombieAIController, so that's warmed up too.
+	AllZombies.Add(ZombieCharacter);
+
+	return ZombieCharacter;
+}
+
+/**
+ * Takes the ZombieCharacter out of play and adds it to the free list.
+ */
+void UZombiePoolSubsystem::AddToFreeList(AZombieCharacter* ZombieCharacter)
+{
+	// Keep the ZombieAIController for the next ZombieCharacter that comes out of the pool.
+	AZombieAIController* ZombieAIController = Cast<AZombieAIController>(ZombieCharacter->GetController());
+	if (ZombieAIController != nullptr)
+	{
+		ZombieAIController->UnPossess();
+		FreeControllers.Add(ZombieAIController);
+	}
+
+	ZombieCharacter->EnterPool();
+	FreeZombies.FindOrAdd(ZombieCharacter->GetClass()).Zombies.Add(ZombieCharacter);
+}
+
+/**
+ * Gives the ZombieCharacter a ZombieAIController from the free list, or spawns one if there
+ * isn't one of the right class.
+ */
+void UZombiePoolSubsystem::PossessWithPooledController(AZombieCharacter* ZombieCharacter)
+{
+	if (ZombieCharacter->GetController() != nullptr) return;
+
+	for (int32 Index = FreeControllers.Num() - 1; Index >= 0; --Index)
+	{
+		AZombieAIController* FreeController = FreeControllers[Index];
+		if (!IsValid(FreeController))
+		{
+			FreeControllers.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		if (FreeController->GetClass() != ZombieCharacter->AIControllerClass) continue;
+
+		FreeControllers.RemoveAtSwap(Index, 1, false);
+		FreeController->Possess(ZombieCharacter);
+		return;
+	}
+
+	ZombieCharacter->SpawnDefaultController();
+}
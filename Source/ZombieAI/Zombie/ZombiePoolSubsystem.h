@@ -0,0 +1,157 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombiePoolSubsystem.generated.h"
+
+class AZombieCharacter;
+class AZombieAIController;
+
+/**
+ * The counters used to size the ZombiePoolSubsystem.
+ */
+USTRUCT(BlueprintType)
+struct FZombiePoolStats
+{
+	GENERATED_BODY()
+
+	// The number of times a ZombieCharacter was handed out from the free list.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = ZombiePool)
+	int32 Hits = 0;
+
+	// The number of times the free list was empty and a new ZombieCharacter had to be spawned.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = ZombiePool)
+	int32 Misses = 0;
+
+	// The number of ZombieCharacters that are currently out of the pool.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = ZombiePool)
+	int32 InUse = 0;
+
+	// The highest number of ZombieCharacters that have been out of the pool at the same time.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = ZombiePool)
+	int32 HighWater = 0;
+
+	// The number of ZombieCharacters that came back to the pool after they died.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = ZombiePool)
+	int32 Recycled = 0;
+};
+
+/**
+ * The ZombieCharacters of one class that are waiting in the ZombiePoolSubsystem.
+ */
+USTRUCT()
+struct FZombieFreeList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AZombieCharacter*> Zombies;
+};
+
+/**
+ * The ZombiePoolSubsystem keeps a pool of pre-spawned ZombieCharacters and ZombieAIControllers
+ * so that spawning a wave doesn't have to construct a character, its skeletal mesh and anim
+ * instance, and a controller with its perception for every zombie. Pooled ZombieCharacters are
+ * hidden, don't collide or tick and aren't part of the ZombieCrowdSubsystem, so they cost
+ * nothing while they wait. Dead ZombieCharacters are handed back here once their death
+ * animation has played instead of being destroyed.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombiePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombiePoolSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Spawns ZombieCharacters of the class, along with their ZombieAIControllers, until the
+	 * pool has at least `Count` of them waiting.
+	 *
+	 * @param ZombieClass The class of ZombieCharacter to spawn.
+	 * @param Count The number of ZombieCharacters the pool should have waiting.
+	 */
+	UFUNCTION(BlueprintCallable, Category = ZombiePool)
+	void Prewarm(TSubclassOf<AZombieCharacter> ZombieClass, int32 Count);
+
+	/**
+	 * Spawns one ZombieCharacter of the class, along with its ZombieAIController, and puts it
+	 * in the pool. Used to spread pre-warming over several frames.
+	 *
+	 * @param ZombieClass The class of ZombieCharacter to spawn.
+	 *
+	 * @return Whether a ZombieCharacter was added.
+	 */
+	bool AddPooledZombie(TSubclassOf<AZombieCharacter> ZombieClass);
+
+	/**
+	 * Takes a ZombieCharacter of the class from the free list, or spawns a new one if there
+	 * isn't one, and brings it into play at the given transform with a ZombieAIController.
+	 *
+	 * @param ZombieClass The class of ZombieCharacter to take.
+	 * @param SpawnTransform The location and rotation to put the ZombieCharacter at.
+	 */
+	UFUNCTION(BlueprintCallable, Category = ZombiePool)
+	AZombieCharacter* Acquire(TSubclassOf<AZombieCharacter> ZombieClass, const FTransform& SpawnTransform);
+
+	/**
+	 * Takes the ZombieCharacter out of play and puts it and its ZombieAIController back on the
+	 * free lists.
+	 *
+	 * @param ZombieCharacter The ZombieCharacter to return to the pool.
+	 */
+	UFUNCTION(BlueprintCallable, Category = ZombiePool)
+	void Release(AZombieCharacter* ZombieCharacter);
+
+	/**
+	 * Returns the number of ZombieCharacters of the class that are waiting in the pool.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombiePool)
+	int32 GetNumFree(TSubclassOf<AZombieCharacter> ZombieClass) const;
+
+	/**
+	 * Returns the counters of the pool.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombiePool)
+	FZombiePoolStats GetStats() const { return Stats; }
+
+protected:
+	/**
+	 * Spawns a new ZombieCharacter that is owned by the pool.
+	 *
+	 * @param ZombieClass The class of ZombieCharacter to spawn.
+	 * @param SpawnTransform The location and rotation to spawn the ZombieCharacter at.
+	 */
+	AZombieCharacter* SpawnPooledZombie(TSubclassOf<AZombieCharacter> ZombieClass, const FTransform& SpawnTransform);
+
+	/**
+	 * Takes the ZombieCharacter out of play and adds it to the free list.
+	 */
+	void AddToFreeList(AZombieCharacter* ZombieCharacter);
+
+	/**
+	 * Gives the ZombieCharacter a ZombieAIController from the free list, or spawns one if there
+	 * isn't one of the right class.
+	 */
+	void PossessWithPooledController(AZombieCharacter* ZombieCharacter);
+
+protected:
+	// Every ZombieCharacter that the pool has spawned, used to keep them from being garbage collected.
+	UPROPERTY()
+	TSet<AZombieCharacter*> AllZombies;
+
+	// The ZombieCharacters that are waiting to be brought into play, kept apart by class so that
+	// taking one or counting them doesn't have to look at the other classes.
+	UPROPERTY()
+	TMap<TSubclassOf<AZombieCharacter>, FZombieFreeList> FreeZombies;
+
+	// The ZombieAIControllers that are waiting for a ZombieCharacter to take over.
+	UPROPERTY()
+	TArray<AZombieAIController*> FreeControllers;
+
+	// The counters of the pool.
+	FZombiePoolStats Stats;
+};
@@ -0,0 +1,237 @@
+#include "ZombieReplicationSubsystem.h"
+#include "ZombieCharacter.h"
+#include "ZombieCrowdSubsystem.h"
+#include "../ZombieAIReplicationGraph.h"
+#include "../ZombieAIStats.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogZombieReplication, Log, All);
+
+static TAutoConsoleVariable<float> CVarZombieNetCloseDistance(
+	TEXT("zombie.Net.CloseDistance"),
+	2000.f,
+	TEXT("The distance from the closest client within which zombies are replicated at the CLOSE rate."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieNetMediumDistance(
+	TEXT("zombie.Net.MediumDistance"),
+	5000.f,
+	TEXT("The distance from the closest client within which zombies are replicated at the MEDIUM rate."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieNetCloseFrequency(
+	TEXT("zombie.Net.CloseFrequency"),
+	20.f,
+	TEXT("The number of times per second zombies in the CLOSE tier are replicated."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieNetMediumFrequency(
+	TEXT("zombie.Net.MediumFrequency"),
+	8.f,
+	TEXT("The number of times per second zombies in the MEDIUM tier are replicated."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieNetDistantFrequency(
+	TEXT("zombie.Net.DistantFrequency"),
+	2.f,
+	TEXT("The number of times per second zombies in the DISTANT tier and dead zombies are replicated."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieNetUpdateInterval(
+	TEXT("zombie.Net.UpdateInterval"),
+	0.5f,
+	TEXT("The number of seconds between replication tier updates."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieNetReport(
+	TEXT("zombie.Net.Report"),
+	0,
+	TEXT("Whether the bytes sent per relevant zombie per second are logged on every replication tier update."),
+	ECVF_Default);
+
+/**
+ * Called when the world that owns the ZombieReplicationSubsystem is torn down.
+ */
+void UZombieReplicationSubsystem::Deinitialize()
+{
+	ViewLocations.Empty();
+	NetTiers.Empty();
+	SlotGenerations.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Returns the tier a ZombieCharacter at the distance from the closest client is in.
+ *
+ * @param Distance The distance to the closest client's viewpoint.
+ * @param CloseDistance The distance within which ZombieCharacters are in the CLOSE tier.
+ * @param MediumDistance The distance within which ZombieCharacters are in the MEDIUM tier.
+ */
+ZombieNetTiers UZombieReplicationSubsystem::ChooseNetTier(float Distance, float CloseDistance, float MediumDistance)
+{
+	if (Distance <= CloseDistance) return ZombieNetTiers::CLOSE;
+	if (Distance <= MediumDistance) return ZombieNetTiers::MEDIUM;
+	return ZombieNetTiers::DISTANT;
+}
+
+/**
+ * Returns the number of times per second ZombieCharacters in the tier are replicated.
+ */
+float UZombieReplicationSubsystem::GetNetTierFrequency(ZombieNetTiers Tier)
+{
+	switch (Tier)
+	{
+	case ZombieNetTiers::CLOSE:
+		return CVarZombieNetCloseFrequency.GetValueOnGameThread();
+	case ZombieNetTiers::MEDIUM:
+		return CVarZombieNetMediumFrequency.GetValueOnGameThread();
+	case ZombieNetTiers::DISTANT:
+		return CVarZombieNetDistantFrequency.GetValueOnGameThread();
+	}
+
+	return CVarZombieNetCloseFrequency.GetValueOnGameThread();
+}
+
+/**
+ * Called every frame to update the tiers once enough time has passed since the last update.
+ */
+void UZombieReplicationSubsystem::Tick(float DeltaTime)
+{
+	// Only a server sends anything to clients.
+	UWorld* World = GetWorld();
+	UNetDriver* NetDriver = (World != nullptr) ? World->GetNetDriver() : nullptr;
+	if (NetDriver == nullptr || !NetDriver->IsServer()) return;
+
+	TimeUntilUpdate -= DeltaTime;
+	TimeSinceUpdate += DeltaTime;
+	if (TimeUntilUpdate > 0.f) return;
+	TimeUntilUpdate = CVarZombieNetUpdateInterval.GetValueOnGameThread();
+
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Replication);
+
+	GatherViewers(NetDriver);
+	UpdateNetTiers(NetDriver);
+
+	// The ZombieCharacters add up what they wrote to their actor channels since the last update.
+	const int64 ZombieBits = TotalZombieBits - ZombieBitsAtUpdate;
+	ZombieBytesPerSecond = (TimeSinceUpdate > 0.f) ? ZombieBits / 8.f / TimeSinceUpdate : 0.f;
+	BytesPerZombiePerSecond = (RelevantZombieCount > 0) ? ZombieBytesPerSecond / RelevantZombieCount : 0.f;
+
+	ZombieBitsAtUpdate = TotalZombieBits;
+	TimeSinceUpdate = 0.f;
+
+	SET_DWORD_STAT(STAT_ZombieAI_RelevantZombies, RelevantZombieCount);
+	SET_DWORD_STAT(STAT_ZombieAI_NetBytesPerZombie, FMath::RoundToInt(BytesPerZombiePerSecond));
+
+	if (CVarZombieNetReport.GetValueOnGameThread() != 0)
+	{
+		UE_LOG(LogZombieReplication, Display, TEXT("%d clients, %d relevant zombies (%d close, %d medium, %d distant), %d bytes/s out, %.0f bytes/s to zombie channels, %.1f bytes per zombie per second."),
+			ViewLocations.Num(), RelevantZombieCount, TierCounts[(int32)ZombieNetTiers::CLOSE], TierCounts[(int32)ZombieNetTiers::MEDIUM], TierCounts[(int32)ZombieNetTiers::DISTANT], OutBytesPerSecond, ZombieBytesPerSecond, BytesPerZombiePerSecond);
+	}
+}
+
+TStatId UZombieReplicationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieReplicationSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Collects where every client is looking from and how many bytes were sent to them.
+ */
+void UZombieReplicationSubsystem::GatherViewers(UNetDriver* NetDriver)
+{
+	ViewLocations.Reset();
+	OutBytesPerSecond = 0;
+
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (Connection == nullptr) continue;
+
+		// The connection works out its bytes per second once per stat period, so this is the
+		// rate over the last whole period.
+		OutBytesPerSecond += Connection->OutBytesPerSecond;
+
+		const APlayerController* PlayerController = Connection->PlayerController;
+		if (PlayerController == nullptr) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+		ViewLocations.Add(ViewLocation);
+	}
+}
+
+/**
+ * Puts every ZombieCharacter in its tier and counts the ZombieCharacters that are relevant
+ * to each client.
+ */
+void UZombieReplicationSubsystem::UpdateNetTiers(UNetDriver* NetDriver)
+{
+	RelevantZombieCount = 0;
+	FMemory::Memzero(TierCounts);
+
+	UWorld* World = GetWorld();
+	UZombieCrowdSubsystem* Crowd = (World != nullptr) ? World->GetSubsystem<UZombieCrowdSubsystem>() : nullptr;
+	if (Crowd == nullptr) return;
+
+	const float CloseDistance = CVarZombieNetCloseDistance.GetValueOnGameThread();
+	const float MediumDistance = FMath::Max(CVarZombieNetMediumDistance.GetValueOnGameThread(), CloseDistance);
+
+	const int32 NumSlots = Crowd->GetNumSlots();
+	while (NetTiers.Num() < NumSlots)
+	{
+		NetTiers.Add(ZombieNetTiers::CLOSE);
+		SlotGenerations.Add(INDEX_NONE);
+	}
+
+	const TArray<ZombieStates>& States = Crowd->GetStates();
+
+	for (int32 Index = 0; Index < NumSlots; ++Index)
+	{
+		AZombieCharacter* ZombieCharacter = Crowd->GetCharacterAt(Index);
+		if (ZombieCharacter == nullptr) continue;
+
+		const FVector Location = ZombieCharacter->GetActorLocation();
+
+		float ClosestDistanceSquared = MAX_flt;
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			const float DistanceSquared = FVector::DistSquared(Location, ViewLocation);
+			ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, DistanceSquared);
+
+			if (DistanceSquared <= ZombieCharacter->NetCullDistanceSquared) RelevantZombieCount++;
+		}
+
+		const ZombieNetTiers NewTier = (States[Index] == ZombieStates::DEAD || ViewLocations.Num() == 0) ? ZombieNetTiers::DISTANT : ChooseNetTier(FMath::Sqrt(ClosestDistanceSquared), CloseDistance, MediumDistance);
+		TierCounts[(int32)NewTier]++;
+
+		// A ZombieCharacter that took over the slot since the last update always gets its tier
+		// applied since it could have come from anywhere.
+		const int32 Generation = Crowd->GetHandleAt(Index).Generation;
+		if (NewTier == NetTiers[Index] && SlotGenerations[Index] == Generation) continue;
+
+		NetTiers[Index] = NewTier;
+		SlotGenerations[Index] = Generation;
+		ApplyNetTier(NetDriver, ZombieCharacter, NewTier);
+	}
+}
+
+/**
+ * Sets how often the ZombieCharacter is replicated, both on the ZombieCharacter and in the
+ * replication graph if the server uses one.
+ */
+void UZombieReplicationSubsystem::ApplyNetTier(UNetDriver* NetDriver, AZombieCharacter* ZombieCharacter, ZombieNetTiers Tier)
+{
+	const float Frequency = GetNetTierFrequency(Tier);
+	ZombieCharacter->NetUpdateFrequency = Frequency;
+
+	// The replication graph keeps its own copy of how often each actor is replicated.
+	UZombieAIReplicationGraph* ReplicationGraph = Cast<UZombieAIReplicationGraph>(NetDriver->GetReplicationDriver());
+	if (ReplicationGraph != nullptr) ReplicationGraph->SetReplicationFrequency(ZombieCharacter, Frequency);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieReplicationSubsystem.generated.h"
+
+class AZombieCharacter;
+class UNetDriver;
+
+/**
+ * How often a ZombieCharacter is sent to the clients, based on how far it is from the closest
+ * of them.
+ */
+UENUM(BlueprintType)
+enum class ZombieNetTiers : uint8 {
+	CLOSE	UMETA(DisplayName = "CLOSE"),
+	MEDIUM	UMETA(DisplayName = "MEDIUM"),
+	DISTANT	UMETA(DisplayName = "DISTANT"),
+};
+
+/**
+ * The ZombieReplicationSubsystem tunes how the horde is replicated on a server. Every so often
+ * it finds the distance from each ZombieCharacter to the closest client's viewpoint and puts it
+ * in a tier that it's replicated at a fixed rate in, so zombies right next to a player move
+ * smoothly while zombies at the edge of the cull distance only update a few times a second.
+ * Dead zombies don't move, so they're always in the DISTANT tier.
+ *
+ * It also reports the bytes sent per relevant zombie per second. Every ZombieCharacter adds the
+ * size of what it writes to a client's actor channel, its properties, movement and components,
+ * and the total since the last update is divided by the time since then and by the number of
+ * zombies within the cull distance of a client, added up over every client. Bunch and packet
+ * headers aren't counted. The report is logged on every update with `zombie.Net.Report 1` and
+ * shown in `stat ZombieAI`.
+ *
+ * The ZombieReplicationBenchmarkCommandlet starts a server with loopback clients and reports
+ * the same number for hordes of different sizes. To try it out by hand, start a server and
+ * connect clients to it on the same machine:
+ *
+ *     UE4Editor ZombieAI.uproject /Game/Levels/MainLevel -server -log
+ *     UE4Editor ZombieAI.uproject 127.0.0.1 -game -windowed -ResX=800 -ResY=600
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieReplicationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieReplicationSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns the tier a ZombieCharacter at the distance from the closest client is in.
+	 *
+	 * @param Distance The distance to the closest client's viewpoint.
+	 * @param CloseDistance The distance within which ZombieCharacters are in the CLOSE tier.
+	 * @param MediumDistance The distance within which ZombieCharacters are in the MEDIUM tier.
+	 */
+	static ZombieNetTiers ChooseNetTier(float Distance, float CloseDistance, float MediumDistance);
+
+	/**
+	 * Returns the number of times per second ZombieCharacters in the tier are replicated.
+	 */
+	static float GetNetTierFrequency(ZombieNetTiers Tier);
+
+	/**
+	 * Returns the number of ZombieCharacters in the tier.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieReplication)
+	int32 CountInNetTier(ZombieNetTiers Tier) const { return TierCounts[(int32)Tier]; }
+
+	/**
+	 * Returns the number of ZombieCharacters within the cull distance of a client, added up over
+	 * every client, in the last update.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieReplication)
+	int32 GetRelevantZombieCount() const { return RelevantZombieCount; }
+
+	/**
+	 * Returns the bytes sent to the clients per second in the last update, including everything
+	 * that isn't a ZombieCharacter.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieReplication)
+	int32 GetOutBytesPerSecond() const { return OutBytesPerSecond; }
+
+	/**
+	 * Returns the bytes written to ZombieCharacter actor channels per second in the last update.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieReplication)
+	float GetZombieBytesPerSecond() const { return ZombieBytesPerSecond; }
+
+	/**
+	 * Returns the bytes written to ZombieCharacter actor channels per relevant ZombieCharacter per
+	 * second in the last update.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieReplication)
+	float GetBytesPerZombiePerSecond() const { return BytesPerZombiePerSecond; }
+
+	/**
+	 * Returns the bytes written to ZombieCharacter actor channels since the world started.
+	 */
+	int64 GetTotalZombieBytes() const { return TotalZombieBits / 8; }
+
+	/**
+	 * Called by a ZombieCharacter after it's written to a client's actor channel.
+	 *
+	 * @param NumBits The number of bits the ZombieCharacter wrote.
+	 */
+	void AddZombieChannelBits(int64 NumBits) { TotalZombieBits += NumBits; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Collects where every client is looking from and how many bytes were sent to them.
+	 */
+	void GatherViewers(UNetDriver* NetDriver);
+
+	/**
+	 * Puts every ZombieCharacter in its tier and counts the ZombieCharacters that are relevant
+	 * to each client.
+	 */
+	void UpdateNetTiers(UNetDriver* NetDriver);
+
+	/**
+	 * Sets how often the ZombieCharacter is replicated, both on the ZombieCharacter and in the
+	 * replication graph if the server uses one.
+	 */
+	static void ApplyNetTier(UNetDriver* NetDriver, AZombieCharacter* ZombieCharacter, ZombieNetTiers Tier);
+
+protected:
+	// Where every client is looking from, gathered on every update.
+	TArray<FVector> ViewLocations;
+
+	// The tier of the ZombieCharacter in each slot of the ZombieCrowdSubsystem.
+	TArray<ZombieNetTiers> NetTiers;
+
+	// The generation of the crowd slot that each entry of `NetTiers` belongs to, so that a
+	// ZombieCharacter that takes over a slot gets its tier applied.
+	TArray<int32> SlotGenerations;
+
+	// The number of ZombieCharacters in each tier.
+	int32 TierCounts[3] = {};
+
+	// The time left until the next update and the time since the last one.
+	float TimeUntilUpdate = 0.f;
+	float TimeSinceUpdate = 0.f;
+
+	// The bits written to ZombieCharacter actor channels since the world started and up to the
+	// last update.
+	int64 TotalZombieBits = 0;
+	int64 ZombieBitsAtUpdate = 0;
+
+	// The results of the last update.
+	int32 RelevantZombieCount = 0;
+	int32 OutBytesPerSecond = 0;
+	float ZombieBytesPerSecond = 0.f;
+	float BytesPerZombiePerSecond = 0.f;
+};
@@ -0,0 +1,179 @@
+#include "ZombieRoamPointSubsystem.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "NavigationSystem.h"
+
+static TAutoConsoleVariable<float> CVarZombieRoamPointsBudgetMs(
+	TEXT("zombie.RoamPoints.BudgetMs"),
+	0.25f,
+	TEXT("The number of milliseconds per frame that can be spent finding roam points."),
+	ECVF_Default);
+
+// The number of points kept ready for every area.
+static const int32 RoamPointsPerRegion = 8;
+
+// The size of the cells that area centers are rounded to.
+static const float RegionCellSize = 250.f;
+
+// The step that area radii are rounded to.
+static const float RegionRadiusStep = 50.f;
+
+// The number of seconds an area is kept after the last zombie asked for a point in it.
+static const float RegionLifetime = 30.f;
+
+// The number of seconds before an area whose center wasn't on the navmesh is tried again.
+static const float OffNavMeshRetryDelay = 10.f;
+
+/**
+ * Called when the world that owns the ZombieRoamPointSubsystem is torn down.
+ */
+void UZombieRoamPointSubsystem::Deinitialize()
+{
+	Regions.Empty();
+	RegionIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Takes a point to roam to out of the area. If the area has no points ready yet then it's
+ * filled over the next frames. Points that are farther than the radius from the center are
+ * thrown away, since the area was started by a zombie with a slightly different center.
+ *
+ * @param Center The location to roam around.
+ * @param Radius How far from the center the point can be.
+ * @param OutPoint The point to roam to. Only set if a point was ready.
+ *
+ * @return Whether a point was ready.
+ */
+bool UZombieRoamPointSubsystem::TakeRoamPoint(const FVector& Center, float Radius, FVector& OutPoint)
+{
+	const FZombieRoamRegionKey Key = MakeKey(Center, Radius);
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	const int32* RegionIndex = RegionIndices.Find(Key);
+	if (RegionIndex == nullptr)
+	{
+		// Start keeping points for the area. They'll be ready for the next zombie that asks.
+		FZombieRoamRegion& NewRegion = Regions.AddDefaulted_GetRef();
+		NewRegion.Key = Key;
+		NewRegion.Center = Center;
+		NewRegion.Radius = Radius;
+		NewRegion.Points.SetNumUninitialized(RoamPointsPerRegion);
+		NewRegion.LastUsedTime = Now;
+		RegionIndices.Add(Key, Regions.Num() - 1);
+		return false;
+	}
+
+	FZombieRoamRegion& Region = Regions[*RegionIndex];
+	Region.LastUsedTime = Now;
+
+	const float RadiusSquared = FMath::Square(Radius);
+	while (Region.Count > 0)
+	{
+		const FVector Point = Region.Points[Region.Head];
+		Region.Head = (Region.Head + 1) % RoamPointsPerRegion;
+		Region.Count--;
+
+		if (FVector::DistSquared2D(Point, Center) > RadiusSquared) continue;
+
+		OutPoint = Point;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Called every frame to drop unused areas and fill the others up under the time budget.
+ */
+void UZombieRoamPointSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::MOVEMENT);
+
+	LastFrameSampleCount = 0;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (int32 RegionIndex = Regions.Num() - 1; RegionIndex >= 0; --RegionIndex)
+	{
+		if (Now - Regions[RegionIndex].LastUsedTime > RegionLifetime) RemoveRegion(RegionIndex);
+	}
+
+	const int32 NumRegions = Regions.Num();
+	if (NumRegions == 0) return;
+
+	UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavigationSystem == nullptr) return;
+
+	const double Deadline = FPlatformTime::Seconds() + CVarZombieRoamPointsBudgetMs.GetValueOnGameThread() / 1000.0;
+
+	// Go around the areas one point at a time so that a new area doesn't have to wait for all
+	// of another area to fill up, and pick up from where the last frame stopped.
+	NextRegionIndex = NextRegionIndex % NumRegions;
+	int32 RegionsWithoutWork = 0;
+	while (RegionsWithoutWork < NumRegions && FPlatformTime::Seconds() < Deadline)
+	{
+		FZombieRoamRegion& Region = Regions[NextRegionIndex];
+		NextRegionIndex = (NextRegionIndex + 1) % NumRegions;
+
+		if (Region.Count >= RoamPointsPerRegion || Now < Region.RetryTime)
+		{
+			RegionsWithoutWork++;
+			continue;
+		}
+
+		// Only points that are connected to the center are picked so that the zombie can always
+		// get there.
+		FNavLocation NavLocation;
+		LastFrameSampleCount++;
+		if (!NavigationSystem->GetRandomReachablePointInRadius(Region.Center, Region.Radius, NavLocation))
+		{
+			// The center isn't on the navmesh so there's nothing to find. The area is kept so that
+			// the zombies that ask for it fall back to picking their own points without it being
+			// started and sampled all over again, and it's only tried again once the navmesh
+			// could have been rebuilt.
+			Region.RetryTime = Now + OffNavMeshRetryDelay;
+			RegionsWithoutWork++;
+			continue;
+		}
+		RegionsWithoutWork = 0;
+
+		const int32 Tail = (Region.Head + Region.Count) % RoamPointsPerRegion;
+		Region.Points[Tail] = NavLocation.Location;
+		Region.Count++;
+	}
+}
+
+TStatId UZombieRoamPointSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieRoamPointSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Returns the key of the area around the center.
+ */
+FZombieRoamRegionKey UZombieRoamPointSubsystem::MakeKey(const FVector& Center, float Radius)
+{
+	FZombieRoamRegionKey Key;
+	Key.Cell = FIntVector(
+		FMath::FloorToInt(Center.X / RegionCellSize),
+		FMath::FloorToInt(Center.Y / RegionCellSize),
+		FMath::FloorToInt(Center.Z / RegionCellSize)
+	);
+	Key.RadiusBucket = FMath::RoundToInt(Radius / RegionRadiusStep);
+	return Key;
+}
+
+/**
+ * Removes the area, keeping the index of every other area up to date.
+ */
+void UZombieRoamPointSubsystem::RemoveRegion(int32 RegionIndex)
+{
+	RegionIndices.Remove(Regions[RegionIndex].Key);
+	Regions.RemoveAtSwap(RegionIndex, 1, false);
+
+	// The last area was moved into the removed one's place.
+	if (RegionIndex < Regions.Num()) RegionIndices.Add(Regions[RegionIndex].Key, RegionIndex);
+}
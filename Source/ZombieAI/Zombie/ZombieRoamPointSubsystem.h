@@ -0,0 +1,127 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieRoamPointSubsystem.generated.h"
+
+/**
+ * Identifies an area that zombies roam in by the grid cell of its center and its rounded radius,
+ * so that zombies that roam around nearly the same place share their roam points.
+ */
+struct FZombieRoamRegionKey
+{
+	// The cell that the center of the area is in.
+	FIntVector Cell;
+
+	// The radius of the area, rounded.
+	int32 RadiusBucket;
+
+	bool operator==(const FZombieRoamRegionKey& Other) const { return Cell == Other.Cell && RadiusBucket == Other.RadiusBucket; }
+
+	friend uint32 GetTypeHash(const FZombieRoamRegionKey& Key) { return HashCombine(GetTypeHash(Key.Cell), GetTypeHash(Key.RadiusBucket)); }
+};
+
+/**
+ * An area that zombies roam in and the reachable points in it that are ready to be handed out.
+ */
+struct FZombieRoamRegion
+{
+	// The key the area is found by.
+	FZombieRoamRegionKey Key;
+
+	// The center and radius of the area.
+	FVector Center;
+	float Radius;
+
+	// A ring buffer of points on the navmesh that can be reached from the center.
+	TArray<FVector, TInlineAllocator<8>> Points;
+
+	// The index of the oldest point in the ring buffer and the number of points in it.
+	int32 Head = 0;
+	int32 Count = 0;
+
+	// The last time a zombie asked for a point in the area.
+	float LastUsedTime = 0.f;
+
+	// The time before which no points are looked for in the area, because its center wasn't on
+	// the navmesh the last time.
+	float RetryTime = 0.f;
+};
+
+/**
+ * The ZombieRoamPointSubsystem hands out points for zombies to roam to that are known to be on
+ * the navmesh and reachable from where they roam around. The points are found ahead of time
+ * under a per-frame time budget and kept in a small ring buffer for every area, so a zombie that
+ * decides to roam never has to ask the navmesh for a point itself and never gets sent somewhere
+ * it can't get to. Zombies whose centers fall in the same cell share an area, so a point is only
+ * handed out if it's also within the radius of the zombie's own center.
+ *
+ * The budget is set with `zombie.RoamPoints.BudgetMs`.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieRoamPointSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieRoamPointSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Takes a point to roam to out of the area. If the area has no points ready yet then it's
+	 * filled over the next frames. Points that are farther than the radius from the center are
+	 * thrown away, since the area was started by a zombie with a slightly different center.
+	 *
+	 * @param Center The location to roam around.
+	 * @param Radius How far from the center the point can be.
+	 * @param OutPoint The point to roam to. Only set if a point was ready.
+	 *
+	 * @return Whether a point was ready.
+	 */
+	bool TakeRoamPoint(const FVector& Center, float Radius, FVector& OutPoint);
+
+	/**
+	 * Returns the number of areas that points are kept for.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieRoamPoints)
+	int32 GetNumRegions() const { return Regions.Num(); }
+
+	/**
+	 * Returns the number of points that were found in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieRoamPoints)
+	int32 GetLastFrameSampleCount() const { return LastFrameSampleCount; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Returns the key of the area around the center.
+	 */
+	static FZombieRoamRegionKey MakeKey(const FVector& Center, float Radius);
+
+	/**
+	 * Removes the area, keeping the index of every other area up to date.
+	 */
+	void RemoveRegion(int32 RegionIndex);
+
+protected:
+	// The areas that points are kept for.
+	TArray<FZombieRoamRegion> Regions;
+
+	// The index of every area in `Regions`.
+	TMap<FZombieRoamRegionKey, int32> RegionIndices;
+
+	// The area that the next frame starts filling from.
+	int32 NextRegionIndex = 0;
+
+	// The number of points that were found in the last frame.
+	int32 LastFrameSampleCount = 0;
+};
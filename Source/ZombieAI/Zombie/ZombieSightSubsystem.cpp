@@ -0,0 +1,350 @@
+#include "ZombieSightSubsystem.h"
+#include "ZombieAIController.h"
+#include "ZombieLineOfSightSubsystem.h"
+#include "../Player/PlayerCharacter.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Perception/AISenseConfig_Sight.h"
+
+static TAutoConsoleVariable<int32> CVarZombieSightShared(
+	TEXT("zombie.Sight.Shared"),
+	0,
+	TEXT("Whether zombies use the shared ZombieSightSubsystem instead of their own perception component. Only applies to zombies that are taken over after it's changed."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieSightMaxTracesPerFrame(
+	TEXT("zombie.Sight.MaxTracesPerFrame"),
+	64,
+	TEXT("The number of line of sight traces the ZombieSightSubsystem can do per frame. Zombies that don't fit are updated in the following frames."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieSightReducedFrameInterval(
+	TEXT("zombie.Sight.ReducedFrameInterval"),
+	4,
+	TEXT("The number of frames between sight updates of zombies in the REDUCED level of detail tier."),
+	ECVF_Default);
+
+/**
+ * Called when the world that owns the ZombieSightSubsystem is torn down.
+ */
+void UZombieSightSubsystem::Deinitialize()
+{
+	Players.Empty();
+	Observers.Empty();
+	SightRadiiSquared.Empty();
+	LoseSightRadiiSquared.Empty();
+	PeripheralVisionCosines.Empty();
+	SightMaxAges.Empty();
+	SightConfirmTimes.Empty();
+	SensedPlayers.Empty();
+	FreeObserverIndices.Empty();
+	PlayerGrid.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Returns whether the ZombieAIControllers should use the ZombieSightSubsystem instead of their
+ * own perception component.
+ */
+bool UZombieSightSubsystem::IsSharedSightEnabled()
+{
+	return CVarZombieSightShared.GetValueOnGameThread() != 0;
+}
+
+/**
+ * Adds the PlayerCharacter to the things that zombies can see. Only the first 32
+ * PlayerCharacters can be seen.
+ *
+ * @param PlayerCharacter The PlayerCharacter to add.
+ */
+void UZombieSightSubsystem::RegisterPlayer(APlayerCharacter* PlayerCharacter)
+{
+	Players.Add(PlayerCharacter);
+}
+
+/**
+ * Removes the PlayerCharacter from the things that zombies can see.
+ *
+ * @param PlayerCharacter The PlayerCharacter to remove.
+ */
+void UZombieSightSubsystem::UnregisterPlayer(APlayerCharacter* PlayerCharacter)
+{
+	Players.Remove(PlayerCharacter, SensedPlayers);
+}
+
+/**
+ * Adds the ZombieAIController to the zombies that look for PlayerCharacters.
+ *
+ * @param Controller The ZombieAIController to add.
+ *
+ * @return The index of the ZombieAIController in the ZombieSightSubsystem.
+ */
+int32 UZombieSightSubsystem::RegisterObserver(AZombieAIController* Controller)
+{
+	if (Controller == nullptr) return INDEX_NONE;
+
+	int32 ObserverIndex;
+	if (FreeObserverIndices.Num() > 0)
+	{
+		ObserverIndex = FreeObserverIndices.Pop(false);
+	}
+	else
+	{
+		ObserverIndex = Observers.Add(nullptr);
+		SightRadiiSquared.AddDefaulted();
+		LoseSightRadiiSquared.AddDefaulted();
+		PeripheralVisionCosines.AddDefaulted();
+		SightMaxAges.AddDefaulted();
+		SightConfirmTimes.AddDefaulted();
+		SensedPlayers.AddDefaulted();
+	}
+
+	// Use the same settings that the ZombieAIController's sight sense would have used.
+	const float PeripheralVisionAngle = (Controller->ZombieSight != nullptr) ? Controller->ZombieSight->PeripheralVisionAngleDegrees : 90.f;
+
+	Observers[ObserverIndex] = Controller;
+	SightRadiiSquared[ObserverIndex] = FMath::Square(Controller->ZombieSightRadius);
+	LoseSightRadiiSquared[ObserverIndex] = FMath::Square(Controller->ZombieLoseSightRadius);
+	PeripheralVisionCosines[ObserverIndex] = FMath::Cos(FMath::DegreesToRadians(PeripheralVisionAngle));
+	SightMaxAges[ObserverIndex] = Controller->ZombieSightMaxAge;
+	SightConfirmTimes[ObserverIndex] = 0.f;
+	SensedPlayers[ObserverIndex] = 0;
+
+	CellSize = FMath::Max(CellSize, Controller->ZombieLoseSightRadius);
+
+	return ObserverIndex;
+}
+
+/**
+ * Removes the ZombieAIController from the zombies that look for PlayerCharacters.
+ *
+ * @param ObserverIndex The index returned by `RegisterObserver`.
+ */
+void UZombieSightSubsystem::UnregisterObserver(int32 ObserverIndex)
+{
+	if (!Observers.IsValidIndex(ObserverIndex) || Observers[ObserverIndex] == nullptr) return;
+
+	Observers[ObserverIndex] = nullptr;
+	SensedPlayers[ObserverIndex] = 0;
+	FreeObserverIndices.Add(ObserverIndex);
+}
+
+/**
+ * Returns whether the zombie currently sees the actor.
+ *
+ * @param ObserverIndex The index returned by `RegisterObserver`.
+ * @param Actor The actor to check.
+ */
+bool UZombieSightSubsystem::IsActorSensed(int32 ObserverIndex, const AActor* Actor) const
+{
+	if (!SensedPlayers.IsValidIndex(ObserverIndex) || Actor == nullptr) return false;
+
+	const int32 PlayerIndex = Players.IndexOf(Actor);
+	if (PlayerIndex == INDEX_NONE) return false;
+
+	return (SensedPlayers[ObserverIndex] & (1u << PlayerIndex)) != 0;
+}
+
+/**
+ * Called every frame to update what the zombies see.
+ */
+void UZombieSightSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::PERCEPTION);
+
+	LastFrameTraceCount = 0;
+
+	const int32 NumObservers = Observers.Num();
+	if (NumObservers == 0) return;
+
+	BuildPlayerGrid();
+
+	UWorld* World = GetWorld();
+	UZombieLineOfSightSubsystem* LineOfSight = (World != nullptr && UZombieLineOfSightSubsystem::IsAsyncLineOfSightEnabled()) ? World->GetSubsystem<UZombieLineOfSightSubsystem>() : nullptr;
+
+	// Go through every zombie once, starting with the one that ran out of trace budget last
+	// frame so that every zombie gets its turn.
+	const int32 MaxTraces = FMath::Max(CVarZombieSightMaxTracesPerFrame.GetValueOnGameThread(), 1);
+	int32 TraceBudget = MaxTraces;
+
+	const uint64 ReducedFrameInterval = (uint64)FMath::Max(CVarZombieSightReducedFrameInterval.GetValueOnGameThread(), 1);
+
+	NextObserverIndex = NextObserverIndex % NumObservers;
+	for (int32 Step = 0; Step < NumObservers; ++Step)
+	{
+		const int32 ObserverIndex = (NextObserverIndex + Step) % NumObservers;
+		if (Observers[ObserverIndex] == nullptr) continue;
+
+		// Zombies further away from the players look around less often, and dormant zombies
+		// don't look around at all.
+		const AZombieCharacter* ZombieCharacter = Observers[ObserverIndex]->ZombieCharacter;
+		const ZombieLODTiers LODTier = (ZombieCharacter != nullptr) ? ZombieCharacter->GetLODTier() : ZombieLODTiers::FULL;
+		if (LODTier == ZombieLODTiers::DORMANT)
+		{
+			SensedPlayers[ObserverIndex] = 0;
+			continue;
+		}
+		if (LODTier == ZombieLODTiers::REDUCED && (GFrameCounter + ObserverIndex) % ReducedFrameInterval != 0) continue;
+
+		// The first zombie of the frame always finishes, so a zombie that needs more traces
+		// than a frame's budget goes over it once instead of being stuck at the front forever.
+		if (!UpdateObserver(ObserverIndex, LineOfSight, TraceBudget, TraceBudget == MaxTraces))
+		{
+			NextObserverIndex = ObserverIndex;
+			break;
+		}
+	}
+
+	LastFrameTraceCount = MaxTraces - TraceBudget;
+}
+
+TStatId UZombieSightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieSightSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Puts every PlayerCharacter into the grid cell that contains it.
+ */
+void UZombieSightSubsystem::BuildPlayerGrid()
+{
+	// Reset the cells instead of emptying the map so that their memory is kept around.
+	for (TPair<FIntPoint, TArray<int32, TInlineAllocator<4>>>& Cell : PlayerGrid)
+	{
+		Cell.Value.Reset();
+	}
+
+	for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); ++PlayerIndex)
+	{
+		const APlayerCharacter* PlayerCharacter = Players[PlayerIndex];
+		if (PlayerCharacter == nullptr) continue;
+
+		PlayerGrid.FindOrAdd(GetCell(PlayerCharacter->GetActorLocation())).Add(PlayerIndex);
+	}
+}
+
+/**
+ * Updates what one zombie sees.
+ *
+ * @param ObserverIndex The index of the zombie.
+ * @param LineOfSight The ZombieLineOfSightSubsystem to ask for line of sight, or nullptr to trace
+ * synchronously.
+ * @param TraceBudget The number of synchronous line of sight traces that can still be done this frame.
+ * @param bCanOverrunBudget Whether the zombie is finished even if it needs more traces than the
+ * budget has left, for the first zombie of the frame so that one that needs more traces than a
+ * whole frame's budget still gets its turn.
+ *
+ * @return Whether the zombie was fully updated. If not, the trace budget ran out and the
+ * zombie has to be updated again next frame.
+ */
+bool UZombieSightSubsystem::UpdateObserver(int32 ObserverIndex, UZombieLineOfSightSubsystem* LineOfSight, int32& TraceBudget, bool bCanOverrunBudget)
+{
+	AZombieAIController* Controller = Observers[ObserverIndex];
+	const APawn* ZombiePawn = Controller->GetPawn();
+	const uint32 OldSensedPlayers = SensedPlayers[ObserverIndex];
+	uint32 NewSensedPlayers = 0;
+
+	// Whether every line of sight result this zombie needed was available.
+	bool bAllConfirmed = true;
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	if (ZombiePawn != nullptr)
+	{
+		const FVector EyeLocation = ZombiePawn->GetPawnViewLocation();
+		const FVector Forward = ZombiePawn->GetActorForwardVector();
+		const FIntPoint ZombieCell = GetCell(EyeLocation);
+
+		// The cells are as big as the largest lose sight radius so the PlayerCharacters that can
+		// be seen are always in the zombie's cell or one of the eight around it.
+		for (int32 CellY = ZombieCell.Y - 1; CellY <= ZombieCell.Y + 1; ++CellY)
+		{
+			for (int32 CellX = ZombieCell.X - 1; CellX <= ZombieCell.X + 1; ++CellX)
+			{
+				const TArray<int32, TInlineAllocator<4>>* CellPlayers = PlayerGrid.Find(FIntPoint(CellX, CellY));
+				if (CellPlayers == nullptr) continue;
+
+				for (const int32 PlayerIndex : *CellPlayers)
+				{
+					const uint32 PlayerBit = 1u << PlayerIndex;
+					const APlayerCharacter* PlayerCharacter = Players[PlayerIndex];
+
+					// A PlayerCharacter that's already seen is kept until it's past the lose sight
+					// radius, like the sight sense does.
+					const float RadiusSquared = (OldSensedPlayers & PlayerBit) ? LoseSightRadiiSquared[ObserverIndex] : SightRadiiSquared[ObserverIndex];
+					const FVector ToPlayer = PlayerCharacter->GetActorLocation() - EyeLocation;
+					if (ToPlayer.SizeSquared() > RadiusSquared) continue;
+
+					if (FVector::DotProduct(Forward, ToPlayer.GetSafeNormal()) < PeripheralVisionCosines[ObserverIndex]) continue;
+
+					if (LineOfSight != nullptr)
+					{
+						bool bVisible = false;
+						if (!LineOfSight->QueryLineOfSight(EyeLocation, PlayerCharacter->GetActorLocation(), SightMaxAges[ObserverIndex], bVisible))
+						{
+							// The trace is still on its way, so keep what the zombie saw before, but
+							// no longer than its sight max age.
+							bAllConfirmed = false;
+							bVisible = (OldSensedPlayers & PlayerBit) && Now - SightConfirmTimes[ObserverIndex] <= SightMaxAges[ObserverIndex];
+						}
+
+						if (bVisible) NewSensedPlayers |= PlayerBit;
+						continue;
+					}
+
+					// Stop before anything is changed if there's no budget left so that the zombie
+					// keeps what it saw until it can be fully updated.
+					if (TraceBudget <= 0 && !bCanOverrunBudget) return false;
+					TraceBudget--;
+
+					if (HasLineOfSight(EyeLocation, PlayerCharacter->GetActorLocation(), ZombiePawn, PlayerCharacter))
+					{
+						NewSensedPlayers |= PlayerBit;
+					}
+				}
+			}
+		}
+	}
+
+	SensedPlayers[ObserverIndex] = NewSensedPlayers;
+	if (bAllConfirmed) SightConfirmTimes[ObserverIndex] = Now;
+
+	// Tell the ZombieAIController about every PlayerCharacter that it started or stopped
+	// seeing, the same way the perception component would.
+	uint32 ChangedPlayers = OldSensedPlayers ^ NewSensedPlayers;
+	while (ChangedPlayers != 0)
+	{
+		const int32 PlayerIndex = FMath::CountTrailingZeros(ChangedPlayers);
+		ChangedPlayers &= ChangedPlayers - 1;
+
+		if (Players[PlayerIndex] != nullptr) Controller->OnSharedSightUpdated(Players[PlayerIndex]);
+	}
+
+	return true;
+}
+
+/**
+ * Returns whether nothing blocks the view between the two locations.
+ */
+bool UZombieSightSubsystem::HasLineOfSight(const FVector& From, const FVector& To, const AActor* Observer, const AActor* Target) const
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return false;
+
+	// Use the visibility channel like the sight sense does. Pawns ignore it so other zombies
+	// don't block the view.
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ZombieSight), true, Observer);
+	QueryParams.AddIgnoredActor(Target);
+
+	return !World->LineTraceTestByChannel(From, To, ECC_Visibility, QueryParams);
+}
+
+/**
+ * Returns the grid cell that contains the location.
+ */
+FIntPoint UZombieSightSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
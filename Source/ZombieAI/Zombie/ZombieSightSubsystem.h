@@ -0,0 +1,166 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombiePlayerSlots.h"
+#include "ZombieSightSubsystem.generated.h"
+
+class AZombieAIController;
+class APlayerCharacter;
+
+/**
+ * The ZombieSightSubsystem is a shared replacement for the sight sense of every ZombieAIController's
+ * perception component. PlayerCharacters are put into a uniform grid every frame and each zombie
+ * only looks at the players in the cells around it, so the cost doesn't grow with the number of
+ * zombies times the number of stimuli sources. Zombies that pass the radius and cone checks
+ * still need a line of sight trace, and those traces are spread over several frames with a
+ * per-frame budget, or handed to the ZombieLineOfSightSubsystem when `zombie.LineOfSight.Async` is 1.
+ *
+ * The ZombieAIControllers use it instead of their perception component when `zombie.Sight.Shared`
+ * is 1 at the time they take over their ZombieCharacter.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieSightSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieSightSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Returns whether the ZombieAIControllers should use the ZombieSightSubsystem instead of their
+	 * own perception component.
+	 */
+	static bool IsSharedSightEnabled();
+
+	/**
+	 * Adds the PlayerCharacter to the things that zombies can see. Only the first 32
+	 * PlayerCharacters can be seen.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter to add.
+	 */
+	void RegisterPlayer(APlayerCharacter* PlayerCharacter);
+
+	/**
+	 * Removes the PlayerCharacter from the things that zombies can see.
+	 *
+	 * @param PlayerCharacter The PlayerCharacter to remove.
+	 */
+	void UnregisterPlayer(APlayerCharacter* PlayerCharacter);
+
+	/**
+	 * Adds the ZombieAIController to the zombies that look for PlayerCharacters.
+	 *
+	 * @param Controller The ZombieAIController to add.
+	 *
+	 * @return The index of the ZombieAIController in the ZombieSightSubsystem.
+	 */
+	int32 RegisterObserver(AZombieAIController* Controller);
+
+	/**
+	 * Removes the ZombieAIController from the zombies that look for PlayerCharacters.
+	 *
+	 * @param ObserverIndex The index returned by `RegisterObserver`.
+	 */
+	void UnregisterObserver(int32 ObserverIndex);
+
+	/**
+	 * Returns whether the zombie currently sees the actor.
+	 *
+	 * @param ObserverIndex The index returned by `RegisterObserver`.
+	 * @param Actor The actor to check.
+	 */
+	bool IsActorSensed(int32 ObserverIndex, const AActor* Actor) const;
+
+	/**
+	 * Returns the number of line of sight traces that were done in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieSight)
+	int32 GetLastFrameTraceCount() const { return LastFrameTraceCount; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Puts every PlayerCharacter into the grid cell that contains it.
+	 */
+	void BuildPlayerGrid();
+
+	/**
+	 * Updates what one zombie sees.
+	 *
+	 * @param ObserverIndex The index of the zombie.
+	 * @param LineOfSight The ZombieLineOfSightSubsystem to ask for line of sight, or nullptr to trace
+	 * synchronously.
+	 * @param TraceBudget The number of synchronous line of sight traces that can still be done this frame.
+	 * @param bCanOverrunBudget Whether the zombie is finished even if it needs more traces than the
+	 * budget has left, for the first zombie of the frame so that one that needs more traces than a
+	 * whole frame's budget still gets its turn.
+	 *
+	 * @return Whether the zombie was fully updated. If not, the trace budget ran out and the
+	 * zombie has to be updated again next frame.
+	 */
+	bool UpdateObserver(int32 ObserverIndex, class UZombieLineOfSightSubsystem* LineOfSight, int32& TraceBudget, bool bCanOverrunBudget);
+
+	/**
+	 * Returns whether nothing blocks the view between the two locations.
+	 */
+	bool HasLineOfSight(const FVector& From, const FVector& To, const AActor* Observer, const AActor* Target) const;
+
+	/**
+	 * Returns the grid cell that contains the location.
+	 */
+	FIntPoint GetCell(const FVector& Location) const;
+
+protected:
+	// The PlayerCharacters that can be seen. The index of a PlayerCharacter is its bit in the
+	// `SensedPlayers` masks.
+	UPROPERTY()
+	FZombiePlayerSlots Players;
+
+	// The ZombieAIControllers that look for PlayerCharacters, or nullptr for a free slot.
+	UPROPERTY()
+	TArray<AZombieAIController*> Observers;
+
+	// The squared sight radius of each zombie.
+	TArray<float> SightRadiiSquared;
+
+	// The squared radius at which each zombie loses sight of a PlayerCharacter it already sees.
+	TArray<float> LoseSightRadiiSquared;
+
+	// The cosine of the half angle of each zombie's view cone.
+	TArray<float> PeripheralVisionCosines;
+
+	// How long each zombie remembers a PlayerCharacter it can't confirm it still sees.
+	TArray<float> SightMaxAges;
+
+	// The last time each zombie had a line of sight result for every PlayerCharacter it looked at.
+	TArray<float> SightConfirmTimes;
+
+	// A bit for every PlayerCharacter that each zombie currently sees.
+	TArray<uint32> SensedPlayers;
+
+	// The observer slots that are free to be reused.
+	TArray<int32> FreeObserverIndices;
+
+	// The PlayerCharacters in each grid cell, rebuilt every frame.
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<4>>> PlayerGrid;
+
+	// The size of a grid cell. This is the largest lose sight radius so that a zombie only ever
+	// has to look at the cells next to its own.
+	float CellSize = 1000.f;
+
+	// The zombie that the next frame's update starts with.
+	int32 NextObserverIndex = 0;
+
+	// The number of line of sight traces that were done in the last frame.
+	int32 LastFrameTraceCount = 0;
+};
@@ -0,0 +1,289 @@
+#include "ZombieThinkScheduler.h"
+#include "ZombieAIController.h"
+#include "ZombieCharacter.h"
+#include "ZombieBrain.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarZombieThinkScheduled(
+	TEXT("zombie.Think.Scheduled"),
+	1,
+	TEXT("Whether zombie decisions are queued and made under a per-frame budget (1) or made as soon as they're requested (0)."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarZombieThinkBudgetMs(
+	TEXT("zombie.Think.BudgetMs"),
+	1.f,
+	TEXT("The number of milliseconds per frame that can be spent making zombie decisions."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieThinkParallel(
+	TEXT("zombie.Think.Parallel"),
+	0,
+	TEXT("Whether queued zombie decisions are made in parallel batches on the task graph."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarZombieThinkBatchSize(
+	TEXT("zombie.Think.BatchSize"),
+	128,
+	TEXT("The number of zombie decisions that are made together in one parallel batch."),
+	ECVF_Default);
+
+/**
+ * Called when the world that owns the ZombieThinkScheduler is torn down.
+ */
+void UZombieThinkScheduler::Deinitialize()
+{
+	HighPriorityQueue.Empty();
+	LowPriorityQueue.Empty();
+	HighPriorityHead = 0;
+	LowPriorityHead = 0;
+	BatchRequests.Empty();
+	BatchInputs.Empty();
+	BatchResults.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Queues a decision for the ZombieAIController, or makes it right away if scheduling is
+ * turned off.
+ *
+ * @param Controller The ZombieAIController that has to make the decision.
+ * @param Type The decision to make.
+ * @param Target The actor the decision is about.
+ */
+void UZombieThinkScheduler::RequestThink(AZombieAIController* Controller, ZombieThinkTypes Type, AActor* Target)
+{
+	if (Controller == nullptr) return;
+
+	FZombieThinkRequest Request;
+	Request.Controller = Controller;
+	Request.Type = Type;
+	Request.Target = Target;
+
+	if (CVarZombieThinkScheduled.GetValueOnGameThread() == 0)
+	{
+		ExecuteRequest(Request);
+		return;
+	}
+
+	if (IsHighPriority(Request))
+	{
+		HighPriorityQueue.Add(Request);
+	}
+	else
+	{
+		LowPriorityQueue.Add(Request);
+	}
+}
+
+/**
+ * Drops every decision the ZombieAIController still has waiting, so that a ZombieAIController
+ * that was reset doesn't act on what its old ZombieCharacter was doing.
+ *
+ * @param Controller The ZombieAIController whose decisions should be dropped.
+ */
+void UZombieThinkScheduler::CancelRequests(AZombieAIController* Controller)
+{
+	if (Controller == nullptr) return;
+
+	RemoveRequests(HighPriorityQueue, HighPriorityHead, Controller);
+	RemoveRequests(LowPriorityQueue, LowPriorityHead, Controller);
+
+	// A parallel batch that is being applied right now shouldn't hand its result to the
+	// ZombieAIController either.
+	for (FZombieThinkRequest& Request : BatchRequests)
+	{
+		if (Request.Controller == Controller) Request.Controller.Reset();
+	}
+}
+
+/**
+ * Called every frame to work through the queued decisions.
+ */
+void UZombieThinkScheduler::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::DECISION);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Deadline = StartTime + FMath::Max(CVarZombieThinkBudgetMs.GetValueOnGameThread(), 0.f) / 1000.0;
+
+	ThinkCount = 0;
+
+	// Chasing zombies go first, idle and roaming zombies get whatever budget is left over.
+	if (CVarZombieThinkParallel.GetValueOnGameThread() != 0)
+	{
+		const bool bReachedDeadline = ProcessQueueInParallel(HighPriorityQueue, HighPriorityHead, Deadline);
+		if (!bReachedDeadline) ProcessQueueInParallel(LowPriorityQueue, LowPriorityHead, Deadline);
+	}
+	else
+	{
+		const bool bReachedDeadline = ProcessQueue(HighPriorityQueue, HighPriorityHead, Deadline);
+		if (!bReachedDeadline) ProcessQueue(LowPriorityQueue, LowPriorityHead, Deadline);
+	}
+
+	LastFrameCostMs = static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	LastFrameThinkCount = ThinkCount;
+}
+
+TStatId UZombieThinkScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieThinkScheduler, STATGROUP_ZombieAI);
+}
+
+/**
+ * Returns whether the decision should be made before the ones of idle and roaming zombies.
+ */
+bool UZombieThinkScheduler::IsHighPriority(const FZombieThinkRequest& Request)
+{
+	// Perception updates are what start and stop chases so they're always served first.
+	if (Request.Type == ZombieThinkTypes::PERCEPTION_UPDATED) return true;
+
+	const AZombieAIController* Controller = Request.Controller.Get();
+	if (Controller == nullptr || Controller->ZombieCharacter == nullptr) return false;
+
+	const ZombieStates State = Controller->ZombieCharacter->GetState();
+	return State == ZombieStates::CHASE || State == ZombieStates::ATTACK;
+}
+
+/**
+ * Makes the decision if the ZombieAIController still exists.
+ */
+void UZombieThinkScheduler::ExecuteRequest(const FZombieThinkRequest& Request)
+{
+	AZombieAIController* Controller = Request.Controller.Get();
+	if (Controller == nullptr) return;
+
+	Controller->Think(Request.Type, Request.Target.Get());
+}
+
+/**
+ * Makes decisions from the front of the queue until the queue is empty or the frame's
+ * deadline has passed. At least one decision is made every frame so the queues always drain.
+ *
+ * @param Queue The queue to work through.
+ * @param Head The index of the first decision in the queue that hasn't been made yet.
+ * @param Deadline The time, in platform seconds, after which no more decisions should be made.
+ *
+ * @return Whether the deadline was reached.
+ */
+bool UZombieThinkScheduler::ProcessQueue(TArray<FZombieThinkRequest>& Queue, int32& Head, double Deadline)
+{
+	bool bReachedDeadline = false;
+
+	while (Head < Queue.Num())
+	{
+		if (ThinkCount > 0 && FPlatformTime::Seconds() >= Deadline)
+		{
+			bReachedDeadline = true;
+			break;
+		}
+
+		// Copy the request out since making the decision can queue new requests and
+		// reallocate the queue.
+		const FZombieThinkRequest Request = Queue[Head++];
+		ExecuteRequest(Request);
+		ThinkCount++;
+	}
+
+	// Drop the decisions that have been made from the front of the queue.
+	Queue.RemoveAt(0, Head, false);
+	Head = 0;
+
+	return bReachedDeadline;
+}
+
+/**
+ * Removes the decisions of the ZombieAIController that haven't been made yet from the queue.
+ *
+ * @param Queue The queue to remove the decisions from.
+ * @param Head The index of the first decision in the queue that hasn't been made yet.
+ * @param Controller The ZombieAIController whose decisions should be removed.
+ */
+void UZombieThinkScheduler::RemoveRequests(TArray<FZombieThinkRequest>& Queue, int32 Head, const AZombieAIController* Controller)
+{
+	// Decisions before `Head` have already been made and are dropped at the end of the frame, so
+	// only the ones after it are compacted. This keeps the order of the remaining decisions.
+	int32 WriteIndex = Head;
+	for (int32 ReadIndex = Head; ReadIndex < Queue.Num(); ++ReadIndex)
+	{
+		if (Queue[ReadIndex].Controller == Controller) continue;
+		if (WriteIndex != ReadIndex) Queue[WriteIndex] = MoveTemp(Queue[ReadIndex]);
+		WriteIndex++;
+	}
+
+	Queue.SetNum(WriteIndex, false);
+}
+
+/**
+ * Works through the queue like `ProcessQueue` but makes the decisions in parallel batches.
+ *
+ * @param Queue The queue to work through.
+ * @param Head The index of the first decision in the queue that hasn't been made yet.
+ * @param Deadline The time, in platform seconds, after which no more batches should be started.
+ *
+ * @return Whether the deadline was reached.
+ */
+bool UZombieThinkScheduler::ProcessQueueInParallel(TArray<FZombieThinkRequest>& Queue, int32& Head, double Deadline)
+{
+	const int32 BatchSize = FMath::Max(CVarZombieThinkBatchSize.GetValueOnGameThread(), 1);
+	bool bReachedDeadline = false;
+
+	TSet<AZombieAIController*, DefaultKeyFuncs<AZombieAIController*>, TInlineSetAllocator<256>> ControllersInBatch;
+
+	while (Head < Queue.Num())
+	{
+		if (ThinkCount > 0 && FPlatformTime::Seconds() >= Deadline)
+		{
+			bReachedDeadline = true;
+			break;
+		}
+
+		BatchRequests.Reset();
+		BatchInputs.Reset();
+		ControllersInBatch.Reset();
+
+		// Gather the inputs on the game thread. A batch ends early if a ZombieAIController shows
+		// up in it twice, since its second decision has to see the result of its first one.
+		while (Head < Queue.Num() && BatchRequests.Num() < BatchSize)
+		{
+			const FZombieThinkRequest& Request = Queue[Head];
+			AZombieAIController* Controller = Request.Controller.Get();
+
+			if (Controller != nullptr && ControllersInBatch.Contains(Controller)) break;
+			Head++;
+			ThinkCount++;
+
+			FZombieThinkInput Input;
+			if (Controller == nullptr || !Controller->GatherThinkInput(Request.Type, Request.Target.Get(), Controller->NextRandomSeed(), Input)) continue;
+
+			ControllersInBatch.Add(Controller);
+			BatchRequests.Add(Request);
+			BatchInputs.Add(Input);
+		}
+
+		// Make every decision of the batch on the task graph. The decisions only read their own
+		// input and write their own result so they don't need any locking.
+		BatchResults.SetNum(BatchInputs.Num(), false);
+		ParallelFor(BatchInputs.Num(), [this](int32 Index)
+		{
+			BatchResults[Index] = FZombieBrain::Decide(BatchInputs[Index]);
+		});
+
+		// Apply the results back on the game thread.
+		for (int32 Index = 0; Index < BatchRequests.Num(); ++Index)
+		{
+			AZombieAIController* Controller = BatchRequests[Index].Controller.Get();
+			if (Controller != nullptr) Controller->CommitThinkResult(BatchResults[Index], BatchRequests[Index].Target.Get());
+		}
+	}
+
+	// Drop the decisions that have been made from the front of the queue.
+	Queue.RemoveAt(0, Head, false);
+	Head = 0;
+
+	return bReachedDeadline;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieThinkTypes.h"
+#include "ZombieThinkScheduler.generated.h"
+
+class AZombieAIController;
+
+/**
+ * A decision that is waiting for its turn in the ZombieThinkScheduler.
+ */
+struct FZombieThinkRequest
+{
+	// The ZombieAIController that has to make the decision.
+	TWeakObjectPtr<AZombieAIController> Controller;
+
+	// The decision to make.
+	ZombieThinkTypes Type;
+
+	// The actor the decision is about, like the actor that was perceived.
+	TWeakObjectPtr<AActor> Target;
+};
+
+/**
+ * The ZombieThinkScheduler queues the decisions of every ZombieAIController and works
+ * through them under a per-frame time budget, serving zombies that are chasing before
+ * the ones that are idle or roaming. This spreads a wave of zombies that all change state
+ * in the same frame over several frames instead of causing a spike.
+ *
+ * The budget is set with `zombie.Think.BudgetMs` and the scheduler can be turned off with
+ * `zombie.Think.Scheduled 0`, in which case decisions are made as soon as they're requested.
+ *
+ * With `zombie.Think.Parallel 1` the queued decisions are made in batches. The input of every
+ * decision in a batch is gathered on the game thread, the decisions are made in parallel on
+ * the task graph and the results are applied back on the game thread in one pass.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieThinkScheduler : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieThinkScheduler is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Queues a decision for the ZombieAIController, or makes it right away if scheduling is
+	 * turned off.
+	 *
+	 * @param Controller The ZombieAIController that has to make the decision.
+	 * @param Type The decision to make.
+	 * @param Target The actor the decision is about.
+	 */
+	void RequestThink(AZombieAIController* Controller, ZombieThinkTypes Type, AActor* Target = nullptr);
+
+	/**
+	 * Drops every decision the ZombieAIController still has waiting, so that a ZombieAIController
+	 * that was reset doesn't act on what its old ZombieCharacter was doing.
+	 *
+	 * @param Controller The ZombieAIController whose decisions should be dropped.
+	 */
+	void CancelRequests(AZombieAIController* Controller);
+
+	/**
+	 * Returns the number of decisions waiting to be made.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieThinkScheduler)
+	int32 GetQueueDepth() const { return (HighPriorityQueue.Num() - HighPriorityHead) + (LowPriorityQueue.Num() - LowPriorityHead); }
+
+	/**
+	 * Returns the time spent making decisions in the last frame in milliseconds.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieThinkScheduler)
+	float GetLastFrameCostMs() const { return LastFrameCostMs; }
+
+	/**
+	 * Returns the number of decisions made in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieThinkScheduler)
+	int32 GetLastFrameThinkCount() const { return LastFrameThinkCount; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Returns whether the decision should be made before the ones of idle and roaming zombies.
+	 */
+	static bool IsHighPriority(const FZombieThinkRequest& Request);
+
+	/**
+	 * Makes the decision if the ZombieAIController still exists.
+	 */
+	static void ExecuteRequest(const FZombieThinkRequest& Request);
+
+	/**
+	 * Makes decisions from the front of the queue until the queue is empty or the frame's
+	 * deadline has passed. At least one decision is made every frame so the queues always drain.
+	 *
+	 * @param Queue The queue to work through.
+	 * @param Head The index of the first decision in the queue that hasn't been made yet.
+	 * @param Deadline The time, in platform seconds, after which no more decisions should be made.
+	 *
+	 * @return Whether the deadline was reached.
+	 */
+	bool ProcessQueue(TArray<FZombieThinkRequest>& Queue, int32& Head, double Deadline);
+
+	/**
+	 * Works through the queue like `ProcessQueue` but makes the decisions in parallel batches.
+	 *
+	 * @param Queue The queue to work through.
+	 * @param Head The index of the first decision in the queue that hasn't been made yet.
+	 * @param Deadline The time, in platform seconds, after which no more batches should be started.
+	 *
+	 * @return Whether the deadline was reached.
+	 */
+	bool ProcessQueueInParallel(TArray<FZombieThinkRequest>& Queue, int32& Head, double Deadline);
+
+	/**
+	 * Removes the decisions of the ZombieAIController that haven't been made yet from the queue.
+	 *
+	 * @param Queue The queue to remove the decisions from.
+	 * @param Head The index of the first decision in the queue that hasn't been made yet.
+	 * @param Controller The ZombieAIController whose decisions should be removed.
+	 */
+	static void RemoveRequests(TArray<FZombieThinkRequest>& Queue, int32 Head, const AZombieAIController* Controller);
+
+protected:
+	// The decisions of zombies that are chasing or attacking, or that just perceived something.
+	TArray<FZombieThinkRequest> HighPriorityQueue;
+
+	// The decisions of zombies that are idle or roaming.
+	TArray<FZombieThinkRequest> LowPriorityQueue;
+
+	// The index of the first decision in each queue that hasn't been made yet. Made decisions
+	// are removed from the front of the queues once per frame instead of one at a time.
+	int32 HighPriorityHead = 0;
+	int32 LowPriorityHead = 0;
+
+	// Scratch space for the requests, inputs and results of a parallel batch so that they don't
+	// have to be allocated every frame.
+	TArray<FZombieThinkRequest> BatchRequests;
+	TArray<FZombieThinkInput> BatchInputs;
+	TArray<FZombieThinkResult> BatchResults;
+
+	// The number of decisions made this frame.
+	int32 ThinkCount = 0;
+
+	// The time spent making decisions in the last frame in milliseconds.
+	float LastFrameCostMs = 0.f;
+
+	// The number of decisions made in the last frame.
+	int32 LastFrameThinkCount = 0;
+};
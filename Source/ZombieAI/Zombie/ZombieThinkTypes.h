@@ -0,0 +1,97 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ZombieCharacter.h"
+#include "ZombieThinkTypes.generated.h"
+
+/**
+ * The decisions that a ZombieAIController can be asked to make.
+ */
+UENUM(BlueprintType)
+enum class ZombieThinkTypes : uint8 {
+	PERCEPTION_UPDATED	UMETA(DisplayName = "PERCEPTION_UPDATED"),
+	MOVE_COMPLETED		UMETA(DisplayName = "MOVE_COMPLETED"),
+	ROAM				UMETA(DisplayName = "ROAM"),
+	IDLE_OR_ROAM		UMETA(DisplayName = "IDLE_OR_ROAM"),
+};
+
+/**
+ * The actions that a ZombieAIController can take as the result of a decision.
+ */
+enum class ZombieThinkActions : uint8 {
+	NONE,
+	IDLE,
+	ROAM,
+	CHASE,
+};
+
+/**
+ * The timers that a ZombieAIController can arm as the result of a decision.
+ */
+enum class ZombieThinkDelays : uint8 {
+	NONE,
+	ROAM_DELAY,
+	AFTER_CHASE_DELAY,
+};
+
+/**
+ * Everything a decision depends on, copied out of the ZombieCharacter and its ZombieAIController
+ * on the game thread so that the decision itself can be made on any thread.
+ */
+struct FZombieThinkInput
+{
+	// The decision to make.
+	ZombieThinkTypes Type = ZombieThinkTypes::IDLE_OR_ROAM;
+
+	// The current and previous state of the ZombieCharacter.
+	ZombieStates State = ZombieStates::IDLE;
+	ZombieStates PreviousState = ZombieStates::IDLE;
+
+	// The roaming settings of the ZombieCharacter.
+	bool bCanRoam = true;
+	float RoamRadius = 0.f;
+	float RoamDelay = 0.f;
+
+	// The chasing settings of the ZombieCharacter.
+	float AfterChaseDelay = 0.f;
+
+	// Where the ZombieCharacter roams around and where it currently is.
+	FVector StartLocation = FVector::ZeroVector;
+	FVector CurrentLocation = FVector::ZeroVector;
+
+	// Whether the actor that the decision is about is currently seen by the ZombieCharacter.
+	bool bTargetInSight = false;
+
+	// Whether the actor that the decision is about is a PlayerCharacter.
+	bool bTargetIsPlayer = false;
+
+	// The seed used to pick a roam location so that decisions are the same no matter which
+	// thread makes them.
+	int32 RandomSeed = 0;
+};
+
+/**
+ * What the ZombieAIController should do as the result of a decision. This is applied on the
+ * game thread after the decision has been made.
+ */
+struct FZombieThinkResult
+{
+	// The action to take.
+	ZombieThinkActions Action = ZombieThinkActions::NONE;
+
+	// The timer to arm after the action has been taken.
+	ZombieThinkDelays Delay = ZombieThinkDelays::NONE;
+
+	// Whether the ZombieCharacter should stop moving before the action is taken.
+	bool bStopMovement = false;
+
+	// Whether the ZombieCharacter's start location should be moved to `NewStartLocation`.
+	bool bSetStartLocation = false;
+	FVector NewStartLocation = FVector::ZeroVector;
+
+	// The location to roam to if the action is ROAM and the location it was picked around. The
+	// ZombieAIController swaps the location for a reachable point around the center from the
+	// ZombieRoamPointSubsystem if one is ready.
+	FVector RoamLocation = FVector::ZeroVector;
+	FVector RoamCenter = FVector::ZeroVector;
+};
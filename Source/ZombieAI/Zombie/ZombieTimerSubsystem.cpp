@@ -0,0 +1,229 @@
+#include "ZombieTimerSubsystem.h"
+#include "ZombieAIController.h"
+#include "ZombieCharacter.h"
+#include "../Benchmark/ZombieBenchmarkTimings.h"
+#include "../ZombieAIStats.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<float> CVarZombieTimersStepSeconds(
+	TEXT("zombie.Timers.StepSeconds"),
+	1.f / 30.f,
+	TEXT("The number of seconds the zombie timer wheel moves forward on every step. Zombie delays expire on the first step at or after they're due."),
+	ECVF_Default);
+
+/**
+ * Called when the world that owns the ZombieTimerSubsystem is torn down.
+ */
+void UZombieTimerSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ZombieAI_ActiveTimers, GetNumActiveTimers());
+
+	Timers.Empty();
+	FreeTimers.Empty();
+	for (int32 Wheel = 0; Wheel < NumWheels; ++Wheel)
+	{
+		for (int32 Slot = 0; Slot < SlotsPerWheel; ++Slot) Slots[Wheel][Slot].Empty();
+	}
+	for (TArray<TWeakObjectPtr<AActor>>& Owners : ExpiredOwners) Owners.Empty();
+
+	Super::Deinitialize();
+}
+
+/**
+ * Starts a delay for the actor, clearing the one the handle was already waiting on.
+ *
+ * @param Handle The handle of the delay. It's set to the new delay.
+ * @param Type What to call on the actor when the delay expires.
+ * @param Owner The actor to call. It must be a ZombieAIController for the ROAM_DELAY and
+ * AFTER_CHASE_DELAY types and a ZombieCharacter for the others.
+ * @param Delay The number of seconds to wait.
+ */
+void UZombieTimerSubsystem::SetTimer(FZombieTimerHandle& Handle, ZombieTimerTypes Type, AActor* Owner, float Delay)
+{
+	ClearTimer(Handle);
+
+	if (Owner == nullptr || Type == ZombieTimerTypes::NUM) return;
+
+	int32 Index;
+	if (FreeTimers.Num() > 0)
+	{
+		Index = FreeTimers.Pop(false);
+	}
+	else
+	{
+		Index = Timers.AddDefaulted();
+	}
+
+	// Delays always wait at least one step so that a delay set while the expired ones are being
+	// handed out doesn't expire in the same frame. Delays longer than the wheels cover expire
+	// when the top wheel has gone all the way around.
+	const float StepSeconds = FMath::Max(CVarZombieTimersStepSeconds.GetValueOnGameThread(), KINDA_SMALL_NUMBER);
+	const int64 MaxSteps = (int64(1) << (SlotBits * NumWheels)) - 1;
+	const int64 Steps = FMath::Clamp<int64>(FMath::CeilToInt(Delay / StepSeconds), 1, MaxSteps);
+
+	FZombieTimer& Timer = Timers[Index];
+	Timer.Owner = Owner;
+	Timer.ExpireStep = CurrentStep + Steps;
+	Timer.Type = Type;
+
+	Schedule(Index);
+
+	Handle.Index = Index;
+	Handle.Generation = Timer.Generation;
+
+	INC_DWORD_STAT(STAT_ZombieAI_ActiveTimers);
+}
+
+/**
+ * Stops the delay so that it never expires, and resets the handle.
+ *
+ * @param Handle The handle of the delay to stop.
+ */
+void UZombieTimerSubsystem::ClearTimer(FZombieTimerHandle& Handle)
+{
+	// The delay stays referenced by its slot until the wheel gets there, but the reference no
+	// longer matches its generation so it's skipped.
+	if (IsTimerActive(Handle)) FreeTimer(Handle.Index);
+
+	Handle = FZombieTimerHandle();
+}
+
+/**
+ * Returns whether the delay is still waiting to expire.
+ */
+bool UZombieTimerSubsystem::IsTimerActive(const FZombieTimerHandle& Handle) const
+{
+	return Timers.IsValidIndex(Handle.Index) && Timers[Handle.Index].Generation == Handle.Generation && Timers[Handle.Index].Type != ZombieTimerTypes::NUM;
+}
+
+/**
+ * Called every frame to move the wheel forward and hand out the delays that expired.
+ */
+void UZombieTimerSubsystem::Tick(float DeltaTime)
+{
+	FZombieBenchmarkScope BenchmarkScope(ZombieBenchmarkTimers::DECISION);
+	ZOMBIE_AI_SCOPE_CYCLE_COUNTER(STAT_ZombieAI_Timers);
+
+	LastFrameExpiredCount = 0;
+
+	const float StepSeconds = FMath::Max(CVarZombieTimersStepSeconds.GetValueOnGameThread(), KINDA_SMALL_NUMBER);
+	AccumulatedTime += DeltaTime;
+	while (AccumulatedTime >= StepSeconds)
+	{
+		AccumulatedTime -= StepSeconds;
+		Advance();
+	}
+
+	INC_DWORD_STAT_BY(STAT_ZombieAI_ExpiredTimers, LastFrameExpiredCount);
+
+	DispatchExpired();
+}
+
+TStatId UZombieTimerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UZombieTimerSubsystem, STATGROUP_ZombieAI);
+}
+
+/**
+ * Puts the delay in the slot of the wheel that is reached when, or shortly before, it expires.
+ */
+void UZombieTimerSubsystem::Schedule(int32 Index)
+{
+	const FZombieTimer& Timer = Timers[Index];
+	const int64 StepsLeft = Timer.ExpireStep - CurrentStep;
+
+	// Pick the finest wheel that goes around before the delay expires. The slot in that wheel
+	// is the one that holds the delay's step at the wheel's resolution.
+	int32 Wheel = 0;
+	while (Wheel < NumWheels - 1 && StepsLeft >= (int64(1) << (SlotBits * (Wheel + 1)))) Wheel++;
+
+	const int32 Slot = (int32)((Timer.ExpireStep >> (SlotBits * Wheel)) & (SlotsPerWheel - 1));
+	Slots[Wheel][Slot].Add({ Index, Timer.Generation });
+}
+
+/**
+ * Frees the delay so that it can be reused, which makes every handle of it stale.
+ */
+void UZombieTimerSubsystem::FreeTimer(int32 Index)
+{
+	FZombieTimer& Timer = Timers[Index];
+	Timer.Owner.Reset();
+	Timer.Type = ZombieTimerTypes::NUM;
+	Timer.Generation++;
+	FreeTimers.Add(Index);
+
+	DEC_DWORD_STAT(STAT_ZombieAI_ActiveTimers);
+}
+
+/**
+ * Moves the wheel one step forward. The delays of the coarser wheels that are now close enough
+ * are moved down, and the delays that expire on this step are added to `ExpiredOwners`.
+ */
+void UZombieTimerSubsystem::Advance()
+{
+	CurrentStep++;
+
+	// When a wheel comes back around to its first slot, the next slot of the wheel above it holds
+	// the delays that expire during the coming turn. The top wheels are emptied first so that
+	// their delays can fall all the way down.
+	for (int32 Wheel = NumWheels - 1; Wheel > 0; --Wheel)
+	{
+		const int32 WheelShift = SlotBits * Wheel;
+		if ((CurrentStep & ((int64(1) << WheelShift) - 1)) != 0) continue;
+
+		// The delays in the slot expire within one turn of the wheel below, so they're always
+		// put in a lower wheel and never back in the slot that is being emptied.
+		TArray<FZombieTimerSlotEntry>& Cascading = Slots[Wheel][(CurrentStep >> WheelShift) & (SlotsPerWheel - 1)];
+		for (const FZombieTimerSlotEntry& Entry : Cascading)
+		{
+			if (Timers[Entry.Index].Generation == Entry.Generation) Schedule(Entry.Index);
+		}
+		Cascading.Reset();
+	}
+
+	TArray<FZombieTimerSlotEntry>& Expiring = Slots[0][CurrentStep & (SlotsPerWheel - 1)];
+	for (const FZombieTimerSlotEntry& Entry : Expiring)
+	{
+		FZombieTimer& Timer = Timers[Entry.Index];
+		if (Timer.Generation != Entry.Generation) continue;
+
+		ExpiredOwners[(int32)Timer.Type].Add(Timer.Owner);
+		FreeTimer(Entry.Index);
+		LastFrameExpiredCount++;
+	}
+	Expiring.Reset();
+}
+
+/**
+ * Calls the actors of the delays that expired this frame, one type at a time.
+ */
+void UZombieTimerSubsystem::DispatchExpired()
+{
+	// The delays are freed before their actors are called, so an actor can set a new delay on
+	// the same handle straight away.
+	for (const TWeakObjectPtr<AActor>& Owner : ExpiredOwners[(int32)ZombieTimerTypes::ROAM_DELAY])
+	{
+		AZombieAIController* ZombieAIController = Cast<AZombieAIController>(Owner.Get());
+		if (ZombieAIController != nullptr) ZombieAIController->OnRoamIdleTimerExpired();
+	}
+
+	for (const TWeakObjectPtr<AActor>& Owner : ExpiredOwners[(int32)ZombieTimerTypes::AFTER_CHASE_DELAY])
+	{
+		AZombieAIController* ZombieAIController = Cast<AZombieAIController>(Owner.Get());
+		if (ZombieAIController != nullptr) ZombieAIController->OnChaseIdleTimerExpired();
+	}
+
+	for (const TWeakObjectPtr<AActor>& Owner : ExpiredOwners[(int32)ZombieTimerTypes::DYING_ANIMATION])
+	{
+		AZombieCharacter* ZombieCharacter = Cast<AZombieCharacter>(Owner.Get());
+		if (ZombieCharacter != nullptr) ZombieCharacter->AfterDeathAnimationFinished();
+	}
+
+	for (const TWeakObjectPtr<AActor>& Owner : ExpiredOwners[(int32)ZombieTimerTypes::REMOVE_AFTER_DEATH])
+	{
+		AZombieCharacter* ZombieCharacter = Cast<AZombieCharacter>(Owner.Get());
+		if (ZombieCharacter != nullptr) ZombieCharacter->ReturnToPool();
+	}
+
+	for (TArray<TWeakObjectPtr<AActor>>& Owners : ExpiredOwners) Owners.Reset();
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ZombieTimerSubsystem.generated.h"
+
+/**
+ * The delays that can be waited on in the ZombieTimerSubsystem. Every type calls one method
+ * of one class when it expires.
+ */
+UENUM(BlueprintType)
+enum class ZombieTimerTypes : uint8 {
+	ROAM_DELAY			UMETA(DisplayName = "ROAM_DELAY"),
+	AFTER_CHASE_DELAY	UMETA(DisplayName = "AFTER_CHASE_DELAY"),
+	DYING_ANIMATION		UMETA(DisplayName = "DYING_ANIMATION"),
+	REMOVE_AFTER_DEATH	UMETA(DisplayName = "REMOVE_AFTER_DEATH"),
+	NUM					UMETA(Hidden),
+};
+
+/**
+ * Identifies a delay in the ZombieTimerSubsystem. The generation is bumped every time a
+ * delay expires or is cleared so that stale handles can be detected.
+ */
+struct FZombieTimerHandle
+{
+	// The index of the delay in the ZombieTimerSubsystem's array of delays.
+	int32 Index = INDEX_NONE;
+
+	// The generation of the delay when this handle was given out.
+	int32 Generation = 0;
+
+	bool IsSet() const { return Index != INDEX_NONE; }
+};
+
+/**
+ * A delay that is waiting in the ZombieTimerSubsystem.
+ */
+struct FZombieTimer
+{
+	// The actor to call when the delay expires.
+	TWeakObjectPtr<AActor> Owner;
+
+	// The step of the wheel that the delay expires on.
+	int64 ExpireStep = 0;
+
+	// The generation of the delay, bumped every time it expires or is cleared.
+	int32 Generation = 0;
+
+	// What to call when the delay expires.
+	ZombieTimerTypes Type = ZombieTimerTypes::NUM;
+};
+
+/**
+ * A reference from a slot of the wheel to a delay. References to delays that have been
+ * cleared are skipped when the slot is reached instead of being searched for and removed.
+ */
+struct FZombieTimerSlotEntry
+{
+	int32 Index;
+	int32 Generation;
+};
+
+/**
+ * The ZombieTimerSubsystem waits out the delays of every zombie, like the pause between roams
+ * and the time the dying animation takes, in a hierarchical timer wheel instead of one timer
+ * manager entry per zombie. Setting and clearing a delay doesn't search or sort anything, the
+ * delays live in one array that is reused as they expire, and the delays that expire in a
+ * frame are handed out together, one type at a time.
+ *
+ * The wheel advances in fixed steps of `zombie.Timers.StepSeconds`, so delays expire on the
+ * first step at or after they're due.
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieTimerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Called when the world that owns the ZombieTimerSubsystem is torn down.
+	 */
+	virtual void Deinitialize() override;
+
+	/**
+	 * Starts a delay for the actor, clearing the one the handle was already waiting on.
+	 *
+	 * @param Handle The handle of the delay. It's set to the new delay.
+	 * @param Type What to call on the actor when the delay expires.
+	 * @param Owner The actor to call. It must be a ZombieAIController for the ROAM_DELAY and
+	 * AFTER_CHASE_DELAY types and a ZombieCharacter for the others.
+	 * @param Delay The number of seconds to wait.
+	 */
+	void SetTimer(FZombieTimerHandle& Handle, ZombieTimerTypes Type, AActor* Owner, float Delay);
+
+	/**
+	 * Stops the delay so that it never expires, and resets the handle.
+	 *
+	 * @param Handle The handle of the delay to stop.
+	 */
+	void ClearTimer(FZombieTimerHandle& Handle);
+
+	/**
+	 * Returns whether the delay is still waiting to expire.
+	 */
+	bool IsTimerActive(const FZombieTimerHandle& Handle) const;
+
+	/**
+	 * Returns the number of delays that are waiting to expire.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieTimers)
+	int32 GetNumActiveTimers() const { return Timers.Num() - FreeTimers.Num(); }
+
+	/**
+	 * Returns the number of delays that expired in the last frame.
+	 */
+	UFUNCTION(BlueprintPure, Category = ZombieTimers)
+	int32 GetLastFrameExpiredCount() const { return LastFrameExpiredCount; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return !IsTemplate(); }
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+
+protected:
+	/**
+	 * Puts the delay in the slot of the wheel that is reached when, or shortly before, it expires.
+	 */
+	void Schedule(int32 Index);
+
+	/**
+	 * Frees the delay so that it can be reused, which makes every handle of it stale.
+	 */
+	void FreeTimer(int32 Index);
+
+	/**
+	 * Moves the wheel one step forward. The delays of the coarser wheels that are now close enough
+	 * are moved down, and the delays that expire on this step are added to `ExpiredOwners`.
+	 */
+	void Advance();
+
+	/**
+	 * Calls the actors of the delays that expired this frame, one type at a time.
+	 */
+	void DispatchExpired();
+
+protected:
+	// The number of wheels and the number of slots in each wheel. Each wheel covers
+	// `SlotsPerWheel` slots of the one below it, so three wheels cover 2^18 steps, about 2.4
+	// hours at the default step of 1/30 of a second.
+	static const int32 NumWheels = 3;
+	static const int32 SlotBits = 6;
+	static const int32 SlotsPerWheel = 1 << SlotBits;
+
+	// Every delay, including the freed ones that are waiting to be reused.
+	TArray<FZombieTimer> Timers;
+
+	// The indices of the delays that can be reused.
+	TArray<int32> FreeTimers;
+
+	// The slots of every wheel. The first wheel has a slot per step and each wheel above it has
+	// a slot per full turn of the wheel below.
+	TArray<FZombieTimerSlotEntry> Slots[NumWheels][SlotsPerWheel];
+
+	// The actors of the delays that expired this frame, by type.
+	TArray<TWeakObjectPtr<AActor>> ExpiredOwners[(int32)ZombieTimerTypes::NUM];
+
+	// The step the wheel is on.
+	int64 CurrentStep = 0;
+
+	// The time that has passed since the wheel last stepped.
+	float AccumulatedTime = 0.f;
+
+	// The number of delays that expired in the last frame.
+	int32 LastFrameExpiredCount = 0;
+};
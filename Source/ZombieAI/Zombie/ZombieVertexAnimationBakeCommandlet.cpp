@@ -0,0 +1,593 @@
+#include "ZombieVertexAnimationBakeCommandlet.h"
+#include "ZombieVertexAnimationData.h"
+#include "GPUSkinPublicDefs.h"
+
+#if WITH_EDITOR
+#include "AssetRegistryModule.h"
+#include "BonePose.h"
+#include "RawMesh.h"
+#include "Animation/AnimSequence.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInstanceConstant.h"
+#include "Materials/MaterialExpressionCustom.h"
+#include "Materials/MaterialExpressionPerInstanceCustomData.h"
+#include "Materials/MaterialExpressionScalarParameter.h"
+#include "Materials/MaterialExpressionTextureCoordinate.h"
+#include "Materials/MaterialExpressionTextureObjectParameter.h"
+#include "Materials/MaterialExpressionTextureSampleParameter2D.h"
+#include "Materials/MaterialExpressionTime.h"
+#include "Materials/MaterialExpressionTransform.h"
+#include "Materials/MaterialExpressionVertexInterpolator.h"
+#include "Misc/PackageName.h"
+#include "Rendering/SkeletalMeshLODModel.h"
+#include "Rendering/SkeletalMeshModel.h"
+#include "UObject/Package.h"
+#endif
+
+DEFINE_LOG_CATEGORY_STATIC(LogZombieVertexAnimationBake, Log, All);
+
+#if WITH_EDITOR
+// The playback material that every baked mesh's material instances are made from.
+static const TCHAR* PlaybackMaterialPackage = TEXT("/Game/VertexAnimation/M_ZombieVertexAnimation");
+
+// The largest texture height that the engine can import.
+static const int32 MaxTextureHeight = 16384;
+
+// Finds the frame of the instance's clip and reads the vertex's texel in it. The clip is read from
+// the instance's custom data, which the ZombieImpostorSubsystem fills in.
+static const TCHAR* PlaybackShaderCode = TEXT(
+	"float Elapsed = max(Time - StartTime, 0.0);\n"
+	"float Frame = floor(Elapsed * FramesPerSecond);\n"
+	"Frame = (Loop > 0.5) ? fmod(Frame, max(ClipFrames, 1.0)) : min(Frame, ClipFrames - 1.0);\n"
+	"float Row = (StartFrame + Frame) * RowsPerFrame + VertexTexel.y;\n"
+	"float2 UV = float2((VertexTexel.x + 0.5) / TextureWidth, (Row + 0.5) / TextureHeight);\n"
+	"return Texture2DSampleLevel(Frames, FramesSampler, UV, 0).xyz;\n");
+
+/**
+ * Loads the asset of the package if it has been saved before, or creates a new one.
+ */
+template<typename T>
+static T* FindOrCreateAsset(const FString& PackageName)
+{
+	const FString AssetName = FPackageName::GetLongPackageAssetName(PackageName);
+
+	UPackage* Package = nullptr;
+	if (FPackageName::DoesPackageExist(PackageName)) Package = LoadPackage(nullptr, *PackageName, LOAD_None);
+	if (Package == nullptr) Package = CreatePackage(nullptr, *PackageName);
+	if (Package == nullptr) return nullptr;
+
+	Package->FullyLoad();
+
+	T* Asset = FindObject<T>(Package, *AssetName);
+	if (Asset != nullptr) return Asset;
+
+	Asset = NewObject<T>(Package, *AssetName, RF_Public | RF_Standalone);
+	FAssetRegistryModule::AssetCreated(Asset);
+
+	return Asset;
+}
+
+/**
+ * Saves the package of the asset.
+ */
+static bool SaveAsset(UObject* Asset)
+{
+	UPackage* Package = Asset->GetOutermost();
+	Package->MarkPackageDirty();
+
+	const FString FileName = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+	if (UPackage::SavePackage(Package, Asset, RF_Public | RF_Standalone, *FileName)) return true;
+
+	UE_LOG(LogZombieVertexAnimationBake, Error, TEXT("Couldn't save %s."), *FileName);
+	return false;
+}
+
+/**
+ * Adds a scalar parameter to the material.
+ */
+static UMaterialExpressionScalarParameter* AddScalarParameter(UMaterial* Material, const TCHAR* Name, float DefaultValue)
+{
+	UMaterialExpressionScalarParameter* Parameter = NewObject<UMaterialExpressionScalarParameter>(Material);
+	Parameter->ParameterName = Name;
+	Parameter->DefaultValue = DefaultValue;
+	Material->Expressions.Add(Parameter);
+
+	return Parameter;
+}
+
+/**
+ * Adds a custom expression that reads the current frame of the instance's clip from the texture
+ * to the material.
+ */
+static UMaterialExpressionCustom* AddFrameReader(UMaterial* Material, const TCHAR* Description, UMaterialExpression* Frames, const TArray<TPair<FName, UMaterialExpression*>>& SharedInputs)
+{
+	UMaterialExpressionCustom* Reader = NewObject<UMaterialExpressionCustom>(Material);
+	Reader->Description = Description;
+	Reader->Code = PlaybackShaderCode;
+	Reader->OutputType = CMOT_Float3;
+	Reader->Inputs.Reset();
+
+	FCustomInput& FramesInput = Reader->Inputs.AddDefaulted_GetRef();
+	FramesInput.InputName = TEXT("Frames");
+	FramesInput.Input.Expression = Frames;
+
+	for (const TPair<FName, UMaterialExpression*>& SharedInput : SharedInputs)
+	{
+		FCustomInput& Input = Reader->Inputs.AddDefaulted_GetRef();
+		Input.InputName = SharedInput.Key;
+		Input.Input.Expression = SharedInput.Value;
+	}
+
+	Material->Expressions.Add(Reader);
+
+	return Reader;
+}
+
+/**
+ * Adds an expression that turns a vector from the mesh's local space into world space to the
+ * material.
+ */
+static UMaterialExpressionTransform* AddLocalToWorld(UMaterial* Material, UMaterialExpression* Input)
+{
+	UMaterialExpressionTransform* Transform = NewObject<UMaterialExpressionTransform>(Material);
+	Transform->TransformSourceType = TRANSFORMSOURCE_Local;
+	Transform->TransformType = TRANSFORM_World;
+	Transform->Input.Expression = Input;
+	Material->Expressions.Add(Transform);
+
+	return Transform;
+}
+
+/**
+ * Returns the texture that gives the material its color, which is the first color texture that
+ * it uses.
+ */
+static UTexture* FindBaseColorTexture(UMaterialInterface* Material)
+{
+	if (Material == nullptr) return nullptr;
+
+	TArray<UTexture*> Textures;
+	Material->GetUsedTextures(Textures, EMaterialQualityLevel::High, true, ERHIFeatureLevel::SM5, true);
+
+	for (UTexture* Texture : Textures)
+	{
+		if (Texture != nullptr && Texture->SRGB && Texture->CompressionSettings != TC_Normalmap) return Texture;
+	}
+
+	return nullptr;
+}
+#endif
+
+/**
+ * Sets default values for this commandlet's properties.
+ */
+UZombieVertexAnimationBakeCommandlet::UZombieVertexAnimationBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+/**
+ * Bakes the clips and saves the assets.
+ */
+int32 UZombieVertexAnimationBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString MeshName = TEXT("/Game/Models/ZombieJill/jill");
+	FString IdleName = TEXT("/Game/Animations/ZombieJill/Zombie_Idle");
+	FString WalkName = TEXT("/Game/Animations/ZombieJill/Zombie_Walk");
+	FString RunName = TEXT("/Game/Animations/ZombieJill/Zombie_Run");
+	FString DyingName = TEXT("/Game/Animations/ZombieJill/Zombie_Dying");
+	FString OutputPath = TEXT("/Game/VertexAnimation/ZombieJill");
+	FParse::Value(*Params, TEXT("Mesh="), MeshName);
+	FParse::Value(*Params, TEXT("Idle="), IdleName);
+	FParse::Value(*Params, TEXT("Walk="), WalkName);
+	FParse::Value(*Params, TEXT("Run="), RunName);
+	FParse::Value(*Params, TEXT("Dying="), DyingName);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	FParse::Value(*Params, TEXT("FramesPerSecond="), FramesPerSecond);
+	FParse::Value(*Params, TEXT("MaxWidth="), MaxTextureWidth);
+	const bool bRebuildMaterial = FParse::Param(*Params, TEXT("RebuildMaterial"));
+
+	if (FramesPerSecond <= 0.f || MaxTextureWidth <= 0)
+	{
+		UE_LOG(LogZombieVertexAnimationBake, Error, TEXT("-FramesPerSecond and -MaxWidth have to be greater than 0."));
+		return 1;
+	}
+
+	SkeletalMesh = LoadObject<USkeletalMesh>(nullptr, *MeshName);
+	const FSkeletalMeshModel* ImportedModel = (SkeletalMesh != nullptr) ? SkeletalMesh->GetImportedModel() : nullptr;
+	if (ImportedModel == nullptr || ImportedModel->LODModels.Num() == 0)
+	{
+		UE_LOG(LogZombieVertexAnimationBake, Error, TEXT("Couldn't load the skeletal mesh %s."), *MeshName);
+		return 1;
+	}
+
+	// Copy what skinning needs out of the first LOD. Its vertices are stored section after
+	// section, which is the order the static mesh and the textures use too.
+	const FSkeletalMeshLODModel& LODModel = ImportedModel->LODModels[0];
+	ReferencePositions.Reset();
+	ReferenceNormals.Reset();
+	InfluenceBones.Reset();
+	InfluenceWeights.Reset();
+
+	for (const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		for (const FSoftSkinVertex& Vertex : Section.SoftVertices)
+		{
+			ReferencePositions.Add(Vertex.Position);
+			ReferenceNormals.Add(FVector(Vertex.TangentZ));
+
+			for (int32 Influence = 0; Influence < MAX_TOTAL_INFLUENCES; ++Influence)
+			{
+				const int32 BoneMapIndex = Vertex.InfluenceBones[Influence];
+				InfluenceBones.Add(Section.BoneMap.IsValidIndex(BoneMapIndex) ? Section.BoneMap[BoneMapIndex] : 0);
+				InfluenceWeights.Add(Vertex.InfluenceWeights[Influence] / 255.f);
+			}
+		}
+	}
+
+	NumVertices = ReferencePositions.Num();
+	TextureWidth = FMath::Min(NumVertices, MaxTextureWidth);
+	RowsPerFrame = FMath::DivideAndRoundUp(NumVertices, FMath::Max(TextureWidth, 1));
+	NumFrames = 0;
+	FrameOffsets.Reset();
+	FrameNormals.Reset();
+	AnimatedBounds = FBox(ReferencePositions);
+
+	SkeletalMesh->CalculateInvRefMatrices();
+
+	const FString AssetName = FPackageName::GetLongPackageAssetName(OutputPath);
+	UZombieVertexAnimationData* Data = FindOrCreateAsset<UZombieVertexAnimationData>(OutputPath / FString::Printf(TEXT("DA_%s_VertexAnimation"), *AssetName));
+	if (Data == nullptr) return 1;
+
+	// Everything but dying loops, the same as in the ZombieAnimBlueprint.
+	if (!BakeClip(LoadObject<UAnimSequence>(nullptr, *IdleName), true, Data->IdleClip)) return 1;
+	if (!BakeClip(LoadObject<UAnimSequence>(nullptr, *WalkName), true, Data->WalkClip)) return 1;
+	if (!BakeClip(LoadObject<UAnimSequence>(nullptr, *RunName), true, Data->RunClip)) return 1;
+	if (!BakeClip(LoadObject<UAnimSequence>(nullptr, *DyingName), false, Data->DyingClip)) return 1;
+
+	const int32 TextureHeight = NumFrames * RowsPerFrame;
+	if (TextureHeight > MaxTextureHeight)
+	{
+		UE_LOG(LogZombieVertexAnimationBake, Error, TEXT("The clips need %d rows, which is more than %d. Raise -MaxWidth or lower -FramesPerSecond."), TextureHeight, MaxTextureHeight);
+		return 1;
+	}
+
+	UTexture2D* PositionTexture = CreateFrameTexture(OutputPath / FString::Printf(TEXT("T_%s_VertexAnimation_Position"), *AssetName), FrameOffsets);
+	UTexture2D* NormalTexture = CreateFrameTexture(OutputPath / FString::Printf(TEXT("T_%s_VertexAnimation_Normal"), *AssetName), FrameNormals);
+
+	UMaterial* PlaybackMaterial = LoadObject<UMaterial>(nullptr, PlaybackMaterialPackage, nullptr, LOAD_NoWarn | LOAD_Quiet);
+	if (PlaybackMaterial == nullptr || bRebuildMaterial) PlaybackMaterial = CreatePlaybackMaterial(PlaybackMaterialPackage);
+	if (PositionTexture == nullptr || NormalTexture == nullptr || PlaybackMaterial == nullptr) return 1;
+
+	// Every material of the skeletal mesh gets an instance of the playback material with the
+	// same color texture and this bake's textures.
+	TArray<UMaterialInterface*> Materials;
+	for (int32 MaterialIndex = 0; MaterialIndex < SkeletalMesh->Materials.Num(); ++MaterialIndex)
+	{
+		const FSkeletalMaterial& SkeletalMaterial = SkeletalMesh->Materials[MaterialIndex];
+		const FString SlotName = SkeletalMaterial.MaterialSlotName.IsNone() ? FString::FromInt(MaterialIndex) : SkeletalMaterial.MaterialSlotName.ToString();
+
+		UMaterialInstanceConstant* Instance = FindOrCreateAsset<UMaterialInstanceConstant>(OutputPath / FString::Printf(TEXT("MI_%s_VertexAnimation_%s"), *AssetName, *SlotName));
+		if (Instance == nullptr) return 1;
+
+		Instance->ClearParameterValuesEditorOnly();
+		Instance->SetParentEditorOnly(PlaybackMaterial);
+		Instance->SetTextureParameterValueEditorOnly(FMaterialParameterInfo(TEXT("PositionTexture")), PositionTexture);
+		Instance->SetTextureParameterValueEditorOnly(FMaterialParameterInfo(TEXT("NormalTexture")), NormalTexture);
+		Instance->SetScalarParameterValueEditorOnly(FMaterialParameterInfo(TEXT("TextureWidth")), TextureWidth);
+		Instance->SetScalarParameterValueEditorOnly(FMaterialParameterInfo(TEXT("TextureHeight")), TextureHeight);
+		Instance->SetScalarParameterValueEditorOnly(FMaterialParameterInfo(TEXT("RowsPerFrame")), RowsPerFrame);
+
+		UTexture* BaseColorTexture = FindBaseColorTexture(SkeletalMaterial.MaterialInterface);
+		if (BaseColorTexture != nullptr) Instance->SetTextureParameterValueEditorOnly(FMaterialParameterInfo(TEXT("BaseColorTexture")), BaseColorTexture);
+
+		Instance->PostEditChange();
+		Materials.Add(Instance);
+	}
+
+	UStaticMesh* StaticMesh = CreateStaticMesh(OutputPath / FString::Printf(TEXT("SM_%s_VertexAnimation"), *AssetName), Materials);
+	if (StaticMesh == nullptr) return 1;
+
+	Data->Mesh = StaticMesh;
+	Data->Material = PlaybackMaterial;
+	Data->MarkPackageDirty();
+
+	bool bSaved = SaveAsset(PositionTexture) && SaveAsset(NormalTexture) && SaveAsset(PlaybackMaterial);
+	for (UMaterialInterface* Material : Materials)
+	{
+		bSaved = SaveAsset(Material) && bSaved;
+	}
+	bSaved = SaveAsset(StaticMesh) && SaveAsset(Data) && bSaved;
+
+	UE_LOG(LogZombieVertexAnimationBake, Display, TEXT("Baked %d frames of %d vertices into %dx%d textures in %s."), NumFrames, NumVertices, TextureWidth, TextureHeight, *OutputPath);
+
+	return bSaved ? 0 : 1;
+#else
+	UE_LOG(LogZombieVertexAnimationBake, Error, TEXT("Vertex animations can only be baked in the editor."));
+	return 1;
+#endif
+}
+
+#if WITH_EDITOR
+/**
+ * Skins every vertex of the skeletal mesh for every frame of the clip and adds the offsets
+ * from the reference pose and the normals to the frame arrays.
+ *
+ * @param Sequence The clip to sample.
+ * @param bLoop Whether the clip loops, in which case its last frame is left out since it's
+ * the same as its first.
+ * @param OutClip Where the clip ended up in the frames.
+ *
+ * @return Whether the clip could be sampled.
+ */
+bool UZombieVertexAnimationBakeCommandlet::BakeClip(UAnimSequence* Sequence, bool bLoop, FZombieVertexAnimationClip& OutClip)
+{
+	if (Sequence == nullptr)
+	{
+		UE_LOG(LogZombieVertexAnimationBake, Error, TEXT("Couldn't load one of the clips."));
+		return false;
+	}
+
+	const FReferenceSkeleton& RefSkeleton = SkeletalMesh->RefSkeleton;
+	const int32 NumBones = RefSkeleton.GetNum();
+
+	// Pose every bone of the mesh so that every vertex can be skinned.
+	TArray<FBoneIndexType> RequiredBones;
+	for (int32 BoneIndex = 0; BoneIndex < NumBones; ++BoneIndex)
+	{
+		RequiredBones.Add(BoneIndex);
+	}
+
+	FBoneContainer BoneContainer;
+	BoneContainer.InitializeTo(RequiredBones, FCurveEvaluationOption(false), *SkeletalMesh);
+
+	FCompactPose Pose;
+	Pose.SetBoneContainer(&BoneContainer);
+	FBlendedCurve Curve;
+	Curve.InitFrom(BoneContainer);
+
+	const float Length = Sequence->SequenceLength;
+	const int32 NumClipFrames = FMath::Max(FMath::RoundToInt(Length * FramesPerSecond) + (bLoop ? 0 : 1), 1);
+
+	OutClip.StartFrame = NumFrames;
+	OutClip.NumFrames = NumClipFrames;
+	OutClip.FramesPerSecond = FramesPerSecond;
+	OutClip.bLoop = bLoop;
+
+	TArray<FTransform> ComponentSpace;
+	TArray<FMatrix> RefToLocal;
+	ComponentSpace.SetNum(NumBones);
+	RefToLocal.SetNum(NumBones);
+
+	const int32 FrameSize = TextureWidth * RowsPerFrame;
+	for (int32 Frame = 0; Frame < NumClipFrames; ++Frame)
+	{
+		const float Time = FMath::Min(Frame / FramesPerSecond, Length);
+		Sequence->GetAnimationPose(Pose, Curve, FAnimExtractContext(Time, false));
+
+		// Parents always come before their children so every bone's parent is already in
+		// component space when it's reached.
+		for (const FCompactPoseBoneIndex PoseIndex : Pose.ForEachBoneIndex())
+		{
+			const int32 BoneIndex = BoneContainer.MakeMeshPoseIndex(PoseIndex).GetInt();
+			const int32 ParentIndex = RefSkeleton.GetParentIndex(BoneIndex);
+
+			ComponentSpace[BoneIndex] = (ParentIndex == INDEX_NONE) ? Pose[PoseIndex] : Pose[PoseIndex] * ComponentSpace[ParentIndex];
+			RefToLocal[BoneIndex] = SkeletalMesh->RefBasesInvMatrix[BoneIndex] * ComponentSpace[BoneIndex].ToMatrixWithScale();
+		}
+
+		// Frames are padded out to whole rows so that every frame starts on a new row.
+		const int32 FrameStart = FrameOffsets.AddZeroed(FrameSize);
+		FrameNormals.AddZeroed(FrameSize);
+
+		for (int32 VertexIndex = 0; VertexIndex < NumVertices; ++VertexIndex)
+		{
+			FVector Position = FVector::ZeroVector;
+			FVector Normal = FVector::ZeroVector;
+			float TotalWeight = 0.f;
+
+			for (int32 Influence = 0; Influence < MAX_TOTAL_INFLUENCES; ++Influence)
+			{
+				const float Weight = InfluenceWeights[VertexIndex * MAX_TOTAL_INFLUENCES + Influence];
+				if (Weight <= 0.f) continue;
+
+				const FMatrix& Matrix = RefToLocal[InfluenceBones[VertexIndex * MAX_TOTAL_INFLUENCES + Influence]];
+				Position += Matrix.TransformPosition(ReferencePositions[VertexIndex]) * Weight;
+				Normal += Matrix.TransformVector(ReferenceNormals[VertexIndex]) * Weight;
+				TotalWeight += Weight;
+			}
+
+			if (TotalWeight > 0.f) Position /= TotalWeight;
+			else Position = ReferencePositions[VertexIndex];
+
+			FrameOffsets[FrameStart + VertexIndex] = Position - ReferencePositions[VertexIndex];
+			FrameNormals[FrameStart + VertexIndex] = Normal.GetSafeNormal();
+			AnimatedBounds += Position;
+		}
+
+		NumFrames++;
+	}
+
+	return true;
+}
+
+/**
+ * Creates the position or normal texture from the baked frames.
+ */
+UTexture2D* UZombieVertexAnimationBakeCommandlet::CreateFrameTexture(const FString& PackageName, const TArray<FVector>& Frames) const
+{
+	UTexture2D* Texture = FindOrCreateAsset<UTexture2D>(PackageName);
+	if (Texture == nullptr) return nullptr;
+
+	TArray<FFloat16Color> Texels;
+	Texels.Reserve(Frames.Num());
+	for (const FVector& Value : Frames)
+	{
+		Texels.Add(FFloat16Color(FLinearColor(Value.X, Value.Y, Value.Z, 1.f)));
+	}
+
+	// The texels are read one by one in the vertex shader, so they're kept exact: no
+	// compression, filtering, mips or color conversion, and always loaded in full.
+	Texture->Source.Init(TextureWidth, Frames.Num() / TextureWidth, 1, 1, TSF_RGBA16F, (const uint8*)Texels.GetData());
+	Texture->CompressionSettings = TC_HDR;
+	Texture->SRGB = false;
+	Texture->Filter = TF_Nearest;
+	Texture->MipGenSettings = TMGS_NoMipmaps;
+	Texture->AddressX = TA_Clamp;
+	Texture->AddressY = TA_Clamp;
+	Texture->NeverStream = true;
+	Texture->PostEditChange();
+
+	return Texture;
+}
+
+/**
+ * Creates the static mesh that the baked animations play back on, with one material slot for
+ * every material of the skeletal mesh.
+ */
+UStaticMesh* UZombieVertexAnimationBakeCommandlet::CreateStaticMesh(const FString& PackageName, const TArray<UMaterialInterface*>& Materials) const
+{
+	UStaticMesh* StaticMesh = FindOrCreateAsset<UStaticMesh>(PackageName);
+	if (StaticMesh == nullptr) return nullptr;
+
+	const FSkeletalMeshLODModel& LODModel = SkeletalMesh->GetImportedModel()->LODModels[0];
+
+	FRawMesh RawMesh;
+	RawMesh.VertexPositions = ReferencePositions;
+
+	for (const FSkelMeshSection& Section : LODModel.Sections)
+	{
+		for (uint32 Triangle = 0; Triangle < Section.NumTriangles; ++Triangle)
+		{
+			for (int32 Corner = 0; Corner < 3; ++Corner)
+			{
+				const uint32 VertexIndex = LODModel.IndexBuffer[Section.BaseIndex + Triangle * 3 + Corner];
+				const FSoftSkinVertex& Vertex = Section.SoftVertices[VertexIndex - Section.BaseVertexIndex];
+
+				RawMesh.WedgeIndices.Add(VertexIndex);
+				RawMesh.WedgeTangentX.Add(Vertex.TangentX);
+				RawMesh.WedgeTangentY.Add(Vertex.TangentY);
+				RawMesh.WedgeTangentZ.Add(FVector(Vertex.TangentZ));
+				RawMesh.WedgeTexCoords[0].Add(Vertex.UVs[0]);
+
+				// The texel of the vertex in the frame textures, which the material looks the
+				// vertex up with.
+				RawMesh.WedgeTexCoords[1].Add(FVector2D(VertexIndex % TextureWidth, VertexIndex / TextureWidth));
+			}
+
+			RawMesh.FaceMaterialIndices.Add(Section.MaterialIndex);
+			RawMesh.FaceSmoothingMasks.Add(1);
+		}
+	}
+
+	StaticMesh->SetNumSourceModels(0);
+	FStaticMeshSourceModel& SourceModel = StaticMesh->AddSourceModel();
+
+	// Keep the vertices exactly as they are in the skeletal mesh. The second UV channel has to
+	// be full precision so that every vertex still finds its own texel.
+	SourceModel.BuildSettings.bRecomputeNormals = false;
+	SourceModel.BuildSettings.bRecomputeTangents = false;
+	SourceModel.BuildSettings.bRemoveDegenerates = false;
+	SourceModel.BuildSettings.bUseFullPrecisionUVs = true;
+	SourceModel.BuildSettings.bGenerateLightmapUVs = false;
+	SourceModel.SaveRawMesh(RawMesh);
+
+	StaticMesh->StaticMaterials.Reset();
+	for (int32 MaterialIndex = 0; MaterialIndex < Materials.Num(); ++MaterialIndex)
+	{
+		StaticMesh->StaticMaterials.Add(FStaticMaterial(Materials[MaterialIndex], SkeletalMesh->Materials[MaterialIndex].MaterialSlotName));
+	}
+
+	// The material moves the vertices, so the bounds have to cover every frame for the
+	// impostors not to be culled while they're still on screen.
+	const FBox ReferenceBounds(ReferencePositions);
+	StaticMesh->PositiveBoundsExtension = (AnimatedBounds.Max - ReferenceBounds.Max).ComponentMax(FVector::ZeroVector);
+	StaticMesh->NegativeBoundsExtension = (ReferenceBounds.Min - AnimatedBounds.Min).ComponentMax(FVector::ZeroVector);
+
+	StaticMesh->Build(true);
+	StaticMesh->PostEditChange();
+
+	return StaticMesh;
+}
+
+/**
+ * Creates the playback material, which moves every vertex of the static mesh to where it is
+ * in the current frame of the instance's clip and turns its normal to match.
+ */
+UMaterial* UZombieVertexAnimationBakeCommandlet::CreatePlaybackMaterial(const FString& PackageName) const
+{
+	UMaterial* Material = FindOrCreateAsset<UMaterial>(PackageName);
+	if (Material == nullptr) return nullptr;
+
+	Material->PreEditChange(nullptr);
+	Material->Expressions.Reset();
+	Material->bUsedWithInstancedStaticMeshes = true;
+
+	// The normals are turned into world space in the vertex shader, so the pixel shader gets
+	// them as they are.
+	Material->bTangentSpaceNormal = false;
+
+	UMaterialExpressionTextureObjectParameter* PositionTexture = NewObject<UMaterialExpressionTextureObjectParameter>(Material);
+	PositionTexture->ParameterName = TEXT("PositionTexture");
+	PositionTexture->SamplerType = SAMPLERTYPE_LinearColor;
+	Material->Expressions.Add(PositionTexture);
+
+	UMaterialExpressionTextureObjectParameter* NormalTexture = NewObject<UMaterialExpressionTextureObjectParameter>(Material);
+	NormalTexture->ParameterName = TEXT("NormalTexture");
+	NormalTexture->SamplerType = SAMPLERTYPE_LinearColor;
+	Material->Expressions.Add(NormalTexture);
+
+	UMaterialExpressionTextureCoordinate* VertexTexel = NewObject<UMaterialExpressionTextureCoordinate>(Material);
+	VertexTexel->CoordinateIndex = 1;
+	Material->Expressions.Add(VertexTexel);
+
+	UMaterialExpressionTime* Time = NewObject<UMaterialExpressionTime>(Material);
+	Material->Expressions.Add(Time);
+
+	// The clip of the instance, in the order the ZombieImpostorSubsystem writes it.
+	const TCHAR* CustomDataNames[] = { TEXT("StartFrame"), TEXT("ClipFrames"), TEXT("FramesPerSecond"), TEXT("Loop"), TEXT("StartTime") };
+
+	TArray<TPair<FName, UMaterialExpression*>> SharedInputs;
+	SharedInputs.Emplace(TEXT("VertexTexel"), VertexTexel);
+	SharedInputs.Emplace(TEXT("Time"), Time);
+
+	for (int32 DataIndex = 0; DataIndex < UE_ARRAY_COUNT(CustomDataNames); ++DataIndex)
+	{
+		UMaterialExpressionPerInstanceCustomData* CustomData = NewObject<UMaterialExpressionPerInstanceCustomData>(Material);
+		CustomData->DataIndex = DataIndex;
+		Material->Expressions.Add(CustomData);
+
+		SharedInputs.Emplace(CustomDataNames[DataIndex], CustomData);
+	}
+
+	SharedInputs.Emplace(TEXT("TextureWidth"), AddScalarParameter(Material, TEXT("TextureWidth"), 1.f));
+	SharedInputs.Emplace(TEXT("TextureHeight"), AddScalarParameter(Material, TEXT("TextureHeight"), 1.f));
+	SharedInputs.Emplace(TEXT("RowsPerFrame"), AddScalarParameter(Material, TEXT("RowsPerFrame"), 1.f));
+
+	UMaterialExpressionCustom* PositionReader = AddFrameReader(Material, TEXT("Vertex Animation Offset"), PositionTexture, SharedInputs);
+	UMaterialExpressionCustom* NormalReader = AddFrameReader(Material, TEXT("Vertex Animation Normal"), NormalTexture, SharedInputs);
+
+	Material->WorldPositionOffset.Expression = AddLocalToWorld(Material, PositionReader);
+
+	UMaterialExpressionVertexInterpolator* NormalInterpolator = NewObject<UMaterialExpressionVertexInterpolator>(Material);
+	NormalInterpolator->Input.Expression = AddLocalToWorld(Material, NormalReader);
+	Material->Expressions.Add(NormalInterpolator);
+	Material->Normal.Expression = NormalInterpolator;
+
+	UMaterialExpressionTextureSampleParameter2D* BaseColor = NewObject<UMaterialExpressionTextureSampleParameter2D>(Material);
+	BaseColor->ParameterName = TEXT("BaseColorTexture");
+	Material->Expressions.Add(BaseColor);
+	Material->BaseColor.Expression = BaseColor;
+
+	Material->PostEditChange();
+
+	return Material;
+}
+#endif
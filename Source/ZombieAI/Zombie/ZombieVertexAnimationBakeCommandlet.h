@@ -0,0 +1,115 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ZombieVertexAnimationBakeCommandlet.generated.h"
+
+class UAnimSequence;
+class UMaterial;
+class USkeletalMesh;
+class UTexture2D;
+struct FZombieVertexAnimationClip;
+
+/**
+ * The ZombieVertexAnimationBakeCommandlet makes everything the ZombieImpostorSubsystem needs to
+ * draw far away zombies. It samples the ZombieCharacter's Idle, Walk, Run and Dying clips on the
+ * Jill skeletal mesh, skins every vertex of every frame on the CPU and writes:
+ *
+ *   - A static mesh with the same vertices as the skeletal mesh in its reference pose. The
+ *     second UV channel holds the texel of each vertex in the textures.
+ *   - A position texture with the offset of every vertex from its reference pose, and a normal
+ *     texture with its normal, one frame after another. A frame takes `RowsPerFrame` rows of
+ *     `TextureWidth` vertices.
+ *   - The M_ZombieVertexAnimation playback material, if it doesn't exist yet, and an instance of
+ *     it for every material of the skeletal mesh.
+ *   - The ZombieVertexAnimationData that records where each clip is in the textures, which the
+ *     ZombieCharacter uses by default.
+ *
+ * Run it with:
+ *
+ *     UE4Editor-Cmd ZombieAI.uproject -run=ZombieVertexAnimationBake -unattended
+ *         [-Mesh=/Game/Models/ZombieJill/jill] [-Idle=/Game/Animations/ZombieJill/Zombie_Idle]
+ *         [-Walk=/Game/Animations/ZombieJill/Zombie_Walk] [-Run=/Game/Animations/ZombieJill/Zombie_Run]
+ *         [-Dying=/Game/Animations/ZombieJill/Zombie_Dying] [-FramesPerSecond=30] [-MaxWidth=4096]
+ *         [-Output=/Game/VertexAnimation/ZombieJill] [-RebuildMaterial]
+ */
+UCLASS()
+class ZOMBIEAI_API UZombieVertexAnimationBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this commandlet's properties.
+	UZombieVertexAnimationBakeCommandlet();
+
+	/**
+	 * Bakes the clips and saves the assets.
+	 */
+	virtual int32 Main(const FString& Params) override;
+
+protected:
+	/**
+	 * Skins every vertex of the skeletal mesh for every frame of the clip and adds the offsets
+	 * from the reference pose and the normals to the frame arrays.
+	 *
+	 * @param Sequence The clip to sample.
+	 * @param bLoop Whether the clip loops, in which case its last frame is left out since it's
+	 * the same as its first.
+	 * @param OutClip Where the clip ended up in the frames.
+	 *
+	 * @return Whether the clip could be sampled.
+	 */
+	bool BakeClip(UAnimSequence* Sequence, bool bLoop, FZombieVertexAnimationClip& OutClip);
+
+	/**
+	 * Creates the position or normal texture from the baked frames.
+	 */
+	UTexture2D* CreateFrameTexture(const FString& PackageName, const TArray<FVector>& Frames) const;
+
+	/**
+	 * Creates the static mesh that the baked animations play back on, with one material slot for
+	 * every material of the skeletal mesh.
+	 */
+	class UStaticMesh* CreateStaticMesh(const FString& PackageName, const TArray<class UMaterialInterface*>& Materials) const;
+
+	/**
+	 * Creates the playback material, which moves every vertex of the static mesh to where it is
+	 * in the current frame of the instance's clip and turns its normal to match.
+	 */
+	UMaterial* CreatePlaybackMaterial(const FString& PackageName) const;
+
+protected:
+	// The skeletal mesh being baked.
+	UPROPERTY(Transient)
+	USkeletalMesh* SkeletalMesh;
+
+	// The frame rate the clips are sampled at.
+	float FramesPerSecond = 30.f;
+
+	// The widest that the textures are allowed to be.
+	int32 MaxTextureWidth = 4096;
+
+	// The number of vertices of the skeletal mesh, the width of the textures and the number of
+	// rows every frame takes up in them.
+	int32 NumVertices = 0;
+	int32 TextureWidth = 0;
+	int32 RowsPerFrame = 0;
+
+	// The number of frames baked so far.
+	int32 NumFrames = 0;
+
+	// The reference pose position and normal of every vertex.
+	TArray<FVector> ReferencePositions;
+	TArray<FVector> ReferenceNormals;
+
+	// The bones and weights of every vertex, `MAX_TOTAL_INFLUENCES` per vertex.
+	TArray<int32> InfluenceBones;
+	TArray<float> InfluenceWeights;
+
+	// The offsets from the reference pose and the normals of every vertex of every frame.
+	TArray<FVector> FrameOffsets;
+	TArray<FVector> FrameNormals;
+
+	// The box that the skinned vertices of every frame fit in.
+	FBox AnimatedBounds;
+};
@@ -0,0 +1,20 @@
+#include "ZombieVertexAnimationData.h"
+
+/**
+ * Returns the clip that's played in the state.
+ */
+const FZombieVertexAnimationClip& UZombieVertexAnimationData::GetClip(ZombieStates State) const
+{
+	switch (State)
+	{
+	case ZombieStates::ROAM:
+		return WalkClip;
+	case ZombieStates::CHASE:
+	case ZombieStates::ATTACK:
+		return RunClip;
+	case ZombieStates::DEAD:
+		return DyingClip;
+	default:
+		return IdleClip;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ZombieCharacter.h"
+#include "ZombieVertexAnimationData.generated.h"
+
+/**
+ * Where one animation clip is in a baked vertex animation texture.
+ */
+USTRUCT(BlueprintType)
+struct FZombieVertexAnimationClip
+{
+	GENERATED_BODY()
+
+	// The first frame of the clip in the vertex animation texture.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	int32 StartFrame = 0;
+
+	// The number of frames of the clip in the vertex animation texture.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	int32 NumFrames = 1;
+
+	// The rate the clip was baked at.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	float FramesPerSecond = 30.f;
+
+	// Whether the clip starts over when it reaches the end or holds its last frame.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	bool bLoop = true;
+};
+
+/**
+ * The ZombieVertexAnimationData describes the ZombieCharacter's animations baked into a vertex
+ * animation texture so that far away zombies can be drawn as instances of a static mesh by the
+ * ZombieImpostorSubsystem instead of being skinned.
+ *
+ * The static mesh, the textures and the material instances that sample them are made from the
+ * Jill skeletal mesh and its Idle, Walk, Run and Dying clips by the
+ * ZombieVertexAnimationBakeCommandlet, which also fills in this asset. The material reads the clip
+ * of every instance from its per-instance custom data:
+ *
+ *   0: The first frame of the clip.
+ *   1: The number of frames in the clip.
+ *   2: The frames per second of the clip.
+ *   3: 1 if the clip loops, 0 if it holds its last frame.
+ *   4: The world time, in seconds, that the clip started playing.
+ */
+UCLASS(BlueprintType)
+class ZOMBIEAI_API UZombieVertexAnimationData : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	// The static mesh that the animations were baked for.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	class UStaticMesh* Mesh;
+
+	// The material that plays the baked animations back. The material slots of `Mesh` use
+	// instances of it that point it at the baked textures.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	class UMaterialInterface* Material;
+
+	// The clip played in the IDLE state.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	FZombieVertexAnimationClip IdleClip;
+
+	// The clip played in the ROAM state.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	FZombieVertexAnimationClip WalkClip;
+
+	// The clip played in the CHASE and ATTACK states.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	FZombieVertexAnimationClip RunClip;
+
+	// The clip played in the DEAD state.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = VertexAnimation)
+	FZombieVertexAnimationClip DyingClip;
+
+	/**
+	 * Returns the clip that's played in the state.
+	 */
+	const FZombieVertexAnimationClip& GetClip(ZombieStates State) const;
+};
@@ -2,4 +2,165 @@
 
 
 #include "ZombieAIGameModeBase.h"
+#include "Zombie/ZombieCharacter.h"
+#include "Zombie/ZombiePoolSubsystem.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerStart.h"
+#include "NavigationSystem.h"
 
+// The number of locations a wave zombie tries to spawn at in one frame before it's left for the
+// next frame.
+static const int32 MaxSpawnLocationAttempts = 4;
+
+/**
+ * Sets default values for this game mode's properties.
+ */
+AZombieAIGameModeBase::AZombieAIGameModeBase()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	ZombieClass = AZombieCharacter::StaticClass();
+}
+
+/**
+ * Called when the game starts.
+ */
+void AZombieAIGameModeBase::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	// Collect the spawn points once since they don't move.
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (It->ActorHasTag(SpawnPointTag)) SpawnPoints.Add(*It);
+	}
+
+	if (SpawnPoints.Num() == 0)
+	{
+		for (TActorIterator<APlayerStart> It(World); It; ++It)
+		{
+			SpawnPoints.Add(*It);
+		}
+	}
+
+	// Give the pool time to warm up before the first wave.
+	TimeUntilNextWave = TimeBetweenWaves;
+}
+
+/**
+ * Called every frame to spawn the zombies of the current wave and pre-warm the pool.
+ */
+void AZombieAIGameModeBase::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (TimeBetweenWaves > 0.f && PendingSpawns == 0)
+	{
+		TimeUntilNextWave -= DeltaSeconds;
+		if (TimeUntilNextWave <= 0.f)
+		{
+			StartWave(FirstWaveSize + WaveNumber * WaveSizeIncrease);
+			TimeUntilNextWave = TimeBetweenWaves;
+		}
+	}
+
+	UWorld* World = GetWorld();
+	UZombiePoolSubsystem* ZombiePool = (World != nullptr) ? World->GetSubsystem<UZombiePoolSubsystem>() : nullptr;
+	if (ZombiePool == nullptr || ZombieClass == nullptr) return;
+
+	const double Deadline = FPlatformTime::Seconds() + SpawnBudgetMs / 1000.0;
+
+	// Spawn the wave first. At least one zombie is spawned every frame so the wave always
+	// finishes, even if the budget is tiny. A zombie that couldn't find anywhere to spawn stays
+	// queued and is tried again next frame.
+	while (PendingSpawns > 0)
+	{
+		if (!SpawnWaveZombie()) break;
+		PendingSpawns--;
+
+		if (FPlatformTime::Seconds() >= Deadline) return;
+	}
+
+	// Spend the rest of the frame's budget getting zombies ready for the next wave. Levels that
+	// don't use waves don't get any pooled zombies.
+	if (!AreWavesEnabled()) return;
+
+	while (ZombiePool->GetNumFree(ZombieClass) < PrewarmCount && FPlatformTime::Seconds() < Deadline)
+	{
+		if (!ZombiePool->AddPooledZombie(ZombieClass)) return;
+	}
+}
+
+/**
+ * Queues a wave of zombies to be spawned over the next frames.
+ *
+ * @param NumZombies The number of zombies in the wave.
+ */
+void AZombieAIGameModeBase::StartWave(int32 NumZombies)
+{
+	if (NumZombies <= 0) return;
+
+	PendingSpawns += NumZombies;
+	WaveNumber++;
+}
+
+/**
+ * Returns whether this level uses waves, either because they start on their own or because
+ * `StartWave` has been called.
+ */
+bool AZombieAIGameModeBase::AreWavesEnabled() const
+{
+	return TimeBetweenWaves > 0.f || WaveNumber > 0;
+}
+
+/**
+ * Takes a zombie from the pool and puts it at a random spawn point. A few spawn points are
+ * tried before giving up.
+ *
+ * @return Whether a zombie was spawned.
+ */
+bool AZombieAIGameModeBase::SpawnWaveZombie()
+{
+	UWorld* World = GetWorld();
+	UZombiePoolSubsystem* ZombiePool = (World != nullptr) ? World->GetSubsystem<UZombiePoolSubsystem>() : nullptr;
+	if (ZombiePool == nullptr) return false;
+
+	FVector Location;
+	bool bFoundLocation = false;
+	for (int32 Attempt = 0; Attempt < MaxSpawnLocationAttempts && !bFoundLocation; ++Attempt)
+	{
+		bFoundLocation = ChooseSpawnLocation(Location);
+	}
+	if (!bFoundLocation) return false;
+
+	// Lift the zombie up so that its capsule starts above the navmesh instead of in the floor.
+	const AZombieCharacter* DefaultZombie = ZombieClass->GetDefaultObject<AZombieCharacter>();
+	const float HalfHeight = DefaultZombie->GetSimpleCollisionHalfHeight();
+	const FRotator Rotation(0.f, FMath::FRandRange(0.f, 360.f), 0.f);
+
+	return ZombiePool->Acquire(ZombieClass, FTransform(Rotation, Location + FVector(0.f, 0.f, HalfHeight))) != nullptr;
+}
+
+/**
+ * Picks a location on the navmesh around a random spawn point.
+ */
+bool AZombieAIGameModeBase::ChooseSpawnLocation(FVector& OutLocation) const
+{
+	if (SpawnPoints.Num() == 0) return false;
+
+	const AActor* SpawnPoint = SpawnPoints[FMath::RandHelper(SpawnPoints.Num())];
+	if (SpawnPoint == nullptr) return false;
+
+	UNavigationSystemV1* NavigationSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavigationSystem == nullptr) return false;
+
+	FNavLocation NavLocation;
+	if (!NavigationSystem->GetRandomPointInNavigableRadius(SpawnPoint->GetActorLocation(), SpawnRadius, NavLocation)) return false;
+
+	OutLocation = NavLocation.Location;
+	return true;
+}
@@ -6,12 +6,121 @@
 #include "GameFramework/GameModeBase.h"
 #include "ZombieAIGameModeBase.generated.h"
 
+class AZombieCharacter;
+
 /**
- * 
+ * The game mode spawns the zombies in waves. A wave is only queued when it starts, and the
+ * zombies in it are brought into play a few at a time every frame under `SpawnBudgetMs`, so a
+ * big wave never has to be constructed in one frame. Once waves are enabled, any time left over
+ * in a frame is spent pre-warming the ZombiePoolSubsystem, so that by the time a wave starts most of its zombies
+ * and their controllers already exist and only have to be woken up. Zombies that die go back
+ * to the pool and are reused by later waves.
  */
 UCLASS()
 class ZOMBIEAI_API AZombieAIGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
-	
+
+public:
+	// Sets default values for this game mode's properties.
+	AZombieAIGameModeBase();
+
+	// The class of ZombieCharacter that the waves are made of.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	TSubclassOf<AZombieCharacter> ZombieClass;
+
+	// The number of zombies that should be waiting in the pool before the next wave starts. The
+	// pool is only filled once waves are enabled, see `AreWavesEnabled`.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	int32 PrewarmCount = 64;
+
+	// The number of milliseconds per frame that can be spent spawning and pre-warming zombies.
+	// At least one zombie of a wave is spawned every frame so waves always finish.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	float SpawnBudgetMs = 1.f;
+
+	// The number of zombies in the first wave, and the number added to every wave after it.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	int32 FirstWaveSize = 20;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	int32 WaveSizeIncrease = 10;
+
+	// The number of seconds between the end of one wave's spawning and the start of the next
+	// wave. If set to 0 waves only start when `StartWave` is called, which is the default so that
+	// levels only get waves when they ask for them.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	float TimeBetweenWaves = 0.f;
+
+	// Zombies spawn around the actors with this tag, or around the player starts if there are none.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	FName SpawnPointTag = TEXT("ZombieSpawn");
+
+	// How far from a spawn point a zombie can spawn.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves)
+	float SpawnRadius = 500.f;
+
+	/**
+	 * Called every frame to spawn the zombies of the current wave and pre-warm the pool.
+	 */
+	virtual void Tick(float DeltaSeconds) override;
+
+	/**
+	 * Queues a wave of zombies to be spawned over the next frames.
+	 *
+	 * @param NumZombies The number of zombies in the wave.
+	 */
+	UFUNCTION(BlueprintCallable, Category = Waves)
+	void StartWave(int32 NumZombies);
+
+	/**
+	 * Returns the number of waves that have been started.
+	 */
+	UFUNCTION(BlueprintPure, Category = Waves)
+	int32 GetWaveNumber() const { return WaveNumber; }
+
+	/**
+	 * Returns the number of zombies of the current wave that haven't been spawned yet.
+	 */
+	UFUNCTION(BlueprintPure, Category = Waves)
+	int32 GetPendingSpawnCount() const { return PendingSpawns; }
+
+protected:
+	/**
+	 * Called when the game starts.
+	 */
+	virtual void BeginPlay() override;
+
+	/**
+	 * Returns whether this level uses waves, either because they start on their own or because
+	 * `StartWave` has been called.
+	 */
+	bool AreWavesEnabled() const;
+
+	/**
+	 * Takes a zombie from the pool and puts it at a random spawn point. A few spawn points are
+	 * tried before giving up.
+	 *
+	 * @return Whether a zombie was spawned.
+	 */
+	bool SpawnWaveZombie();
+
+	/**
+	 * Picks a location on the navmesh around a random spawn point.
+	 */
+	bool ChooseSpawnLocation(FVector& OutLocation) const;
+
+protected:
+	// The actors that zombies spawn around.
+	UPROPERTY(Transient)
+	TArray<AActor*> SpawnPoints;
+
+	// The number of zombies of the current wave that haven't been spawned yet.
+	int32 PendingSpawns = 0;
+
+	// The number of waves that have been started.
+	int32 WaveNumber = 0;
+
+	// The time left until the next wave starts.
+	float TimeUntilNextWave = 0.f;
 };
@@ -0,0 +1,161 @@
+#include "ZombieAIReplicationGraph.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/Actor.h"
+#include "UObject/UObjectIterator.h"
+
+/**
+ * Sets how often the actor is replicated, for things like the ZombieReplicationSubsystem's
+ * tiers that change it while the actor is in play.
+ *
+ * @param Actor The actor to change.
+ * @param Frequency The number of times per second the actor should be replicated.
+ */
+void UZombieAIReplicationGraph::SetReplicationFrequency(AActor* Actor, float Frequency)
+{
+	FGlobalActorReplicationInfo* GlobalInfo = GlobalActorReplicationInfoMap.Find(Actor);
+	if (GlobalInfo == nullptr) return;
+
+	const uint16 PeriodFrame = GetReplicationPeriodFrameForFrequency(Frequency);
+	GlobalInfo->Settings.ReplicationPeriodFrame = PeriodFrame;
+
+	// Every connection keeps its own copy of the period from when it first saw the actor, so
+	// the copies have to be changed too.
+	for (UNetReplicationGraphConnection* Connection : Connections)
+	{
+		FConnectionReplicationActorInfo* ConnectionInfo = (Connection != nullptr) ? Connection->ActorInfoMap.Find(Actor) : nullptr;
+		if (ConnectionInfo != nullptr) ConnectionInfo->ReplicationPeriodFrame = PeriodFrame;
+	}
+}
+
+/**
+ * Sets up how often and how far away the actors of every replicated class are replicated,
+ * from the values on their class defaults.
+ */
+void UZombieAIReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject(false));
+		if (ActorCDO == nullptr || !ActorCDO->GetIsReplicated()) continue;
+
+		// Skip the temporary classes made while blueprints compile.
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_"))) continue;
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+
+		// Actors that aren't placed in the grid don't have a distance to be culled at.
+		const bool bSpatialized = !ActorCDO->bAlwaysRelevant && !ActorCDO->bOnlyRelevantToOwner;
+		ClassInfo.SetCullDistanceSquared(bSpatialized ? ActorCDO->NetCullDistanceSquared : 0.f);
+
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+/**
+ * Creates the nodes shared by every connection.
+ */
+void UZombieAIReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = GridSpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+/**
+ * Creates the list of the actors that are only relevant to the connection's owner.
+ */
+void UZombieAIReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* OwnerRelevantNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(OwnerRelevantNode, RepGraphConnection);
+
+	OwnerRelevantNodes.Add(RepGraphConnection->NetConnection, OwnerRelevantNode);
+}
+
+/**
+ * Puts a newly replicated actor in the node it's relevant through.
+ */
+void UZombieAIReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	if (ActorInfo.Actor->bAlwaysRelevant)
+	{
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+	}
+	else if (ActorInfo.Actor->bOnlyRelevantToOwner)
+	{
+		ActorsWithoutNetConnection.Add(ActorInfo.Actor);
+	}
+	else
+	{
+		// Actors don't say whether they move, so every actor in the grid is treated as moving
+		// while it's awake and as standing still while it's dormant, like pooled zombies.
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+	}
+}
+
+/**
+ * Takes an actor that stopped being replicated out of the node it was in.
+ */
+void UZombieAIReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	if (ActorInfo.Actor->bAlwaysRelevant)
+	{
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+	}
+	else if (ActorInfo.Actor->bOnlyRelevantToOwner)
+	{
+		ActorsWithoutNetConnection.Remove(ActorInfo.Actor);
+
+		UReplicationGraphNode_AlwaysRelevant_ForConnection** OwnerRelevantNode = OwnerRelevantNodes.Find(ActorInfo.Actor->GetNetConnection());
+		if (OwnerRelevantNode != nullptr) (*OwnerRelevantNode)->NotifyRemoveNetworkActor(ActorInfo);
+	}
+	else
+	{
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+	}
+}
+
+/**
+ * Forgets the list of a connection that closed.
+ */
+void UZombieAIReplicationGraph::RemoveClientConnection(UNetConnection* NetConnection)
+{
+	OwnerRelevantNodes.Remove(NetConnection);
+
+	Super::RemoveClientConnection(NetConnection);
+}
+
+/**
+ * Moves the actors that got a connection since the last frame into that connection's list,
+ * then replicates the actors to every connection.
+ */
+int32 UZombieAIReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	for (int32 Index = ActorsWithoutNetConnection.Num() - 1; Index >= 0; --Index)
+	{
+		AActor* Actor = ActorsWithoutNetConnection[Index];
+		UNetConnection* Connection = (Actor != nullptr) ? Actor->GetNetConnection() : nullptr;
+		if (Actor != nullptr && Connection == nullptr) continue;
+
+		if (Connection != nullptr)
+		{
+			UReplicationGraphNode_AlwaysRelevant_ForConnection** OwnerRelevantNode = OwnerRelevantNodes.Find(Connection);
+			if (OwnerRelevantNode != nullptr) (*OwnerRelevantNode)->NotifyAddNetworkActor(FNewReplicatedActorInfo(Actor));
+		}
+
+		ActorsWithoutNetConnection.RemoveAtSwap(Index, 1, false);
+	}
+
+	return Super::ServerReplicateActors(DeltaSeconds);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "ZombieAIReplicationGraph.generated.h"
+
+class UReplicationGraphNode_ActorList;
+class UReplicationGraphNode_AlwaysRelevant_ForConnection;
+class UReplicationGraphNode_GridSpatialization2D;
+
+/**
+ * The replication graph decides which actors are sent to each client. Instead of testing every
+ * replicated actor against every connection each frame, actors are put into a 2D grid of
+ * cells covering the areas they're relevant within, and each connection only looks at the
+ * actors in the cell its viewer is in. The cost per connection grows with the zombies near the
+ * player, not with the size of the whole horde.
+ *
+ * Actors that are relevant to everyone, like the game state, are kept in one list, and actors
+ * that are only relevant to their owner, like player controllers, in a list for each connection.
+ *
+ * It's set as the replication driver of the game net driver in DefaultEngine.ini. Clearing
+ * `ReplicationDriverClassName` there goes back to the default relevancy to compare against.
+ */
+UCLASS(Transient, config = Engine)
+class ZOMBIEAI_API UZombieAIReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	// The size of a cell of the grid. It's about the cull distance of a zombie so that each
+	// zombie is only in a few cells.
+	UPROPERTY(Config)
+	float GridCellSize = 8000.f;
+
+	// The corner of the grid. Actors beyond it are put in the edge cells.
+	UPROPERTY(Config)
+	FVector2D GridSpatialBias = FVector2D(-200000.f, -200000.f);
+
+	/**
+	 * Sets how often the actor is replicated, for things like the ZombieReplicationSubsystem's
+	 * tiers that change it while the actor is in play.
+	 *
+	 * @param Actor The actor to change.
+	 * @param Frequency The number of times per second the actor should be replicated.
+	 */
+	void SetReplicationFrequency(AActor* Actor, float Frequency);
+
+	// UReplicationGraph
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual void RemoveClientConnection(UNetConnection* NetConnection) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+protected:
+	// The grid of every actor that's relevant within a distance.
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	// The actors that are relevant to every connection.
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	// The list of actors only relevant to the owner of each connection.
+	UPROPERTY()
+	TMap<UNetConnection*, UReplicationGraphNode_AlwaysRelevant_ForConnection*> OwnerRelevantNodes;
+
+	// Actors that are only relevant to their owner but don't have a connection yet. They're
+	// moved to their connection's list once they get one.
+	UPROPERTY()
+	TArray<AActor*> ActorsWithoutNetConnection;
+};
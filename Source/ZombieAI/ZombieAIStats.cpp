@@ -0,0 +1,40 @@
+#include "ZombieAIStats.h"
+
+DEFINE_STAT(STAT_ZombieAI_ControllerTick);
+DEFINE_STAT(STAT_ZombieAI_OnTargetPerceptionUpdate);
+DEFINE_STAT(STAT_ZombieAI_OnMoveCompleted);
+DEFINE_STAT(STAT_ZombieAI_Think);
+DEFINE_STAT(STAT_ZombieAI_Roam);
+DEFINE_STAT(STAT_ZombieAI_Chase);
+DEFINE_STAT(STAT_ZombieAI_SendEvents);
+DEFINE_STAT(STAT_ZombieAI_MovementTick);
+DEFINE_STAT(STAT_ZombieAI_Steering);
+DEFINE_STAT(STAT_ZombieAI_SimpleMovement);
+DEFINE_STAT(STAT_ZombieAI_BuildFlowField);
+DEFINE_STAT(STAT_ZombieAI_UpdateAnimationProperties);
+DEFINE_STAT(STAT_ZombieAI_OnBulletHitComponent);
+DEFINE_STAT(STAT_ZombieAI_Timers);
+DEFINE_STAT(STAT_ZombieAI_AttackRange);
+DEFINE_STAT(STAT_ZombieAI_ApplyDamage);
+DEFINE_STAT(STAT_ZombieAI_AreaDamage);
+DEFINE_STAT(STAT_ZombieAI_Replication);
+DEFINE_STAT(STAT_ZombieAI_RecordPoses);
+DEFINE_STAT(STAT_ZombieAI_RewindTrace);
+DEFINE_STAT(STAT_ZombieAI_IdleZombies);
+DEFINE_STAT(STAT_ZombieAI_RoamingZombies);
+DEFINE_STAT(STAT_ZombieAI_ChasingZombies);
+DEFINE_STAT(STAT_ZombieAI_AttackingZombies);
+DEFINE_STAT(STAT_ZombieAI_DeadZombies);
+DEFINE_STAT(STAT_ZombieAI_Transitions);
+DEFINE_STAT(STAT_ZombieAI_TransitionsPerSecond);
+DEFINE_STAT(STAT_ZombieAI_PathRequests);
+DEFINE_STAT(STAT_ZombieAI_PerceptionEvents);
+DEFINE_STAT(STAT_ZombieAI_ActiveTimers);
+DEFINE_STAT(STAT_ZombieAI_ExpiredTimers);
+DEFINE_STAT(STAT_ZombieAI_Hits);
+DEFINE_STAT(STAT_ZombieAI_Deaths);
+DEFINE_STAT(STAT_ZombieAI_RelevantZombies);
+DEFINE_STAT(STAT_ZombieAI_NetBytesPerZombie);
+DEFINE_STAT(STAT_ZombieAI_PoseHistoryMemory);
+
+UE_TRACE_CHANNEL_DEFINE(ZombieAIChannel);
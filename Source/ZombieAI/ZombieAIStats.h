@@ -0,0 +1,83 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/**
+ * The stats of the zombie AI, shown in game with `stat ZombieAI` and recorded in headless runs
+ * with `stat startfile` and `stat stopfile`.
+ */
+DECLARE_STATS_GROUP(TEXT("ZombieAI"), STATGROUP_ZombieAI, STATCAT_Advanced);
+
+// The time spent in the hot paths of the zombies.
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Controller Tick"), STAT_ZombieAI_ControllerTick, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnTargetPerceptionUpdate"), STAT_ZombieAI_OnTargetPerceptionUpdate, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnMoveCompleted"), STAT_ZombieAI_OnMoveCompleted, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Think"), STAT_ZombieAI_Think, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Roam"), STAT_ZombieAI_Roam, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Chase"), STAT_ZombieAI_Chase, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Send State Events"), STAT_ZombieAI_SendEvents, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Movement Tick"), STAT_ZombieAI_MovementTick, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Steering"), STAT_ZombieAI_Steering, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Simple Movement"), STAT_ZombieAI_SimpleMovement, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Flow Field"), STAT_ZombieAI_BuildFlowField, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateAnimationProperties"), STAT_ZombieAI_UpdateAnimationProperties, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnBulletHitComponent"), STAT_ZombieAI_OnBulletHitComponent, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Timer Wheel"), STAT_ZombieAI_Timers, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Attack Range"), STAT_ZombieAI_AttackRange, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Damage"), STAT_ZombieAI_ApplyDamage, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Area Damage"), STAT_ZombieAI_AreaDamage, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Replication Tiers"), STAT_ZombieAI_Replication, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Record Poses"), STAT_ZombieAI_RecordPoses, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rewind Trace"), STAT_ZombieAI_RewindTrace, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+// The number of zombies in each state.
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Idle Zombies"), STAT_ZombieAI_IdleZombies, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Roaming Zombies"), STAT_ZombieAI_RoamingZombies, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Chasing Zombies"), STAT_ZombieAI_ChasingZombies, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Attacking Zombies"), STAT_ZombieAI_AttackingZombies, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Dead Zombies"), STAT_ZombieAI_DeadZombies, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+// The number of state transitions in the last frame and over the last second.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("State Transitions"), STAT_ZombieAI_Transitions, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("State Transitions/s"), STAT_ZombieAI_TransitionsPerSecond, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+// The number of paths asked of the navigation system and of perception events in the last frame.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Path Requests"), STAT_ZombieAI_PathRequests, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Perception Events"), STAT_ZombieAI_PerceptionEvents, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+// The number of zombie delays that are waiting and that expired in the last frame.
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Timers"), STAT_ZombieAI_ActiveTimers, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Expired Timers"), STAT_ZombieAI_ExpiredTimers, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+// The number of hits zombies took and the number of zombies that died in the last frame.
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits"), STAT_ZombieAI_Hits, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Deaths"), STAT_ZombieAI_Deaths, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+// The number of zombies relevant to the clients, added up over every client, and the bytes sent
+// per relevant zombie per second.
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Net Relevant Zombies"), STAT_ZombieAI_RelevantZombies, STATGROUP_ZombieAI, ZOMBIEAI_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Net Bytes/Zombie/s"), STAT_ZombieAI_NetBytesPerZombie, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+// The memory taken up by the zombie pose history that shots are rewound against.
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Pose History Memory"), STAT_ZombieAI_PoseHistoryMemory, STATGROUP_ZombieAI, ZOMBIEAI_API);
+
+/**
+ * The Unreal Insights channel of the zombie AI. Captures include it with `-trace=cpu,ZombieAI`.
+ */
+UE_TRACE_CHANNEL_EXTERN(ZombieAIChannel, ZOMBIEAI_API);
+
+/**
+ * Times the rest of the scope under the stat in `stat ZombieAI` and as an event on the ZombieAI
+ * trace channel.
+ */
+#if CPUPROFILERTRACE_ENABLED
+#define ZOMBIE_AI_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, ZombieAIChannel)
+#else
+#define ZOMBIE_AI_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat)
+#endif